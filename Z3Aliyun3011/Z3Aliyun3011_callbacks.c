@@ -8,12 +8,23 @@
 #include <string.h>
 
 #include "app/framework/include/af.h"
+#include <kernel/include/os.h>
 #include "app/framework/plugin/network-creator/network-creator.h"
 #include "device-table/device-table.h"
 
 #include "wifi/wgm110.h"
 #include "iotkit-embedded-sdk/aliyun_main.h"
 #include "iotkit-embedded-sdk/wrappers/wrappers_defs.h"
+#ifdef INFRA_TRACE
+#include "iotkit-embedded-sdk/infra/infra_trace.h"
+#endif
+#ifdef INFRA_DLOG
+#include "iotkit-embedded-sdk/infra/infra_dlog.h"
+#endif
+#ifdef OTA_RELAY_ENABLED
+#include "iotkit-embedded-sdk/ota_relay/ota_relay_api.h"
+#endif
+#include "ota-relay/ota-relay-server.h"
 
 extern int HAL_Timer_Task_Init();
 extern uint8_t *emAfZclBuffer;
@@ -30,6 +41,7 @@ EmberEventControl pollAttrEventControl;
 EmberEventControl clearWiFiEventControl;
 EmberEventControl addSubDevEventControl;
 EmberEventControl formNetworkRetryEventControl;
+EmberEventControl otaRelayEventControl;
 
 typedef struct
 {
@@ -49,8 +61,6 @@ void emberAfPollAttrByDeviceTable()
 {
     EmberStatus status;
     uint8_t attributeIdBuffer[2];
-    EmberAfPluginDeviceTableEntry *deviceTable = emberAfDeviceTablePointer();
-    uint8_t  i;
     
     attributeIdBuffer[0] = LOW_BYTE(g_polllist[g_current_poll_index].attrID);
     attributeIdBuffer[1] = HIGH_BYTE(g_polllist[g_current_poll_index].attrID);
@@ -77,26 +87,6 @@ void emberAfPollAttrByDeviceTable()
                                                                              status);
 
     g_current_poll_index = (g_current_poll_index + 1) % (sizeof(g_polllist) / sizeof(PollItem_S));
-
-    for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE; i++) {
-        if (EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID == deviceTable[i].nodeId ||
-            EMBER_AF_PLUGIN_DEVICE_TABLE_STATE_JOINED != deviceTable[i].state ||
-            (DEMO_Z3DIMMERLIGHT != deviceTable[i].deviceId &&
-             DEMO_Z3CURTAIN != deviceTable[i].deviceId)) {
-            continue;
-        }
-
-        deviceTable[i].keepalive_failcnt++;
-        if (deviceTable[i].keepalive_failcnt > 2 * (sizeof(g_polllist) / sizeof(PollItem_S))) {
-            
-            if (0 != deviceTable[i].online) {
-                emberEventControlSetActive(addSubDevEventControl);    
-            }
-            
-            deviceTable[i].online = 0;
-            deviceTable[i].keepalive_failcnt = 0;
-        }
-    }
 }
 
 void pollAttrEventHandler()
@@ -128,7 +118,6 @@ void clearWiFiEventHandler()
 void addSubDevEventHandler()
 {
     uint8_t     cloud_oper_cnt = 0;
-    EmberEUI64  nulleui64 = {0xFF};
     
     emberEventControlSetInactive(addSubDevEventControl);
     
@@ -138,33 +127,28 @@ void addSubDevEventHandler()
     }
 
     EmberAfPluginDeviceTableEntry *deviceTable = emberAfDeviceTablePointer();
-    uint8_t i;
-
-    memset(nulleui64, 0xFF, sizeof(nulleui64));
-    for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE; i++) {
-        if (EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID != deviceTable[i].nodeId &&
-            EMBER_AF_PLUGIN_DEVICE_TABLE_STATE_JOINED == deviceTable[i].state &&
-            0 != memcmp(nulleui64, deviceTable[i].eui64, sizeof(nulleui64)) &&
-            (DEMO_Z3DIMMERLIGHT == deviceTable[i].deviceId ||
-             DEMO_Z3CURTAIN == deviceTable[i].deviceId)) {
-            
-            if (deviceTable[i].cloud_devid <= 0 &&
-                deviceTable[i].online == 1) {
-                aliyun_add_subdev(deviceTable[i].eui64, 
-                                  deviceTable[i].endpoint, 
-                                  deviceTable[i].deviceId, 
-                                  &deviceTable[i].cloud_devid);
-                cloud_oper_cnt++;
-            } else if (deviceTable[i].cloud_devid > 0 && 
-                       deviceTable[i].online != 1) {
-                emberAfCorePrintln("[%d] node %X ep %d cloudid=%d", i, 
-                                                                    deviceTable[i].nodeId,
-                                                                    deviceTable[i].endpoint,
-                                                                    deviceTable[i].cloud_devid);
-                aliyun_del_subdev(deviceTable[i].cloud_devid);
-                deviceTable[i].cloud_devid = -1;
-                cloud_oper_cnt++;
-            }
+    EmberAfPluginDeviceTableLiveness *liveness = emberAfDeviceTableLivenessPointer();
+    uint16_t i;
+
+    for (i = emberAfDeviceTableGetNextJoinedSupportedIndex(0);
+         i != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+         i = emberAfDeviceTableGetNextJoinedSupportedIndex(i + 1)) {
+        if (deviceTable[i].cloud_devid <= 0 &&
+            liveness[i].online == 1) {
+            aliyun_add_subdev(deviceTable[i].eui64, 
+                              deviceTable[i].endpoint, 
+                              deviceTable[i].deviceId, 
+                              &deviceTable[i].cloud_devid);
+            cloud_oper_cnt++;
+        } else if (deviceTable[i].cloud_devid > 0 && 
+                   liveness[i].online != 1) {
+            emberAfCorePrintln("[%d] node %X ep %d cloudid=%d", i, 
+                                                                deviceTable[i].nodeId,
+                                                                deviceTable[i].endpoint,
+                                                                deviceTable[i].cloud_devid);
+            aliyun_del_subdev(deviceTable[i].cloud_devid);
+            deviceTable[i].cloud_devid = -1;
+            cloud_oper_cnt++;
         }
 
         if (cloud_oper_cnt >= 4) {
@@ -189,6 +173,14 @@ void formNetworkRetryEventHandler()
     }
 }
 
+void otaRelayEventHandler()
+{
+    emberEventControlSetInactive(otaRelayEventControl);
+#ifdef OTA_RELAY_ENABLED
+    otaRelayServerTick();
+#endif
+}
+
 void emberAfHalButtonIsrCallback(int8u button, int8u state)
 {
     if (BUTTON0 == button) {
@@ -245,6 +237,16 @@ void emberAfPluginMicriumRtosAppTask1InitCallback(void)
         halReboot();
 		return;
 	}
+
+#ifdef INFRA_DLOG
+    if (0 != iotx_dlog_init()) {
+        printf("[%s][%d]init dlog failed", __func__, __LINE__);
+    }
+#endif
+
+#ifdef OTA_RELAY_ENABLED
+    otaRelayServerInit();
+#endif
 }
 
 /** @brief
@@ -295,18 +297,13 @@ void emberAfPluginDeviceTableNewDeviceCallback(EmberEUI64 eui64)
     //emberEventControlSetDelayMS(addSubDevEventControl, 5000);
     
     EmberAfPluginDeviceTableEntry *deviceTable = emberAfDeviceTablePointer();
-    uint8_t i;
+    uint16_t i;
 
-    
-    for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE; i++) {
-        if (EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID != deviceTable[i].nodeId &&
-            EMBER_AF_PLUGIN_DEVICE_TABLE_STATE_JOINED == deviceTable[i].state) {
-            if (0 == MEMCOMPARE(eui64, deviceTable[i].eui64, EUI64_SIZE)) {
-                deviceTable[i].online = 1;
-                deviceTable[i].keepalive_failcnt = 0;
-                deviceTable[i].keepalive_seq = 0;
-                deviceTable[i].cloud_devid = -1;
-            }
+    for (i = emberAfDeviceTableGetFirstIndexFromEui64(eui64);
+         i != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+         i = emberAfDeviceTableGetNextEndpointIndex(i)) {
+        if (EMBER_AF_PLUGIN_DEVICE_TABLE_STATE_JOINED == deviceTable[i].state) {
+            deviceTable[i].cloud_devid = -1;
         }
     }
 }
@@ -316,20 +313,28 @@ void emberAfPluginDeviceTableDeviceLeftCallback(EmberEUI64 eui64)
     //emberEventControlSetDelayMS(addSubDevEventControl, 5000);
     
     EmberAfPluginDeviceTableEntry *deviceTable = emberAfDeviceTablePointer();
-    uint8_t i;
-
-    for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE; i++) {
-        if (EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID != deviceTable[i].nodeId &&
-            EMBER_AF_PLUGIN_DEVICE_TABLE_STATE_JOINED == deviceTable[i].state) {
-            if (0 == MEMCOMPARE(eui64, deviceTable[i].eui64, EUI64_SIZE)) {
-                deviceTable[i].online = 0;
-                deviceTable[i].keepalive_failcnt = 0xFF;
-                deviceTable[i].keepalive_seq = 0;
-            }
+    uint16_t i;
+
+    for (i = emberAfDeviceTableGetFirstIndexFromEui64(eui64);
+         i != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+         i = emberAfDeviceTableGetNextEndpointIndex(i)) {
+        if (EMBER_AF_PLUGIN_DEVICE_TABLE_STATE_JOINED == deviceTable[i].state) {
+            emberAfDeviceTableSetOffline(i);
         }
     }
 }
 
+bool emberAfPluginDeviceTableSupportedDeviceCallback(uint16_t deviceId)
+{
+    return (DEMO_Z3DIMMERLIGHT == deviceId || DEMO_Z3CURTAIN == deviceId);
+}
+
+void emberAfPluginDeviceTableLivenessChangedCallback(uint16_t index, bool online)
+{
+    /* add or delete the sub device in the cloud as it comes and goes */
+    emberEventControlSetActive(addSubDevEventControl);
+}
+
 boolean emberAfReadAttributesResponseCallback(EmberAfClusterId clusterId, int8u *buffer, int16u bufLen)
 {
     EmberNodeId nodeID;
@@ -343,13 +348,6 @@ boolean emberAfReadAttributesResponseCallback(EmberAfClusterId clusterId, int8u
         return false;
     }
 
-    if (1 != deviceTable[index].online) {
-        emberEventControlSetActive(addSubDevEventControl);    
-    }
-    
-    deviceTable[index].online = 1;
-    deviceTable[index].keepalive_failcnt = 0;
-
     if (ZCL_ON_OFF_CLUSTER_ID == clusterId) {
         EmberAfAttributeId attributeId = (EmberAfAttributeId)emberAfGetInt16u(buffer, 0, bufLen);
         EmberAfStatus status = (EmberAfStatus)emberAfGetInt8u(buffer, 2, bufLen);
@@ -398,6 +396,21 @@ boolean emberAfReadAttributesResponseCallback(EmberAfClusterId clusterId, int8u
     return false;
 }
 
+/** @brief Pre Command Received
+ *
+ * The ota-server plugin is not in this build, the commands of the OTA
+ * clients are served by the OTA relay server.
+ */
+bool emberAfPreCommandReceivedCallback(EmberAfClusterCommand* cmd)
+{
+#if defined(OTA_RELAY_ENABLED) && !defined(EMBER_AF_PLUGIN_OTA_SERVER)
+    if (otaRelayServerCommandReceived(cmd)) {
+        return true;
+    }
+#endif
+    return false;
+}
+
 static void kv_show(void)
 {
 	uint8_t i;
@@ -483,6 +496,198 @@ static void em_txpower20(void)
     halCommonSetToken(TOKEN_STACK_NODE_DATA, &data);
 }
 
+static void stats_cloud(void)
+{
+    aliyun_show_stats();
+}
+
+static void stats_wifi(void)
+{
+    uint8_t    i;
+    WiFi_Stats stats;
+
+    if (WLAN_ERR_NONE != wifi_get_stats(&stats)) {
+        printf("wifi not initialized\r\n");
+        return;
+    }
+
+    for (i = 0; i < MAX_EP_SIMULTANEOUS_NUM; i++) {
+        printf("ep slot %d: %s ep=%d rx %d/%d high-water %d drops %lu\r\n",
+               i,
+               stats.ep[i].used ? "used" : "free",
+               stats.ep[i].endpoint,
+               stats.ep[i].rx_len,
+               stats.ep[i].rx_size,
+               stats.ep[i].rx_high_water,
+               (unsigned long)stats.ep[i].rx_drops);
+    }
+    printf("udp queue: %d/%d high-water %d drops %lu\r\n",
+           stats.udp_used, stats.udp_size, stats.udp_high_water, (unsigned long)stats.udp_drops);
+    printf("dns cache hits %lu resolves %lu, tls cert uploads %lu skipped %lu\r\n",
+           (unsigned long)stats.dns_hits, (unsigned long)stats.dns_resolves,
+           (unsigned long)stats.tls_cert_uploads, (unsigned long)stats.tls_cert_skips);
+}
+
+static void stats_heap(void)
+{
+    uint8_t          i;
+    hal_heap_stats_t stats;
+
+    HAL_Heap_GetStats(&stats);
+    printf("heap: in use %lu peak %lu failures %lu\r\n",
+           (unsigned long)stats.in_use, (unsigned long)stats.peak, (unsigned long)stats.failures);
+    for (i = 0; i < HAL_HEAP_SIZE_CLASSES; i++) {
+        if (0 != stats.size_class[i].limit) {
+            printf("  <=%-5lu", (unsigned long)stats.size_class[i].limit);
+        } else {
+            printf("  >%-6lu", (unsigned long)stats.size_class[i - 1].limit);
+        }
+        printf(" blocks %-4lu bytes %-6lu peak %lu\r\n",
+               (unsigned long)stats.size_class[i].blocks,
+               (unsigned long)stats.size_class[i].bytes,
+               (unsigned long)stats.size_class[i].peak_bytes);
+    }
+}
+
+static void stats_timer(void)
+{
+    hal_timer_stats_t stats;
+
+    HAL_Timer_GetStats(&stats);
+    printf("timer slots: %d/%d running %d peak %d\r\n", stats.used, stats.slots, stats.running, stats.peak);
+}
+
+static void stats_task(void)
+{
+    OS_TCB       *ptcb;
+    CPU_STK_SIZE  stkfree;
+    CPU_STK_SIZE  stkused;
+    RTOS_ERR      err;
+
+    /*keep tasks from being deleted under the walk  */
+    OSSchedLock(&err);
+    for (ptcb = OSTaskDbgListPtr; NULL != ptcb; ptcb = ptcb->DbgNextPtr) {
+        OSTaskStkChk(ptcb, &stkfree, &stkused, &err);
+        if (RTOS_ERR_CODE_GET(err) != RTOS_ERR_NONE) {
+            printf("%-16s stack check failed %d\r\n", ptcb->NamePtr, RTOS_ERR_CODE_GET(err));
+            continue;
+        }
+        printf("%-16s stack used %lu/%lu bytes\r\n",
+               ptcb->NamePtr,
+               (unsigned long)(stkused * sizeof(CPU_STK)),
+               (unsigned long)((stkused + stkfree) * sizeof(CPU_STK)));
+    }
+    OSSchedUnlock(&err);
+}
+
+#ifdef INFRA_DLOG
+static void stats_dlog(void)
+{
+    iotx_dlog_stats_t stats;
+
+    iotx_dlog_get_stats(&stats);
+    printf("dlog: recorded %lu dropped %lu ring %lu/%lu words high-water %lu\r\n",
+           (unsigned long)stats.recorded,
+           (unsigned long)stats.dropped,
+           (unsigned long)stats.used_words,
+           (unsigned long)stats.ring_words,
+           (unsigned long)stats.high_water_words);
+}
+#endif
+
+#ifdef OTA_RELAY_ENABLED
+static void stats_otarelay(void)
+{
+    static const char * const states[] = {"idle", "fetching", "ready", "failed"};
+    iotx_ota_relay_stats_t stats;
+    iotx_ota_relay_image_t image;
+    OtaRelayServerStats    server;
+
+    IOT_OtaRelay_GetStats(&stats);
+    printf("ota relay: %s %lu/%lu bytes fetched %lu in %lu requests, %lu resumed, %lu verify failures\r\n",
+           states[stats.state],
+           (unsigned long)stats.stored,
+           (unsigned long)stats.size,
+           (unsigned long)stats.fetch_bytes,
+           (unsigned long)stats.fetch_requests,
+           (unsigned long)stats.resumes,
+           (unsigned long)stats.verify_failures);
+    printf("  link %lu bytes/s chunk %lu\r\n",
+           (unsigned long)stats.fetch_rate,
+           (unsigned long)stats.chunk_size);
+    if (0 == IOT_OtaRelay_GetImage(&image)) {
+        printf("  image mfg 0x%04X type 0x%04X version 0x%08lX size %lu\r\n",
+               image.manufacturer_id,
+               image.image_type,
+               (unsigned long)image.file_version,
+               (unsigned long)image.image_size);
+    }
+    printf("  cache reads %lu bytes %lu page hits %lu misses %lu\r\n",
+           (unsigned long)stats.reads,
+           (unsigned long)stats.read_bytes,
+           (unsigned long)stats.page_hits,
+           (unsigned long)stats.page_misses);
+
+    otaRelayServerGetStats(&server);
+    printf("  server sessions %d/%d queries %lu block requests %lu page requests %lu\r\n",
+           server.sessions,
+           OTA_RELAY_SERVER_MAX_SESSIONS,
+           (unsigned long)server.queries,
+           (unsigned long)server.blockRequests,
+           (unsigned long)server.pageRequests);
+    printf("  sent %lu blocks %lu bytes, waits %lu aborts %lu upgrade ends %lu notifies %lu\r\n",
+           (unsigned long)server.blocksSent,
+           (unsigned long)server.bytesSent,
+           (unsigned long)server.waits,
+           (unsigned long)server.aborts,
+           (unsigned long)server.upgradeEnds,
+           (unsigned long)server.notifies);
+}
+#endif
+
+static void stats_all(void)
+{
+    stats_cloud();
+    stats_wifi();
+    stats_heap();
+    stats_timer();
+    stats_task();
+#ifdef INFRA_DLOG
+    stats_dlog();
+#endif
+#ifdef OTA_RELAY_ENABLED
+    stats_otarelay();
+#endif
+}
+
+static EmberCommandEntry statsCommands[] = {
+  emberCommandEntryAction("all", stats_all, "", ""),
+  emberCommandEntryAction("cloud", stats_cloud, "", ""),
+  emberCommandEntryAction("wifi", stats_wifi, "", ""),
+  emberCommandEntryAction("heap", stats_heap, "", ""),
+  emberCommandEntryAction("timer", stats_timer, "", ""),
+  emberCommandEntryAction("task", stats_task, "", ""),
+#ifdef INFRA_DLOG
+  emberCommandEntryAction("dlog", stats_dlog, "", ""),
+#endif
+#ifdef OTA_RELAY_ENABLED
+  emberCommandEntryAction("otarelay", stats_otarelay, "", ""),
+#endif
+  emberCommandEntryTerminator()
+};
+
+#ifdef INFRA_TRACE
+static void trace_show(void)
+{
+    iotx_trace_dump();
+}
+
+static void trace_clear(void)
+{
+    iotx_trace_reset();
+}
+#endif
+
 EmberCommandEntry emberAfCustomCommands[] = {
   emberCommandEntryAction("kvshow", kv_show, "", ""),
   emberCommandEntryAction("kvadd",  kv_add, "bb", ""),
@@ -490,5 +695,10 @@ EmberCommandEntry emberAfCustomCommands[] = {
   emberCommandEntryAction("wificlear", wifi_clear, "", ""),
   emberCommandEntryAction("showtxpwr", em_showtxpwr, "", ""),
   emberCommandEntryAction("txpwr20", em_txpower20, "", ""),
+  emberCommandEntrySubMenu("stats", statsCommands, ""),
+#ifdef INFRA_TRACE
+  emberCommandEntryAction("trace", trace_show, "", ""),
+  emberCommandEntryAction("traceclear", trace_clear, "", ""),
+#endif
   emberCommandEntryTerminator()
 };
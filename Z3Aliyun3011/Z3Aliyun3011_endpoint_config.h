@@ -115,21 +115,27 @@ const EmberAfGenericClusterFunction emberAfFuncArrayIdentifyClusterServer[] = {
   EmberEventControl emberAfIdentifyClusterServerTickCallbackControl1; \
   extern EmberEventControl emberAfPluginConcentratorUpdateEventControl; \
   extern EmberEventControl emberAfPluginDeviceTableNewDeviceEventControl; \
+  extern EmberEventControl emberAfPluginDeviceTableSaveEventControl; \
+  extern EmberEventControl emberAfPluginDeviceTableLivenessEventControl; \
   extern EmberEventControl emberAfPluginFormAndJoinCleanupEventControl; \
   extern EmberEventControl emberAfPluginNetworkCreatorSecurityOpenNetworkEventControl; \
   extern EmberEventControl emberAfPluginScanDispatchScanEventControl; \
   extern void emberAfPluginConcentratorUpdateEventHandler(void); \
   extern void emberAfPluginDeviceTableNewDeviceEventHandler(void); \
+  extern void emberAfPluginDeviceTableSaveEventHandler(void); \
+  extern void emberAfPluginDeviceTableLivenessEventHandler(void); \
   extern void emberAfPluginFormAndJoinCleanupEventHandler(void); \
   extern void emberAfPluginNetworkCreatorSecurityOpenNetworkEventHandler(void); \
   extern void emberAfPluginScanDispatchScanEventHandler(void); \
   extern EmberEventControl addSubDevEventControl; \
   extern EmberEventControl clearWiFiEventControl; \
   extern EmberEventControl formNetworkRetryEventControl; \
+  extern EmberEventControl otaRelayEventControl; \
   extern EmberEventControl pollAttrEventControl; \
   extern void addSubDevEventHandler(void); \
   extern void clearWiFiEventHandler(void); \
   extern void formNetworkRetryEventHandler(void); \
+  extern void otaRelayEventHandler(void); \
   extern void pollAttrEventHandler(void); \
   static void clusterTickWrapper(EmberEventControl *control, EmberAfTickFunction callback, uint8_t endpoint) \
   { \
@@ -146,12 +152,15 @@ const EmberAfGenericClusterFunction emberAfFuncArrayIdentifyClusterServer[] = {
   { &emberAfIdentifyClusterServerTickCallbackControl1, emberAfIdentifyClusterServerTickCallbackWrapperFunction1 }, \
   { &emberAfPluginConcentratorUpdateEventControl, emberAfPluginConcentratorUpdateEventHandler }, \
   { &emberAfPluginDeviceTableNewDeviceEventControl, emberAfPluginDeviceTableNewDeviceEventHandler }, \
+  { &emberAfPluginDeviceTableSaveEventControl, emberAfPluginDeviceTableSaveEventHandler }, \
+  { &emberAfPluginDeviceTableLivenessEventControl, emberAfPluginDeviceTableLivenessEventHandler }, \
   { &emberAfPluginFormAndJoinCleanupEventControl, emberAfPluginFormAndJoinCleanupEventHandler }, \
   { &emberAfPluginNetworkCreatorSecurityOpenNetworkEventControl, emberAfPluginNetworkCreatorSecurityOpenNetworkEventHandler }, \
   { &emberAfPluginScanDispatchScanEventControl, emberAfPluginScanDispatchScanEventHandler }, \
   { &addSubDevEventControl, addSubDevEventHandler }, \
   { &clearWiFiEventControl, clearWiFiEventHandler }, \
   { &formNetworkRetryEventControl, formNetworkRetryEventHandler }, \
+  { &otaRelayEventControl, otaRelayEventHandler }, \
   { &pollAttrEventControl, pollAttrEventHandler }, \
 
 
@@ -159,12 +168,15 @@ const EmberAfGenericClusterFunction emberAfFuncArrayIdentifyClusterServer[] = {
   "Identify Cluster Server EP 1",  \
   "Concentrator Support Plugin Update",  \
   "Device Table Plugin NewDevice",  \
+  "Device Table Plugin Save",  \
+  "Device Table Plugin Liveness",  \
   "Form and Join Library Plugin Cleanup",  \
   "Network Creator Security Plugin OpenNetwork",  \
   "Scan Dispatch Plugin Scan",  \
   "addSubDev Custom",  \
   "clearWiFi Custom",  \
   "formNetworkRetry Custom",  \
+  "otaRelay Custom",  \
   "pollAttr Custom",  \
 
 
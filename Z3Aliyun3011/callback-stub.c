@@ -1243,61 +1243,6 @@ bool emberAfOtaServerIncomingMessageRawCallback(EmberAfClusterCommand *message)
   return false;
 }
 
-/** @brief Ota Server Query
- *
- * This callback is fired when the OTA server receives a query request by the
- * client.  The callback lets the server application indicate to the client what
- * the 'next' version of software is for the device, or if there is not one
- * available.
- *
- * @param currentImageId This is the current software image that the client
- * hase.  Ver.: always
- * @param hardwareVersion If this value is non-NULL, it indicates the hardware
- * version of the client device.  If NULL, the client did not specify a hardware
- * version.  Ver.: always
- * @param nextUpgradeImageId This is a pointer to a data structure containing
- * the 'next' software version for the client to download.  Ver.: always
- */
-uint8_t emberAfOtaServerQueryCallback(const EmberAfOtaImageId* currentImageId,
-                                      uint16_t* hardwareVersion,
-                                      EmberAfOtaImageId* nextUpgradeImageId)
-{
-  // If a new software image is available, this function should return EMBER_ZCL_STATUS_SUCCESS
-  // and populate the 'nextUpgradeImageId' structure with the appropriate values.
-  // If no new software image is available (i.e. the client should not download a firmware image)
-  // then the server should return EMBER_ZCL_STATUS_NO_IMAGE_AVAILABLE.
-  return EMBER_ZCL_STATUS_NO_IMAGE_AVAILABLE;
-}
-
-/** @brief Ota Server Send Image Notify
- *
- * This callback is an indication to the OTA server that it should send out
- * notification about an OTA file that is available for download.
- *
- * @param dest The destination of the image notify message.  May be a broadcast
- * address.  Ver.: always
- * @param endpoint The destination endpoint of the image notify message.  May be
- * a broadcast endpoint.  Ver.: always
- * @param payloadType The type of data the image notify message will contain.  0
- * = no data.  1 = Manufacturer ID.  2 = Manufacturer ID and the image type ID. 
- * 3 = Manufacturer ID, image type ID, and firmware version.  Ver.: always
- * @param queryJitter The percentage of nodes that should respond to this
- * message, from 1-100.  On receipt of this message, each recipient will
- * randomly choose a percentage and only query the server if their percentage is
- * below this value.  Ver.: always
- * @param id The image information that will be put in the message.  The data
- * within this struct that will be appended to the message is determined by the
- * previous 'payloadType' argument.  Ver.: always
- */
-bool emberAfOtaServerSendImageNotifyCallback(EmberNodeId dest,
-                                             uint8_t endpoint,
-                                             uint8_t payloadType,
-                                             uint8_t queryJitter,
-                                             const EmberAfOtaImageId* id)
-{
-  return false;
-}
-
 /** @brief Ota Server Upgrade End Request
  *
  * This function is called when the OTA server receives a request an upgrade end
@@ -1376,17 +1321,6 @@ EmberAfOtaStorageStatus emberAfOtaStorageClearTempDataCallback(void)
   return EMBER_AF_OTA_STORAGE_ERROR;
 }
 
-/** @brief Ota Storage Close
- *
- * This callback shuts down the ZigBee Over-the-air storage module.
- *
- */
-void emberAfOtaStorageCloseCallback(void)
-{
-  // Please implement me.
-  assert(false);
-}
-
 /** @brief Ota Storage Driver Download Finish
  *
  * This callback defines the low-level means by which a device records the final
@@ -1514,140 +1448,6 @@ EmberAfOtaStorageStatus emberAfOtaStorageFinishDownloadCallback(uint32_t offset)
   return EMBER_AF_OTA_STORAGE_SUCCESS;
 }
 
-/** @brief Ota Storage Get Count
- *
- * This callback returns the total number of ZigBee Over-the-air upgrade images
- * stored in the storage module.
- *
- */
-uint8_t emberAfOtaStorageGetCountCallback(void)
-{
-  return 0;
-}
-
-/** @brief Ota Storage Get Full Header
- *
- * This callback populates the EmberAfOtaHeader structure pointed to by the
- * returnData with data about the OTA file stored in the storage module.
- *
- * @param id This is a pointer to the image id for the OTA file to retrieve
- * information about.  Ver.: always
- * @param returnData This is a pointer to the location of the structure that
- * will be populated with data.  Ver.: always
- */
-EmberAfOtaStorageStatus emberAfOtaStorageGetFullHeaderCallback(const EmberAfOtaImageId* id,
-                                                               EmberAfOtaHeader* returnData)
-{
-  // If the requested image cannot be found, then an error shouldb e returned.
-  return EMBER_AF_OTA_STORAGE_ERROR;
-}
-
-/** @brief Ota Storage Get Total Image Size
- *
- * This function returns the total size of the ZigBee Over-the-air file with the
- * passed parameters.  If no file is found with those parameters, 0 is returned.
- *
- * @param id A pointer to the image identifier for the OTA file to retrieve
- * information for.  Ver.: always
- */
-uint32_t emberAfOtaStorageGetTotalImageSizeCallback(const EmberAfOtaImageId* id)
-{
-  // On failure this should return an image size of zero.
-  return 0;
-}
-
-/** @brief Ota Storage Init
- *
- * This callback initializes the ZigBee Over-the-air storage module.
- *
- */
-EmberAfOtaStorageStatus emberAfOtaStorageInitCallback(void)
-{
-  return EMBER_AF_OTA_STORAGE_SUCCESS;
-}
-
-/** @brief Ota Storage Iterator First
- *
- * This callback lets you walk through the list of all OTA files by jumping to
- * the first file in the list maintained by the storage module.  If there is no
- * file then emberAfOtaInvalidImageId is returned.
- *
- */
-EmberAfOtaImageId emberAfOtaStorageIteratorFirstCallback(void)
-{
-  // It is expected that the storage module maintain its own internal iterator that the 'first' and 'next' functions will manipulate.
-
-  // If there are no images at all, this function should return the invalid image id.
-  return emberAfInvalidImageId;
-}
-
-/** @brief Ota Storage Iterator Next
- *
- * This callback lets you walk through the list of all OTA files by jumping to
- * the next file in the list maintained by the storage module.  If there is no
- * next file then emberAfOtaInvalidImageId is returned.
- *
- */
-EmberAfOtaImageId emberAfOtaStorageIteratorNextCallback(void)
-{
-  // It is expected that the storage module maintain its own internal iterator that the 'first' and 'next' functions will manipulate.
-
-  // If there are no more images, this function should return the invalid image id.
-  return emberAfInvalidImageId;
-}
-
-/** @brief Ota Storage Read Image Data
- *
- * This callback reads data from the specified OTA file and returns that data to
- * the caller.
- *
- * @param id This is a pointer to the image id for the OTA file to retrieve data
- * from.  Ver.: always
- * @param offset This is the offset relative to the start of the image where the
- * data should be read from.  Ver.: always
- * @param length This is the length of data that will be read.  Ver.: always
- * @param returnData This is a pointer to where the data read out of the file
- * will be written to  Ver.: always
- * @param returnedLength This is a pointer to a variable where the actual length
- * of data read will be written to.  A short read may occur if the end of file
- * was reached.  Ver.: always
- */
-EmberAfOtaStorageStatus emberAfOtaStorageReadImageDataCallback(const EmberAfOtaImageId* id,
-                                                               uint32_t offset,
-                                                               uint32_t length,
-                                                               uint8_t* returnData,
-                                                               uint32_t* returnedLength)
-{
-  // If the requested image cannot be found, then an error should be returned.
-  return EMBER_AF_OTA_STORAGE_ERROR;
-}
-
-/** @brief Ota Storage Search
- *
- * This callback searches through the list of all images for one that matches
- * the passed parameters.  On success an image identifier is returned with a
- * matching image.  On failure emberAfInvalidImageId is returned.
- *
- * @param manufacturerId The ZigBee assigned identifier of the manufacturer
- * contained in the OTA image being searched for.  Ver.: always
- * @param imageTypeId The image type identifier contained in the OTA image being
- * searched for.  Ver.: always
- * @param hardwareVersion This is a pointer to the hardware version that will be
- * used in the search.  If the pointer is NULL, hardware version will not be
- * considered when searching for matching images.  If it points to a value, the
- * search will only consider images where that value falls between the minimum
- * and maxmimum hardware version specified in the OTA file.  If no hardware
- * version is present in an OTA file but the other parameters match, the file
- * will be considered a match  Ver.: always
- */
-EmberAfOtaImageId emberAfOtaStorageSearchCallback(uint16_t manufacturerId,
-                                                  uint16_t imageTypeId,
-                                                  const uint16_t* hardwareVersion)
-{
-  // If no image is found that matches the search criteria, this function should return the invalid image id.
-  return emberAfInvalidImageId;
-}
-
 /** @brief Ota Storage Write Temp Data
  *
  * This function writes to the temporary data in the storage device at the
@@ -2097,24 +1897,6 @@ bool emberAfPreCliSendCallback(EmberApsFrame* apsFrame,
   return false;
 }
 
-/** @brief Pre Command Received
- *
- * This callback is the second in the Application Framework's message processing
- * chain. At this point in the processing of incoming over-the-air messages, the
- * application has determined that the incoming message is a ZCL command. It
- * parses enough of the message to populate an EmberAfClusterCommand struct. The
- * Application Framework defines this struct value in a local scope to the
- * command processing but also makes it available through a global pointer
- * called emberAfCurrentCommand, in app/framework/util/util.c. When command
- * processing is complete, this pointer is cleared.
- *
- * @param cmd   Ver.: always
- */
-bool emberAfPreCommandReceivedCallback(EmberAfClusterCommand* cmd)
-{
-  return false;
-}
-
 /** @brief Pre Message Received
  *
  * This callback is the first in the Application Framework's message processing
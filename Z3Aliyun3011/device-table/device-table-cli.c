@@ -37,6 +37,8 @@
 #include "device-table.h"
 #include "app/framework/plugin/device-table/device-table-internal.h"
 
+void emAfDeviceTableFlush(void);
+
 #ifdef EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE
 #undef EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE
 #endif
@@ -255,6 +257,7 @@ void emberAfDeviceTablePrintDeviceTable(void)
 {
   uint16_t totalDevices = 0;
   EmberAfPluginDeviceTableEntry *deviceTable = emberAfDeviceTablePointer();
+  EmberAfPluginDeviceTableLiveness *liveness = emberAfDeviceTableLivenessPointer();
   uint16_t index;
 
   for (index = 0;
@@ -266,8 +269,7 @@ void emberAfDeviceTablePrintDeviceTable(void)
       emberAfCorePrint(" %d ", deviceTable[index].endpoint);
       printDeviceId(deviceTable[index].deviceId);
       printState(deviceTable[index].state);
-      //emberAfCorePrintln(" %l", emberAfDeviceTableTimeSinceLastMessage(index));
-      emberAfCorePrintln(" %s %d %d", deviceTable[index].online ? "Online" : "Offline", deviceTable[index].keepalive_failcnt, deviceTable[index].cloud_devid);
+      emberAfCorePrintln(" %s %l %d", liveness[index].online ? "Online" : "Offline", emberAfDeviceTableTimeSinceLastMessage(index), deviceTable[index].cloud_devid);
       totalDevices++;
     }
   }
@@ -367,7 +369,7 @@ void emAfDeviceTableSendCommand(void)
 
 void emAfDeviceTableSaveCommand(void)
 {
-  emAfDeviceTableSave();
+  emAfDeviceTableFlush();
 }
 
 void emAfDeviceTableLoadCommand(void)
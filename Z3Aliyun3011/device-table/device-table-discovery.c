@@ -60,13 +60,33 @@
 #define DEVICE_DISCOVERY_SIMPLE_RETRY_TIME_QS    4
 #define DEVICE_DISCOVERY_MAX_WAIT_TIME_S       120
 
-#define DEVICE_DISCOVERY_MAX_WAIT_TICKS \
-  ((DEVICE_DISCOVERY_MAX_WAIT_TIME_S * 1000) / EVENT_TICK_MS)
+#define DEVICE_DISCOVERY_MAX_WAIT_MS \
+  (DEVICE_DISCOVERY_MAX_WAIT_TIME_S * 1000UL)
+
+#define DEVICE_DISCOVERY_ENDPOINT_RETRY_MS \
+  (DEVICE_DISCOVERY_ENDPONT_RETRY_TIME_QS * 250)
+#define DEVICE_DISCOVERY_SIMPLE_RETRY_MS \
+  (DEVICE_DISCOVERY_SIMPLE_RETRY_TIME_QS * 250)
+
+// Number of interview requests (active endpoints / simple descriptor) that
+// may be outstanding at the same time.
+#ifndef EMBER_AF_PLUGIN_DEVICE_TABLE_MAX_IN_FLIGHT
+#define EMBER_AF_PLUGIN_DEVICE_TABLE_MAX_IN_FLIGHT 4
+#endif
 
-#define DEVICE_DISCOVERY_ENDPOINT_RETRY_TICKS \
-  ((DEVICE_DISCOVERY_ENDPONT_RETRY_TIME_QS * 250) / EVENT_TICK_MS)
-#define DEVICE_DISCOVERY_SIMPLE_RETRY_TICKS \
-  ((DEVICE_DISCOVERY_SIMPLE_RETRY_TIME_QS * 250) / EVENT_TICK_MS)
+// Airtime the interviews may consume in every window, so a join wave does not
+// crowd out regular traffic.
+#ifndef EMBER_AF_PLUGIN_DEVICE_TABLE_AIRTIME_BUDGET_MS
+#define EMBER_AF_PLUGIN_DEVICE_TABLE_AIRTIME_BUDGET_MS 100
+#endif
+#ifndef EMBER_AF_PLUGIN_DEVICE_TABLE_AIRTIME_WINDOW_MS
+#define EMBER_AF_PLUGIN_DEVICE_TABLE_AIRTIME_WINDOW_MS 1000
+#endif
+
+// Estimated airtime of a unicast ZDO request with its MAC ACK, and of a
+// broadcast route repair including the relays.
+#define DEVICE_DISCOVERY_UNICAST_AIRTIME_MS   3
+#define DEVICE_DISCOVERY_BROADCAST_AIRTIME_MS 10
 
 #define APS_OPTION_DISCOVER EMBER_APS_OPTION_RETRY
 
@@ -123,8 +143,9 @@ typedef struct {
   uint16_t nodeId;
   uint8_t endpoint;
   uint8_t state;
-  uint16_t delay;
-  uint32_t waitTime;
+  uint8_t heapIndex;
+  uint32_t deadline; // next action is due at this tick
+  uint32_t expiry;   // interview is abandoned at this tick
 } DeviceTableQueueEntry;
 
 static uint8_t permitJoinBroadcastCounter = (PJOIN_BROADCAST_PERIOD - 1);
@@ -150,131 +171,242 @@ static const char * const statusStrings[] =
   "STANDARD_SECURITY_UNSECURED_REJOIN",
 };
 
+// Queue entries live in fixed slots; deadlineHeap is a min-heap of slot
+// numbers ordered by deadline, and its first queueSize elements are exactly
+// the slots in use.
 DeviceTableQueueEntry taskQueue[MAX_QUEUE_SIZE];
+static uint8_t deadlineHeap[MAX_QUEUE_SIZE];
 static uint8_t queueSize;
-static uint32_t tick;
+static uint8_t inFlight;
+static uint32_t airtimeCredit;
+static uint32_t airtimeRefillTime;
+
+#define deadlineBefore(a, b) ((int32_t)((a) - (b)) < 0)
 
 void emberAfPluginDeviceTableIndexAddedCallback(uint16_t index);
 
 // Bookkeeping callbacks
 void emAfPluginDeviceTableDeviceLeftCallback(EmberEUI64 newNodeEui64);
 
-static uint8_t getQueueIndexFromNodeAndEndpoint(DeviceTableQueueEntry * queue,
-                                                uint16_t nodeId,
+// Sets the addressing fields of an entry and keeps the lookup indexes in sync
+void emAfDeviceTableSetEntryAddress(uint16_t index,
+                                    EmberNodeId nodeId,
+                                    EmberEUI64 eui64,
+                                    uint8_t endpoint);
+void emAfDeviceTableSetEntryDeviceId(uint16_t index, uint16_t deviceId);
+void emAfDeviceTableSetEntryState(uint16_t index, uint8_t newState);
+void emAfDeviceTableLivenessHeard(uint16_t index);
+
+static bool queueSlotInUse(uint8_t index)
+{
+  uint8_t heapIndex = taskQueue[index].heapIndex;
+
+  return (heapIndex < queueSize) && (deadlineHeap[heapIndex] == index);
+}
+
+static bool isWaitingState(uint8_t state)
+{
+  return (state == DEVICE_DISCOVERY_STATE_ENDPOINTS_WAITING)
+         || (state == DEVICE_DISCOVERY_STATE_SIMPLE_WAITING);
+}
+
+static uint8_t getQueueIndexFromNodeAndEndpoint(uint16_t nodeId,
                                                 uint8_t endpoint)
 {
   uint8_t i;
 
-  if ((queue == NULL) || (queueSize == 0)) {
+  if (queueSize == 0) {
     return DEVICE_QUEUE_NULL;
   }
-  for (i = 0; i < queueSize; i++) {
-    if ((queue[i].nodeId == nodeId) && (queue[i].endpoint == endpoint)) {
+  for (i = 0; i < MAX_QUEUE_SIZE; i++) {
+    if (queueSlotInUse(i)
+        && (taskQueue[i].nodeId == nodeId)
+        && (taskQueue[i].endpoint == endpoint)) {
       return i;
     }
   }
   return DEVICE_QUEUE_NULL;
 }
 
-static void deleteQueueEntry(DeviceTableQueueEntry * queue, uint8_t index)
+static bool heapLess(uint8_t i, uint8_t j)
 {
-  uint8_t i;
+  return deadlineBefore(taskQueue[deadlineHeap[i]].deadline,
+                        taskQueue[deadlineHeap[j]].deadline);
+}
 
-  if (queueSize == 0) {
-    return;
+static void heapSwap(uint8_t i, uint8_t j)
+{
+  uint8_t index = deadlineHeap[i];
+
+  deadlineHeap[i] = deadlineHeap[j];
+  deadlineHeap[j] = index;
+  taskQueue[deadlineHeap[i]].heapIndex = i;
+  taskQueue[deadlineHeap[j]].heapIndex = j;
+}
+
+static void heapSiftUp(uint8_t i)
+{
+  while ((i > 0) && heapLess(i, (i - 1) / 2)) {
+    heapSwap(i, (i - 1) / 2);
+    i = (i - 1) / 2;
   }
+}
+
+static void heapSiftDown(uint8_t i)
+{
+  uint16_t child;
 
-  for (i = index; i < queueSize; i++) {
-    queue[i] = queue[i + 1];
+  for (;;) {
+    child = 2 * (uint16_t)i + 1;
+    if (child >= queueSize) {
+      return;
+    }
+    if ((child + 1 < queueSize) && heapLess(child + 1, child)) {
+      child++;
+    }
+    if (!heapLess(child, i)) {
+      return;
+    }
+    heapSwap(i, child);
+    i = child;
   }
-  queueSize--;
-  queue[queueSize].nodeId = 0;
-  queue[queueSize].state = 0;
-  queue[queueSize].delay = 0;
-  queue[queueSize].waitTime = 0;
-  MEMSET(queue[queueSize].eui64, 0, EUI64_SIZE);
 }
 
-static void bubbleSortQueue(DeviceTableQueueEntry * queue)
+// Arm the discovery event for the earliest deadline in the queue.
+static void scheduleNewDeviceEvent(void)
 {
-  uint8_t passesIndex, stepsIndex;
-  DeviceTableQueueEntry swapDeviceEntry;
+  uint32_t now, deadline;
 
   if (queueSize == 0) {
+    emberEventControlSetInactive(newDeviceEventControl);
     return;
   }
-  for (passesIndex = 0; passesIndex < (queueSize - 1); passesIndex++) {
-    for (stepsIndex = 0;
-         stepsIndex < (queueSize - passesIndex - 1);
-         stepsIndex++) {
-      if (queue[stepsIndex].delay > queue[stepsIndex + 1].delay) {
-        swapDeviceEntry = queue[stepsIndex];
-        queue[stepsIndex] = queue[stepsIndex + 1];
-        queue[stepsIndex + 1] = swapDeviceEntry;
-      }
-    }
+  now = halCommonGetInt32uMillisecondTick();
+  deadline = taskQueue[deadlineHeap[0]].deadline;
+  if (deadlineBefore(now, deadline)) {
+    emberEventControlSetDelayMS(newDeviceEventControl, deadline - now);
+  } else {
+    emberEventControlSetActive(newDeviceEventControl);
+  }
+}
+
+static void deleteQueueEntry(uint8_t index)
+{
+  uint8_t heapIndex = taskQueue[index].heapIndex;
+  uint8_t moved;
+
+  if (!queueSlotInUse(index)) {
+    return;
+  }
+  if (isWaitingState(taskQueue[index].state)) {
+    inFlight--;
   }
+
+  queueSize--;
+  if (heapIndex != queueSize) {
+    heapSwap(heapIndex, queueSize);
+    moved = deadlineHeap[heapIndex];
+    heapSiftUp(heapIndex);
+    heapSiftDown(taskQueue[moved].heapIndex);
+  }
+  scheduleNewDeviceEvent();
 }
 
 void printQueue(void)
 {
+  uint32_t now = halCommonGetInt32uMillisecondTick();
   uint8_t i;
 
-  emberAfCorePrintln("index    node  ep  state  delay  wait");
-  for (i = 0; i < queueSize; i++) {
+  emberAfCorePrintln("in flight %d/%d", inFlight,
+                     EMBER_AF_PLUGIN_DEVICE_TABLE_MAX_IN_FLIGHT);
+  emberAfCorePrintln("index    node  ep  state  due(ms)  expires(s)");
+  for (i = 0; i < MAX_QUEUE_SIZE; i++) {
+    if (!queueSlotInUse(i)) {
+      continue;
+    }
     emberAfCorePrintln("  %d   0x%2X  %d    %d     %d    %d",
                        i,
                        taskQueue[i].nodeId,
                        taskQueue[i].endpoint,
                        taskQueue[i].state,
-                       taskQueue[i].delay,
-                       taskQueue[i].waitTime);
+                       (int32_t)(taskQueue[i].deadline - now),
+                       (int32_t)(taskQueue[i].expiry - now) / 1000);
   }
 }
 
-static void updateQueueEntry(DeviceTableQueueEntry * queue,
-                             uint8_t index,
+// Moves an entry to its next state and re-keys it in the deadline heap.
+static void updateQueueEntry(uint8_t index,
                              uint8_t nextState,
-                             uint8_t delay)
+                             uint32_t deadline)
 {
-  queue[index].state = nextState;
-  queue[index].delay = delay;
-  bubbleSortQueue(queue);
+  if (isWaitingState(taskQueue[index].state)) {
+    inFlight--;
+  }
+  if (isWaitingState(nextState)) {
+    inFlight++;
+  }
+  taskQueue[index].state = nextState;
+  taskQueue[index].deadline = deadline;
+  heapSiftUp(taskQueue[index].heapIndex);
+  heapSiftDown(taskQueue[index].heapIndex);
 }
 
-static bool addQueueEntry(DeviceTableQueueEntry * queue,
-                          DeviceTableQueueEntry * newEntryPtr)
+static bool addQueueEntry(DeviceTableQueueEntry * newEntryPtr)
 {
+  uint8_t index;
+
   if (queueSize == MAX_QUEUE_SIZE) {
     return false;
   }
+  for (index = 0; queueSlotInUse(index); index++) {
+  }
 
-  queue[queueSize] = *newEntryPtr;
+  taskQueue[index] = *newEntryPtr;
+  taskQueue[index].heapIndex = queueSize;
+  deadlineHeap[queueSize] = index;
   queueSize++;
-  bubbleSortQueue(queue);
-
-  if (queueSize == 1) { // this is the first entry and the state machine is inactive
-                        // we have to activated it.
-    emberEventControlSetActive(newDeviceEventControl);
+  if (isWaitingState(newEntryPtr->state)) {
+    inFlight++;
   }
+  heapSiftUp(taskQueue[index].heapIndex);
+  scheduleNewDeviceEvent();
   return true;
 }
 
-static void updateTaskQueueByTick(void)
+// Token bucket for the interview airtime.  Credit is kept in units of
+// 1/AIRTIME_WINDOW_MS ms so the refill rate stays integral.
+static bool spendAirtime(uint32_t now, uint16_t airtimeMs)
 {
-  uint8_t i = 0;
+  uint32_t elapsed = now - airtimeRefillTime;
+  uint32_t cost = (uint32_t)airtimeMs
+                  * EMBER_AF_PLUGIN_DEVICE_TABLE_AIRTIME_WINDOW_MS;
 
-  while (i < queueSize) {
-    taskQueue[i].waitTime++;
-    if (taskQueue[i].delay != 0) {
-      taskQueue[i].delay--;
-    }
-    if (taskQueue[i].waitTime > DEVICE_DISCOVERY_MAX_WAIT_TICKS) {
-      deleteQueueEntry(taskQueue, i);
-    } else {
-      i++;
-    }
+  airtimeRefillTime = now;
+  if (elapsed > EMBER_AF_PLUGIN_DEVICE_TABLE_AIRTIME_WINDOW_MS) {
+    elapsed = EMBER_AF_PLUGIN_DEVICE_TABLE_AIRTIME_WINDOW_MS;
+  }
+  airtimeCredit += elapsed * EMBER_AF_PLUGIN_DEVICE_TABLE_AIRTIME_BUDGET_MS;
+  if (airtimeCredit > ((uint32_t)EMBER_AF_PLUGIN_DEVICE_TABLE_AIRTIME_BUDGET_MS
+                       * EMBER_AF_PLUGIN_DEVICE_TABLE_AIRTIME_WINDOW_MS)) {
+    airtimeCredit = (uint32_t)EMBER_AF_PLUGIN_DEVICE_TABLE_AIRTIME_BUDGET_MS
+                    * EMBER_AF_PLUGIN_DEVICE_TABLE_AIRTIME_WINDOW_MS;
+  }
+  if (airtimeCredit < cost) {
+    return false;
   }
+  airtimeCredit -= cost;
+  return true;
+}
+
+// Time until the bucket holds enough credit for a request; only valid right
+// after spendAirtime() failed.
+static uint32_t airtimeWaitMs(uint16_t airtimeMs)
+{
+  uint32_t cost = (uint32_t)airtimeMs
+                  * EMBER_AF_PLUGIN_DEVICE_TABLE_AIRTIME_WINDOW_MS;
+
+  return (cost - airtimeCredit + EMBER_AF_PLUGIN_DEVICE_TABLE_AIRTIME_BUDGET_MS - 1)
+         / EMBER_AF_PLUGIN_DEVICE_TABLE_AIRTIME_BUDGET_MS;
 }
 
 static void setCurrentSourceRoute(uint16_t nodeId)
@@ -300,70 +432,102 @@ static void routeRepairReturn(const EmberAfServiceDiscoveryResult* result)
 }
 
 // We have a new endpoint.
-static void newEndpointDiscovered(EmberAfPluginDeviceTableEntry *p_entry)
+static void newEndpointDiscovered(uint16_t index)
 {
+  EmberAfPluginDeviceTableEntry *p_entry =
+    emberAfDeviceTableFindDeviceTableEntry(index);
+
   // Figure out if we need to do anything, like write the CIE address to it.
   if (p_entry->deviceId == DEVICE_ID_IAS_ZONE) {
     // write IEEE address to CIE address location
     emAfDeviceTableSendCieAddressWrite(p_entry->nodeId, p_entry->endpoint);
   }
-  p_entry->state = EMBER_AF_PLUGIN_DEVICE_TABLE_STATE_JOINED;
+  emAfDeviceTableSetEntryState(index, EMBER_AF_PLUGIN_DEVICE_TABLE_STATE_JOINED);
+  emAfDeviceTableLivenessHeard(index);
   // New device is set, time to make the callback to indicate a new device
   // has joined.
   emberAfPluginDeviceTableNewDeviceCallback(p_entry->eui64);
   emAfDeviceTableSave();
 }
 
+// Services every queue entry whose deadline has passed.  Sends are limited to
+// MAX_IN_FLIGHT outstanding requests and to the airtime budget; a send that
+// cannot go out yet is pushed back rather than blocking the entries behind it.
 void emberAfPluginDeviceTableNewDeviceEventHandler(void)
 {
-  EmberAfPluginDeviceTableEntry *deviceTable = emberAfDeviceTablePointer();
-  DeviceTableQueueEntry * currentEntryPtr = &taskQueue[0];
-  EmberStatus status;
-  uint16_t newEndpoint;
-  uint8_t taskQueueIndex, nextState, delay;
-
-  if ((currentEntryPtr->delay == 0) && (queueSize > 0)) {
-    emberAfPrintBigEndianEui64(currentEntryPtr->eui64);
-    taskQueueIndex = getQueueIndexFromNodeAndEndpoint(taskQueue,
-                                                      currentEntryPtr->nodeId,
-                                                      currentEntryPtr->endpoint);
+  uint32_t now = halCommonGetInt32uMillisecondTick();
+  DeviceTableQueueEntry * currentEntryPtr;
+  uint8_t index;
+
+  while (queueSize > 0) {
+    index = deadlineHeap[0];
+    currentEntryPtr = &taskQueue[index];
+    if (deadlineBefore(now, currentEntryPtr->deadline)) {
+      break;
+    }
+    if (!deadlineBefore(now, currentEntryPtr->expiry)) {
+      emberAfCorePrintln("Discovery of 0x%2x timed out",
+                         currentEntryPtr->nodeId);
+      deleteQueueEntry(index);
+      continue;
+    }
+
     switch (currentEntryPtr->state) {
       case DEVICE_DISCOVERY_STATE_ENDPOINTS_SEND:
-        // send out active endpoints request.
-        //setCurrentSourceRoute(currentEntryPtr->nodeId);
-        status = emberActiveEndpointsRequest(currentEntryPtr->nodeId,
-                                             APS_OPTION_DISCOVER);
-        nextState = DEVICE_DISCOVERY_STATE_ENDPOINTS_WAITING;
-        delay = DEVICE_DISCOVERY_ENDPOINT_RETRY_TICKS;
+      case DEVICE_DISCOVERY_STATE_SIMPLE_SEND:
+        if (inFlight >= EMBER_AF_PLUGIN_DEVICE_TABLE_MAX_IN_FLIGHT) {
+          updateQueueEntry(index,
+                           currentEntryPtr->state,
+                           now + EVENT_TICK_MS);
+          break;
+        }
+        if (!spendAirtime(now, DEVICE_DISCOVERY_UNICAST_AIRTIME_MS)) {
+          updateQueueEntry(index,
+                           currentEntryPtr->state,
+                           now + airtimeWaitMs(DEVICE_DISCOVERY_UNICAST_AIRTIME_MS));
+          break;
+        }
+        emberAfPrintBigEndianEui64(currentEntryPtr->eui64);
+        if (currentEntryPtr->state == DEVICE_DISCOVERY_STATE_ENDPOINTS_SEND) {
+          // send out active endpoints request.
+          //setCurrentSourceRoute(currentEntryPtr->nodeId);
+          emberActiveEndpointsRequest(currentEntryPtr->nodeId,
+                                      APS_OPTION_DISCOVER);
+          updateQueueEntry(index,
+                           DEVICE_DISCOVERY_STATE_ENDPOINTS_WAITING,
+                           now + DEVICE_DISCOVERY_ENDPOINT_RETRY_MS);
+        } else {
+          emberSimpleDescriptorRequest(currentEntryPtr->nodeId,
+                                       currentEntryPtr->endpoint,
+                                       EMBER_AF_DEFAULT_APS_OPTIONS);
+          updateQueueEntry(index,
+                           DEVICE_DISCOVERY_STATE_SIMPLE_WAITING,
+                           now + DEVICE_DISCOVERY_SIMPLE_RETRY_MS);
+        }
         break;
       case DEVICE_DISCOVERY_STATE_ENDPOINTS_WAITING:
-        emberAfFindNodeId(currentEntryPtr->eui64, routeRepairReturn);
-        nextState = DEVICE_DISCOVERY_STATE_ENDPOINTS_SEND;
-        delay = DEVICE_DISCOVERY_ENDPOINT_RETRY_TICKS;
-        break;
-      case DEVICE_DISCOVERY_STATE_SIMPLE_SEND:
-        emberSimpleDescriptorRequest(currentEntryPtr->nodeId,
-                                     currentEntryPtr->endpoint,
-                                     EMBER_AF_DEFAULT_APS_OPTIONS);
-        nextState = DEVICE_DISCOVERY_STATE_SIMPLE_WAITING;
-        delay = DEVICE_DISCOVERY_SIMPLE_RETRY_TICKS;
+        // No response; repair the route if the budget allows and retry.
+        if (spendAirtime(now, DEVICE_DISCOVERY_BROADCAST_AIRTIME_MS)) {
+          emberAfFindNodeId(currentEntryPtr->eui64, routeRepairReturn);
+        }
+        updateQueueEntry(index,
+                         DEVICE_DISCOVERY_STATE_ENDPOINTS_SEND,
+                         now + DEVICE_DISCOVERY_ENDPOINT_RETRY_MS);
         break;
       case DEVICE_DISCOVERY_STATE_SIMPLE_WAITING:
-        emberAfFindNodeId(currentEntryPtr->eui64, routeRepairReturn);
-        nextState = DEVICE_DISCOVERY_STATE_SIMPLE_SEND;
-        delay = DEVICE_DISCOVERY_SIMPLE_RETRY_TICKS;
+        if (spendAirtime(now, DEVICE_DISCOVERY_BROADCAST_AIRTIME_MS)) {
+          emberAfFindNodeId(currentEntryPtr->eui64, routeRepairReturn);
+        }
+        updateQueueEntry(index,
+                         DEVICE_DISCOVERY_STATE_SIMPLE_SEND,
+                         now + DEVICE_DISCOVERY_SIMPLE_RETRY_MS);
         break;
       default:
+        deleteQueueEntry(index);
         break;
     }
-    updateQueueEntry(taskQueue, taskQueueIndex, nextState, delay);
-  }
-  if (queueSize > 0) {
-    emberEventControlSetDelayMS(newDeviceEventControl, EVENT_TICK_MS);
-    updateTaskQueueByTick();
-  } else {
-    emberEventControlSetInactive(newDeviceEventControl);
   }
+  scheduleNewDeviceEvent();
 }
 
 static void newDeviceParseActiveEndpointsResponse(EmberNodeId emberNodeId,
@@ -376,22 +540,21 @@ static void newDeviceParseActiveEndpointsResponse(EmberNodeId emberNodeId,
 
   // Make sure I have not used the redundant endpoint response
   // check if there is any active endpoint that is being processed
-  i = getQueueIndexFromNodeAndEndpoint(taskQueue,
-                                       emberNodeId,
+  i = getQueueIndexFromNodeAndEndpoint(emberNodeId,
                                        DEVICE_TABLE_UNKNOWN_ENDPOINT);
   if (i != DEVICE_QUEUE_NULL) {
     MEMCOPY(entry.eui64, taskQueue[i].eui64, EUI64_SIZE);
-    deleteQueueEntry(taskQueue, i);//delete the ep initial task
+    deleteQueueEntry(i);//delete the ep initial task
     entry.nodeId = emberNodeId;
     entry.state = DEVICE_DISCOVERY_STATE_SIMPLE_SEND;
-    entry.delay = 0;
-    entry.waitTime = 0;
+    entry.deadline = halCommonGetInt32uMillisecondTick();
+    entry.expiry = entry.deadline + DEVICE_DISCOVERY_MAX_WAIT_MS;
     emberAfCorePrintln("number of ep: %d",
                        message[ACTIVE_ENDPOINT_RESPONSE_COUNT_OFFSET]);
     for (i = 0; i < message[ACTIVE_ENDPOINT_RESPONSE_COUNT_OFFSET]; i++) {
       entry.endpoint = message[ACTIVE_ENDPOINT_RESPONSE_LIST_OFFSET + i];
       emberAfCorePrintln("ep: %d", message[ACTIVE_ENDPOINT_RESPONSE_LIST_OFFSET + i]);
-      addQueueEntry(taskQueue, &entry);
+      addQueueEntry(&entry);
     }
   }
 }
@@ -407,8 +570,9 @@ static void newDeviceParseSimpleDescriptorResponse(EmberNodeId nodeId,
                                                    uint16_t length)
 {
   uint8_t endpoint;
-  EmberAfPluginDeviceTableEntry *pEntry;
+  uint16_t clusterIds[EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_SIZE];
   uint8_t clusterIndex = 0;
+  uint8_t clusterOutStartPosition = 0;
   uint16_t endpointIndex;
   uint8_t i, currentClusterType, ClusterCount;
   uint8_t msgArrayIndex = SIMPLE_DESCRIPTOR_RESPONSE_INPUT_CLUSTER_LIST_INDEX;
@@ -428,10 +592,9 @@ static void newDeviceParseSimpleDescriptorResponse(EmberNodeId nodeId,
     }
     emberAfPluginDeviceTableIndexAddedCallback(endpointIndex);
   }
-  pEntry = emberAfDeviceTableFindDeviceTableEntry(endpointIndex);
-  pEntry->deviceId =
-    emberFetchLowHighInt16u(message
-                            + SIMPLE_DESCRIPTOR_RESPONSE_DEVICE_ID_OFFSET);
+  emAfDeviceTableSetEntryDeviceId(endpointIndex,
+                                  emberFetchLowHighInt16u(message
+                                                          + SIMPLE_DESCRIPTOR_RESPONSE_DEVICE_ID_OFFSET));
 
   ClusterCount = message[SIMPLE_DESCRIPTOR_RESPONSE_INPUT_CLUSTER_LIST_COUNT_INDEX];
 
@@ -439,26 +602,33 @@ static void newDeviceParseSimpleDescriptorResponse(EmberNodeId nodeId,
        currentClusterType < NUMBER_OF_CLUSTER_IN_OUT;
        currentClusterType++) {
     for (i = 0; i < ClusterCount; i++) {
-      pEntry->clusterIds[clusterIndex] =
-        HIGH_LOW_TO_INT(message[msgArrayIndex + 1], message[msgArrayIndex]);
-      clusterIndex++;
+      if (clusterIndex < EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_SIZE) {
+        clusterIds[clusterIndex] =
+          HIGH_LOW_TO_INT(message[msgArrayIndex + 1], message[msgArrayIndex]);
+        clusterIndex++;
+      }
       msgArrayIndex += 2; //advance the index by 2 bytes for each 16 bit
                           //cluster id
     }
     if (currentClusterType == CLUSTER_IN) {
-      pEntry->clusterOutStartPosition = clusterIndex;
+      clusterOutStartPosition = clusterIndex;
       // This is the output cluster count
       ClusterCount = message[msgArrayIndex++];
     }
   }
+  emberAfDeviceTableSetClusterList(endpointIndex,
+                                   clusterIds,
+                                   clusterIndex,
+                                   clusterOutStartPosition);
 
-  i = getQueueIndexFromNodeAndEndpoint(taskQueue, nodeId, endpoint);
+  i = getQueueIndexFromNodeAndEndpoint(nodeId, endpoint);
   if (i != DEVICE_QUEUE_NULL) {
-    MEMCOPY(pEntry->eui64, taskQueue[i].eui64, EUI64_SIZE);
-    pEntry->nodeId = taskQueue[i].nodeId;
-    pEntry->endpoint = taskQueue[i].endpoint;
-    deleteQueueEntry(taskQueue, i);
-    newEndpointDiscovered(pEntry);
+    emAfDeviceTableSetEntryAddress(endpointIndex,
+                                   taskQueue[i].nodeId,
+                                   taskQueue[i].eui64,
+                                   taskQueue[i].endpoint);
+    deleteQueueEntry(i);
+    newEndpointDiscovered(endpointIndex);
   }
 }
 
@@ -476,19 +646,20 @@ void emberAfDeviceTableNewDeviceJoinHandler(EmberNodeId newNodeId,
   if (deviceTableIndex == EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX) {
     //search is there any old task in the taskQueue that matches the eui64,
     //then we should not do anything in that case
-    for (i = 0; i < queueSize; i++) {
-      if (emberAfDeviceTableMatchEui64(taskQueue[i].eui64, newNodeEui64)) {
-        deleteQueueEntry(taskQueue, i);
+    for (i = 0; i < MAX_QUEUE_SIZE; i++) {
+      if (queueSlotInUse(i)
+          && emberAfDeviceTableMatchEui64(taskQueue[i].eui64, newNodeEui64)) {
+        deleteQueueEntry(i);
       }
     }
     //add new task
     entry.endpoint = DEVICE_TABLE_UNKNOWN_ENDPOINT;
     entry.nodeId = newNodeId;
     entry.state = DEVICE_DISCOVERY_STATE_ENDPOINTS_SEND;
-    entry.delay = 0;
-    entry.waitTime = 0;
+    entry.deadline = halCommonGetInt32uMillisecondTick();
+    entry.expiry = entry.deadline + DEVICE_DISCOVERY_MAX_WAIT_MS;
     MEMCOPY(entry.eui64, newNodeEui64, EUI64_SIZE);
-    addQueueEntry(taskQueue, &entry);
+    addQueueEntry(&entry);
   } else {
     // Is this a new node ID?
     if (newNodeId != deviceTable[deviceTableIndex].nodeId) {
@@ -530,9 +701,10 @@ static void newDeviceLeftHandler(EmberEUI64 newNodeEui64)
   }
 
   //search and delete any pending task in the taskQueue that matches the eui64
-  for (index = 0; index < queueSize; index++) {
-    if (emberAfDeviceTableMatchEui64(taskQueue[index].eui64, newNodeEui64)) {
-      deleteQueueEntry(taskQueue, index);
+  for (index = 0; index < MAX_QUEUE_SIZE; index++) {
+    if (queueSlotInUse(index)
+        && emberAfDeviceTableMatchEui64(taskQueue[index].eui64, newNodeEui64)) {
+      deleteQueueEntry(index);
     }
   }
 }
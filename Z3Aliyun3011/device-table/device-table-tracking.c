@@ -48,6 +48,33 @@ static void optionallyChangeState(EmberNodeId nodeId,
                                   EmberAfPluginDeviceTableDeviceState state);
 static EmberAfPluginDeviceTableDeviceState getCurrentState(EmberNodeId nodeId);
 
+void emAfDeviceTableLivenessHeard(uint16_t index);
+
+// An entry goes offline when nothing has been heard from it for this long.
+#ifndef EMBER_AF_PLUGIN_DEVICE_TABLE_LIVENESS_TIMEOUT_S
+#define EMBER_AF_PLUGIN_DEVICE_TABLE_LIVENESS_TIMEOUT_S 60
+#endif
+#define LIVENESS_TIMEOUT_MS \
+  (EMBER_AF_PLUGIN_DEVICE_TABLE_LIVENESS_TIMEOUT_S * MILLISECOND_TICKS_PER_SECOND)
+
+// Timing wheel of the liveness deadlines.  Both sizes are powers of two so
+// the slot of a deadline stays continuous when the millisecond tick wraps.
+// Deadlines further out than one turn of the wheel stay in their slot until
+// the turn they are due.
+#define LIVENESS_WHEEL_TICK_MS 1024
+#define LIVENESS_WHEEL_SLOTS   64
+#define LIVENESS_WHEEL_NULL_SLOT 0xff
+
+#define livenessEventControl emberAfPluginDeviceTableLivenessEventControl
+EmberEventControl livenessEventControl;
+
+static uint16_t wheelHead[LIVENESS_WHEEL_SLOTS];
+static uint16_t wheelNext[EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE];
+static uint16_t wheelPrev[EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE];
+static uint8_t wheelSlot[EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE];
+static uint16_t wheelCount;
+static uint32_t wheelTime; // start of the slot the wheel is on
+
 // --------------------------------
 // Route Repair functions
 static void serviceReturn(const EmberAfServiceDiscoveryResult* result)
@@ -59,9 +86,7 @@ static void serviceReturn(const EmberAfServiceDiscoveryResult* result)
 bool emAfPluginDeviceTablePreCommandReceivedCallback(EmberAfClusterCommand* cmd)
 {
   uint16_t nodeId = cmd->source;
-  uint32_t currentTimestamp = halCommonGetInt32uMillisecondTick();
   uint32_t index = emAfDeviceTableFindFirstEndpointNodeId(nodeId);
-  EmberAfPluginDeviceTableEntry *deviceTable = emberAfDeviceTablePointer();
 
   if (getCurrentState(nodeId)
       >= EMBER_AF_PLUGIN_DEVICE_TABLE_STATE_LEAVE_SENT
@@ -75,7 +100,7 @@ bool emAfPluginDeviceTablePreCommandReceivedCallback(EmberAfClusterCommand* cmd)
   optionallyChangeState(nodeId, EMBER_AF_PLUGIN_DEVICE_TABLE_STATE_JOINED);
 
   while (index != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX) {
-    deviceTable[index].lastMsgTimestamp = currentTimestamp;
+    emAfDeviceTableLivenessHeard(index);
     index = emAfDeviceTableFindNextEndpoint(index);
   }
 
@@ -234,3 +259,156 @@ bool emAfDeviceTableShouldDeviceLeave(EmberNodeId nodeId)
 {
   return shouldDeviceLeave(nodeId);
 }
+
+// --------------------------------
+// Liveness
+// Every online entry sits in the wheel slot of its deadline, the time it was
+// last heard from plus the timeout.  Hearing from an entry moves it to a new
+// slot; the wheel event only visits the slots it passes, so the work done is
+// proportional to the number of online/offline transitions.
+static uint8_t wheelSlotOf(uint32_t time)
+{
+  return (uint8_t)((time / LIVENESS_WHEEL_TICK_MS) & (LIVENESS_WHEEL_SLOTS - 1));
+}
+
+static void wheelUnlink(uint16_t index)
+{
+  uint8_t slot = wheelSlot[index];
+
+  if (slot == LIVENESS_WHEEL_NULL_SLOT) {
+    return;
+  }
+  if (wheelPrev[index] == EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX) {
+    wheelHead[slot] = wheelNext[index];
+  } else {
+    wheelNext[wheelPrev[index]] = wheelNext[index];
+  }
+  if (wheelNext[index] != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX) {
+    wheelPrev[wheelNext[index]] = wheelPrev[index];
+  }
+  wheelSlot[index] = LIVENESS_WHEEL_NULL_SLOT;
+  wheelCount--;
+}
+
+static void wheelLink(uint16_t index, uint32_t deadline)
+{
+  uint8_t slot = wheelSlotOf(deadline);
+
+  if (wheelSlot[index] == slot) {
+    return;
+  }
+  wheelUnlink(index);
+
+  if (wheelCount == 0) {
+    // The wheel was stopped, restart it on the current slot
+    wheelTime = halCommonGetInt32uMillisecondTick()
+                & ~((uint32_t)LIVENESS_WHEEL_TICK_MS - 1);
+    emberEventControlSetDelayMS(livenessEventControl, LIVENESS_WHEEL_TICK_MS);
+  }
+  wheelPrev[index] = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+  wheelNext[index] = wheelHead[slot];
+  if (wheelHead[slot] != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX) {
+    wheelPrev[wheelHead[slot]] = index;
+  }
+  wheelHead[slot] = index;
+  wheelSlot[index] = slot;
+  wheelCount++;
+}
+
+void emAfDeviceTableLivenessInit(void)
+{
+  uint16_t i;
+
+  for (i = 0; i < LIVENESS_WHEEL_SLOTS; i++) {
+    wheelHead[i] = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+  }
+  for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE; i++) {
+    wheelSlot[i] = LIVENESS_WHEEL_NULL_SLOT;
+  }
+  wheelCount = 0;
+  emberEventControlSetInactive(livenessEventControl);
+}
+
+// Re-arms or disarms an entry after its liveness was changed directly.
+void emAfDeviceTableLivenessUpdate(uint16_t index)
+{
+  EmberAfPluginDeviceTableLiveness *liveness = emberAfDeviceTableLivenessPointer();
+
+  if (liveness[index].online
+      && emberAfDeviceTableGetNodeIdFromIndex(index)
+      != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID) {
+    wheelLink(index, liveness[index].lastMsgTimestamp + LIVENESS_TIMEOUT_MS);
+  } else {
+    wheelUnlink(index);
+  }
+}
+
+void emAfDeviceTableLivenessHeard(uint16_t index)
+{
+  EmberAfPluginDeviceTableLiveness *liveness = emberAfDeviceTableLivenessPointer();
+  uint32_t now = halCommonGetInt32uMillisecondTick();
+
+  liveness[index].lastMsgTimestamp = now;
+  wheelLink(index, now + LIVENESS_TIMEOUT_MS);
+  if (!liveness[index].online) {
+    liveness[index].online = 1;
+    emberAfPluginDeviceTableLivenessChangedCallback(index, true);
+  }
+}
+
+void emberAfDeviceTableSetOffline(uint16_t index)
+{
+  EmberAfPluginDeviceTableLiveness *liveness = emberAfDeviceTableLivenessPointer();
+
+  wheelUnlink(index);
+  if (liveness[index].online) {
+    liveness[index].online = 0;
+    emberAfPluginDeviceTableLivenessChangedCallback(index, false);
+  }
+}
+
+static void expireWheelSlot(uint8_t slot, uint32_t now)
+{
+  EmberAfPluginDeviceTableLiveness *liveness = emberAfDeviceTableLivenessPointer();
+  uint16_t index = wheelHead[slot];
+  uint16_t next;
+
+  while (index != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX) {
+    next = wheelNext[index];
+    if (timeGTorEqualInt32u(now,
+                            liveness[index].lastMsgTimestamp
+                            + LIVENESS_TIMEOUT_MS)) {
+      wheelUnlink(index);
+      if (liveness[index].online) {
+        liveness[index].online = 0;
+        emberAfPluginDeviceTableLivenessChangedCallback(index, false);
+      }
+    }
+    index = next;
+  }
+}
+
+void emberAfPluginDeviceTableLivenessEventHandler(void)
+{
+  uint32_t now = halCommonGetInt32uMillisecondTick();
+  uint8_t turned = 0;
+
+  emberEventControlSetInactive(livenessEventControl);
+
+  // Visit every slot the wheel has fully passed since the last run
+  while (turned < LIVENESS_WHEEL_SLOTS
+         && timeGTorEqualInt32u(now, wheelTime + LIVENESS_WHEEL_TICK_MS)) {
+    expireWheelSlot(wheelSlotOf(wheelTime), now);
+    wheelTime += LIVENESS_WHEEL_TICK_MS;
+    turned++;
+  }
+  if (turned == LIVENESS_WHEEL_SLOTS) {
+    // Fell a whole turn behind, every slot has been visited once
+    wheelTime = now & ~((uint32_t)LIVENESS_WHEEL_TICK_MS - 1);
+  }
+
+  if (wheelCount > 0) {
+    emberEventControlSetDelayMS(livenessEventControl,
+                                wheelTime + LIVENESS_WHEEL_TICK_MS - now);
+  }
+}
@@ -46,9 +46,26 @@
 #endif
 #define EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE MAX_DEV_TABLE_NUMBER
 
+// One cluster list per entry in the worst case, so every entry always gets
+// one.  List indexes are stored in a uint8_t, with 0xff for none.
+#define EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_LIST_COUNT \
+  EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE
+#if EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_LIST_COUNT >= EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_CLUSTER_LIST
+#error "device table too large for uint8_t cluster list indexes"
+#endif
+
 void emAfDeviceTableSave(void);
+void emAfDeviceTableFlush(void);
 void emAfDeviceTableLoad(void);
 
+// Saves are deferred by this long so a join wave ends up in one flush
+#ifndef EMBER_AF_PLUGIN_DEVICE_TABLE_SAVE_DELAY_MS
+#define EMBER_AF_PLUGIN_DEVICE_TABLE_SAVE_DELAY_MS 1000
+#endif
+
+#define saveEventControl emberAfPluginDeviceTableSaveEventControl
+EmberEventControl saveEventControl;
+
 // Framework message send global data
 extern uint8_t appZclBuffer[];
 extern uint16_t appZclBufferLen;
@@ -67,11 +84,328 @@ EmberStatus emberAfGetChildData(uint8_t index,
 void emAfDeviceTableInitiateRouteRepair(EmberNodeId nodeId);
 static void clearDeviceTableIndex(uint16_t index);
 
+// Liveness tracking
+void emAfDeviceTableLivenessInit(void);
+void emAfDeviceTableLivenessUpdate(uint16_t index);
+
+// --------------------------------
+// Lookup indexes
+// nodeIdHash chains every used entry by node ID.  eui64Hash chains the first
+// endpoint of every node by EUI64 and nextEndpointIndex links the remaining
+// endpoints of that node.  The node ID and endpoint chains are kept in
+// ascending index order, so the lookups return the same entry the linear
+// scans did.  Entries without a node ID are not indexed.
+#define DEVICE_TABLE_HASH_SIZE 32 // power of 2
+
+static uint16_t nodeIdHash[DEVICE_TABLE_HASH_SIZE];
+static uint16_t eui64Hash[DEVICE_TABLE_HASH_SIZE];
+static uint16_t nodeIdHashNext[EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE];
+static uint16_t eui64HashNext[EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE];
+static uint16_t nextEndpointIndex[EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE];
+static bool indexed[EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE];
+
+// Entries whose persisted fields differ from TOKEN_DEV_TABLE
+static uint8_t dirtyEntries[(EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE + 7) / 8];
+
+static void markDirty(uint16_t index)
+{
+  dirtyEntries[index >> 3] |= (uint8_t)(1 << (index & 0x07));
+}
+
+static bool isDirty(uint16_t index)
+{
+  return (dirtyEntries[index >> 3] & (1 << (index & 0x07))) != 0;
+}
+
+// Hot per-entry state, see EmberAfPluginDeviceTableLiveness
+static EmberAfPluginDeviceTableLiveness liveness[EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE];
+
+// Entries that are joined, have an EUI64 and a device type the application
+// supports; the periodic sweeps walk this instead of the table.
+static uint8_t joinedSupported[(EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE + 7) / 8];
+
+// Cluster lists shared by reference count between the entries
+static EmberAfPluginDeviceTableClusterList clusterLists[EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_LIST_COUNT];
+
+static uint16_t nodeIdHashKey(EmberNodeId nodeId)
+{
+  return (nodeId ^ (nodeId >> 8)) & (DEVICE_TABLE_HASH_SIZE - 1);
+}
+
+static uint16_t eui64HashKey(const uint8_t *eui64)
+{
+  uint8_t i;
+  uint16_t key = 0;
+
+  for (i = 0; i < EUI64_SIZE; i++) {
+    key = (key * 31) + eui64[i];
+  }
+  return key & (DEVICE_TABLE_HASH_SIZE - 1);
+}
+
+static bool isNullEui64(const uint8_t *eui64)
+{
+  uint8_t i;
+  for (i = 0; i < EUI64_SIZE; i++) {
+    if (eui64[i] != 0xff) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void updateJoinedSupported(uint16_t index)
+{
+  uint8_t mask = (uint8_t)(1 << (index & 0x07));
+
+  if (deviceTable[index].nodeId != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID
+      && deviceTable[index].state == EMBER_AF_PLUGIN_DEVICE_TABLE_STATE_JOINED
+      && !isNullEui64(deviceTable[index].eui64)
+      && emberAfPluginDeviceTableSupportedDeviceCallback(deviceTable[index].deviceId)) {
+    joinedSupported[index >> 3] |= mask;
+  } else {
+    joinedSupported[index >> 3] &= (uint8_t)~mask;
+  }
+}
+
+static void releaseClusterList(uint16_t index)
+{
+  uint8_t list = deviceTable[index].clusterList;
+
+  if (list < EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_LIST_COUNT
+      && clusterLists[list].refCount > 0) {
+    clusterLists[list].refCount--;
+  }
+  deviceTable[index].clusterList = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_CLUSTER_LIST;
+}
+
+static void resetClusterLists(void)
+{
+  uint16_t i;
+
+  MEMSET(clusterLists, 0, sizeof(clusterLists));
+  for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE; i++) {
+    deviceTable[i].clusterList = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_CLUSTER_LIST;
+  }
+}
+
+// Link index into the chain starting at *link, keeping ascending order.
+static void chainInsert(uint16_t *link, uint16_t *next, uint16_t index)
+{
+  while (*link != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX && *link < index) {
+    link = &next[*link];
+  }
+  next[index] = *link;
+  *link = index;
+}
+
+static void chainRemove(uint16_t *link, uint16_t *next, uint16_t index)
+{
+  while (*link != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX) {
+    if (*link == index) {
+      *link = next[index];
+      next[index] = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+      return;
+    }
+    link = &next[*link];
+  }
+}
+
+// Returns the eui64Hash link holding the first endpoint of the node, the link
+// holds the null index if the node is not in the table.
+static uint16_t *eui64HeadLink(const uint8_t *eui64)
+{
+  uint16_t *link = &eui64Hash[eui64HashKey(eui64)];
+
+  while (*link != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX
+         && MEMCOMPARE(deviceTable[*link].eui64, eui64, EUI64_SIZE) != 0) {
+    link = &eui64HashNext[*link];
+  }
+  return link;
+}
+
+static void indexEntry(uint16_t index)
+{
+  uint16_t *link;
+  uint16_t head;
+
+  if (indexed[index]
+      || deviceTable[index].nodeId == EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID) {
+    return;
+  }
+
+  chainInsert(&nodeIdHash[nodeIdHashKey(deviceTable[index].nodeId)],
+              nodeIdHashNext,
+              index);
+
+  link = eui64HeadLink(deviceTable[index].eui64);
+  head = *link;
+  if (head == EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX) {
+    // First endpoint of a new node
+    eui64HashNext[index] = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+    nextEndpointIndex[index] = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+    *link = index;
+  } else if (index < head) {
+    // New first endpoint, it takes over the bucket slot of the old one
+    eui64HashNext[index] = eui64HashNext[head];
+    eui64HashNext[head] = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+    nextEndpointIndex[index] = head;
+    *link = index;
+  } else {
+    chainInsert(&nextEndpointIndex[head], nextEndpointIndex, index);
+  }
+
+  indexed[index] = true;
+}
+
+static void unindexEntry(uint16_t index)
+{
+  uint16_t *link;
+  uint16_t next;
+
+  if (!indexed[index]) {
+    return;
+  }
+
+  chainRemove(&nodeIdHash[nodeIdHashKey(deviceTable[index].nodeId)],
+              nodeIdHashNext,
+              index);
+
+  link = eui64HeadLink(deviceTable[index].eui64);
+  if (*link == index) {
+    next = nextEndpointIndex[index];
+    if (next != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX) {
+      eui64HashNext[next] = eui64HashNext[index];
+      *link = next;
+    } else {
+      *link = eui64HashNext[index];
+    }
+  } else if (*link != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX) {
+    chainRemove(&nextEndpointIndex[*link], nextEndpointIndex, index);
+  }
+
+  eui64HashNext[index] = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+  nextEndpointIndex[index] = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+  indexed[index] = false;
+}
+
+static void resetIndexes(void)
+{
+  uint16_t i;
+
+  for (i = 0; i < DEVICE_TABLE_HASH_SIZE; i++) {
+    nodeIdHash[i] = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+    eui64Hash[i] = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+  }
+  for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE; i++) {
+    nodeIdHashNext[i] = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+    eui64HashNext[i] = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+    nextEndpointIndex[i] = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+    indexed[i] = false;
+  }
+}
+
+// First used index with the node ID, in the same order as a linear scan.
+static uint16_t firstIndexFromNodeId(EmberNodeId nodeId)
+{
+  uint16_t index = nodeIdHash[nodeIdHashKey(nodeId)];
+
+  while (index != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX
+         && deviceTable[index].nodeId != nodeId) {
+    index = nodeIdHashNext[index];
+  }
+  return index;
+}
+
+static uint16_t nextIndexFromNodeId(uint16_t index)
+{
+  EmberNodeId nodeId = deviceTable[index].nodeId;
+
+  index = nodeIdHashNext[index];
+  while (index != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX
+         && deviceTable[index].nodeId != nodeId) {
+    index = nodeIdHashNext[index];
+  }
+  return index;
+}
+
 EmberAfPluginDeviceTableEntry* emberAfDeviceTablePointer(void)
 {
   return deviceTable;
 }
 
+EmberAfPluginDeviceTableLiveness* emberAfDeviceTableLivenessPointer(void)
+{
+  return liveness;
+}
+
+uint16_t emberAfDeviceTableGetNextJoinedSupportedIndex(uint16_t index)
+{
+  while (index < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE) {
+    if (joinedSupported[index >> 3] == 0) {
+      index = (index | 0x07) + 1;
+    } else if (joinedSupported[index >> 3] & (1 << (index & 0x07))) {
+      return index;
+    } else {
+      index++;
+    }
+  }
+  return EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+}
+
+const EmberAfPluginDeviceTableClusterList* emberAfDeviceTableGetClusterList(uint16_t index)
+{
+  uint8_t list;
+
+  assert(index < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE);
+  list = deviceTable[index].clusterList;
+  if (list >= EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_LIST_COUNT) {
+    return NULL;
+  }
+  return &clusterLists[list];
+}
+
+bool emberAfDeviceTableSetClusterList(uint16_t index,
+                                      const uint16_t *clusterIds,
+                                      uint8_t count,
+                                      uint8_t clusterOutStartPosition)
+{
+  uint16_t ids[EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_SIZE];
+  uint8_t freeList = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_CLUSTER_LIST;
+  uint8_t i;
+
+  assert(index < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE);
+
+  for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_SIZE; i++) {
+    ids[i] = (i < count) ? clusterIds[i] : ZCL_NULL_CLUSTER_ID;
+  }
+
+  releaseClusterList(index);
+  for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_LIST_COUNT; i++) {
+    if (clusterLists[i].refCount == 0) {
+      if (freeList == EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_CLUSTER_LIST) {
+        freeList = i;
+      }
+    } else if (clusterLists[i].clusterOutStartPosition == clusterOutStartPosition
+               && MEMCOMPARE(clusterLists[i].clusterIds, ids, sizeof(ids)) == 0) {
+      break;
+    }
+  }
+
+  if (i == EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_LIST_COUNT) {
+    if (freeList == EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_CLUSTER_LIST) {
+      emberAfCorePrintln("DeviceTable: no free cluster list");
+      return false;
+    }
+    i = freeList;
+    MEMCOPY(clusterLists[i].clusterIds, ids, sizeof(ids));
+    clusterLists[i].clusterOutStartPosition = clusterOutStartPosition;
+  }
+  clusterLists[i].refCount++;
+  deviceTable[index].clusterList = i;
+  return true;
+}
+
 uint16_t emberAfDeviceTableGetNodeIdFromIndex(uint16_t index)
 {
   EmberAfPluginDeviceTableEntry *deviceTable = emberAfDeviceTablePointer();
@@ -146,18 +480,18 @@ static void unsetEui64(EmberEUI64 eui64)
 
 static void clearDeviceTableIndex(uint16_t index)
 {
-  uint8_t i;
-
   assert(index < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE);
 
+  unindexEntry(index);
+  markDirty(index);
   deviceTable[index].nodeId = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID;
   unsetEui64(deviceTable[index].eui64);
   deviceTable[index].state = EMBER_AF_PLUGIN_DEVICE_TABLE_STATE_NULL;
   deviceTable[index].endpoint = 0;
-  for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_SIZE; i++) {
-    deviceTable[index].clusterIds[i] = ZCL_NULL_CLUSTER_ID;
-  }
-  deviceTable[index].clusterOutStartPosition = 0;
+  releaseClusterList(index);
+  MEMSET(&liveness[index], 0, sizeof(EmberAfPluginDeviceTableLiveness));
+  emAfDeviceTableLivenessUpdate(index);
+  updateJoinedSupported(index);
 }
 
 void emAfPluginDeviceTableDeleteEntry(uint16_t index)
@@ -179,6 +513,9 @@ void emAfPluginDeviceTableDeleteEntry(uint16_t index)
 void emAfDeviceTableInit(void)
 {
   uint16_t i;
+  resetIndexes();
+  resetClusterLists();
+  emAfDeviceTableLivenessInit();
   for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE; i++) {
     clearDeviceTableIndex(i);
   }
@@ -195,6 +532,18 @@ uint16_t emberAfDeviceTableGetIndexFromEui64AndEndpoint(EmberEUI64 eui64,
                                                         uint8_t endpoint)
 {
   uint16_t i;
+
+  if (!isNullEui64(eui64)) {
+    for (i = *eui64HeadLink(eui64);
+         i != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+         i = nextEndpointIndex[i]) {
+      if (deviceTable[i].endpoint == endpoint) {
+        return i;
+      }
+    }
+    return EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+  }
+
   for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE; i++) {
     if (matchEui64(deviceTable[i].eui64, eui64)
         && deviceTable[i].endpoint == endpoint) {
@@ -207,6 +556,14 @@ uint16_t emberAfDeviceTableGetIndexFromEui64AndEndpoint(EmberEUI64 eui64,
 uint16_t emberAfDeviceTableGetNodeIdFromEui64(EmberEUI64 eui64)
 {
   uint16_t i;
+
+  if (!isNullEui64(eui64)) {
+    i = *eui64HeadLink(eui64);
+    return (i == EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX)
+           ? EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID
+           : deviceTable[i].nodeId;
+  }
+
   for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE; i++) {
     if (matchEui64(deviceTable[i].eui64, eui64) ) {
       return deviceTable[i].nodeId;
@@ -217,19 +574,23 @@ uint16_t emberAfDeviceTableGetNodeIdFromEui64(EmberEUI64 eui64)
 
 bool emberAfDeviceTableGetEui64FromNodeId(EmberNodeId emberNodeId, EmberEUI64 eui64)
 {
-  uint16_t i;
-  for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE; i++) {
-    if (deviceTable[i].nodeId == emberNodeId) {
-      MEMCOPY(eui64, deviceTable[i].eui64, EUI64_SIZE);
-      return true;
-    }
+  uint16_t i = emberAfDeviceTableGetIndexFromNodeId(emberNodeId);
+
+  if (i == EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX) {
+    return false;
   }
-  return false;
+  MEMCOPY(eui64, deviceTable[i].eui64, EUI64_SIZE);
+  return true;
 }
 
 uint16_t emberAfDeviceTableGetIndexFromNodeId(EmberNodeId emberNodeId)
 {
   uint16_t i;
+
+  if (emberNodeId != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID) {
+    return firstIndexFromNodeId(emberNodeId);
+  }
+
   for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE; i++) {
     if (deviceTable[i].nodeId == emberNodeId) {
       return i;
@@ -253,6 +614,18 @@ uint16_t emberAfDeviceTableGetEndpointFromNodeIdAndEndpoint(EmberNodeId emberNod
                                                             uint8_t endpoint)
 {
   uint16_t i;
+
+  if (emberNodeId != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID) {
+    for (i = firstIndexFromNodeId(emberNodeId);
+         i != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+         i = nextIndexFromNodeId(i)) {
+      if (deviceTable[i].endpoint == endpoint) {
+        return i;
+      }
+    }
+    return EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+  }
+
   for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE; i++) {
     if (deviceTable[i].nodeId == emberNodeId
         && deviceTable[i].endpoint == endpoint) {
@@ -277,7 +650,50 @@ void emAfDeviceTableCopyDeviceTableEntry(uint16_t fromIndex, uint16_t toIndex)
   // make sure the toIndex is in the valud range.
   assert(toIndex < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE);
 
+  unindexEntry(toIndex);
+  releaseClusterList(toIndex);
   MEMCOPY(to, from, sizeof(EmberAfPluginDeviceTableEntry));
+  if (to->clusterList < EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_LIST_COUNT) {
+    clusterLists[to->clusterList].refCount++;
+  }
+  liveness[toIndex] = liveness[fromIndex];
+  indexEntry(toIndex);
+  emAfDeviceTableLivenessUpdate(toIndex);
+  updateJoinedSupported(toIndex);
+  markDirty(toIndex);
+}
+
+void emAfDeviceTableSetEntryAddress(uint16_t index,
+                                    EmberNodeId nodeId,
+                                    EmberEUI64 eui64,
+                                    uint8_t endpoint)
+{
+  assert(index < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE);
+
+  unindexEntry(index);
+  deviceTable[index].nodeId = nodeId;
+  MEMCOPY(deviceTable[index].eui64, eui64, EUI64_SIZE);
+  deviceTable[index].endpoint = endpoint;
+  indexEntry(index);
+  updateJoinedSupported(index);
+  markDirty(index);
+}
+
+void emAfDeviceTableSetEntryDeviceId(uint16_t index, uint16_t deviceId)
+{
+  assert(index < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE);
+
+  deviceTable[index].deviceId = deviceId;
+  updateJoinedSupported(index);
+  markDirty(index);
+}
+
+void emAfDeviceTableSetEntryState(uint16_t index, uint8_t newState)
+{
+  assert(index < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE);
+
+  deviceTable[index].state = newState;
+  updateJoinedSupported(index);
 }
 
 uint8_t emAfDeviceTableNumberOfEndpointsFromIndex(uint16_t index)
@@ -286,6 +702,15 @@ uint8_t emAfDeviceTableNumberOfEndpointsFromIndex(uint16_t index)
   uint16_t currentNodeId = emberAfDeviceTableGetNodeIdFromIndex(index);
   uint16_t i;
 
+  if (currentNodeId != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID) {
+    for (i = firstIndexFromNodeId(currentNodeId);
+         i != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+         i = nextIndexFromNodeId(i)) {
+      count++;
+    }
+    return count;
+  }
+
   for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE; i++) {
     if (deviceTable[i].nodeId == currentNodeId) {
       count++;
@@ -318,17 +743,26 @@ static uint16_t findIndexFromEui64AndIndex(EmberEUI64 eui64, uint16_t index)
 
 uint16_t emAfDeviceTableFindFirstEndpointNodeId(uint16_t nodeId)
 {
+  if (nodeId != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID) {
+    return firstIndexFromNodeId(nodeId);
+  }
   return findIndexFromNodeIdAndIndex(nodeId, 0);
 }
 
 uint16_t emAfDeviceTableFindNextEndpoint(uint16_t index)
 {
+  if (indexed[index]) {
+    return nextEndpointIndex[index];
+  }
   return findIndexFromEui64AndIndex(deviceTable[index].eui64,
                                     index + 1);
 }
 
 uint16_t emAfDeviceTableFindFirstEndpointIeee(EmberEUI64 eui64)
 {
+  if (!isNullEui64(eui64)) {
+    return *eui64HeadLink(eui64);
+  }
   return findIndexFromEui64AndIndex(eui64, 0);
 }
 
@@ -337,6 +771,12 @@ uint16_t emberAfDeviceTableGetFirstIndexFromEui64(EmberEUI64 eui64)
   return emAfDeviceTableFindFirstEndpointIeee(eui64);
 }
 
+uint16_t emberAfDeviceTableGetNextEndpointIndex(uint16_t index)
+{
+  assert(index < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE);
+  return emAfDeviceTableFindNextEndpoint(index);
+}
+
 EmberAfStatus emAfDeviceTableAddNewEndpoint(uint16_t index, uint8_t newEndpoint)
 {
   uint16_t newIndex = emAfDeviceTableFindFreeDeviceTableIndex();
@@ -348,6 +788,7 @@ EmberAfStatus emAfDeviceTableAddNewEndpoint(uint16_t index, uint8_t newEndpoint)
   emAfDeviceTableCopyDeviceTableEntry(index, newIndex);
 
   deviceTable[newIndex].endpoint = newEndpoint;
+  markDirty(newIndex);
 
   return EMBER_ZCL_STATUS_SUCCESS;
 }
@@ -355,15 +796,7 @@ EmberAfStatus emAfDeviceTableAddNewEndpoint(uint16_t index, uint8_t newEndpoint)
 uint16_t emAfDeviceTableFindIndexNodeIdEndpoint(uint16_t nodeId,
                                                 uint8_t endpoint)
 {
-  uint16_t i;
-  for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE; i++) {
-    if (deviceTable[i].nodeId == nodeId
-        && deviceTable[i].endpoint == endpoint) {
-      return i;
-    }
-  }
-
-  return EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX;
+  return emberAfDeviceTableGetEndpointFromNodeIdAndEndpoint(nodeId, endpoint);
 }
 
 EmberAfPluginDeviceTableEntry *emberAfDeviceTableFindDeviceTableEntry(uint16_t index)
@@ -377,7 +810,14 @@ void emAfDeviceTableUpdateNodeId(uint16_t currentNodeId, uint16_t newNodeId)
   uint16_t index = emAfDeviceTableFindFirstEndpointNodeId(currentNodeId);
 
   while (index != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX) {
+    // Only the node ID chain depends on the node ID
+    chainRemove(&nodeIdHash[nodeIdHashKey(deviceTable[index].nodeId)],
+                nodeIdHashNext,
+                index);
     deviceTable[index].nodeId = newNodeId;
+    chainInsert(&nodeIdHash[nodeIdHashKey(newNodeId)], nodeIdHashNext, index);
+    updateJoinedSupported(index);
+    markDirty(index);
 
     index = emAfDeviceTableFindNextEndpoint(index);
   }
@@ -387,6 +827,7 @@ void emAfDeviceTableUpdateDeviceState(uint16_t index, uint8_t newState)
 {
   while (index != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX) {
     deviceTable[index].state = newState;
+    updateJoinedSupported(index);
 
     index = emAfDeviceTableFindNextEndpoint(index);
   }
@@ -396,7 +837,7 @@ uint32_t emberAfDeviceTableTimeSinceLastMessage(uint16_t index)
 {
   uint32_t timeSinceLastMessage = halCommonGetInt32uMillisecondTick();
 
-  timeSinceLastMessage -= deviceTable[index].lastMsgTimestamp;
+  timeSinceLastMessage -= liveness[index].lastMsgTimestamp;
   timeSinceLastMessage /= MILLISECOND_TICKS_PER_SECOND;
 
   return timeSinceLastMessage;
@@ -430,11 +871,28 @@ void emberAfPluginDeviceTableStackStatusCallback(EmberStatus status)
 
 // --------------------------------
 // Save/Load the devices
+// The mutators mark the entries they touch dirty, saving only schedules a
+// flush, which writes the dirty entries without reading the tokens back.
 void emAfDeviceTableSave(void)
+{
+  if (!emberEventControlGetActive(saveEventControl)) {
+    emberEventControlSetDelayMS(saveEventControl,
+                                EMBER_AF_PLUGIN_DEVICE_TABLE_SAVE_DELAY_MS);
+  }
+}
+
+void emberAfPluginDeviceTableSaveEventHandler(void)
+{
+  emberEventControlSetInactive(saveEventControl);
+  emAfDeviceTableFlush();
+}
+
+void emAfDeviceTableFlush(void)
 {
 #if defined(EZSP_HOST) && !defined(EMBER_TEST)
   FILE *fp;
   EmberAfPluginDeviceTableEntry *deviceTable = emberAfDeviceTablePointer();
+  const EmberAfPluginDeviceTableClusterList *clusterList;
   uint8_t i;
   uint8_t j;
 
@@ -453,10 +911,12 @@ void emAfDeviceTableSave(void)
       for (j = 0; j < 8; j++) {
         fprintf(fp, "%x ", deviceTable[i].eui64[j]);
       }
+      clusterList = emberAfDeviceTableGetClusterList(i);
       for (j = 0; j < EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_SIZE; j++) {
-        fprintf(fp, "%x ", deviceTable[i].clusterIds[j]);
+        fprintf(fp, "%x ",
+                clusterList ? clusterList->clusterIds[j] : ZCL_NULL_CLUSTER_ID);
       }
-      fprintf(fp, "%d ", deviceTable[i].clusterOutStartPosition);
+      fprintf(fp, "%d ", clusterList ? clusterList->clusterOutStartPosition : 0);
     }
   }
 
@@ -470,20 +930,42 @@ void emAfDeviceTableSave(void)
     tokTypeDevTable data;
     uint8_t i;
 
+    emberEventControlSetInactive(saveEventControl);
+
     for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE; i++) {
+        if (!isDirty(i)) {
+            continue;
+        }
         memset(&data, 0xFF, sizeof(data));
-        halCommonGetIndexedToken(&data, TOKEN_DEV_TABLE, i);
-        if (deviceTable[i].nodeId != data.nodeId
-            || deviceTable[i].endpoint != data.endpoint
-            || deviceTable[i].deviceId != data.deviceId
-            || 0 != MEMCOMPARE(deviceTable[i].eui64, data.eui64, EUI64_SIZE)) {
+        if (deviceTable[i].nodeId != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID) {
             data.endpoint = deviceTable[i].endpoint;
             data.deviceId = deviceTable[i].deviceId;
             data.nodeId = deviceTable[i].nodeId;
             MEMCOPY(data.eui64, deviceTable[i].eui64, EUI64_SIZE);
-            halCommonSetIndexedToken(TOKEN_DEV_TABLE, i, &data);
         }
+        halCommonSetIndexedToken(TOKEN_DEV_TABLE, i, &data);
     }
+    memset(dirtyEntries, 0, sizeof(dirtyEntries));
+}
+
+// A token that cannot be a joined endpoint, e.g. left over by an older image
+static bool isValidDevTableToken(const tokTypeDevTable *data)
+{
+  uint8_t i;
+  bool allZero = true;
+
+  if (data->nodeId >= EMBER_MIN_BROADCAST_ADDRESS
+      || data->endpoint == 0x00
+      || data->endpoint == 0xFF
+      || isNullEui64(data->eui64)) {
+    return false;
+  }
+  for (i = 0; i < EUI64_SIZE; i++) {
+    if (data->eui64[i] != 0x00) {
+      allZero = false;
+    }
+  }
+  return !allZero;
 }
 
 void emAfDeviceTableLoad(void)
@@ -494,6 +976,7 @@ void emAfDeviceTableLoad(void)
   FILE *fp;
   unsigned int data, data2, data3;
   EmberAfPluginDeviceTableEntry *deviceTable = emberAfDeviceTablePointer();
+  uint16_t clusterIds[EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_SIZE];
 
   fp = fopen("devices.txt", "r");
 
@@ -516,15 +999,18 @@ void emAfDeviceTableLoad(void)
       }
       for (j = 0; j < EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_SIZE; j++) {
         fscanf(fp, "%x", &data);
-        deviceTable[i].clusterIds[j] = (uint16_t) data;
+        clusterIds[j] = (uint16_t) data;
       }
       fscanf(fp, "%d", &data);
-      deviceTable[i].clusterOutStartPosition = (uint16_t) data;
+      emberAfDeviceTableSetClusterList(i,
+                                       clusterIds,
+                                       EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_SIZE,
+                                       (uint8_t) data);
 
       deviceTable[i].state = EMBER_AF_PLUGIN_DEVICE_TABLE_STATE_JOINED;
     }
 
-    deviceTable[i].lastMsgTimestamp = halCommonGetInt32uMillisecondTick();
+    liveness[i].lastMsgTimestamp = halCommonGetInt32uMillisecondTick();
   }
 
   fclose(fp);
@@ -537,28 +1023,45 @@ void emAfDeviceTableLoad(void)
 #endif // #if defined(EZSP_HOST) && !defined(EMBER_TEST)
 
     EmberAfPluginDeviceTableEntry *deviceTable = emberAfDeviceTablePointer();
+    resetIndexes();
     memset(deviceTable, 0xFF, sizeof(EmberAfPluginDeviceTableEntry) * EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE);
+    memset(dirtyEntries, 0, sizeof(dirtyEntries));
+    memset(liveness, 0, sizeof(liveness));
+    memset(joinedSupported, 0, sizeof(joinedSupported));
+    resetClusterLists();
+    emAfDeviceTableLivenessInit();
 
     tokTypeDevTable data;
     uint8_t i;
 
+    // One pass over the tokens at boot, entries that do not validate or
+    // duplicate an earlier endpoint are dropped and erased by the next flush.
     for (i = 0; i < EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE; i++) {
         memset(&data, 0xFF, sizeof(data));
         halCommonGetIndexedToken(&data, TOKEN_DEV_TABLE, i);
+        if (data.nodeId != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID
+            && (!isValidDevTableToken(&data)
+                || emberAfDeviceTableGetIndexFromEui64AndEndpoint(data.eui64, data.endpoint)
+                   != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX)) {
+            emberAfCorePrintln("DeviceTable: drop token %d", i);
+            data.nodeId = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID;
+            markDirty(i);
+        }
         if (data.nodeId != EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID) {
             deviceTable[i].endpoint = data.endpoint;
             deviceTable[i].deviceId = data.deviceId;
             deviceTable[i].nodeId = data.nodeId;
             deviceTable[i].state = EMBER_AF_PLUGIN_DEVICE_TABLE_STATE_JOINED;
             deviceTable[i].cloud_devid = -1;
-            deviceTable[i].online = 0;
-            deviceTable[i].keepalive_failcnt = 0;
-            deviceTable[i].keepalive_seq = 0;
             MEMCOPY(deviceTable[i].eui64, data.eui64, EUI64_SIZE);
+            indexEntry(i);
+            updateJoinedSupported(i);
         } else {
             deviceTable[i].nodeId = EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID;
         }
     }
+
+    emAfDeviceTableSave();
 }
 
 // --------------------------------
@@ -31,23 +31,38 @@ enum {
 
 #define EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_SIZE 20
 
+// Endpoints reporting the same clusters share one cluster list.  There are
+// as many lists as table entries, see device-table.c.
+#define EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_CLUSTER_LIST 0xff
+
+typedef struct {
+  uint16_t clusterIds[EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_SIZE];
+  uint8_t clusterOutStartPosition;
+  uint8_t refCount;
+} EmberAfPluginDeviceTableClusterList;
+
 typedef struct {
   uint8_t     endpoint;
   uint16_t    deviceId;
-  uint32_t    lastMsgTimestamp;
   EmberNodeId nodeId;
   EmberEUI64  eui64;
   EmberAfPluginDeviceTableDeviceState state;
-  uint16_t clusterIds[EMBER_AF_PLUGIN_DEVICE_TABLE_CLUSTER_SIZE];
-  uint8_t clusterOutStartPosition;
+  uint8_t     clusterList;
 
   //appended
-  uint8_t           online;
-  uint8_t           keepalive_failcnt;
-  uint8_t           keepalive_seq;
   int               cloud_devid;
 } EmberAfPluginDeviceTableEntry;
 
+// Per-entry fields written on every received message and read by the
+// periodic sweeps.  They are kept in their own array, indexed like the
+// device table, so the sweeps do not pull in the entries.  online is
+// maintained by the liveness tracker, see
+// emberAfPluginDeviceTableLivenessChangedCallback().
+typedef struct {
+  uint32_t          lastMsgTimestamp;
+  uint8_t           online;
+} EmberAfPluginDeviceTableLiveness;
+
 #define EMBER_AF_PLUGIN_DEVICE_TABLE_DEVICE_TABLE_SIZE 250
 #define EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_NODE_ID 0xffff
 #define EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX 0xffff
@@ -254,6 +269,100 @@ void emberAfPluginDeviceTableInitiateRouteRepair(EmberNodeId nodeId);
  */
 EmberAfPluginDeviceTableEntry* emberAfDeviceTablePointer(void);
 
+/** @brief Returns a pointer to the liveness array.
+ *
+ * Returns a pointer to the liveness array, which is indexed like the device
+ * table.
+ *
+ * @return  A pointer to the liveness array.
+ */
+EmberAfPluginDeviceTableLiveness* emberAfDeviceTableLivenessPointer(void);
+
+/** @brief Takes an entry offline.
+ *
+ * Marks the entry offline before its liveness timeout, e.g. when the device
+ * left the network, and stops tracking it until it is heard from again.
+ * emberAfPluginDeviceTableLivenessChangedCallback() is called if the entry
+ * was online.  Clearing the online flag through
+ * emberAfDeviceTableLivenessPointer() does neither.
+ *
+ * @param index  The index of the device table entry.
+ */
+void emberAfDeviceTableSetOffline(uint16_t index);
+
+/** @brief Finds the next joined device of a supported type.
+ *
+ * Returns the first index at or after the given one whose entry has joined,
+ * has a valid EUI64 and a device ID accepted by
+ * emberAfPluginDeviceTableSupportedDeviceCallback().  The answer comes from
+ * a bitmap, so iterating this way does not touch the device table entries.
+ *
+ * @param index  The index at which to start looking.
+ *
+ * @return  The index found, or EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX.
+ */
+uint16_t emberAfDeviceTableGetNextJoinedSupportedIndex(uint16_t index);
+
+/** @brief Finds the next endpoint of the same node.
+ *
+ * @param index  The index of an endpoint of the node.
+ *
+ * @return  The index of the node's next endpoint, or
+ * EMBER_AF_PLUGIN_DEVICE_TABLE_NULL_INDEX.
+ */
+uint16_t emberAfDeviceTableGetNextEndpointIndex(uint16_t index);
+
+/** @brief Returns the cluster list of an entry.
+ *
+ * @param index  The index of the device table entry.
+ *
+ * @return  The shared cluster list, or NULL if the clusters are not known.
+ */
+const EmberAfPluginDeviceTableClusterList* emberAfDeviceTableGetClusterList(uint16_t index);
+
+/** @brief Sets the cluster list of an entry.
+ *
+ * The input clusters come first in clusterIds followed by the output
+ * clusters.  The list is shared with any other entry reporting the same
+ * clusters.
+ *
+ * @param index  The index of the device table entry.
+ * @param clusterIds  The cluster IDs.
+ * @param count  The number of cluster IDs.
+ * @param clusterOutStartPosition  The position of the first output cluster.
+ *
+ * @return  True if the list was stored.  There are as many lists as
+ * entries, so this does not fail for a valid index.
+ */
+bool emberAfDeviceTableSetClusterList(uint16_t index,
+                                      const uint16_t *clusterIds,
+                                      uint8_t count,
+                                      uint8_t clusterOutStartPosition);
+
+/** @brief Supported device
+ *
+ * Called when an entry joins or changes to decide whether it is one the
+ * application tracks, see emberAfDeviceTableGetNextJoinedSupportedIndex().
+ *
+ * @param deviceId  The device ID of the entry.
+ *
+ * @return  True if the application tracks devices with this ID.
+ */
+bool emberAfPluginDeviceTableSupportedDeviceCallback(uint16_t deviceId);
+
+/** @brief Liveness changed
+ *
+ * Called when an entry comes online, because a message was heard from the
+ * device or it just joined, and when it goes offline because nothing was
+ * heard from it for EMBER_AF_PLUGIN_DEVICE_TABLE_LIVENESS_TIMEOUT_S seconds
+ * or emberAfDeviceTableSetOffline() was called.
+ *
+ * @param index  The index of the device table entry.
+ * @param online  The new liveness of the entry.
+ */
+void emberAfPluginDeviceTableLivenessChangedCallback(uint16_t index,
+                                                     bool online);
+
 /** @brief Returns a pointer to the device table entry.
  *
  * Returns a pointer to the device table entry based on the device table index.
@@ -6,6 +6,13 @@
 #include "cJSON.h"
 
 #include "sdk_include.h"
+#ifdef INFRA_TRACE
+    #include "infra_trace.h"
+#endif
+#ifdef INFRA_DLOG
+    #include "infra_log.h"
+    #include "infra_dlog.h"
+#endif
 #include "app/framework/include/af.h"
 #include "app/framework/plugin/device-table/device-table.h"
 #include "aliyun_main.h"
@@ -13,6 +20,10 @@
 extern void emberAfCloudConnectedHandler();
 extern void emberAfDeviceTableCommandIndexSendByDeviceID(uint16_t deviceid, uint8_t sendtimes);
 
+#ifdef INFRA_DLOG
+#define ALIYUN_TRACE(...)   iotx_dlog(LOG_INFO_LEVEL, __func__, __LINE__, __VA_ARGS__)
+#define ALIYUN_ERROR(...)   iotx_dlog(LOG_ERR_LEVEL, __func__, __LINE__, __VA_ARGS__)
+#else
 #define ALIYUN_TRACE(...) \
     do { \
         HAL_Printf("\033[1;32;40m%s.%d: ", __func__, __LINE__); \
@@ -25,6 +36,7 @@ extern void emberAfDeviceTableCommandIndexSendByDeviceID(uint16_t deviceid, uint
         HAL_Printf(__VA_ARGS__); \
         HAL_Printf("\033[0m\r\n"); \
     } while (0)
+#endif
 
 typedef struct {
     int     master_devid;
@@ -154,6 +166,15 @@ int aliyun_form_devicename(uint16_t deviceid, EmberEUI64 eui64, uint8_t endpoint
     return 0;
 }
 
+static void aliyun_zigbee_command_send(EmberEUI64 eui64, uint8_t endpoint)
+{
+    emberAfDeviceTableCommandSendWithEndpoint(eui64, endpoint);
+#ifdef INFRA_TRACE
+    /* the first command of a property set ends its trace, the others are no-ops */
+    iotx_trace_end(IOTX_TRACE_ZIGBEE_SEND);
+#endif
+}
+
 static int aliyun_lightswitch_property_set(int devid, cJSON *json_item)
 {
     int        res = 0;
@@ -175,7 +196,7 @@ static int aliyun_lightswitch_property_set(int devid, cJSON *json_item)
     }
 
     
-    emberAfDeviceTableCommandSendWithEndpoint(eui64, endpoint);
+    aliyun_zigbee_command_send(eui64, endpoint);
     return 0;
 }
 
@@ -196,7 +217,7 @@ static int aliyun_brightness_property_set(int devid, cJSON *json_item)
     val = json_item->valueint;
     brightness = (uint8_t)(val * 255.0 / 100);
     emberAfFillCommandLevelControlClusterMoveToLevelWithOnOff(brightness, 0);
-    emberAfDeviceTableCommandSendWithEndpoint(eui64, endpoint);
+    aliyun_zigbee_command_send(eui64, endpoint);
     return 0;
 }
 
@@ -222,7 +243,7 @@ static int aliyun_colorTemperature_property_set(int devid, cJSON *json_item)
     
     colortemps = (int16_t)(1000000/val);
     emberAfFillCommandColorControlClusterMoveToColorTemperature(colortemps, 0, 0, 0);
-    emberAfDeviceTableCommandSendWithEndpoint(eui64, endpoint);
+    aliyun_zigbee_command_send(eui64, endpoint);
     return 0;
 }
 
@@ -262,7 +283,7 @@ static int aliyun_curtain_property_set(int devid, cJSON *json_item)
         }
     }
 
-    emberAfDeviceTableCommandSendWithEndpoint(eui64, endpoint);
+    aliyun_zigbee_command_send(eui64, endpoint);
     return 0;
 }
 
@@ -276,6 +297,9 @@ static int aliyun_property_set_event_handler(const int devid, const char *reques
     ALIYUN_TRACE("Property Set Received, Devid: %d, Request: %s", devid, request);
 
     json_root = cJSON_Parse(request);
+#ifdef INFRA_TRACE
+    iotx_trace_point(IOTX_TRACE_PROPERTY_PARSED);
+#endif
     if (json_root) {
 
         /*light switch  */
@@ -318,6 +342,62 @@ static int aliyun_property_set_event_handler(const int devid, const char *reques
     return 0;
 }
 
+#ifdef OTA_RELAY_ENABLED
+/*
+ * SubDevOta service of the gateway, {"Url":"...","Size":123,"Md5":"..."}
+ * or with "Sha256" in place of "Md5": fetch a Zigbee OTA file into the relay cache for the nodes to upgrade from.
+ * The reply only says whether the download was queued.
+ */
+#define ALIYUN_SERVICE_SUBDEV_OTA   "SubDevOta"
+
+static int aliyun_service_request_event_handler(const int devid, const char *serviceid, const int serviceid_len,
+        const char *request, const int request_len,
+        char **response, int *response_len)
+{
+    int        res = -1;
+    cJSON     *json_root = NULL;
+    cJSON     *json_url = NULL;
+    cJSON     *json_size = NULL;
+    cJSON     *json_digest = NULL;
+    const char *reply = NULL;
+    aliyun_ctx_t *aliyun_ctx = aliyun_get_ctx();
+
+    ALIYUN_TRACE("Service Request Received, Devid: %d, Service: %.*s", devid, serviceid_len, serviceid);
+
+    if (aliyun_ctx->master_devid != devid ||
+        serviceid_len != strlen(ALIYUN_SERVICE_SUBDEV_OTA) ||
+        0 != strncmp(serviceid, ALIYUN_SERVICE_SUBDEV_OTA, serviceid_len)) {
+        return -1;
+    }
+
+    json_root = cJSON_Parse(request);
+    if (json_root) {
+        json_url = cJSON_GetObjectItem(json_root, "Url");
+        json_size = cJSON_GetObjectItem(json_root, "Size");
+        json_digest = cJSON_GetObjectItem(json_root, "Sha256");
+        if (json_digest == NULL) {
+            json_digest = cJSON_GetObjectItem(json_root, "Md5");
+        }
+        if (json_url && cJSON_IsString(json_url) &&
+            json_size && cJSON_IsNumber(json_size) && json_size->valueint > 0 &&
+            json_digest && cJSON_IsString(json_digest)) {
+            res = IOT_OtaRelay_Start(json_url->valuestring, (uint32_t)json_size->valueint, json_digest->valuestring);
+        }
+        cJSON_Delete(json_root);
+    }
+    ALIYUN_TRACE("SubDevOta start res=%d", res);
+
+    reply = (0 == res) ? "{\"Result\":0}" : "{\"Result\":-1}";
+    *response = HAL_Malloc(strlen(reply) + 1);
+    if (NULL != *response) {
+        memcpy(*response, reply, strlen(reply) + 1);
+        *response_len = strlen(reply);
+    }
+
+    return res;
+}
+#endif
+
 static int aliyun_report_reply_event_handler(const int devid, const int msgid, const int code, const char *reply,
         const int reply_len)
 {
@@ -400,7 +480,13 @@ int aliyun_connect_cloud()
 
     memset(aliyun_ctx, 0, sizeof(aliyun_ctx_t));
 
+#ifdef INFRA_DLOG
+    /* deferred logs cost the calling task a ring write, debug ones included */
     IOT_SetLogLevel(IOT_LOG_DEBUG);
+#else
+    /* printed logs block the MQTT and WiFi tasks, keep them to warnings */
+    IOT_SetLogLevel(IOT_LOG_WARNING);
+#endif
 
     /* Register Callback */
     IOT_RegisterCallback(ITE_CONNECT_SUCC, aliyun_connected_event_handler);
@@ -410,6 +496,9 @@ int aliyun_connect_cloud()
     IOT_RegisterCallback(ITE_TIMESTAMP_REPLY, aliyun_timestamp_reply_event_handler);
     IOT_RegisterCallback(ITE_INITIALIZE_COMPLETED, aliyun_initialized);
     IOT_RegisterCallback(ITE_PERMIT_JOIN, aliyun_permit_join_event_handler);
+#ifdef OTA_RELAY_ENABLED
+    IOT_RegisterCallback(ITE_SERVICE_REQUEST, aliyun_service_request_event_handler);
+#endif
 
     memset(&master_meta_info, 0, sizeof(iotx_linkkit_dev_meta_info_t));
     HAL_GetProductKey(master_meta_info.product_key);
@@ -566,3 +655,24 @@ int aliyun_del_subdev(int devid)
     ALIYUN_TRACE("subdev logout success: devid = %d\n", devid);
     return 0;    
 }
+
+void aliyun_show_stats(void)
+{
+    iotx_linkkit_stats_t linkkit_stats;
+    iotx_mqtt_stats_t    mqtt_stats;
+
+    if (0 == IOT_Linkkit_GetStats(&linkkit_stats)) {
+        HAL_Printf("dm ipc: %d/%d high-water %d drops %d\r\n", linkkit_stats.ipc_size,
+                   linkkit_stats.ipc_max_size, linkkit_stats.ipc_high_water, linkkit_stats.ipc_drops);
+        HAL_Printf("dm msg cache: %d/%d\r\n", linkkit_stats.msg_cache_size, linkkit_stats.msg_cache_max_size);
+    }
+
+    if (0 == IOT_MQTT_GetStats(NULL, &mqtt_stats)) {
+        HAL_Printf("mqtt pub-wait: %d/%d high-water %d\r\n", mqtt_stats.pub_wait,
+                   mqtt_stats.pub_wait_max, mqtt_stats.pub_wait_high_water);
+        HAL_Printf("mqtt rx pool: %d/%d misses %d\r\n", mqtt_stats.rx_pool_used,
+                   mqtt_stats.rx_pool_size, mqtt_stats.rx_pool_misses);
+    } else {
+        HAL_Printf("mqtt: no client\r\n");
+    }
+}
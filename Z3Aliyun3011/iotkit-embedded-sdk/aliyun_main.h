@@ -19,6 +19,7 @@ bool aliyun_is_cloud_connected();
 int aliyun_add_subdev(EmberEUI64 eui64, uint8_t endpoint, uint16_t deviceid, int *pdevid);
 int aliyun_del_subdev(int devid);
 void aliyun_post_property(int devid, char *property_payload);
+void aliyun_show_stats(void);
 
 #ifdef __cplusplus
 #if __cplusplus
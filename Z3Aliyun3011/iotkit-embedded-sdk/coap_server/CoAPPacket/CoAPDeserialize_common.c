@@ -29,9 +29,11 @@ int CoAPDeserialize_Token(CoAPMessage *msg, unsigned char *buf)
     return msg->header.tokenlen;
 }
 
-static int CoAPDeserialize_Option(CoAPMsgOption *option, unsigned char *buf, unsigned short *predeltas)
+/* The options and the payload point into buf, so every length is checked against buflen */
+static int CoAPDeserialize_Option(CoAPMsgOption *option, unsigned char *buf, int buflen, unsigned short *predeltas)
 {
     unsigned char  *ptr      = buf;
+    unsigned char  *end      = buf + buflen;
     unsigned short optdelta  = 0;
     unsigned short optlen    = 0;
     unsigned short predelta  = 0;
@@ -40,6 +42,13 @@ static int CoAPDeserialize_Option(CoAPMsgOption *option, unsigned char *buf, uns
     optlen    = (*ptr & 0x0F);
     ptr++;
 
+    if (15 == optdelta || 15 == optlen) {
+        return -1;
+    }
+    if ((ptr - buf) + (optdelta >= 13 ? optdelta - 12 : 0) + (optlen >= 13 ? optlen - 12 : 0) > buflen) {
+        return -1;
+    }
+
     predelta = *predeltas;
     if (13 == optdelta) {
         predelta += 13 + *ptr;
@@ -65,6 +74,9 @@ static int CoAPDeserialize_Option(CoAPMsgOption *option, unsigned char *buf, uns
         ptr += 2;
     }
     option->len = optlen;
+    if (optlen > end - ptr) {
+        return -1;
+    }
 
     option->val = ptr;
     *predeltas = option->num;
@@ -77,12 +89,15 @@ int CoAPDeserialize_Options(CoAPMessage *msg, unsigned char *buf, int buflen)
     int  index = 0;
     int  count = 0;
     unsigned char  *ptr      = buf;
-    unsigned short len       = 0;
+    int            len       = 0;
     unsigned short optdeltas = 0;
 
     msg->optcount = 0;
     while ((count < buflen) && (0xFF != *ptr)) {
-        len = CoAPDeserialize_Option(&msg->options[index], ptr, &optdeltas);
+        len = CoAPDeserialize_Option(&msg->options[index], ptr, buflen - count, &optdeltas);
+        if (len < 0) {
+            return -1;
+        }
         msg->optcount += 1;
         ptr += len;
         index ++;
@@ -103,7 +118,7 @@ int CoAPDeserialize_Payload(CoAPMessage *msg, unsigned char *buf, int buflen)
 {
     unsigned char *ptr = buf;
 
-    if (0xFF == *ptr) {
+    if (buflen > 0 && 0xFF == *ptr) {
         ptr ++;
     } else {
         return 0;
@@ -134,6 +149,9 @@ int CoAPDeserialize_Message(CoAPMessage *msg, unsigned char *buf, int buflen)
     remlen -= count;
 
     /* Deserialize the token, if any. */
+    if (msg->header.tokenlen > COAP_MSG_MAX_TOKEN_LEN || msg->header.tokenlen > remlen) {
+        return COAP_ERROR_INVALID_LENGTH;
+    }
     count = CoAPDeserialize_Token(msg, ptr);
     ptr += count;
     remlen -= count;
@@ -12,6 +12,8 @@
 extern "C" {
 #endif /* __cplusplus */
 
+int CoAPSerialize_Header(CoAPMessage *msg, unsigned char *buf, unsigned short buflen);
+
 unsigned short CoAPSerialize_MessageLength(CoAPMessage *msg);
 
 int CoAPSerialize_Message(CoAPMessage *msg, unsigned char *buf, unsigned short buflen);
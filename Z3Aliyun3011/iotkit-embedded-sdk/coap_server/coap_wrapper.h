@@ -49,6 +49,12 @@ int HAL_UDP_recvfrom(intptr_t sockfd,
                      unsigned char *p_data,
                      unsigned int datalen,
                      unsigned int timeout_ms);
+int HAL_UDP_recvfrom_borrow(intptr_t sockfd,
+                            NetworkAddr *p_remote,
+                            unsigned char **pp_data,
+                            unsigned int timeout_ms);
+void HAL_UDP_recvfrom_release(intptr_t sockfd);
+void HAL_UDP_wakeup(intptr_t sockfd);
 int HAL_UDP_sendto(intptr_t sockfd,
                    const NetworkAddr *p_remote,
                    const unsigned char *p_data,
@@ -62,6 +68,7 @@ p_HAL_Aes128_t HAL_Aes128_Init(
             const uint8_t *iv,
             AES_DIR_t dir);
 int HAL_Aes128_Destroy(p_HAL_Aes128_t aes);
+int HAL_Aes128_Set_Iv(p_HAL_Aes128_t aes, const uint8_t *iv);
 int HAL_Aes128_Cbc_Encrypt(
             p_HAL_Aes128_t aes,
             const void *src,
@@ -10,6 +10,14 @@
 #define COAP_MSG_MAX_PDU_LEN      4096
 #endif
 
+/* Parse received datagrams in place in the UDP rx queue, no recvbuf copy */
+#define COAP_RECV_ZERO_COPY
+
+/* Buckets of the send list msgid/token lookup tables, must be a power of 2 */
+#ifndef COAP_SENDLIST_HASH_SIZE
+#define COAP_SENDLIST_HASH_SIZE   16
+#endif
+
 #ifndef CONFIG_COAP_AUTH_TIMEOUT
     #define CONFIG_COAP_AUTH_TIMEOUT        (3 * 1000)
 #endif
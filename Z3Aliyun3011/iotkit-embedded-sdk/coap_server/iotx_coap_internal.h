@@ -171,6 +171,7 @@ typedef void (*CoAPSendMsgHandler)(CoAPContext *context, CoAPReqResult result, v
 
 typedef void (*CoAPEventNotifier)(unsigned int event, NetworkAddr *remote, void *message);
 
+/* message options/payload point into the receive buffer and are only valid during the call */
 typedef void (*CoAPRecvMsgHandler)(CoAPContext *context, const char *paths, NetworkAddr *remote, CoAPMessage *message);
 
 typedef int (*CoAPDataEncrypt)(CoAPContext *context, const char *paths, NetworkAddr *addr, CoAPMessage *message,
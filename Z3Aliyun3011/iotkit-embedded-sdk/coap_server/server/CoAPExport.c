@@ -29,6 +29,7 @@
 
 CoAPContext *CoAPContext_create(CoAPInitParam *param)
 {
+    int                index = 0;
     CoAPIntContext    *p_ctx = NULL;
     NetworkInit    network_param;
 
@@ -59,12 +60,14 @@ CoAPContext *CoAPContext_create(CoAPInitParam *param)
     memset(p_ctx->sendbuf, 0x00, COAP_MSG_MAX_PDU_LEN);
 #endif
 
+#ifndef COAP_RECV_ZERO_COPY
     p_ctx->recvbuf = coap_malloc(COAP_MSG_MAX_PDU_LEN);
     if (NULL == p_ctx->recvbuf) {
         COAP_ERR("not enough memory");
         goto err;
     }
     memset(p_ctx->recvbuf, 0x00, COAP_MSG_MAX_PDU_LEN);
+#endif
 
     if (0 == param->waittime) {
         p_ctx->waittime = COAP_DEFAULT_WAIT_TIME_MS;
@@ -82,6 +85,11 @@ CoAPContext *CoAPContext_create(CoAPInitParam *param)
     HAL_MutexLock(p_ctx->sendlist.list_mutex);
     /*CoAP message send list*/
     INIT_LIST_HEAD(&p_ctx->sendlist.list);
+    for (index = 0; index < COAP_SENDLIST_HASH_SIZE; index++) {
+        INIT_LIST_HEAD(&p_ctx->sendhash_id[index]);
+        INIT_LIST_HEAD(&p_ctx->sendhash_token[index]);
+    }
+    INIT_LIST_HEAD(&p_ctx->sendtimer);
     p_ctx->sendlist.count = 0;
     HAL_MutexUnlock(p_ctx->sendlist.list_mutex);
 
@@ -209,6 +217,7 @@ void CoAPContext_free(CoAPContext *context)
         }
     }
     INIT_LIST_HEAD(&p_ctx->sendlist.list);
+    INIT_LIST_HEAD(&p_ctx->sendtimer);
     HAL_MutexUnlock(p_ctx->sendlist.list_mutex);
     HAL_MutexDestroy(p_ctx->sendlist.list_mutex);
     p_ctx->sendlist.list_mutex = NULL;
@@ -85,6 +85,10 @@ extern int CoAPMessage_retransmit(CoAPContext *context);
 
 extern int CoAPMessage_cycle(CoAPContext *context);
 
+extern int CoAPMessage_yield(CoAPContext *context, unsigned int max_wait_ms);
+
+extern void CoAPMessage_wakeup(CoAPContext *context);
+
 extern int CoAPMessage_cancel(CoAPContext *context, CoAPMessage *message);
 
 extern int CoAPMessageId_cancel(CoAPContext *context, unsigned short msgid);
@@ -32,6 +32,9 @@ typedef struct
     unsigned char            *sendbuf;
     unsigned char            *recvbuf;
     CoAPList                 sendlist;
+    struct list_head         sendhash_id[COAP_SENDLIST_HASH_SIZE];
+    struct list_head         sendhash_token[COAP_SENDLIST_HASH_SIZE];
+    struct list_head         sendtimer;
     CoAPList                 obsserver;
     CoAPList                 obsclient;
     CoAPList                 resource;
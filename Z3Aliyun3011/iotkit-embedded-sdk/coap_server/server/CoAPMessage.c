@@ -70,12 +70,53 @@ int CoAPMessageHandler_set(CoAPMessage *message, CoAPSendMsgHandler handler)
     return COAP_SUCCESS;
 }
 
+static unsigned int CoAPToken_hash(const unsigned char *token, unsigned char tokenlen)
+{
+    unsigned int hash = 2166136261u;
+    unsigned char index = 0;
+
+    for (index = 0; index < tokenlen; index++) {
+        hash = (hash ^ token[index]) * 16777619u;
+    }
+    return hash & (COAP_SENDLIST_HASH_SIZE - 1);
+}
+
+#define CoAPMsgId_hash(msgid) ((msgid) & (COAP_SENDLIST_HASH_SIZE - 1))
+
+/*
+ * Insert the node into the retransmit queue, which is ordered by deadline. Must hold the list mutex.
+ * Return 1 if the node becomes the nearest deadline.
+ */
+static int CoAPSendNode_schedule(CoAPIntContext *ctx, CoAPSendNode *node)
+{
+    struct list_head *pos = ctx->sendtimer.prev;
+
+    /* New deadlines are usually the latest one, so search from the tail */
+    while (pos != &ctx->sendtimer
+           && list_entry(pos, CoAPSendNode, timerlist)->timeout > node->timeout) {
+        pos = pos->prev;
+    }
+    list_add(&node->timerlist, pos);
+    return (pos == &ctx->sendtimer);
+}
+
+/* Remove the node from the send list and all its indexes. Must hold the list mutex */
+static void CoAPSendNode_unlink(CoAPIntContext *ctx, CoAPSendNode *node)
+{
+    list_del(&node->sendlist);
+    list_del_init(&node->idlist);
+    list_del_init(&node->toklist);
+    list_del_init(&node->timerlist);
+    ctx->sendlist.count--;
+}
+
 static int CoAPMessageList_add(CoAPContext *context, NetworkAddr *remote,
                                CoAPMessage *message, unsigned char *buffer, int len)
 {
     CoAPIntContext *ctx = (CoAPIntContext *)context;
     CoAPSendNode *node = NULL;
     uint64_t tick ;
+    int nearest = 0;
     node = coap_malloc(sizeof(CoAPSendNode));
 
     if (NULL != node) {
@@ -107,6 +148,8 @@ static int CoAPMessageList_add(CoAPContext *context, NetworkAddr *remote,
 
         memcpy(node->token, message->token, message->header.tokenlen);
 
+        INIT_LIST_HEAD(&node->toklist);
+
         HAL_MutexLock(ctx->sendlist.list_mutex);
         if (ctx->sendlist.count >= ctx->sendlist.maxcount) {
             HAL_MutexUnlock(ctx->sendlist.list_mutex);
@@ -115,8 +158,18 @@ static int CoAPMessageList_add(CoAPContext *context, NetworkAddr *remote,
             return COAP_ERROR_DATA_SIZE;
         } else {
             list_add_tail(&node->sendlist, &ctx->sendlist.list);
+            list_add_tail(&node->idlist, &ctx->sendhash_id[CoAPMsgId_hash(node->header.msgid)]);
+            if (0 != node->header.tokenlen) {
+                list_add_tail(&node->toklist,
+                              &ctx->sendhash_token[CoAPToken_hash(node->token, node->header.tokenlen)]);
+            }
+            nearest = CoAPSendNode_schedule(ctx, node);
             ctx->sendlist.count ++;
             HAL_MutexUnlock(ctx->sendlist.list_mutex);
+            /* The yield loop may be sleeping past the new deadline, let it re-arm */
+            if (nearest) {
+                CoAPNetwork_wakeup(ctx->p_network);
+            }
             return COAP_SUCCESS;
         }
     } else {
@@ -174,12 +227,62 @@ void CoAPMessage_dump(NetworkAddr *remote, CoAPMessage *message)
 
 }
 
-int CoAPMessage_send(CoAPContext *context, NetworkAddr *remote, CoAPMessage *message)
+/*
+ * Write the serialized message and add it to the send list if it needs to be retransmitted.
+ * An owned buffer is handed over to the send list or freed, otherwise it's copied when kept.
+ */
+static int CoAPMessage_transmit(CoAPIntContext *ctx, NetworkAddr *remote, CoAPMessage *message,
+                                unsigned char *buff, unsigned short msglen, int owned)
 {
     int   ret              = COAP_SUCCESS;
+    unsigned short readlen = 0;
+    unsigned char  *keep   = NULL;
+
+    readlen = CoAPNetwork_write(ctx->p_network, remote,
+                                buff, (unsigned int)msglen, ctx->waittime);
+    if (msglen == readlen) {/*Send message success*/
+        if (CoAPReqMsg(message->header) || CoAPCONRespMsg(message->header)) {
+            COAP_FLOW("The message id %d len %d send success, add to the list",
+                      message->header.msgid, msglen);
+            if (owned) {
+                keep = buff;
+            } else {
+                keep = (unsigned char *)coap_malloc(msglen);
+                if (NULL == keep) {
+                    COAP_ERR("Add the message %d to list failed", message->header.msgid);
+                    return COAP_ERROR_MALLOC;
+                }
+                memcpy(keep, buff, msglen);
+            }
+            ret = CoAPMessageList_add(ctx, remote, message, keep, msglen);
+            if (COAP_SUCCESS != ret) {
+                coap_free(keep);
+                COAP_ERR("Add the message %d to list failed", message->header.msgid);
+                return ret;
+            }
+        } else {
+            if (owned) {
+                coap_free(buff);
+            }
+            COAP_FLOW("The message %d isn't CON msg, needless to be retransmitted",
+                      message->header.msgid);
+        }
+    } else {
+        if (owned) {
+            coap_free(buff);
+        }
+        COAP_ERR("CoAP transport write failed, send message %d return %d", message->header.msgid, ret);
+        return COAP_ERROR_WRITE_FAILED;
+    }
+
+    CoAPMessage_dump(remote, message);
+    return COAP_SUCCESS;
+}
+
+int CoAPMessage_send(CoAPContext *context, NetworkAddr *remote, CoAPMessage *message)
+{
     unsigned short msglen  = 0;
     unsigned char  *buff   = NULL;
-    unsigned short readlen = 0;
     CoAPIntContext *ctx    = NULL;
 
     if (NULL == message || NULL == context) {
@@ -204,31 +307,21 @@ int CoAPMessage_send(CoAPContext *context, NetworkAddr *remote, CoAPMessage *mes
 #ifndef COAP_OBSERVE_CLIENT_DISABLE
     CoAPObsClient_delete(ctx, message);
 #endif
-    readlen = CoAPNetwork_write(ctx->p_network, remote,
-                                buff, (unsigned int)msglen, ctx->waittime);
-    if (msglen == readlen) {/*Send message success*/
-        if (CoAPReqMsg(message->header) || CoAPCONRespMsg(message->header)) {
-            COAP_FLOW("The message id %d len %d send success, add to the list",
-                      message->header.msgid, msglen);
-            ret = CoAPMessageList_add(ctx, remote, message, buff, msglen);
-            if (COAP_SUCCESS != ret) {
-                coap_free(buff);
-                COAP_ERR("Add the message %d to list failed", message->header.msgid);
-                return ret;
-            }
-        } else {
-            coap_free(buff);
-            COAP_FLOW("The message %d isn't CON msg, needless to be retransmitted",
-                      message->header.msgid);
-        }
-    } else {
-        coap_free(buff);
-        COAP_ERR("CoAP transport write failed, send message %d return %d", message->header.msgid, ret);
-        return COAP_ERROR_WRITE_FAILED;
+    return CoAPMessage_transmit(ctx, remote, message, buff, msglen, 1);
+}
+
+/*
+ * Send a message that the caller has already serialized into buff, e.g. a shared
+ * observe notification. The buffer stays owned by the caller, it's copied if kept.
+ */
+int CoAPMessage_send_encoded(CoAPContext *context, NetworkAddr *remote, CoAPMessage *message,
+                             unsigned char *buff, unsigned short msglen)
+{
+    if (NULL == message || NULL == context || NULL == remote || NULL == buff) {
+        return (COAP_ERROR_INVALID_PARAM);
     }
 
-    CoAPMessage_dump(remote, message);
-    return COAP_SUCCESS;
+    return CoAPMessage_transmit((CoAPIntContext *)context, remote, message, buff, msglen, 0);
 }
 
 int CoAPMessage_cancel(CoAPContext *context, CoAPMessage *message)
@@ -242,10 +335,10 @@ int CoAPMessage_cancel(CoAPContext *context, CoAPMessage *message)
 
 
     HAL_MutexLock(ctx->sendlist.list_mutex);
-    list_for_each_entry_safe(node, next, &ctx->sendlist.list, sendlist, CoAPSendNode) {
+    list_for_each_entry_safe(node, next, &ctx->sendhash_id[CoAPMsgId_hash(message->header.msgid)],
+                             idlist, CoAPSendNode) {
         if (node->header.msgid == message->header.msgid) {
-            list_del(&node->sendlist);
-            ctx->sendlist.count--;
+            CoAPSendNode_unlink(ctx, node);
             COAP_INFO("Cancel message %d from list, cur count %d",
                       node->header.msgid, ctx->sendlist.count);
             coap_free(node->message);
@@ -266,11 +359,10 @@ int CoAPMessageId_cancel(CoAPContext *context, unsigned short msgid)
     }
 
     HAL_MutexLock(ctx->sendlist.list_mutex);
-    list_for_each_entry_safe(node, next, &ctx->sendlist.list, sendlist, CoAPSendNode) {
+    list_for_each_entry_safe(node, next, &ctx->sendhash_id[CoAPMsgId_hash(msgid)], idlist, CoAPSendNode) {
         if (NULL != node) {
             if (node->header.msgid == msgid) {
-                list_del(&node->sendlist);
-                ctx->sendlist.count--;
+                CoAPSendNode_unlink(ctx, node);
                 COAP_FLOW("Cancel message %d from list, cur count %d",
                           node->header.msgid, ctx->sendlist.count);
                 coap_free(node->message);
@@ -289,7 +381,8 @@ static int CoAPAckMessage_handle(CoAPContext *context, CoAPMessage *message)
     CoAPIntContext *ctx = (CoAPIntContext *)context;
 
     HAL_MutexLock(ctx->sendlist.list_mutex);
-    list_for_each_entry_safe(node, next, &ctx->sendlist.list, sendlist, CoAPSendNode) {
+    list_for_each_entry_safe(node, next, &ctx->sendhash_id[CoAPMsgId_hash(message->header.msgid)],
+                             idlist, CoAPSendNode) {
         if (node->header.msgid == message->header.msgid) {
             CoAPSendMsgHandler handler = node->handler;
             void *user_data = node->user;
@@ -297,10 +390,9 @@ static int CoAPAckMessage_handle(CoAPContext *context, CoAPMessage *message)
             memcpy(&remote, &node->remote, sizeof(remote));
             node->acked = 1;
             if (CoAPRespMsg(node->header)) { /* CON response message */
-                list_del(&node->sendlist);
+                CoAPSendNode_unlink(ctx, node);
                 coap_free(node->message);
                 coap_free(node);
-                ctx->sendlist.count --;
                 COAP_DEBUG("The CON response message %d receive ACK, remove it", message->header.msgid);
             }
             if (handler) handler(ctx, COAP_RECV_RESP_SUC, user_data, &remote, NULL);
@@ -375,12 +467,13 @@ static int CoAPRespMessage_handle(CoAPContext *context, NetworkAddr *remote, CoA
     }
 
     HAL_MutexLock(ctx->sendlist.list_mutex);
-    list_for_each_entry_safe(node, next, &ctx->sendlist.list, sendlist, CoAPSendNode) {
+    list_for_each_entry_safe(node, next,
+                             &ctx->sendhash_token[CoAPToken_hash(message->token, message->header.tokenlen)],
+                             toklist, CoAPSendNode) {
         if (0 != node->header.tokenlen && node->header.tokenlen == message->header.tokenlen
             && 0 == memcmp(node->token, message->token, message->header.tokenlen)) {
             if (!node->keep) {
-                list_del(&node->sendlist);
-                ctx->sendlist.count--;
+                CoAPSendNode_unlink(ctx, node);
                 COAP_FLOW("Remove the message id %d from list", node->header.msgid);
             } else {
                 COAP_FLOW("Find the message id %d, It need keep", node->header.msgid);
@@ -514,6 +607,8 @@ static void CoAPMessage_handle(CoAPContext *context,
             /* TODO: */
             /* context->notifier(context, event); */
         }
+        COAP_DEBUG("Drop malformed message, ret %d", ret);
+        return;
     }
 
     COAP_FLOW("--------Receive a Message------");
@@ -543,6 +638,9 @@ int CoAPMessage_process(CoAPContext *context, unsigned int timeout)
     NetworkAddr remote;
     char ip_addr[17] = {0};
     CoAPIntContext *ctx = (CoAPIntContext *)context;
+#ifdef COAP_RECV_ZERO_COPY
+    unsigned char *datagram = NULL;
+#endif
 
     if (NULL == context) {
         return COAP_ERROR_NULL;
@@ -552,6 +650,15 @@ int CoAPMessage_process(CoAPContext *context, unsigned int timeout)
 
     while (1) {
         memset(&remote, 0x00, sizeof(NetworkAddr));
+#ifdef COAP_RECV_ZERO_COPY
+        /* Parse the datagram in place, options and payload are valid until the release */
+        len = CoAPNetwork_read_borrow(ctx->p_network, &remote, &datagram, timeout);
+        if (len > 0) {
+            if (strncmp((const char *)ip_addr, (const char *)remote.addr, sizeof(ip_addr)) != 0) { /* drop the packet from itself*/
+                CoAPMessage_handle(ctx, &remote, datagram, len);
+            }
+            CoAPNetwork_read_release(ctx->p_network);
+#else
         memset(ctx->recvbuf, 0x00, COAP_MSG_MAX_PDU_LEN);
         len = CoAPNetwork_read(ctx->p_network,
                                &remote,
@@ -561,72 +668,37 @@ int CoAPMessage_process(CoAPContext *context, unsigned int timeout)
             continue;
         if (len > 0) {
             CoAPMessage_handle(ctx, &remote, ctx->recvbuf, len);
+#endif
+            /* Drain the queued datagrams without blocking, the caller recomputes the deadline */
+            timeout = 0;
         } else {
             return len;
         }
     }
 }
 
-static void Check_timeout (void *context)
+/* Handle the due messages of the retransmit queue, cost is proportional to the due messages only */
+static void CoAPMessage_expire(CoAPIntContext *ctx)
 {
-    CoAPIntContext *ctx = (CoAPIntContext *)context;
-    CoAPSendNode *node = NULL, *next = NULL, *timeout_node = NULL;
-    uint64_t tick = HAL_UptimeMs ();
-    do {
-        timeout_node = NULL;
-        HAL_MutexLock(ctx->sendlist.list_mutex);
-        list_for_each_entry_safe(node, next, &ctx->sendlist.list, sendlist, CoAPSendNode) {
+    CoAPSendNode *node = NULL, *next = NULL;
+    struct list_head expired;
+    uint64_t tick = HAL_UptimeMs();
 
-            if (node->keep != NOKEEP) {
-                continue;
-            }
-            if ((node->retrans_count > 0) || (node->timeout >= tick)) {
-                continue;
-            }
+    INIT_LIST_HEAD(&expired);
 
-            /*Remove the node from the list*/
-            list_del_init(&node->sendlist);
-            ctx->sendlist.count--;
-            COAP_INFO("Retransmit timeout,remove the message id %d count %d",
-                              node->header.msgid, ctx->sendlist.count);
-            #ifndef COAP_OBSERVE_SERVER_DISABLE
-                CoapObsServerAll_delete(ctx, &node->remote);
-            #endif
-            timeout_node = node;
+    HAL_MutexLock(ctx->sendlist.list_mutex);
+    while (!list_empty(&ctx->sendtimer)) {
+        node = list_first_entry(&ctx->sendtimer, CoAPSendNode, timerlist);
+        if (node->timeout > tick) {
             break;
         }
-        HAL_MutexUnlock(ctx->sendlist.list_mutex);
-
-        if (timeout_node) {
-            if(NULL != timeout_node->handler){
-                timeout_node->handler(ctx, COAP_RECV_RESP_TIMEOUT, timeout_node->user, &timeout_node->remote, NULL);
-            }
-            coap_free(timeout_node->message);
-            coap_free(timeout_node);
-        }
-    } while (timeout_node);
-}
-
-static void Retansmit (void *context)
-{
-    CoAPIntContext *ctx = (CoAPIntContext *)context;
-    CoAPSendNode *node = NULL, *next = NULL;
-    unsigned int ret = 0;
-
-    uint64_t tick = HAL_UptimeMs (); 
-    HAL_MutexLock(ctx->sendlist.list_mutex);
-    list_for_each_entry_safe(node, next, &ctx->sendlist.list, sendlist, CoAPSendNode) {
-        if (NULL == node || node->timeout > tick ) {
-            continue;
-        }    
+        list_del_init(&node->timerlist);
 
         if (node->retrans_count > 0) {
             /*If has received ack message, don't resend the message*/
-            if(0 == node->acked){
+            if (0 == node->acked) {
                 COAP_DEBUG("Retansmit the message id %d len %d", node->header.msgid, node->msglen);
-                ret = CoAPNetwork_write(ctx->p_network, &node->remote, node->message, node->msglen, ctx->waittime);
-                if (ret != COAP_SUCCESS) {
-                }    
+                CoAPNetwork_write(ctx->p_network, &node->remote, node->message, node->msglen, ctx->waittime);
             }
             node->timeout_val = node->timeout_val * 3 / 2;
             -- node->retrans_count;
@@ -635,16 +707,68 @@ static void Retansmit (void *context)
             } else {
                 node->timeout = tick + node->timeout_val;
             }
+            COAP_FLOW("node->timeout_val = %d , node->timeout=%d ,tick=%d", node->timeout_val, node->timeout, tick);
+
+            /* The kept message is never timed out, no need to schedule it after the last retransmission */
+            if (node->retrans_count > 0 || node->keep == NOKEEP) {
+                CoAPSendNode_schedule(ctx, node);
+            }
+        } else if (node->keep == NOKEEP) {
+            /*Remove the node from the list*/
+            CoAPSendNode_unlink(ctx, node);
+            list_add_tail(&node->sendlist, &expired);
+            COAP_INFO("Retransmit timeout,remove the message id %d count %d",
+                      node->header.msgid, ctx->sendlist.count);
+        }
+    }
+    HAL_MutexUnlock(ctx->sendlist.list_mutex);
 
-            COAP_FLOW("node->timeout_val = %d , node->timeout=%d ,tick=%d", node->timeout_val,node->timeout,tick);
+    list_for_each_entry_safe(node, next, &expired, sendlist, CoAPSendNode) {
+        list_del(&node->sendlist);
+#ifndef COAP_OBSERVE_SERVER_DISABLE
+        CoapObsServerAll_delete(ctx, &node->remote);
+#endif
+        if (NULL != node->handler) {
+            node->handler(ctx, COAP_RECV_RESP_TIMEOUT, node->user, &node->remote, NULL);
+        }
+        coap_free(node->message);
+        coap_free(node);
+    }
+}
+
+unsigned int CoAPMessage_next_deadline(CoAPContext *context, unsigned int max_wait)
+{
+    unsigned int wait = max_wait;
+    uint64_t tick = 0;
+    CoAPSendNode *node = NULL;
+    CoAPIntContext *ctx = (CoAPIntContext *)context;
+
+    if (NULL == ctx) {
+        return max_wait;
+    }
+
+    HAL_MutexLock(ctx->sendlist.list_mutex);
+    if (!list_empty(&ctx->sendtimer)) {
+        node = list_first_entry(&ctx->sendtimer, CoAPSendNode, timerlist);
+        tick = HAL_UptimeMs();
+        if (node->timeout <= tick) {
+            wait = 0;
+        } else if (node->timeout - tick < max_wait) {
+            wait = (unsigned int)(node->timeout - tick);
         }
     }
     HAL_MutexUnlock(ctx->sendlist.list_mutex);
+
+    return wait;
 }
 
 extern void *coap_yield_mutex;
 
-int CoAPMessage_cycle(CoAPContext *context)
+/*
+ * Block until a datagram arrives, the nearest retransmit deadline expires,
+ * CoAPMessage_wakeup() is called or max_wait_ms elapses, then handle them.
+ */
+int CoAPMessage_yield(CoAPContext *context, unsigned int max_wait_ms)
 {
     int res = 0;
 
@@ -658,14 +782,39 @@ int CoAPMessage_cycle(CoAPContext *context)
         HAL_MutexLock(coap_yield_mutex);
     }
 
-    res = CoAPMessage_process(ctx, ctx->waittime);
-    Retansmit (ctx);
-    Check_timeout (ctx);
+    /* Wait for the socket no longer than the nearest retransmit deadline */
+    res = CoAPMessage_process(ctx, CoAPMessage_next_deadline(ctx, max_wait_ms));
+    CoAPMessage_expire(ctx);
 
     if (coap_yield_mutex != NULL) {
         HAL_MutexUnlock(coap_yield_mutex);
     }
 
+    return res;
+}
+
+void CoAPMessage_wakeup(CoAPContext *context)
+{
+    CoAPIntContext *ctx = (CoAPIntContext *)context;
+
+    if (NULL == context) {
+        return;
+    }
+
+    CoAPNetwork_wakeup(ctx->p_network);
+}
+
+int CoAPMessage_cycle(CoAPContext *context)
+{
+    int res = 0;
+
+    CoAPIntContext *ctx = (CoAPIntContext *)context;
+
+    if (NULL == context) {
+        return COAP_ERROR_NULL;
+    }
+
+    res = CoAPMessage_yield(context, ctx->waittime);
     if (res < 0) {
         HAL_SleepMs(20);
     }
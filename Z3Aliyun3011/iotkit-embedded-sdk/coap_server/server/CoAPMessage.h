@@ -22,6 +22,9 @@ typedef struct
     CoAPSendMsgHandler       handler;
     NetworkAddr              remote;
     struct list_head         sendlist;
+    struct list_head         idlist;     /* msgid hash bucket */
+    struct list_head         toklist;    /* token hash bucket */
+    struct list_head         timerlist;  /* deadline ordered retransmit queue */
     void                    *user;
     unsigned char           *message;
     int                      acked;
@@ -71,6 +74,9 @@ int CoAPMessage_destory(CoAPMessage *message);
 
 int CoAPMessage_send(CoAPContext *context, NetworkAddr *remote, CoAPMessage *message);
 
+int CoAPMessage_send_encoded(CoAPContext *context, NetworkAddr *remote, CoAPMessage *message,
+                             unsigned char *buff, unsigned short msglen);
+
 int CoAPMessage_recv(CoAPContext *context, unsigned int timeout, int readcount);
 
 int CoAPMessage_retransmit(CoAPContext *context);
@@ -79,6 +85,12 @@ int CoAPMessage_process(CoAPContext *context, unsigned int timeout);
 
 int CoAPMessage_cycle(CoAPContext *context);
 
+int CoAPMessage_yield(CoAPContext *context, unsigned int max_wait_ms);
+
+void CoAPMessage_wakeup(CoAPContext *context);
+
+unsigned int CoAPMessage_next_deadline(CoAPContext *context, unsigned int max_wait);
+
 int CoAPMessage_cancel(CoAPContext *context, CoAPMessage *message);
 
 #ifdef __cplusplus
@@ -43,6 +43,49 @@ int CoAPNetwork_read(NetworkContext         *p_context,
     return len;
 }
 
+/* Like CoAPNetwork_read() but *pp_data points into the HAL rx queue until CoAPNetwork_read_release() */
+int CoAPNetwork_read_borrow(NetworkContext  *p_context,
+                            NetworkAddr     *p_remote,
+                            unsigned char  **pp_data,
+                            unsigned int     timeout_ms)
+{
+    int          len      = 0;
+    NetworkConf  *network = NULL;
+
+    if (NULL == p_context || NULL == p_remote || NULL == pp_data) {
+        return -1;
+    }
+
+    network = (NetworkConf *)p_context;
+#ifdef COAP_DTLS_SUPPORT
+    if (COAP_NETWORK_DTLS == network->type) {
+    } else {
+#endif
+        len = HAL_UDP_recvfrom_borrow(network->fd, p_remote, pp_data, timeout_ms);
+#ifdef COAP_DTLS_SUPPORT
+    }
+#endif
+    return len;
+}
+
+void CoAPNetwork_read_release(NetworkContext *p_context)
+{
+    NetworkConf  *network = NULL;
+
+    if (NULL == p_context) {
+        return;
+    }
+
+    network = (NetworkConf *)p_context;
+#ifdef COAP_DTLS_SUPPORT
+    if (COAP_NETWORK_DTLS != network->type) {
+#endif
+        HAL_UDP_recvfrom_release(network->fd);
+#ifdef COAP_DTLS_SUPPORT
+    }
+#endif
+}
+
 int CoAPNetwork_write(NetworkContext          *p_context,
                       NetworkAddr   *p_remote,
                       const unsigned char  *p_data,
@@ -73,6 +116,25 @@ int CoAPNetwork_write(NetworkContext          *p_context,
     return len;
 }
 
+/* Make a CoAPNetwork_read() blocked on the socket return early */
+void CoAPNetwork_wakeup(NetworkContext *p_context)
+{
+    NetworkConf  *network = NULL;
+
+    if (NULL == p_context) {
+        return;
+    }
+
+    network = (NetworkConf *)p_context;
+#ifdef COAP_DTLS_SUPPORT
+    if (COAP_NETWORK_DTLS != network->type) {
+#endif
+        HAL_UDP_wakeup(network->fd);
+#ifdef COAP_DTLS_SUPPORT
+    }
+#endif
+}
+
 
 NetworkContext *CoAPNetwork_init(const NetworkInit   *p_param)
 {
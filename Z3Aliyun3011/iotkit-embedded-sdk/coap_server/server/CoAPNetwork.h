@@ -49,6 +49,15 @@ int CoAPNetwork_read(NetworkContext *p_context,
                      unsigned int datalen,
                      unsigned int timeout);
 
+int CoAPNetwork_read_borrow(NetworkContext *p_context,
+                            NetworkAddr    *p_remote,
+                            unsigned char **pp_data,
+                            unsigned int timeout);
+
+void CoAPNetwork_read_release(NetworkContext *p_context);
+
+void CoAPNetwork_wakeup(NetworkContext *p_context);
+
 void CoAPNetwork_deinit(NetworkContext *p_context);
 
 #ifdef __cplusplus
@@ -9,6 +9,7 @@
 #include "iotx_coap_internal.h"
 #include "CoAPPlatform.h"
 #include "CoAPInternal.h"
+#include "CoAPSerialize.h"
 
 #ifndef COAP_OBSERVE_SERVER_DISABLE
 int CoAPObsServer_init(CoAPContext *context, unsigned char        obs_maxcount)
@@ -165,6 +166,140 @@ int CoapObsServerAll_delete(CoAPContext *context,          NetworkAddr  *remote)
 }
 
 
+static int CoAPObsServer_notify_one(CoAPIntContext *ctx, CoapObserver *node, CoAPResource *resource,
+                                    const char *path, unsigned char *payload,
+                                    unsigned short payloadlen, CoAPDataEncrypt handler)
+{
+    int ret = COAP_SUCCESS;
+    CoAPLenString src;
+    CoAPLenString dest;
+    CoAPMessage message;
+
+    CoAPMessage_init(&message);
+    CoAPMessageType_set(&message, node->msg_type);
+    CoAPMessageCode_set(&message, COAP_MSG_CODE_205_CONTENT);
+    CoAPMessageId_set(&message, CoAPMessageId_gen(ctx));
+    CoAPMessageHandler_set(&message, NULL);
+    CoAPMessageUserData_set(&message, node->p_resource_of_interest);
+    CoAPMessageToken_set(&message, node->token, node->tokenlen);
+    CoAPUintOption_add(&message, COAP_OPTION_OBSERVE, node->observer_sequence_num++);
+    CoAPUintOption_add(&message, COAP_OPTION_CONTENT_FORMAT, node->ctype);
+    CoAPUintOption_add(&message, COAP_OPTION_MAXAGE, resource->maxage);
+    COAP_DEBUG("Send notify message path %s to remote %s:%d ",
+               path, node->remote.addr, node->remote.port);
+
+    memset(&dest, 0x00, sizeof(CoAPLenString));
+    if (NULL != handler) {
+        src.len = payloadlen;
+        src.data = payload;
+        ret = handler(ctx, path, &node->remote, &message, &src, &dest);
+        if (COAP_SUCCESS == ret) {
+            CoAPMessagePayload_set(&message, dest.data, dest.len);
+        } else {
+            COAP_INFO("Encrypt payload failed");
+        }
+    } else {
+        CoAPMessagePayload_set(&message, payload, payloadlen);
+    }
+    ret = CoAPMessage_send(ctx, &node->remote, &message);
+    if (NULL != handler && 0 != dest.len && NULL != dest.data) {
+        coap_free(dest.data);
+        dest.len = 0;
+    }
+    CoAPMessage_destory(&message);
+
+    return ret;
+}
+
+/*
+ * Plain payload notify: the options and payload are serialized once into a shared
+ * buffer, only the header and token in front of them are patched per observer.
+ * Observers asking for another content format than the first one are sent one by one.
+ * Must hold the observe server list mutex.
+ */
+static int CoAPObsServer_notify_shared(CoAPIntContext *ctx, CoAPResource *resource,
+                                       const char *path, unsigned char *payload,
+                                       unsigned short payloadlen)
+{
+    int ret = COAP_SUCCESS;
+    unsigned char ctype = 0;
+    unsigned int sequence = 0;
+    unsigned short msglen = 0;
+    unsigned char *buff = NULL;
+    unsigned char *start = NULL;
+    CoapObserver *node = NULL, *first = NULL;
+    CoAPMessage message;
+
+    list_for_each_entry(node, &ctx->obsserver.list, obslist, CoapObserver) {
+        if (node->p_resource_of_interest != resource) {
+            continue;
+        }
+        if (NULL == first) {
+            first = node;
+            ctype = node->ctype;
+        }
+        if (node->ctype == ctype && node->observer_sequence_num > sequence) {
+            sequence = node->observer_sequence_num;
+        }
+    }
+    if (NULL == first) {
+        return COAP_SUCCESS;
+    }
+
+    /* Serialize a token-less template at the max token offset, the token is inserted before its options */
+    CoAPMessage_init(&message);
+    CoAPMessageCode_set(&message, COAP_MSG_CODE_205_CONTENT);
+    CoAPUintOption_add(&message, COAP_OPTION_OBSERVE, sequence);
+    CoAPUintOption_add(&message, COAP_OPTION_CONTENT_FORMAT, ctype);
+    CoAPUintOption_add(&message, COAP_OPTION_MAXAGE, resource->maxage);
+    CoAPMessagePayload_set(&message, payload, payloadlen);
+    msglen = CoAPSerialize_MessageLength(&message);
+    if (COAP_MSG_MAX_PDU_LEN < msglen + COAP_MSG_MAX_TOKEN_LEN) {
+        COAP_INFO("The message length %d is too loog", msglen);
+        CoAPMessage_destory(&message);
+        return COAP_ERROR_DATA_SIZE;
+    }
+    buff = (unsigned char *)coap_malloc(COAP_MSG_MAX_TOKEN_LEN + msglen);
+    if (NULL == buff) {
+        CoAPMessage_destory(&message);
+        return COAP_ERROR_MALLOC;
+    }
+    memset(buff, 0x00, COAP_MSG_MAX_TOKEN_LEN + msglen);
+    CoAPSerialize_Message(&message, buff + COAP_MSG_MAX_TOKEN_LEN, msglen);
+    CoAPMessage_destory(&message);
+
+    for (node = first; &node->obslist != &ctx->obsserver.list;
+         node = list_next_entry(node, obslist, CoapObserver)) {
+        if (node->p_resource_of_interest != resource) {
+            continue;
+        }
+        if (node->ctype != ctype) {
+            ret = CoAPObsServer_notify_one(ctx, node, resource, path, payload, payloadlen, NULL);
+            continue;
+        }
+
+        /* Only the header fields are used to serialize and to track the sent message */
+        CoAPMessage_init(&message);
+        CoAPMessageType_set(&message, node->msg_type);
+        CoAPMessageCode_set(&message, COAP_MSG_CODE_205_CONTENT);
+        CoAPMessageId_set(&message, CoAPMessageId_gen(ctx));
+        CoAPMessageUserData_set(&message, node->p_resource_of_interest);
+        CoAPMessageToken_set(&message, node->token, node->tokenlen);
+        CoAPMessagePayload_set(&message, payload, payloadlen);
+        node->observer_sequence_num = sequence + 1;
+        COAP_DEBUG("Send notify message path %s to remote %s:%d ",
+                   path, node->remote.addr, node->remote.port);
+
+        start = buff + COAP_MSG_MAX_TOKEN_LEN - node->tokenlen;
+        CoAPSerialize_Header(&message, start, 4);
+        memcpy(start + 4, node->token, node->tokenlen);
+        ret = CoAPMessage_send_encoded(ctx, &node->remote, &message, start, msglen + node->tokenlen);
+    }
+
+    coap_free(buff);
+    return ret;
+}
+
 int CoAPObsServer_notify(CoAPContext *context,
                          const char *path, unsigned char *payload,
                          unsigned short payloadlen, CoAPDataEncrypt handler)
@@ -172,52 +307,22 @@ int CoAPObsServer_notify(CoAPContext *context,
     unsigned int ret  = COAP_SUCCESS;
     CoAPResource *resource = NULL;
     CoapObserver *node     = NULL;
-    CoAPLenString src;
-    CoAPLenString dest;
     CoAPIntContext *ctx = (CoAPIntContext *)context;
 
     resource = CoAPResourceByPath_get(ctx, path);
 
     if (NULL != resource) {
         HAL_MutexLock(ctx->obsserver.list_mutex);
-        list_for_each_entry(node, &ctx->obsserver.list, obslist, CoapObserver) {
-            if (node->p_resource_of_interest == resource) {
-                CoAPMessage message;
-                CoAPMessage_init(&message);
-                CoAPMessageType_set(&message, node->msg_type);
-                CoAPMessageCode_set(&message, COAP_MSG_CODE_205_CONTENT);
-                CoAPMessageId_set(&message, CoAPMessageId_gen(ctx));
-                CoAPMessageHandler_set(&message, NULL);
-                CoAPMessageUserData_set(&message, node->p_resource_of_interest);
-                CoAPMessageToken_set(&message, node->token, node->tokenlen);
-                CoAPUintOption_add(&message, COAP_OPTION_OBSERVE, node->observer_sequence_num++);
-                CoAPUintOption_add(&message, COAP_OPTION_CONTENT_FORMAT, node->ctype);
-                CoAPUintOption_add(&message, COAP_OPTION_MAXAGE, resource->maxage);
-                COAP_DEBUG("Send notify message path %s to remote %s:%d ",
-                           path, node->remote.addr, node->remote.port);
-
-                memset(&dest, 0x00, sizeof(CoAPLenString));
-                if (NULL != handler) {
-                    src.len = payloadlen;
-                    src.data = payload;
-                    ret = handler(context, path, &node->remote, &message, &src, &dest);
-                    if (COAP_SUCCESS == ret) {
-                        CoAPMessagePayload_set(&message, dest.data, dest.len);
-                    } else {
-                        COAP_INFO("Encrypt payload failed");
-                    }
-                } else {
-                    CoAPMessagePayload_set(&message, payload, payloadlen);
-                }
-                ret = CoAPMessage_send(ctx, &node->remote, &message);
-                if (NULL != handler && 0 != dest.len && NULL != dest.data) {
-                    coap_free(dest.data);
-                    dest.len = 0;
+        if (NULL == handler) {
+            ret = CoAPObsServer_notify_shared(ctx, resource, path, payload, payloadlen);
+        } else {
+            /* The payload is encrypted per observer, nothing can be shared */
+            list_for_each_entry(node, &ctx->obsserver.list, obslist, CoapObserver) {
+                if (node->p_resource_of_interest == resource) {
+                    ret = CoAPObsServer_notify_one(ctx, node, resource, path, payload, payloadlen, handler);
                 }
-                CoAPMessage_destory(&message);
             }
         }
-
         HAL_MutexUnlock(ctx->obsserver.list_mutex);
     }
     return ret;
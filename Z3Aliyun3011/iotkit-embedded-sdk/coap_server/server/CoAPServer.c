@@ -9,6 +9,8 @@
 #include "CoAPServer.h"
 
 #define COAP_INIT_TOKEN     (0x01020304)
+/* Longest sleep of the idle daemon task, bounds the reaction to g_coap_running */
+#define COAP_SERV_IDLE_WAIT_MS  (5000)
 
 static unsigned int g_coap_running = 0;
 #ifdef COAP_SERV_MULTITHREAD
@@ -81,7 +83,7 @@ static void *CoAPServer_yield(void *param)
     COAP_DEBUG("Enter to CoAP daemon task");
 
     while (g_coap_running) {
-        CoAPMessage_cycle(context);
+        CoAPMessage_yield(context, COAP_SERV_IDLE_WAIT_MS);
     }
 
 #ifdef COAP_SERV_MULTITHREAD
@@ -171,6 +173,7 @@ void CoAPServer_deinit(CoAPContext *context)
 
     COAP_INFO("CoAP Server deinit");
     g_coap_running = 0;
+    CoAPMessage_wakeup(context);
 
 #ifdef COAP_SERV_MULTITHREAD
     if (NULL != g_semphore) {
@@ -63,6 +63,7 @@ void remove_session(CoAPContext *ctx, session_item *session)
     if (session) {
         CoapObsServerAll_delete(ctx, &session->addr);
         list_del(&session->lst);
+        alcs_session_key_deinit(session);
         coap_free(session);
     }
 }
@@ -283,106 +284,114 @@ bool is_networkadd_same(NetworkAddr *addr1, NetworkAddr *addr2)
     return addr1->port == addr2->port && !strncmp((const char *)addr1->addr, (const char *)addr2->addr, NETWORK_ADDR_LEN);
 }
 
-int alcs_encrypt(const char *src, int len, const char *key, void *out)
+#define ALCS_AES_IV "a1b1c1d1e1f1g1h1"
+
+int alcs_session_key_init(session_item *session)
 {
-    char *iv = "a1b1c1d1e1f1g1h1";
+    alcs_session_key_deinit(session);
+
+    session->aes_enc = HAL_Aes128_Init((uint8_t *)session->sessionKey, (uint8_t *)ALCS_AES_IV, HAL_AES_ENCRYPTION);
+    session->aes_dec = HAL_Aes128_Init((uint8_t *)session->sessionKey, (uint8_t *)ALCS_AES_IV, HAL_AES_DECRYPTION);
+    if (!session->aes_enc || !session->aes_dec) {
+        COAP_ERR("fail to init session key");
+        alcs_session_key_deinit(session);
+        return COAP_ERROR_MALLOC;
+    }
+
+    return COAP_SUCCESS;
+}
 
+void alcs_session_key_deinit(session_item *session)
+{
+    if (session->aes_enc) {
+        HAL_Aes128_Destroy(session->aes_enc);
+        session->aes_enc = NULL;
+    }
+    if (session->aes_dec) {
+        HAL_Aes128_Destroy(session->aes_dec);
+        session->aes_dec = NULL;
+    }
+}
+
+/*
+ * PKCS#7 padded AES-128-CBC, out must hold len rounded up to the next
+ * 16 bytes and may be src itself. The last block is chained from the iv
+ * again rather than from the previous block, that is what the peers do.
+ */
+int alcs_encrypt(const char *src, int len, session_item *session, void *out)
+{
+    uint8_t *dst = (uint8_t *)out;
     int len1 = len & 0xfffffff0;
     int len2 = len1 + 16;
     int pad = len2 - len; /*pad range[1 to 16]  */
     int ret = 0;
 
-    if (len1) {
-        p_HAL_Aes128_t aes_e_h = HAL_Aes128_Init((uint8_t *)key, (uint8_t *)iv, HAL_AES_ENCRYPTION);
-        ret = HAL_Aes128_Cbc_Encrypt(aes_e_h, src, len1 >> 4, out);
-        HAL_Aes128_Destroy(aes_e_h);
+    if (!session->aes_enc) {
+        COAP_ERR("session key not ready");
+        return 0;
     }
-    if (!ret && pad) {
-        char buf[16];
-        p_HAL_Aes128_t aes_e_h = NULL;
 
-        if (len == len1) {
-            pad = 16;
-            memset(buf, pad, 16);
-        } else {
-            memcpy(buf, src + len1, len - len1);
-            memset(buf + len - len1, pad, pad);
-        }
-        
-        aes_e_h = HAL_Aes128_Init((uint8_t *)key, (uint8_t *)iv, HAL_AES_ENCRYPTION);
-        ret = HAL_Aes128_Cbc_Encrypt(aes_e_h, buf, 1, (uint8_t *)out + len1);
-        HAL_Aes128_Destroy(aes_e_h);
+    if (dst != (const uint8_t *)src) {
+        memmove(dst, src, len);
     }
+    memset(dst + len, pad, pad);
 
-    COAP_DEBUG("to encrypt src:%s, len:%d", src, len2);
+    HAL_Aes128_Set_Iv(session->aes_enc, (uint8_t *)ALCS_AES_IV);
+    if (len1) {
+        ret = HAL_Aes128_Cbc_Encrypt(session->aes_enc, dst, len1 >> 4, dst);
+    }
+    if (!ret) {
+        HAL_Aes128_Set_Iv(session->aes_enc, (uint8_t *)ALCS_AES_IV);
+        ret = HAL_Aes128_Cbc_Encrypt(session->aes_enc, dst + len1, 1, dst + len1);
+    }
+
+    COAP_DEBUG("to encrypt len:%d", len2);
     return ret == 0 ? len2 : 0;
 }
 
-int alcs_decrypt(const char *src, int len, const char *key, void *out)
+int alcs_decrypt(const char *src, int len, session_item *session, void *out)
 {
-    char *iv = "a1b1c1d1e1f1g1h1";
-    p_HAL_Aes128_t aes_d_h;
     int n = len >> 4;
-    char *out_c = NULL;
+    char *out_c = (char *)out;
     int offset = 0;
     int ret = 0;
     char pad = 0;
 
     COAP_DEBUG("to decrypt len:%d", len);
-    if (0 != (len & 0xF)) {
+    if (0 == n || 0 != (len & 0xF)) {
         COAP_DEBUG("invalid data");
         return 0;
     }
+    if (!session->aes_dec) {
+        COAP_ERR("session key not ready");
+        return 0;
+    }
 
-    do {
-        if (n > 1) {
-            aes_d_h  = HAL_Aes128_Init((uint8_t *)key, (uint8_t *)iv, HAL_AES_DECRYPTION);
-            if (!aes_d_h) {
-                COAP_ERR("fail to decrypt init");
-                break;
-            }
-
-            ret = HAL_Aes128_Cbc_Decrypt(aes_d_h, src, n - 1, out);
-            HAL_Aes128_Destroy(aes_d_h);
-
-            if (ret != 0) {
-                COAP_ERR("fail to decrypt");
-                break;
-            }
-        }
-
-        out_c = (char *)out;
-        offset = n > 0 ? ((n - 1) << 4) : 0;
-        out_c[offset] = 0;
-
-        aes_d_h  = HAL_Aes128_Init((uint8_t *)key, (uint8_t *)iv, HAL_AES_DECRYPTION);
-        if (!aes_d_h) {
-            COAP_ERR("fail to decrypt init");
-            break;
-        }
-
-        ret = HAL_Aes128_Cbc_Decrypt(aes_d_h, src + offset, 1, out_c + offset);
-        HAL_Aes128_Destroy(aes_d_h);
-
-        if (ret != 0) {
-            COAP_ERR("fail to decrypt remain data");
-            break;
-        }
+    offset = (n - 1) << 4;
+    HAL_Aes128_Set_Iv(session->aes_dec, (uint8_t *)ALCS_AES_IV);
+    if (n > 1) {
+        ret = HAL_Aes128_Cbc_Decrypt(session->aes_dec, src, n - 1, out);
+    }
+    if (!ret) {
+        HAL_Aes128_Set_Iv(session->aes_dec, (uint8_t *)ALCS_AES_IV);
+        ret = HAL_Aes128_Cbc_Decrypt(session->aes_dec, src + offset, 1, out_c + offset);
+    }
+    if (ret != 0) {
+        COAP_ERR("fail to decrypt");
+        return 0;
+    }
 
-        pad = out_c[len - 1];
-        COAP_DEBUG("decrypt len=%d pad=%d", len, pad);
+    pad = out_c[len - 1];
+    COAP_DEBUG("decrypt len=%d pad=%d", len, pad);
 
-        if (0 == pad || pad > 16) {
-            COAP_ERR("invalid pad data, pad=%d", pad);
-            break;
-        }
-        
-        out_c[len - pad] = 0;
-        COAP_DEBUG("decrypt data:%s, len:%d", out_c, len - pad);
-        return len - pad;
-    } while (0);
+    if (0 == pad || pad > 16) {
+        COAP_ERR("invalid pad data, pad=%d", pad);
+        return 0;
+    }
 
-    return 0;
+    out_c[len - pad] = 0;
+    COAP_DEBUG("decrypt data:%s, len:%d", out_c, len - pad);
+    return len - pad;
 }
 
 bool alcs_is_auth(CoAPContext *ctx, AlcsDeviceKey *devKey)
@@ -397,7 +406,7 @@ typedef struct {
     CoAPSendMsgHandler orig_handler;
 } secure_send_item;
 
-static int do_secure_send(CoAPContext *ctx, NetworkAddr *addr, CoAPMessage *message, const char *key, char *buf)
+static int do_secure_send(CoAPContext *ctx, NetworkAddr *addr, CoAPMessage *message, session_item *session, char *buf)
 {
     int ret = COAP_SUCCESS;
     void *payload_old = message->payload;
@@ -406,7 +415,7 @@ static int do_secure_send(CoAPContext *ctx, NetworkAddr *addr, CoAPMessage *mess
     COAP_DEBUG("do_secure_send");
 
     message->payload = (unsigned char *)buf;
-    message->payloadlen = alcs_encrypt((const char *)payload_old, len_old, key, message->payload);
+    message->payloadlen = alcs_encrypt((const char *)payload_old, len_old, session, message->payload);
     ret = CoAPMessage_send(ctx, addr, message);
 
     message->payload = payload_old;
@@ -448,20 +457,20 @@ int internal_secure_send(CoAPContext *ctx, session_item *session, NetworkAddr *a
     encryptlen = (message->payloadlen & 0xfffffff0) + 16;
     if (encryptlen > 64) {
         char *buf = (char *)coap_malloc(encryptlen);
-        int rt = do_secure_send(ctx, addr, message, session->sessionKey, buf);
+        int rt = do_secure_send(ctx, addr, message, session, buf);
         coap_free(buf);
         return rt;
     } else {
         char buf[64];
-        return do_secure_send(ctx, addr, message, session->sessionKey, buf);
+        return do_secure_send(ctx, addr, message, session, buf);
     }
 }
 
-static void call_cb(CoAPContext *context, NetworkAddr *remote, CoAPMessage *message, const char *key, char *buf,
+static void call_cb(CoAPContext *context, NetworkAddr *remote, CoAPMessage *message, session_item *session, char *buf,
                     secure_send_item *send_item)
 {
     if (send_item->orig_handler) {
-        int len = alcs_decrypt((const char *)message->payload, message->payloadlen, key, buf);
+        int len = alcs_decrypt((const char *)message->payload, message->payloadlen, session, buf);
         if (len <= 0) {
             return;
         }
@@ -502,11 +511,11 @@ void secure_sendmsg_handler(CoAPContext *context, CoAPReqResult result, void *us
             session->heart_time = HAL_UptimeMs();
             if (message->payloadlen < 128) {
                 char buf[128];
-                call_cb(context, remote, message, session->sessionKey, buf, send_item);
+                call_cb(context, remote, message, session, buf, send_item);
             } else {
                 char *buf = (char *)coap_malloc(message->payloadlen);
                 if (buf) {
-                    call_cb(context, remote, message, session->sessionKey, buf, send_item);
+                    call_cb(context, remote, message, session, buf, send_item);
                     coap_free(buf);
                 }
             }
@@ -78,6 +78,8 @@ typedef struct {
     int interval;
     NetworkAddr addr;
     char pk_dn[PK_DN_CHECKSUM_LEN];
+    p_HAL_Aes128_t aes_enc;     /* sessionKey expanded once at auth, see alcs_session_key_init() */
+    p_HAL_Aes128_t aes_dec;
     struct list_head  lst;
 } session_item;
 
@@ -150,8 +152,10 @@ typedef struct {
 extern struct list_head secure_resource_cb_head;
 #endif
 
-int alcs_encrypt(const char *src, int len, const char *key, void *out);
-int alcs_decrypt(const char *src, int len, const char *key, void *out);
+int alcs_session_key_init(session_item *session);
+void alcs_session_key_deinit(session_item *session);
+int alcs_encrypt(const char *src, int len, session_item *session, void *out);
+int alcs_decrypt(const char *src, int len, session_item *session, void *out);
 int observe_data_encrypt(CoAPContext *ctx, const char *paths, NetworkAddr *addr,
                          CoAPMessage *message, CoAPLenString *src, CoAPLenString *dest);
 
@@ -287,6 +287,12 @@ void  auth_cb(CoAPContext *ctx, CoAPReqResult result, void *userdata, NetworkAdd
                 char buf[32];
                 HAL_Snprintf(buf, sizeof(buf), "%s%.*s", session->randomKey, tmplen, tmp);
                 utils_hmac_sha1_hex(buf, strlen(buf), session->sessionKey, auth_param->accessToken, strlen(auth_param->accessToken));
+                if (alcs_session_key_init(session) != COAP_SUCCESS) {
+                    msg.code = -1;
+                    msg.msg = "sessionKey init fail!";
+                    remove_session(ctx, session);
+                    break;
+                }
                 session->authed_time = HAL_UptimeMs();
                 session->heart_time = session->authed_time;
                 session->interval = default_heart_interval;
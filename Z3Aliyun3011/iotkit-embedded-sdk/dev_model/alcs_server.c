@@ -263,6 +263,7 @@ void alcs_rec_auth(CoAPContext *ctx, const char *paths, NetworkAddr *from, CoAPM
             char path[100] = {0};
             struct list_head *svr_head;
             session = (session_item *)coap_malloc(sizeof(session_item));
+            memset(session, 0, sizeof(session_item));
             gen_random_key((unsigned char *)session->randomKey, RANDOMKEY_LEN);
             session->sessionId = ++sessionid_seed;
 
@@ -281,6 +282,11 @@ void alcs_rec_auth(CoAPContext *ctx, const char *paths, NetworkAddr *from, CoAPM
 
         HAL_Snprintf(buf, sizeof(buf), "%.*s%s", randomkeylen, randomkey, session->randomKey);
         utils_hmac_sha1_hex(buf, strlen(buf), session->sessionKey, accessToken, tokenlen);
+        if (alcs_session_key_init(session) != COAP_SUCCESS) {
+            remove_session(ctx, session);
+            res_code = ALCS_AUTH_INVALIDPARAM;
+            break;
+        }
 
         /*calc sign, save in buf*/
         calc_sign_len = sizeof(buf);
@@ -432,14 +438,14 @@ void send_err_rsp(CoAPContext *ctx, NetworkAddr *addr, int code, CoAPMessage *re
     alcs_sendrsp(ctx, addr, &sendMsg, 1, request->header.msgid, &token);
 }
 
-void call_cb(CoAPContext *context, const char *path, NetworkAddr *remote, CoAPMessage *message, const char *key,
+void call_cb(CoAPContext *context, const char *path, NetworkAddr *remote, CoAPMessage *message, session_item *session,
              char *buf, CoAPRecvMsgHandler cb)
 {
     CoAPMessage tmpMsg;
     memcpy(&tmpMsg, message, sizeof(CoAPMessage));
 
-    if (key && buf) {
-        int len = alcs_decrypt((const char *)message->payload, message->payloadlen, key, buf);
+    if (session && buf) {
+        int len = alcs_decrypt((const char *)message->payload, message->payloadlen, session, buf);
         if (len <= 0) {
             return;
         }
@@ -507,11 +513,11 @@ void recv_msg_handler(CoAPContext *context, const char *path, NetworkAddr *remot
 
     if (message->payloadlen < 256) {
         char buf[256];
-        call_cb(context, path, remote, message, session->sessionKey, buf, node->cb);
+        call_cb(context, path, remote, message, session, buf, node->cb);
     } else {
         char *buf = (char *)coap_malloc(message->payloadlen);
         if (buf) {
-            call_cb(context, path, remote, message, session->sessionKey, buf, node->cb);
+            call_cb(context, path, remote, message, session, buf, node->cb);
             coap_free(buf);
         }
     }
@@ -674,7 +680,7 @@ int observe_data_encrypt(CoAPContext *ctx, const char *path, NetworkAddr *from,
     if (session) {
         dest->len = (src->len & 0xfffffff0) + 16;
         dest->data  = (unsigned char *)coap_malloc(dest->len);
-        alcs_encrypt((const char *)src->data, src->len, session->sessionKey, dest->data);
+        alcs_encrypt((const char *)src->data, src->len, session, dest->data);
         CoAPUintOption_add(message, COAP_OPTION_SESSIONID, session->sessionId);
         return COAP_SUCCESS;
     }
@@ -178,6 +178,25 @@ DLL_IOT_API int IOT_Linkkit_Query(int devid, iotx_linkkit_msg_type_t msg_type, u
  */
 DLL_IOT_API int IOT_Linkkit_TriggerEvent(int devid, char *eventid, int eventid_len, char *payload, int payload_len);
 
+typedef struct {
+    int ipc_size;               /* events waiting for IOT_Linkkit_Yield() */
+    int ipc_max_size;
+    int ipc_high_water;
+    int ipc_drops;
+    int msg_cache_size;         /* upstream messages waiting for their reply */
+    int msg_cache_max_size;
+} iotx_linkkit_stats_t;
+
+/**
+ * @brief get the runtime statistics of the linkkit queues
+ *
+ * @param stats. the statistics.
+ *
+ * @return success: 0, fail: -1.
+ *
+ */
+DLL_IOT_API int IOT_Linkkit_GetStats(iotx_linkkit_stats_t *stats);
+
 #if defined(__cplusplus)
 }
 #endif
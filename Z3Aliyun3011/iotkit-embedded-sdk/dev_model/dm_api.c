@@ -273,12 +273,13 @@ void iotx_dm_dispatch(void)
             dm_ipc_msg_t *msg = (dm_ipc_msg_t *)data;
 
             if (ctx->event_callback) {
-                ctx->event_callback(msg->type, msg->data);
+                ctx->event_callback(msg->type, msg->data, msg->payload, msg->payload_len);
             }
 
             if (msg->data) {
                 DM_free(msg->data);
             }
+            dm_client_release_packet(msg->packet);
             DM_free(msg);
             data = NULL;
         } else {
@@ -287,6 +288,22 @@ void iotx_dm_dispatch(void)
     }
 }
 
+int iotx_dm_get_stats(_OU_ iotx_dm_stats_t *stats)
+{
+    if (stats == NULL) {
+        return DM_INVALID_PARAMETER;
+    }
+
+    memset(stats, 0, sizeof(iotx_dm_stats_t));
+    dm_ipc_get_stats(stats);
+#if !defined(DM_MESSAGE_CACHE_DISABLED)
+    stats->msg_cache_size = dm_msg_cache_size();
+    stats->msg_cache_max_size = CONFIG_MSGCACHE_QUEUE_MAXLEN;
+#endif
+
+    return SUCCESS_RETURN;
+}
+
 int iotx_dm_post_rawdata(_IN_ int devid, _IN_ char *payload, _IN_ int payload_len)
 {
     int res = 0;
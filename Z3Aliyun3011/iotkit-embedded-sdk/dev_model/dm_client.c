@@ -210,8 +210,10 @@ void dm_client_thing_model_down_raw(int fd, const char *topic, const char *paylo
     source.payload = (unsigned char *)payload;
     source.payload_len = payload_len;
     source.context = NULL;
+    source.packet = dm_client_hold_packet();
 
     dm_msg_proc_thing_model_down_raw(&source);
+    dm_client_release_packet(source.packet);
 }
 
 void dm_client_thing_model_up_raw_reply(int fd, const char *topic, const char *payload, unsigned int payload_len,
@@ -248,10 +250,12 @@ void dm_client_thing_service_property_set(int fd, const char *topic, const char
     source.payload = (unsigned char *)payload;
     source.payload_len = payload_len;
     source.context = NULL;
+    source.packet = dm_client_hold_packet();
 
     dest.uri_name = DM_URI_THING_SERVICE_PROPERTY_SET_REPLY;
 
     res = dm_msg_proc_thing_service_property_set(&source, &dest, &request, &response);
+    dm_client_release_packet(source.packet);
     if (res < SUCCESS_RETURN) {
         return;
     }
@@ -312,8 +316,10 @@ void dm_client_thing_service_request(int fd, const char *topic, const char *payl
     source.payload = (unsigned char *)payload;
     source.payload_len = payload_len;
     source.context = NULL;
+    source.packet = dm_client_hold_packet();
 
     dm_msg_proc_thing_service_request(&source);
+    dm_client_release_packet(source.packet);
 }
 
 void dm_client_thing_event_post_reply(int fd, const char *topic, const char *payload, unsigned int payload_len,
@@ -143,3 +143,18 @@ int dm_client_yield(unsigned int timeout)
 
     return iotx_cm_yield(ctx->fd, timeout);
 }
+
+/* from a topic handler, keeps its topic and payload valid after it returns; NULL when they can not be */
+void *dm_client_hold_packet(void)
+{
+    dm_client_ctx_t *ctx = dm_client_get_ctx();
+
+    return iotx_cm_hold_packet(ctx->fd);
+}
+
+void dm_client_release_packet(void *packet)
+{
+    if (packet != NULL) {
+        iotx_cm_release_packet(packet);
+    }
+}
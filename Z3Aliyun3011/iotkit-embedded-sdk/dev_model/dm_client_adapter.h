@@ -14,5 +14,7 @@ int dm_client_subscribe(char *uri, iotx_cm_data_handle_cb callback, void *contex
 int dm_client_unsubscribe(char *uri);
 int dm_client_publish(char *uri, unsigned char *payload, int payload_len, iotx_cm_data_handle_cb callback);
 int dm_client_yield(unsigned int timeout);
+void *dm_client_hold_packet(void);
+void dm_client_release_packet(void *packet);
 
 #endif
\ No newline at end of file
@@ -65,6 +65,7 @@ void dm_ipc_deinit(void)
         if (del_msg->data) {
             DM_free(del_msg->data);
         }
+        dm_client_release_packet(del_msg->packet);
         DM_free(del_msg);
         del_msg = NULL;
 
@@ -87,20 +88,29 @@ int dm_ipc_msg_insert(void *data)
     dm_log_debug("dm msg list size: %d, max size: %d", ctx->msg_list.size, ctx->msg_list.max_size);
     if (ctx->msg_list.size >= ctx->msg_list.max_size) {
         dm_log_warning("dm ipc list full");
+        ctx->msg_list.drops++;
         _dm_ipc_unlock();
         return FAIL_RETURN;
     }
 
     node = DM_malloc(sizeof(dm_ipc_msg_node_t));
     if (node == NULL) {
+        ctx->msg_list.drops++;
         _dm_ipc_unlock();
         return DM_MEMORY_NOT_ENOUGH;
     }
     memset(node, 0, sizeof(dm_ipc_msg_node_t));
 
     node->data = data;
+#ifdef INFRA_TRACE
+    iotx_trace_point(IOTX_TRACE_DM_IPC_INSERT);
+    iotx_trace_detach(&node->trace);
+#endif
     INIT_LIST_HEAD(&node->linked_list);
     ctx->msg_list.size++;
+    if (ctx->msg_list.size > ctx->msg_list.high_water) {
+        ctx->msg_list.high_water = ctx->msg_list.size;
+    }
     list_add_tail(&node->linked_list, &ctx->msg_list.message_list);
 
     _dm_ipc_unlock();
@@ -128,9 +138,24 @@ int dm_ipc_msg_next(void **data)
     ctx->msg_list.size--;
 
     *data = node->data;
+#ifdef INFRA_TRACE
+    iotx_trace_attach(&node->trace);
+    iotx_trace_point(IOTX_TRACE_DM_DISPATCH);
+#endif
     DM_free(node);
 
     _dm_ipc_unlock();
     return SUCCESS_RETURN;
 }
 
+void dm_ipc_get_stats(_OU_ iotx_dm_stats_t *stats)
+{
+    dm_ipc_t *ctx = _dm_ipc_get_ctx();
+
+    _dm_ipc_lock();
+    stats->ipc_size = ctx->msg_list.size;
+    stats->ipc_max_size = ctx->msg_list.max_size;
+    stats->ipc_high_water = ctx->msg_list.high_water;
+    stats->ipc_drops = ctx->msg_list.drops;
+    _dm_ipc_unlock();
+}
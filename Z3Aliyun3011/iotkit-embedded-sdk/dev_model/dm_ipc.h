@@ -8,20 +8,31 @@
 #define _DM_IPC_H_
 
 #include "iotx_dm_internal.h"
+#ifdef INFRA_TRACE
+    #include "infra_trace.h"
+#endif
 
 typedef struct {
     iotx_dm_event_types_t type;
     char *data;
+    void *packet;           /* held MQTT packet payload is in, released once dispatched */
+    char *payload;
+    int payload_len;
 } dm_ipc_msg_t;
 
 typedef struct {
     void *data;
+#ifdef INFRA_TRACE
+    iotx_trace_t trace;
+#endif
     struct list_head linked_list;
 } dm_ipc_msg_node_t;
 
 typedef struct {
     int max_size;
     int size;
+    int high_water;
+    int drops;
     struct list_head message_list;
 } dm_ipc_msg_list_t;
 
@@ -34,5 +45,6 @@ int dm_ipc_init(int max_size);
 void dm_ipc_deinit(void);
 int dm_ipc_msg_insert(void *data);
 int dm_ipc_msg_next(void **data);
+void dm_ipc_get_stats(_OU_ iotx_dm_stats_t *stats);
 
 #endif
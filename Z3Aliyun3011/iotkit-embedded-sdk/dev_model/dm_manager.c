@@ -311,6 +311,9 @@ int dm_mgr_device_destroy(_IN_ int devid)
 
 #ifdef DEVICE_MODEL_GATEWAY
     dm_client_subdev_unsubscribe(node->product_key,node->device_name);
+    if (node->sign) {
+        DM_free(node->sign);
+    }
 #endif
 
     DM_free(node);
@@ -572,6 +575,14 @@ int dm_mgr_set_device_secret(_IN_ int devid, _IN_ char device_secret[IOTX_DEVICE
     memset(node->device_secret, 0, IOTX_DEVICE_SECRET_LEN + 1);
     memcpy(node->device_secret, device_secret, strlen(device_secret));
 
+#ifdef DEVICE_MODEL_GATEWAY
+    /* signed with the old secret */
+    if (node->sign) {
+        DM_free(node->sign);
+        node->sign = NULL;
+    }
+#endif
+
     return SUCCESS_RETURN;
 }
 
@@ -910,8 +921,22 @@ int dm_mgr_upstream_combine_login(_IN_ int devid)
     HAL_GetProductKey(request.product_key);
     HAL_GetDeviceName(request.device_name);
 
+    /* Sign Material, kept for the next logins of the device */
+    if (node->sign == NULL) {
+        node->sign = DM_malloc(sizeof(iotx_sign_subdev_t));
+        if (node->sign == NULL) {
+            return DM_MEMORY_NOT_ENOUGH;
+        }
+        if (IOT_Sign_Subdev_Init(node->sign, node->product_key, node->device_name,
+                                 node->device_secret) != SUCCESS_RETURN) {
+            DM_free(node->sign);
+            node->sign = NULL;
+            return FAIL_RETURN;
+        }
+    }
+
     /* Get Params And Method */
-    res = dm_msg_combine_login(node->product_key, node->device_name, node->device_secret, &request);
+    res = dm_msg_combine_login(node->product_key, node->device_name, node->sign, &request);
     if (res != SUCCESS_RETURN) {
         return FAIL_RETURN;
     }
@@ -19,6 +19,9 @@ typedef struct {
     char product_key[IOTX_PRODUCT_KEY_LEN + 1];
     char device_name[IOTX_DEVICE_NAME_LEN + 1];
     char device_secret[IOTX_DEVICE_SECRET_LEN + 1];
+#ifdef DEVICE_MODEL_GATEWAY
+    iotx_sign_subdev_t *sign;   /* combine login sign material, made at the first login */
+#endif
     iotx_dm_dev_avail_t status;
     iotx_dm_dev_status_t dev_status;
     struct list_head linked_list;
@@ -28,6 +28,12 @@ int dm_msg_deinit(void)
 }
 
 int _dm_msg_send_to_user(iotx_dm_event_types_t type, char *message)
+{
+    return _dm_msg_send_to_user_in_place(type, message, NULL, NULL, 0);
+}
+
+int _dm_msg_send_to_user_in_place(iotx_dm_event_types_t type, char *message, void **packet, char *payload,
+                                  int payload_len)
 {
     int res = 0;
     dm_ipc_msg_t *dipc_msg = NULL;
@@ -40,6 +46,11 @@ int _dm_msg_send_to_user(iotx_dm_event_types_t type, char *message)
 
     dipc_msg->type = type;
     dipc_msg->data = message;
+    if (packet != NULL && *packet != NULL) {
+        dipc_msg->packet = *packet;
+        dipc_msg->payload = payload;
+        dipc_msg->payload_len = payload_len;
+    }
 
     res = dm_ipc_msg_insert((void *)dipc_msg);
     if (res != SUCCESS_RETURN) {
@@ -47,6 +58,11 @@ int _dm_msg_send_to_user(iotx_dm_event_types_t type, char *message)
         return FAIL_RETURN;
     }
 
+    /* the hold on the packet goes with the message */
+    if (packet != NULL && *packet != NULL) {
+        *packet = NULL;
+    }
+
     return SUCCESS_RETURN;
 }
 
@@ -289,9 +305,10 @@ int dm_msg_response(dm_msg_dest_type_t type, _IN_ dm_msg_request_payload_t *requ
 
 
 const char DM_MSG_THING_MODEL_DOWN_FMT[] DM_READ_ONLY = "{\"devid\":%d,\"payload\":\"%.*s\"}";
+const char DM_MSG_THING_MODEL_DOWN_IN_PLACE_FMT[] DM_READ_ONLY = "{\"devid\":%d}";
 int dm_msg_thing_model_down_raw(_IN_ char product_key[IOTX_PRODUCT_KEY_LEN + 1],
                                 _IN_ char device_name[IOTX_DEVICE_NAME_LEN + 1],
-                                _IN_ char *payload, _IN_ int payload_len)
+                                _IN_ char *payload, _IN_ int payload_len, _IN_ void **packet)
 {
     int res = 0, devid = 0, message_len = 0;
     char *hexstr = NULL, *message = NULL;
@@ -308,6 +325,24 @@ int dm_msg_thing_model_down_raw(_IN_ char product_key[IOTX_PRODUCT_KEY_LEN + 1],
         return FAIL_RETURN;
     }
 
+    /* the raw data is handed over in the held packet, not hex encoded into the message */
+    if (packet != NULL && *packet != NULL) {
+        message_len = strlen(DM_MSG_THING_MODEL_DOWN_IN_PLACE_FMT) + DM_UTILS_UINT32_STRLEN + 1;
+        message = DM_malloc(message_len);
+        if (message == NULL) {
+            return DM_MEMORY_NOT_ENOUGH;
+        }
+        memset(message, 0, message_len);
+        HAL_Snprintf(message, message_len, DM_MSG_THING_MODEL_DOWN_IN_PLACE_FMT, devid);
+
+        res = _dm_msg_send_to_user_in_place(IOTX_DM_EVENT_MODEL_DOWN_RAW, message, packet, payload, payload_len);
+        if (res != SUCCESS_RETURN) {
+            DM_free(message);
+            return FAIL_RETURN;
+        }
+        return SUCCESS_RETURN;
+    }
+
     res = dm_utils_hex_to_str((unsigned char *)payload, payload_len, &hexstr);
     if (res != SUCCESS_RETURN) {
         return FAIL_RETURN;
@@ -380,14 +415,41 @@ int dm_msg_thing_model_up_raw_reply(_IN_ char product_key[IOTX_PRODUCT_KEY_LEN +
 #ifndef DEPRECATED_LINKKIT
 #ifdef LOG_REPORT_TO_CLOUD
     const char DM_MSG_PROPERTY_SET_FMT[] DM_READ_ONLY = "{\"devid\":%d,\"payload\":%.*s,\"msgid\":%.*s}";
+    const char DM_MSG_PROPERTY_SET_IN_PLACE_FMT[] DM_READ_ONLY = "{\"devid\":%d,\"msgid\":%.*s}";
 #else
     const char DM_MSG_PROPERTY_SET_FMT[] DM_READ_ONLY = "{\"devid\":%d,\"payload\":%.*s}";
+    const char DM_MSG_PROPERTY_SET_IN_PLACE_FMT[] DM_READ_ONLY = "{\"devid\":%d}";
 #endif
-int dm_msg_property_set(int devid, dm_msg_request_payload_t *request)
+int dm_msg_property_set(int devid, dm_msg_request_payload_t *request, void **packet)
 {
     int res = 0, message_len = 0;
     char *message = NULL;
 
+    /* the params are handed over where they are in the held packet, ended with a NUL there */
+    if (packet != NULL && *packet != NULL) {
+        message_len = strlen(DM_MSG_PROPERTY_SET_IN_PLACE_FMT) + DM_UTILS_UINT32_STRLEN + request->id.value_length + 1;
+        message = DM_malloc(message_len);
+        if (message == NULL) {
+            return DM_MEMORY_NOT_ENOUGH;
+        }
+        memset(message, 0, message_len);
+#ifdef LOG_REPORT_TO_CLOUD
+        HAL_Snprintf(message, message_len, DM_MSG_PROPERTY_SET_IN_PLACE_FMT, devid, request->id.value_length,
+                     request->id.value);
+#else
+        HAL_Snprintf(message, message_len, DM_MSG_PROPERTY_SET_IN_PLACE_FMT, devid);
+#endif
+        request->params.value[request->params.value_length] = '\0';
+
+        res = _dm_msg_send_to_user_in_place(IOTX_DM_EVENT_PROPERTY_SET, message, packet, request->params.value,
+                                            request->params.value_length);
+        if (res != SUCCESS_RETURN) {
+            DM_free(message);
+            return FAIL_RETURN;
+        }
+        return SUCCESS_RETURN;
+    }
+
     message_len = strlen(DM_MSG_PROPERTY_SET_FMT) + DM_UTILS_UINT32_STRLEN + request->params.value_length + 1;
     message = DM_malloc(message_len);
     if (message == NULL) {
@@ -451,9 +513,12 @@ int dm_msg_property_get(_IN_ int devid, _IN_ dm_msg_request_payload_t *request,
 
 const char DM_MSG_SERVICE_REQUEST_FMT[] DM_READ_ONLY =
             "{\"id\":\"%.*s\",\"devid\":%d,\"serviceid\":\"%.*s\",\"payload\":%.*s,\"ctx\":\"%s\"}";
+const char DM_MSG_SERVICE_REQUEST_IN_PLACE_FMT[] DM_READ_ONLY =
+            "{\"id\":\"%.*s\",\"devid\":%d,\"serviceid\":\"%.*s\",\"ctx\":\"%s\"}";
 int dm_msg_thing_service_request(_IN_ char product_key[IOTX_PRODUCT_KEY_LEN + 1],
                                  _IN_ char device_name[IOTX_DEVICE_NAME_LEN + 1],
-                                 char *identifier, int identifier_len, dm_msg_request_payload_t *request,  _IN_ void *ctx)
+                                 char *identifier, int identifier_len, dm_msg_request_payload_t *request,  _IN_ void *ctx,
+                                 void **packet)
 {
     int res = 0, devid = 0, message_len = 0;
     char *message = NULL;
@@ -479,8 +544,14 @@ int dm_msg_thing_service_request(_IN_ char product_key[IOTX_PRODUCT_KEY_LEN + 1]
     memset(ctx_addr_str, 0, sizeof(uintptr_t) * 2 + 1);
     infra_hex2str((unsigned char *)&ctx_addr_num, sizeof(uintptr_t), ctx_addr_str);
 
-    message_len = strlen(DM_MSG_SERVICE_REQUEST_FMT) + request->id.value_length + DM_UTILS_UINT32_STRLEN + identifier_len +
-                  request->params.value_length + strlen(ctx_addr_str)  + 1;
+    if (packet != NULL && *packet != NULL) {
+        /* the params are handed over where they are in the held packet, ended with a NUL there */
+        message_len = strlen(DM_MSG_SERVICE_REQUEST_IN_PLACE_FMT) + request->id.value_length + DM_UTILS_UINT32_STRLEN +
+                      identifier_len + strlen(ctx_addr_str)  + 1;
+    } else {
+        message_len = strlen(DM_MSG_SERVICE_REQUEST_FMT) + request->id.value_length + DM_UTILS_UINT32_STRLEN + identifier_len +
+                      request->params.value_length + strlen(ctx_addr_str)  + 1;
+    }
     message = DM_malloc(message_len);
     if (message == NULL) {
         DM_free(ctx_addr_str);
@@ -488,12 +559,19 @@ int dm_msg_thing_service_request(_IN_ char product_key[IOTX_PRODUCT_KEY_LEN + 1]
     }
 
     memset(message, 0, message_len);
-    HAL_Snprintf(message, message_len, DM_MSG_SERVICE_REQUEST_FMT, request->id.value_length, request->id.value, devid,
-                 identifier_len, identifier,
-                 request->params.value_length, request->params.value, ctx_addr_str);
+    if (packet != NULL && *packet != NULL) {
+        HAL_Snprintf(message, message_len, DM_MSG_SERVICE_REQUEST_IN_PLACE_FMT, request->id.value_length, request->id.value,
+                     devid, identifier_len, identifier, ctx_addr_str);
+        request->params.value[request->params.value_length] = '\0';
+    } else {
+        HAL_Snprintf(message, message_len, DM_MSG_SERVICE_REQUEST_FMT, request->id.value_length, request->id.value, devid,
+                     identifier_len, identifier,
+                     request->params.value_length, request->params.value, ctx_addr_str);
+    }
 
     DM_free(ctx_addr_str);
-    res = _dm_msg_send_to_user(IOTX_DM_EVENT_THING_SERVICE_REQUEST, message);
+    res = _dm_msg_send_to_user_in_place(IOTX_DM_EVENT_THING_SERVICE_REQUEST, message, packet, request->params.value,
+                                        request->params.value_length);
     if (res != SUCCESS_RETURN) {
         DM_free(message);
         return FAIL_RETURN;
@@ -1994,29 +2072,25 @@ int dm_msg_thing_list_found(_IN_ char product_key[IOTX_PRODUCT_KEY_LEN + 1],
 }
 
 
-const char DM_MSG_COMBINE_LOGIN_SIGN_SOURCE[] DM_READ_ONLY = "clientId%sdeviceName%sproductKey%stimestamp%s";
 const char DM_MSG_COMBINE_LOGIN_METHOD[] DM_READ_ONLY = "combine.login";
 const char DM_MSG_COMBINE_LOGIN_PARAMS[] DM_READ_ONLY =
             "{\"productKey\":\"%s\",\"deviceName\":\"%s\",\"clientId\":\"%s\",\"timestamp\":\"%s\",\"signMethod\":\"%s\",\"sign\":\"%s\",\"cleanSession\":\"%s\"}";
 int dm_msg_combine_login(_IN_ char product_key[IOTX_PRODUCT_KEY_LEN + 1],
                          _IN_ char device_name[IOTX_DEVICE_NAME_LEN + 1],
-                         _IN_ char device_secret[IOTX_DEVICE_SECRET_LEN + 1], _OU_ dm_msg_request_t *request)
+                         _IN_ const iotx_sign_subdev_t *sign_subdev, _OU_ dm_msg_request_t *request)
 {
     char *params = NULL;
     int params_len = 0;
     char timestamp[DM_UTILS_UINT64_STRLEN] = {0};
-    char client_id[IOTX_PRODUCT_KEY_LEN + 1 + IOTX_DEVICE_NAME_LEN + 21] = {0};
-    char *sign_source = NULL;
-    int sign_source_len = 0;
+    const char *client_id = NULL;
     char *sign_method = DM_MSG_SIGN_METHOD_HMACSHA1;
-    char sign[64] = {0};
+    char sign[DEV_SIGN_SUBDEV_SIGN_LEN] = {0};
 
 
     if (request == NULL || product_key == NULL ||
-        device_name == NULL || device_secret == NULL ||
+        device_name == NULL || sign_subdev == NULL ||
         (strlen(product_key) >= IOTX_PRODUCT_KEY_LEN + 1) ||
         (strlen(device_name) >= IOTX_DEVICE_NAME_LEN + 1) ||
-        (strlen(device_secret) >= IOTX_DEVICE_SECRET_LEN + 1) ||
         (strlen(request->product_key) >= IOTX_PRODUCT_KEY_LEN + 1) ||
         (strlen(request->device_name) >= IOTX_DEVICE_NAME_LEN + 1)) {
         return DM_INVALID_PARAMETER;
@@ -2027,35 +2101,12 @@ int dm_msg_combine_login(_IN_ char product_key[IOTX_PRODUCT_KEY_LEN + 1],
     /* dm_log_debug("Time Stamp: %s", timestamp); */
 
     /* Client ID */
-    HAL_Snprintf(client_id, IOTX_PRODUCT_KEY_LEN + 1 + IOTX_DEVICE_NAME_LEN + 21, "%s.%s|_v=sdk-c-"IOTX_SDK_VERSION"|", product_key, device_name);
-
-    /* Sign */
-    sign_source_len = strlen(DM_MSG_COMBINE_LOGIN_SIGN_SOURCE) + strlen(client_id) +
-                      strlen(device_name) + strlen(product_key) + strlen(timestamp) + 1;
-    sign_source = DM_malloc(sign_source_len);
-    if (sign_source == NULL) {
-        return DM_MEMORY_NOT_ENOUGH;
-    }
-    memset(sign_source, 0, sign_source_len);
-    HAL_Snprintf(sign_source, sign_source_len, DM_MSG_COMBINE_LOGIN_SIGN_SOURCE, client_id,
-                 device_name, product_key, timestamp);
+    client_id = sign_subdev->clientid;
 
-    /* dm_log_debug("Sign Srouce: %s", sign_source); */
-#if 0
-    if (strcmp(sign_method, DM_MSG_SIGN_METHOD_HMACMD5) == 0) {
-        utils_hmac_md5(sign_source, strlen(sign_source), sign, device_secret, strlen(device_secret));
-    } else if (strcmp(sign_method, DM_MSG_SIGN_METHOD_HMACSHA1) == 0) {
-        utils_hmac_sha1(sign_source, strlen(sign_source), sign, device_secret, strlen(device_secret));
-    } else if (strcmp(sign_method, DM_MSG_SIGN_METHOD_HMACSHA256) == 0) {
-        utils_hmac_sha256(sign_source, strlen(sign_source), sign, device_secret, strlen(device_secret));
-    } else {
-        DM_free(sign_source);
+    /* Sign, the sign source up to the timestamp is already hashed */
+    if (IOT_Sign_Subdev(sign_subdev, timestamp, sign) != SUCCESS_RETURN) {
         return FAIL_RETURN;
     }
-#else
-    utils_hmac_sha1(sign_source, strlen(sign_source), sign, device_secret, strlen(device_secret));
-#endif
-    DM_free(sign_source);
     /* dm_log_debug("Sign : %s", sign); */
 
     /* Params */
@@ -2330,7 +2381,7 @@ static int _dm_msg_set_array(dm_msg_set_type_t type, int devid, char *key, lite_
 #else
     const char DM_MSG_PROPERTY_SET_FMT[] DM_READ_ONLY = "{\"devid\":%d,\"propertyid\":\"%.*s\"}";
 #endif
-int dm_msg_property_set(int devid, dm_msg_request_payload_t *request)
+int dm_msg_property_set(int devid, dm_msg_request_payload_t *request, void **packet)
 {
     int res = 0, message_len = 0;
     char *message = NULL;
@@ -2463,7 +2514,8 @@ int dm_msg_property_get(_IN_ int devid, _IN_ dm_msg_request_payload_t *request,
 #endif
 int dm_msg_thing_service_request(_IN_ char product_key[IOTX_PRODUCT_KEY_LEN + 1],
                                  _IN_ char device_name[IOTX_DEVICE_NAME_LEN + 1],
-                                 char *identifier, int identifier_len, dm_msg_request_payload_t *request,  _IN_ void *ctx)
+                                 char *identifier, int identifier_len, dm_msg_request_payload_t *request,  _IN_ void *ctx,
+                                 void **packet)
 {
     int res = 0, id = 0, devid = 0, message_len = 0;
     lite_cjson_t lite;
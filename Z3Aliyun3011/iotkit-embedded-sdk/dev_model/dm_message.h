@@ -40,6 +40,7 @@ typedef struct {
     unsigned char *payload;
     unsigned int payload_len;
     void *context;
+    void *packet;           /* held MQTT packet uri and payload are in, NULL if none */
 } dm_msg_source_t;
 
 typedef struct {
@@ -89,6 +90,9 @@ typedef struct {
 int dm_msg_init(void);
 int dm_msg_deinit(void);
 int _dm_msg_send_to_user(iotx_dm_event_types_t type, char *message);
+/* same, and when *packet is held the payload stays in it; the message then takes the hold and *packet is cleared */
+int _dm_msg_send_to_user_in_place(iotx_dm_event_types_t type, char *message, void **packet, char *payload,
+                                  int payload_len);
 int dm_msg_send_msg_timeout_to_user(int msg_id, int devid, iotx_dm_event_types_t type);
 int dm_msg_uri_parse_pkdn(_IN_ char *uri, _IN_ int uri_len, _IN_ int start_deli, _IN_ int end_deli,
                           _OU_ char product_key[IOTX_PRODUCT_KEY_LEN + 1], _OU_ char device_name[IOTX_DEVICE_NAME_LEN + 1]);
@@ -98,11 +102,11 @@ int dm_msg_request(dm_msg_dest_type_t type, _IN_ dm_msg_request_t *request);
 int dm_msg_response(dm_msg_dest_type_t type, _IN_ dm_msg_request_payload_t *request, _IN_ dm_msg_response_t *response,
                     _IN_ char *data, _IN_ int data_len, _IN_ void *user_data);
 int dm_msg_thing_model_down_raw(_IN_ char product_key[IOTX_PRODUCT_KEY_LEN + 1], _IN_ char device_name[IOTX_DEVICE_NAME_LEN + 1],
-                                _IN_ char *payload, _IN_ int payload_len);
+                                _IN_ char *payload, _IN_ int payload_len, _IN_ void **packet);
 int dm_msg_thing_model_up_raw_reply(_IN_ char product_key[IOTX_PRODUCT_KEY_LEN + 1],
                                     _IN_ char device_name[IOTX_DEVICE_NAME_LEN + 1], char *payload, int payload_len);
 #if !defined(DEVICE_MODEL_RAWDATA_SOLO)
-int dm_msg_property_set(int devid, dm_msg_request_payload_t *request);
+int dm_msg_property_set(int devid, dm_msg_request_payload_t *request, void **packet);
 #ifndef DEPRECATED_LINKKIT
 int dm_msg_property_get(_IN_ int devid, _IN_ dm_msg_request_payload_t *request, _IN_ void *ctx);
 #else
@@ -110,7 +114,8 @@ int dm_msg_property_get(_IN_ int devid, _IN_ dm_msg_request_payload_t *request,
                         _IN_ int *payload_len);
 #endif
 int dm_msg_thing_service_request(_IN_ char product_key[IOTX_PRODUCT_KEY_LEN + 1], _IN_ char device_name[IOTX_DEVICE_NAME_LEN + 1],
-                                 char *identifier, int identifier_len, dm_msg_request_payload_t *request,  _IN_ void *ctx);
+                                 char *identifier, int identifier_len, dm_msg_request_payload_t *request,  _IN_ void *ctx,
+                                 void **packet);
 int dm_msg_rrpc_request(_IN_ char product_key[IOTX_PRODUCT_KEY_LEN + 1], _IN_ char device_name[IOTX_DEVICE_NAME_LEN + 1],
                         char *messageid, int messageid_len, dm_msg_request_payload_t *request);
 int dm_msg_thing_event_property_post_reply(dm_msg_response_payload_t *response);
@@ -170,7 +175,7 @@ int dm_msg_thing_topo_get(_OU_ dm_msg_request_t *request);
 int dm_msg_thing_list_found(_IN_ char product_key[IOTX_PRODUCT_KEY_LEN + 1], _IN_ char device_name[IOTX_DEVICE_NAME_LEN + 1],
                             _OU_ dm_msg_request_t *request);
 int dm_msg_combine_login(_IN_ char product_key[IOTX_PRODUCT_KEY_LEN + 1], _IN_ char device_name[IOTX_DEVICE_NAME_LEN + 1],
-                         _IN_ char device_secret[IOTX_DEVICE_SECRET_LEN + 1], _OU_ dm_msg_request_t *request);
+                         _IN_ const iotx_sign_subdev_t *sign_subdev, _OU_ dm_msg_request_t *request);
 int dm_msg_combine_logout(_IN_ char product_key[IOTX_PRODUCT_KEY_LEN + 1], _IN_ char device_name[IOTX_DEVICE_NAME_LEN + 1],
                           _OU_ dm_msg_request_t *request);
 #endif
@@ -174,4 +174,15 @@ void dm_msg_cache_tick(void)
     }
     _dm_msg_cache_mutex_unlock();
 }
+int dm_msg_cache_size(void)
+{
+    dm_msg_cache_ctx_t *ctx = _dm_msg_cache_get_ctx();
+    int size = 0;
+
+    _dm_msg_cache_mutex_lock();
+    size = ctx->dmc_list_size;
+    _dm_msg_cache_mutex_unlock();
+
+    return size;
+}
 #endif
\ No newline at end of file
@@ -32,6 +32,7 @@ int dm_msg_cache_insert(int msg_id, int devid, iotx_dm_event_types_t type, char
 int dm_msg_cache_search(_IN_ int msg_id, _OU_ dm_msg_cache_node_t **node);
 int dm_msg_cache_remove(int msg_id);
 void dm_msg_cache_tick(void);
+int dm_msg_cache_size(void);
 
 #endif
 #endif
\ No newline at end of file
@@ -107,7 +107,8 @@ int dm_msg_proc_thing_model_down_raw(_IN_ dm_msg_source_t *source)
         return FAIL_RETURN;
     }
 
-    return dm_msg_thing_model_down_raw(product_key, device_name, (char *)source->payload, source->payload_len);
+    return dm_msg_thing_model_down_raw(product_key, device_name, (char *)source->payload, source->payload_len,
+                                       &source->packet);
 }
 
 int dm_msg_proc_thing_model_up_raw_reply(_IN_ dm_msg_source_t *source)
@@ -161,7 +162,7 @@ int dm_msg_proc_thing_service_property_set(_IN_ dm_msg_source_t *source, _IN_ dm
     }
 
     /* Operation */
-    res = dm_msg_property_set(devid, request);
+    res = dm_msg_property_set(devid, request, &source->packet);
 
     /* Response */
     response->service_prefix = DM_URI_SYS_PREFIX;
@@ -293,7 +294,7 @@ int dm_msg_proc_thing_service_request(_IN_ dm_msg_source_t *source)
 
     /* Operation */
     return dm_msg_thing_service_request(product_key, device_name, (char *)source->uri + serviceid_pos + 1,
-                                        strlen(source->uri) - serviceid_pos - 1, &request, source->context);
+                                        strlen(source->uri) - serviceid_pos - 1, &request, source->context, &source->packet);
 }
 
 int dm_msg_proc_thing_event_post_reply(_IN_ dm_msg_source_t *source)
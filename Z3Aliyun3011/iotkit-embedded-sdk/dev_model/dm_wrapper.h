@@ -18,6 +18,7 @@ void *HAL_Malloc(uint32_t size);
 void HAL_Free(void *ptr);
 uint64_t HAL_UptimeMs(void);
 void HAL_SleepMs(uint32_t ms);
+int HAL_Network_Wait(const uintptr_t handles[], int count, uint32_t timeout_ms);
 void HAL_Srandom(uint32_t seed);
 uint32_t HAL_Random(uint32_t region);
 void HAL_Printf(const char *fmt, ...);
@@ -67,6 +68,7 @@ int HAL_Aes128_Cbc_Encrypt(
             size_t blockNum,
             void *dst);
 int HAL_Aes128_Destroy(p_HAL_Aes128_t aes);
+int HAL_Aes128_Set_Iv(p_HAL_Aes128_t aes, const uint8_t *iv);
 int HAL_Aes128_Cbc_Decrypt(
             p_HAL_Aes128_t aes,
             const void *src,
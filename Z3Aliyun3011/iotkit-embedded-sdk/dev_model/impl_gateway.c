@@ -477,7 +477,8 @@ int linkkit_gateway_exit(void)
     return SUCCESS_RETURN;
 }
 
-static void _linkkit_gateway_event_callback(iotx_dm_event_types_t type, char *payload)
+static void _linkkit_gateway_event_callback(iotx_dm_event_types_t type, char *payload, const char *data,
+        int data_len)
 {
     linkkit_gateway_legacy_ctx_t *linkkit_gateway_ctx = _linkkit_gateway_legacy_get_ctx();
 
@@ -227,7 +227,7 @@ static void _iotx_linkkit_upstream_callback_remove(int msgid, int code)
     extern void dm_server_free_context(_IN_ void *ctx);
 #endif
 
-static void _iotx_linkkit_event_callback(iotx_dm_event_types_t type, char *payload)
+static void _iotx_linkkit_event_callback(iotx_dm_event_types_t type, char *payload, const char *data, int data_len)
 {
     int res = 0;
     void *callback;
@@ -285,6 +285,10 @@ static void _iotx_linkkit_event_callback(iotx_dm_event_types_t type, char *paylo
         dm_utils_json_object_item(&lite, IOTX_LINKKIT_KEY_URL, strlen(IOTX_LINKKIT_KEY_URL), cJSON_Invalid,
                                   &lite_item_url);
 
+        /* params received in place stand for the payload item */
+        if (data != NULL && type != IOTX_DM_EVENT_MODEL_DOWN_RAW) {
+            dm_utils_json_parse(data, data_len, cJSON_Invalid, &lite_item_payload);
+        }
     }
 
     switch (type) {
@@ -319,11 +323,26 @@ static void _iotx_linkkit_event_callback(iotx_dm_event_types_t type, char *paylo
             int raw_data_len = 0;
             unsigned char *raw_data = NULL;
 
-            if (payload == NULL || lite_item_devid.type != cJSON_Number || lite_item_payload.type != cJSON_String) {
+            if (payload == NULL || lite_item_devid.type != cJSON_Number) {
                 return;
             }
 
             dm_log_debug("Current Devid: %d", lite_item_devid.value_int);
+
+            if (data != NULL) {
+                HEXDUMP_DEBUG(data, data_len);
+                callback = iotx_event_callback(ITE_RAWDATA_ARRIVED);
+                if (callback) {
+                    ((int (*)(const int, const unsigned char *, const int))callback)(lite_item_devid.value_int,
+                            (const unsigned char *)data, data_len);
+                }
+                return;
+            }
+
+            if (lite_item_payload.type != cJSON_String) {
+                return;
+            }
+
             dm_log_debug("Current Raw Data: %.*s", lite_item_payload.value_length, lite_item_payload.value);
 
             raw_data_len = lite_item_payload.value_length / 2;
@@ -376,7 +395,8 @@ static void _iotx_linkkit_event_callback(iotx_dm_event_types_t type, char *paylo
 #if !defined(DEVICE_MODEL_RAWDATA_SOLO)
         case IOTX_DM_EVENT_THING_SERVICE_REQUEST: {
             int response_len = 0;
-            char *request = NULL, *response = NULL;
+            const char *request = data;
+            char *request_copy = NULL, *response = NULL;
 
             uintptr_t property_get_ctx_num = 0;
             void *property_get_ctx = NULL;
@@ -396,13 +416,17 @@ static void _iotx_linkkit_event_callback(iotx_dm_event_types_t type, char *paylo
                                 sizeof(uintptr_t));
             property_get_ctx = (void *)property_get_ctx_num;
 
-            request = IMPL_LINKKIT_MALLOC(lite_item_payload.value_length + 1);
+            /* params received in place already end with a NUL */
             if (request == NULL) {
-                dm_log_err("Not Enough Memory");
-                return;
+                request_copy = IMPL_LINKKIT_MALLOC(lite_item_payload.value_length + 1);
+                if (request_copy == NULL) {
+                    dm_log_err("Not Enough Memory");
+                    return;
+                }
+                memset(request_copy, 0, lite_item_payload.value_length + 1);
+                memcpy(request_copy, lite_item_payload.value, lite_item_payload.value_length);
+                request = request_copy;
             }
-            memset(request, 0, lite_item_payload.value_length + 1);
-            memcpy(request, lite_item_payload.value, lite_item_payload.value_length);
 
             callback = iotx_event_callback(ITE_SERVICE_REQUEST);
             if (callback) {
@@ -424,11 +448,14 @@ static void _iotx_linkkit_event_callback(iotx_dm_event_types_t type, char *paylo
                 dm_server_free_context(property_get_ctx);
             }
 #endif
-            IMPL_LINKKIT_FREE(request);
+            if (request_copy != NULL) {
+                IMPL_LINKKIT_FREE(request_copy);
+            }
         }
         break;
         case IOTX_DM_EVENT_PROPERTY_SET: {
-            char *property_payload = NULL;
+            const char *property_payload = data;
+            char *property_copy = NULL;
 
             if (payload == NULL || lite_item_devid.type != cJSON_Number || lite_item_payload.type != cJSON_Object) {
                 return;
@@ -437,13 +464,17 @@ static void _iotx_linkkit_event_callback(iotx_dm_event_types_t type, char *paylo
             dm_log_debug("Current Devid: %d", lite_item_devid.value_int);
             dm_log_debug("Current Payload: %.*s", lite_item_payload.value_length, lite_item_payload.value);
 
-            property_payload = IMPL_LINKKIT_MALLOC(lite_item_payload.value_length + 1);
+            /* params received in place already end with a NUL */
             if (property_payload == NULL) {
-                dm_log_err("No Enough Memory");
-                return;
+                property_copy = IMPL_LINKKIT_MALLOC(lite_item_payload.value_length + 1);
+                if (property_copy == NULL) {
+                    dm_log_err("No Enough Memory");
+                    return;
+                }
+                memset(property_copy, 0, lite_item_payload.value_length + 1);
+                memcpy(property_copy, lite_item_payload.value, lite_item_payload.value_length);
+                property_payload = property_copy;
             }
-            memset(property_payload, 0, lite_item_payload.value_length + 1);
-            memcpy(property_payload, lite_item_payload.value, lite_item_payload.value_length);
 #ifdef LOG_REPORT_TO_CLOUD
             if (SUCCESS_RETURN == check_target_msg(msg_id.value, msg_id.value_length)) {
                 report_sample = 1;
@@ -462,7 +493,9 @@ static void _iotx_linkkit_event_callback(iotx_dm_event_types_t type, char *paylo
             }
 #endif
 
-            IMPL_LINKKIT_FREE(property_payload);
+            if (property_copy != NULL) {
+                IMPL_LINKKIT_FREE(property_copy);
+            }
         }
         break;
 #ifdef DEVICE_MODEL_SHADOW
@@ -969,7 +1002,7 @@ static int _iotx_linkkit_master_connect(void)
     }
 
     type = IOTX_DM_EVENT_INITIALIZED;
-    _iotx_linkkit_event_callback(type, "{\"devid\":0}");
+    _iotx_linkkit_event_callback(type, "{\"devid\":0}", NULL, 0);
 
     return SUCCESS_RETURN;
 }
@@ -1264,6 +1297,29 @@ void IOT_Linkkit_Yield(int timeout_ms)
 #endif
 }
 
+int IOT_Linkkit_GetStats(iotx_linkkit_stats_t *stats)
+{
+    iotx_dm_stats_t dm_stats;
+
+    if (stats == NULL) {
+        dm_log_err("Invalid Parameter");
+        return FAIL_RETURN;
+    }
+
+    if (iotx_dm_get_stats(&dm_stats) != SUCCESS_RETURN) {
+        return FAIL_RETURN;
+    }
+
+    stats->ipc_size = dm_stats.ipc_size;
+    stats->ipc_max_size = dm_stats.ipc_max_size;
+    stats->ipc_high_water = dm_stats.ipc_high_water;
+    stats->ipc_drops = dm_stats.ipc_drops;
+    stats->msg_cache_size = dm_stats.msg_cache_size;
+    stats->msg_cache_max_size = dm_stats.msg_cache_max_size;
+
+    return SUCCESS_RETURN;
+}
+
 int IOT_Linkkit_Close(int devid)
 {
     int res = 0;
@@ -187,7 +187,7 @@ int being_deprecated linkkit_set_opt(linkkit_opt_t opt, void *data)
     return res;
 }
 
-static void _linkkit_solo_event_callback(iotx_dm_event_types_t type, char *payload)
+static void _linkkit_solo_event_callback(iotx_dm_event_types_t type, char *payload, const char *data, int data_len)
 {
     int res = 0;
     linkkit_solo_legacy_ctx_t *linkkit_solo_ctx = _linkkit_solo_legacy_get_ctx();
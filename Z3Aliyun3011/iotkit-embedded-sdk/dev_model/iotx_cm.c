@@ -134,11 +134,87 @@ static int _iotx_cm_yield(int fd, unsigned int timeout)
 
 }
 #ifdef DEVICE_MODEL_GATEWAY
+/*
+ * Wait on the network handles of all the connections at once, until one is
+ * readable or the first timer (keepalive, reconnect, QoS1 republish) is due,
+ * and only service those. A wait that runs to timeout services them all.
+ * Falls back to yielding each connection in turn when one can not be polled.
+ */
+static int _iotx_cm_poll(unsigned int timeout)
+{
+    iotx_cm_poll_fp    poll_func[CM_MAX_FD_NUM];
+    iotx_cm_process_fp process_func[CM_MAX_FD_NUM];
+    uintptr_t          handles[CM_MAX_FD_NUM];
+    uint32_t           next_ms[CM_MAX_FD_NUM];
+    uint32_t           wait_ms = timeout;
+    uint32_t           elapsed;
+    uint64_t           start;
+    int                ready = 0;
+    int                i;
+
+    if (fd_lock == NULL) {
+        return NULL_VALUE_ERROR;
+    }
+
+    HAL_MutexLock(fd_lock);
+    for (i = 0; i < CM_MAX_FD_NUM; i++) {
+        poll_func[i] = NULL;
+        process_func[i] = NULL;
+        if (_cm_fd[i] == NULL) {
+            continue;
+        }
+        if (_cm_fd[i]->poll_func == NULL || _cm_fd[i]->process_func == NULL) {
+            HAL_MutexUnlock(fd_lock);
+            return _iotx_cm_yield(-1, timeout);
+        }
+        poll_func[i] = _cm_fd[i]->poll_func;
+        process_func[i] = _cm_fd[i]->process_func;
+    }
+    HAL_MutexUnlock(fd_lock);
+
+    for (i = 0; i < CM_MAX_FD_NUM; i++) {
+        handles[i] = 0;
+        next_ms[i] = timeout;
+        if (poll_func[i] == NULL) {
+            continue;
+        }
+        if (poll_func[i](&handles[i], &next_ms[i]) != 0) {
+            handles[i] = 0;
+            next_ms[i] = timeout;
+        }
+        if (next_ms[i] < wait_ms) {
+            wait_ms = next_ms[i];
+        }
+    }
+
+    start = HAL_UptimeMs();
+    if (wait_ms > 0) {
+        ready = HAL_Network_Wait(handles, CM_MAX_FD_NUM, wait_ms);
+        if (ready < 0) {
+            HAL_SleepMs(wait_ms);
+            ready = 0;
+        }
+    }
+    elapsed = (uint32_t)(HAL_UptimeMs() - start);
+    if (ready == 0 && elapsed < wait_ms) {
+        /* timed out a tick early, the first timer is still the one due */
+        elapsed = wait_ms;
+    }
+
+    for (i = 0; i < CM_MAX_FD_NUM; i++) {
+        if (process_func[i] != NULL && ((ready & (1 << i)) || next_ms[i] <= elapsed || elapsed >= timeout)) {
+            process_func[i]();
+        }
+    }
+
+    return 0;
+}
+
 static void *_iotx_cm_yield_thread_func(void *params)
 {
     yield_task_leave = 0;
     while (inited_conn_num > 0) {
-        _iotx_cm_yield(-1, CM_DEFAULT_YIELD_TIMEOUT);
+        _iotx_cm_poll(CM_DEFAULT_YIELD_TIMEOUT);
     }
     yield_task_leave = 1;
     return NULL;
@@ -203,6 +279,28 @@ int iotx_cm_pub(int fd, iotx_cm_ext_params_t *ext, const char *topic, const char
     return pub_func(ext, topic, payload, payload_len);
 }
 
+void *iotx_cm_hold_packet(int fd)
+{
+    iotx_cm_hold_fp hold_func;
+
+    if (_fd_is_valid(fd) == -1) {
+        return NULL;
+    }
+
+    HAL_MutexLock(fd_lock);
+    hold_func = _cm_fd[fd]->hold_func;
+    HAL_MutexUnlock(fd_lock);
+    return (hold_func != NULL) ? hold_func() : NULL;
+}
+
+void iotx_cm_release_packet(void *packet)
+{
+    /* only MQTT packets are ever held */
+#ifdef MQTT_COMM_ENABLED
+    IOT_MQTT_ReleasePacket(packet);
+#endif
+}
+
 int iotx_cm_close(int fd)
 {
     iotx_cm_close_fp close_func;
@@ -133,4 +133,7 @@ int iotx_cm_sub(int fd, iotx_cm_ext_params_t *ext, const char *topic,
 int iotx_cm_unsub(int fd, const char *topic);
 int iotx_cm_pub(int fd, iotx_cm_ext_params_t *ext, const char *topic, const char *payload, unsigned int payload_len);
 int iotx_cm_close(int fd);
+/* called by a data handler of fd, keeps the topic and payload it was given valid until released */
+void *iotx_cm_hold_packet(int fd);
+void iotx_cm_release_packet(void *packet);
 #endif /* _LINKKIT_CM_H_ */
@@ -403,6 +403,9 @@ static void _set_common_handlers()
         _coap_conncection->pub_func = _coap_publish;
         _coap_conncection->yield_func = _coap_yield;
         _coap_conncection->close_func = _coap_close;
+        _coap_conncection->poll_func = NULL;
+        _coap_conncection->process_func = NULL;
+        _coap_conncection->hold_func = NULL;
     }
 }
 #endif
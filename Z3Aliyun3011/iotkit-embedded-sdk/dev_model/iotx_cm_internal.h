@@ -44,12 +44,18 @@
 
 typedef int (*iotx_cm_connect_fp)(uint32_t timeout);
 typedef int (*iotx_cm_yield_fp)(unsigned int timeout);
+/* handle to wait readable on (0 for none) and ms until a timer of the connection is due */
+typedef int (*iotx_cm_poll_fp)(uintptr_t *handle, uint32_t *next_ms);
+/* yield without waiting, for when the handle is readable or the timer is due */
+typedef int (*iotx_cm_process_fp)(void);
 typedef int (*iotx_cm_sub_fp)(iotx_cm_ext_params_t *params, const char *topic,
                               iotx_cm_data_handle_cb topic_handle_func, void *pcontext);
 typedef int (*iotx_cm_unsub_fp)(const char *topic);
 typedef int (*iotx_cm_pub_fp)(iotx_cm_ext_params_t *params, const char *topic, const char *payload,
                               unsigned int payload_len);
 typedef int (*iotx_cm_close_fp)();
+/* hold the packet being delivered to a data handler, NULL when the protocol can not */
+typedef void *(*iotx_cm_hold_fp)(void);
 
 
 typedef struct iotx_connection_st {
@@ -63,7 +69,10 @@ typedef struct iotx_connection_st {
     iotx_cm_unsub_fp                 unsub_func;
     iotx_cm_pub_fp                   pub_func;
     iotx_cm_yield_fp                 yield_func;
+    iotx_cm_poll_fp                  poll_func;
+    iotx_cm_process_fp               process_func;
     iotx_cm_close_fp                 close_func;
+    iotx_cm_hold_fp                  hold_func;
     iotx_cm_event_handle_cb          event_handler;
     void                             *cb_data;
 
@@ -171,9 +171,7 @@ static void iotx_cloud_conn_mqtt_event_handle(void *pcontext, void *pclient, iot
         case IOTX_MQTT_EVENT_PUBLISH_RECEIVED: {
             iotx_mqtt_topic_info_pt topic_info = (iotx_mqtt_topic_info_pt)msg->msg;
             iotx_cm_data_handle_cb topic_handle_func = (iotx_cm_data_handle_cb)pcontext;
-#ifndef DEVICE_MODEL_ALINK2
-            char *topic = NULL;
-#endif
+
             if (topic_handle_func == NULL) {
                 cm_warning("bypass %d bytes on [%.*s]", topic_info->payload_len, topic_info->topic_len, topic_info->ptopic);
                 return;
@@ -182,17 +180,8 @@ static void iotx_cloud_conn_mqtt_event_handle(void *pcontext, void *pclient, iot
             topic_handle_func(_mqtt_conncection->fd, topic_info->ptopic, topic_info->topic_len, topic_info->payload,
                               topic_info->payload_len, NULL);
 #else
-            topic = cm_malloc(topic_info->topic_len + 1);
-            if (topic == NULL) {
-                cm_err("topic malloc failed");
-                return;
-            }
-            memset(topic, 0, topic_info->topic_len + 1);
-            memcpy(topic, topic_info->ptopic, topic_info->topic_len);
-
-            topic_handle_func(_mqtt_conncection->fd, topic, topic_info->payload, topic_info->payload_len, NULL);
-
-            cm_free(topic);
+            /* the topic of a received message ends with a NUL in the packet */
+            topic_handle_func(_mqtt_conncection->fd, topic_info->ptopic, topic_info->payload, topic_info->payload_len, NULL);
 #endif
         }
         break;
@@ -300,6 +289,33 @@ static int _mqtt_yield(uint32_t timeout)
     return IOT_MQTT_Yield(_mqtt_conncection->context, timeout);
 }
 
+static int _mqtt_poll(uintptr_t *handle, uint32_t *next_ms)
+{
+    if (_mqtt_conncection == NULL) {
+        return NULL_VALUE_ERROR;
+    }
+
+    return IOT_MQTT_PollInfo(_mqtt_conncection->context, handle, next_ms);
+}
+
+static int _mqtt_process(void)
+{
+    if (_mqtt_conncection == NULL) {
+        return NULL_VALUE_ERROR;
+    }
+
+    return IOT_MQTT_Process(_mqtt_conncection->context);
+}
+
+static void *_mqtt_hold(void)
+{
+    if (_mqtt_conncection == NULL) {
+        return NULL;
+    }
+
+    return IOT_MQTT_HoldPacket(_mqtt_conncection->context);
+}
+
 static int _mqtt_sub(iotx_cm_ext_params_t *ext, const char *topic,
                      iotx_cm_data_handle_cb topic_handle_func, void *pcontext)
 {
@@ -397,7 +413,10 @@ static void _set_common_handlers()
         _mqtt_conncection->unsub_func = _mqtt_unsub;
         _mqtt_conncection->pub_func = _mqtt_publish;
         _mqtt_conncection->yield_func = (iotx_cm_yield_fp)_mqtt_yield;
+        _mqtt_conncection->poll_func = _mqtt_poll;
+        _mqtt_conncection->process_func = _mqtt_process;
         _mqtt_conncection->close_func = _mqtt_close;
+        _mqtt_conncection->hold_func = _mqtt_hold;
     }
 }
 
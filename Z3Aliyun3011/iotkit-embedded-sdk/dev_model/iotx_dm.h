@@ -98,7 +98,12 @@ typedef enum {
     IOTX_DM_EVENT_MAX
 } iotx_dm_event_types_t;
 
-typedef void (*iotx_dm_event_callback)(iotx_dm_event_types_t type, char *payload);
+/*
+ * payload is the event as JSON. data, when not NULL, is what the JSON leaves out: the params of a
+ * property set or service request, or the raw data of a model down, left where they were received
+ * and valid only until the callback returns.
+ */
+typedef void (*iotx_dm_event_callback)(iotx_dm_event_types_t type, char *payload, const char *data, int data_len);
 
 typedef enum {
     IOTX_DM_DEVICE_SECRET_PRODUCT,
@@ -168,12 +173,22 @@ typedef enum {
 
 #define IOTX_DM_POST_PROPERTY_ALL (NULL)
 
+typedef struct {
+    int ipc_size;               /* events queued for iotx_dm_dispatch() */
+    int ipc_max_size;
+    int ipc_high_water;
+    int ipc_drops;              /* events lost on a full queue or out of memory */
+    int msg_cache_size;         /* upstream messages waiting for their reply */
+    int msg_cache_max_size;
+} iotx_dm_stats_t;
+
 int iotx_dm_open(void);
 int iotx_dm_connect(_IN_ iotx_dm_init_params_t *init_params);
 int iotx_dm_subscribe(_IN_ int devid);
 int iotx_dm_close(void);
 int iotx_dm_yield(int timeout_ms);
 void iotx_dm_dispatch(void);
+int iotx_dm_get_stats(_OU_ iotx_dm_stats_t *stats);
 
 int iotx_dm_post_rawdata(_IN_ int devid, _IN_ char *payload, _IN_ int payload_len);
 
@@ -18,6 +18,7 @@
 #include "infra_string.h"
 #if defined(DEVICE_MODEL_GATEWAY)
     #include "infra_sha1.h"
+    #include "dev_sign_api.h"
 #endif
 
 
@@ -2,6 +2,7 @@
 #define _DEV_SIGN_H_
 
 #include "dev_sign_internal.h"
+#include "infra_sha1.h"
 
 typedef struct {
     char hostname[DEV_SIGN_HOSTNAME_MAXLEN];
@@ -13,6 +14,49 @@ typedef struct {
 
 int32_t IOT_Sign_MQTT(iotx_mqtt_region_types_t region, iotx_dev_meta_info_t *meta, iotx_sign_mqtt_t *signout);
 
+#ifdef DEVICE_MODEL_GATEWAY
+#define DEV_SIGN_SUBDEV_CLIENT_ID_MAXLEN    (IOTX_PRODUCT_KEY_LEN + 1 + IOTX_DEVICE_NAME_LEN + 21)
+#define DEV_SIGN_SUBDEV_SIGN_LEN            (41)
+
+/*
+ * Sign material of a sub-device for the gateway's combine login: the client
+ * ID it logs in with and an HMAC-SHA1 context of its secret that has already
+ * hashed the sign source up to the timestamp. It is made once per device and
+ * secret, each login then hashes the timestamp alone.
+ */
+typedef struct {
+    char clientid[DEV_SIGN_SUBDEV_CLIENT_ID_MAXLEN];
+    iot_hmac_sha1_context hmac;
+} iotx_sign_subdev_t;
+
+/**
+ * @brief   make the sign material of a sub-device.
+ *
+ * @retval  -1 : failure
+ * @retval  0 : sucess
+ */
+int32_t IOT_Sign_Subdev_Init(iotx_sign_subdev_t *subdev, const char *product_key, const char *device_name,
+                             const char *device_secret);
+
+/**
+ * @brief   sign the login of a sub-device, as hex HMAC-SHA1 of
+ *          "clientId<clientid>deviceName<dn>productKey<pk>timestamp<timestamp>".
+ *
+ * @retval  -1 : failure
+ * @retval  0 : sucess
+ */
+int32_t IOT_Sign_Subdev(const iotx_sign_subdev_t *subdev, const char *timestamp, char sign[DEV_SIGN_SUBDEV_SIGN_LEN]);
+
+/**
+ * @brief   sign the logins of count sub-devices with the same timestamp.
+ *
+ * @retval  -1 : failure
+ * @retval  0 : sucess
+ */
+int32_t IOT_Sign_Subdev_Bulk(const iotx_sign_subdev_t *subdev[], int count, const char *timestamp,
+                             char sign[][DEV_SIGN_SUBDEV_SIGN_LEN]);
+#endif
+
 #endif
 
 
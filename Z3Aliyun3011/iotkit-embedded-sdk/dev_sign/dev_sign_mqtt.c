@@ -59,6 +59,10 @@ const char *clientid_kv[][2] = {
 #endif
 };
 
+/* "|timestamp=...,_v=...,...|", the same for every device */
+static char g_sign_clientid_kv[DEV_SIGN_CLIENT_ID_MAXLEN];
+static uint16_t g_sign_clientid_kv_len;
+
 static void _hex2str(uint8_t *input, uint16_t input_len, char *output)
 {
     char *zEncode = "0123456789ABCDEF";
@@ -70,40 +74,66 @@ static void _hex2str(uint8_t *input, uint16_t input_len, char *output)
     }
 }
 
-int _sign_get_clientid(char *clientid_string, const char *device_id)
+static int _sign_format_clientid_kv(void)
 {
+    char *kv = g_sign_clientid_kv;
+    uint16_t len = 0;
     uint8_t i;
 
+    kv[len++] = '|';
+    for (i = 0; i < (sizeof(clientid_kv) / (sizeof(clientid_kv[0]))); i++) {
+        if ((len + strlen(clientid_kv[i][0]) + strlen(clientid_kv[i][1]) + 2) >= DEV_SIGN_CLIENT_ID_MAXLEN) {
+            return FAIL_RETURN;
+        }
+
+        memcpy(kv + len, clientid_kv[i][0], strlen(clientid_kv[i][0]));
+        len += strlen(clientid_kv[i][0]);
+        kv[len++] = '=';
+        memcpy(kv + len, clientid_kv[i][1], strlen(clientid_kv[i][1]));
+        len += strlen(clientid_kv[i][1]);
+        kv[len++] = ',';
+    }
+    kv[len - 1] = '|';
+    kv[len] = '\0';
+
+    g_sign_clientid_kv_len = len;
+    return SUCCESS_RETURN;
+}
+
+int _sign_get_clientid(char *clientid_string, const char *device_id)
+{
+    uint16_t device_id_len;
+
     if (clientid_string == NULL || device_id == NULL) {
         return FAIL_RETURN;
     }
 
-    memset(clientid_string, 0, DEV_SIGN_CLIENT_ID_MAXLEN);
-    memcpy(clientid_string, device_id, strlen(device_id));
-    memcpy(clientid_string + strlen(clientid_string), "|", 1);
-
-    for (i = 0; i < (sizeof(clientid_kv) / (sizeof(clientid_kv[0]))); i++) {
-        if ((strlen(clientid_string) + strlen(clientid_kv[i][0]) + strlen(clientid_kv[i][1]) + 2) >=
-            DEV_SIGN_CLIENT_ID_MAXLEN) {
-            return FAIL_RETURN;
-        }
+    if (g_sign_clientid_kv_len == 0 && _sign_format_clientid_kv() != SUCCESS_RETURN) {
+        return FAIL_RETURN;
+    }
 
-        memcpy(clientid_string + strlen(clientid_string), clientid_kv[i][0], strlen(clientid_kv[i][0]));
-        memcpy(clientid_string + strlen(clientid_string), "=", 1);
-        memcpy(clientid_string + strlen(clientid_string), clientid_kv[i][1], strlen(clientid_kv[i][1]));
-        memcpy(clientid_string + strlen(clientid_string), ",", 1);
+    device_id_len = strlen(device_id);
+    if (device_id_len + g_sign_clientid_kv_len >= DEV_SIGN_CLIENT_ID_MAXLEN) {
+        return FAIL_RETURN;
     }
 
-    memcpy(clientid_string + strlen(clientid_string) - 1, "|", 1);
+    memset(clientid_string, 0, DEV_SIGN_CLIENT_ID_MAXLEN);
+    memcpy(clientid_string, device_id, device_id_len);
+    memcpy(clientid_string + device_id_len, g_sign_clientid_kv, g_sign_clientid_kv_len);
 
     return SUCCESS_RETURN;
 }
 
+static void _sign_update(iot_hmac_sha256_context *hmac, const char *str)
+{
+    utils_hmac_sha256_update(hmac, (const uint8_t *)str, strlen(str));
+}
+
 int _iotx_generate_sign_string(const char *device_id, const char *device_name, const char *product_key, const char *device_secret, char *sign_string)
 {
-    char signsource[DEV_SIGN_SOURCE_MAXLEN] = {0};
-    uint16_t signsource_len = 0;
+    iot_hmac_sha256_context hmac;
     const char sign_fmt[] = "clientId%sdeviceName%sproductKey%stimestamp%s";
+    uint16_t signsource_len = 0;
     uint8_t sign_hex[32] = {0};
 
     signsource_len = sizeof(sign_fmt) + strlen(device_id) + strlen(device_name) + strlen(product_key) + strlen(TIMESTAMP_VALUE);
@@ -111,18 +141,17 @@ int _iotx_generate_sign_string(const char *device_id, const char *device_name, c
         return ERROR_DEV_SIGN_SOURCE_TOO_SHORT;
     }
 
-    memset(signsource, 0, DEV_SIGN_SOURCE_MAXLEN);
-    memcpy(signsource, "clientId", strlen("clientId"));
-    memcpy(signsource + strlen(signsource), device_id, strlen(device_id));
-    memcpy(signsource + strlen(signsource), "deviceName", strlen("deviceName"));
-    memcpy(signsource + strlen(signsource), device_name, strlen(device_name));
-    memcpy(signsource + strlen(signsource), "productKey", strlen("productKey"));
-    memcpy(signsource + strlen(signsource), product_key, strlen(product_key));
-    memcpy(signsource + strlen(signsource), "timestamp", strlen("timestamp"));
-    memcpy(signsource + strlen(signsource), TIMESTAMP_VALUE, strlen(TIMESTAMP_VALUE));
-
-    utils_hmac_sha256((uint8_t *)signsource, strlen(signsource), (uint8_t *)device_secret,
-                      strlen(device_secret), sign_hex);
+    /* the sign source is hashed as it goes, it is never put together */
+    utils_hmac_sha256_starts(&hmac, (const uint8_t *)device_secret, strlen(device_secret));
+    _sign_update(&hmac, "clientId");
+    _sign_update(&hmac, device_id);
+    _sign_update(&hmac, "deviceName");
+    _sign_update(&hmac, device_name);
+    _sign_update(&hmac, "productKey");
+    _sign_update(&hmac, product_key);
+    _sign_update(&hmac, "timestamp");
+    _sign_update(&hmac, TIMESTAMP_VALUE);
+    utils_hmac_sha256_finish(&hmac, sign_hex);
 
     _hex2str(sign_hex, 32, sign_string);
 
@@ -202,3 +231,82 @@ int32_t IOT_Sign_MQTT(iotx_mqtt_region_types_t region, iotx_dev_meta_info_t *met
     return SUCCESS_RETURN;
 }
 
+#ifdef DEVICE_MODEL_GATEWAY
+#define SIGN_SUBDEV_CLIENTID_SUFFIX "|_v=sdk-c-"IOTX_SDK_VERSION"|"
+
+static void _sign_subdev_update(iot_hmac_sha1_context *hmac, const char *str)
+{
+    utils_hmac_sha1_update(hmac, (const unsigned char *)str, strlen(str));
+}
+
+int32_t IOT_Sign_Subdev_Init(iotx_sign_subdev_t *subdev, const char *product_key, const char *device_name,
+                             const char *device_secret)
+{
+    if (subdev == NULL || product_key == NULL || device_name == NULL || device_secret == NULL ||
+        strlen(product_key) > IOTX_PRODUCT_KEY_LEN || strlen(device_name) > IOTX_DEVICE_NAME_LEN ||
+        strlen(device_secret) > IOTX_DEVICE_SECRET_LEN) {
+        return FAIL_RETURN;
+    }
+
+    memset(subdev, 0, sizeof(iotx_sign_subdev_t));
+    memcpy(subdev->clientid, product_key, strlen(product_key));
+    memcpy(subdev->clientid + strlen(subdev->clientid), ".", strlen("."));
+    memcpy(subdev->clientid + strlen(subdev->clientid), device_name, strlen(device_name));
+    memcpy(subdev->clientid + strlen(subdev->clientid), SIGN_SUBDEV_CLIENTID_SUFFIX,
+           strlen(SIGN_SUBDEV_CLIENTID_SUFFIX));
+
+    /* everything of the sign source but the timestamp */
+    utils_hmac_sha1_starts(&subdev->hmac, (const unsigned char *)device_secret, strlen(device_secret));
+    _sign_subdev_update(&subdev->hmac, "clientId");
+    _sign_subdev_update(&subdev->hmac, subdev->clientid);
+    _sign_subdev_update(&subdev->hmac, "deviceName");
+    _sign_subdev_update(&subdev->hmac, device_name);
+    _sign_subdev_update(&subdev->hmac, "productKey");
+    _sign_subdev_update(&subdev->hmac, product_key);
+    _sign_subdev_update(&subdev->hmac, "timestamp");
+
+    return SUCCESS_RETURN;
+}
+
+int32_t IOT_Sign_Subdev(const iotx_sign_subdev_t *subdev, const char *timestamp, char sign[DEV_SIGN_SUBDEV_SIGN_LEN])
+{
+    const char *hex = "0123456789abcdef";
+    iot_hmac_sha1_context hmac;
+    unsigned char out[20];
+    int i;
+
+    if (subdev == NULL || timestamp == NULL || sign == NULL || subdev->clientid[0] == '\0') {
+        return FAIL_RETURN;
+    }
+
+    hmac = subdev->hmac;
+    _sign_subdev_update(&hmac, timestamp);
+    utils_hmac_sha1_finish(&hmac, out);
+
+    for (i = 0; i < 20; i++) {
+        sign[i * 2] = hex[out[i] >> 4];
+        sign[i * 2 + 1] = hex[out[i] & 0xf];
+    }
+    sign[40] = '\0';
+
+    return SUCCESS_RETURN;
+}
+
+int32_t IOT_Sign_Subdev_Bulk(const iotx_sign_subdev_t *subdev[], int count, const char *timestamp,
+                             char sign[][DEV_SIGN_SUBDEV_SIGN_LEN])
+{
+    int i;
+
+    if (subdev == NULL || sign == NULL || count < 0) {
+        return FAIL_RETURN;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (IOT_Sign_Subdev(subdev[i], timestamp, sign[i]) != SUCCESS_RETURN) {
+            return FAIL_RETURN;
+        }
+    }
+
+    return SUCCESS_RETURN;
+}
+#endif /* #ifdef DEVICE_MODEL_GATEWAY */
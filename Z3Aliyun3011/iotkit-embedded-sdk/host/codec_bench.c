@@ -0,0 +1,579 @@
+/*
+ * Codec micro benchmark for the host simulation build.
+ *
+ * Times the per message work of the cloud stack one function at a time,
+ * without any network: the JSON parsers (lite_cjson, json_parser and the
+ * bundled cJSON used by aliyun_main.c), MQTT PUBLISH and CoAP packet
+ * (de)serialization, the digests, the MQTT connect signature, the sub-device
+ * combine login signature and, when the host HAL has AES, the ALCS payload
+ * encryption. Every
+ * case runs over a small corpus of Alink messages as the gateway sees
+ * them, and reports the time and the HAL_Malloc() traffic per call.
+ *
+ * usage: codec_bench [-n iterations] [-f case filter]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "infra_types.h"
+#include "infra_defs.h"
+#include "infra_compat.h"
+#include "infra_cjson.h"
+#include "infra_json_parser.h"
+#include "infra_sha256.h"
+#include "infra_sha1.h"
+#include "infra_md5.h"
+#include "MQTTPacket.h"
+#include "CoAPSerialize.h"
+#include "CoAPDeserialize.h"
+#include "dev_sign_api.h"
+#include "wrappers_defs.h"
+#include "cJSON.h"
+#ifdef CODEC_BENCH_AES
+    #include "alcs_api_internal.h"
+#endif
+
+#define BENCH_KEYS_MAX          (3)
+#define BENCH_PACKET_MAX        (2048)
+
+typedef struct {
+    const char     *name;
+    const char     *topic;
+    const char     *json;
+    const char     *keys[BENCH_KEYS_MAX];   /* top level members the handler looks up */
+    int             json_len;
+    unsigned char   mqtt_pkt[BENCH_PACKET_MAX];
+    int             mqtt_pkt_len;
+    unsigned char   coap_pkt[BENCH_PACKET_MAX];
+    int             coap_pkt_len;
+#ifdef CODEC_BENCH_AES
+    unsigned char   alcs_pkt[BENCH_PACKET_MAX];
+    int             alcs_pkt_len;
+#endif
+} bench_payload_t;
+
+typedef struct {
+    const char *name;
+    int         per_payload;            /* 0 for the cases that do not look at the message */
+    int (*run)(bench_payload_t *p);
+} bench_case_t;
+
+/* downstream property set, as relayed to a Zigbee light */
+static const char g_json_property_set[] =
+    "{\"method\":\"thing.service.property.set\",\"id\":\"1946731042\",\"params\":"
+    "{\"LightSwitch\":1,\"Brightness\":75,\"ColorTemperature\":4000},\"version\":\"1.0.0\"}";
+
+/* upstream property post of a sub-device, one entry per reported attribute */
+static const char g_json_property_post[] =
+    "{\"id\":\"102\",\"version\":\"1.0\",\"params\":{"
+    "\"LightSwitch\":{\"value\":1,\"time\":1571479834000},"
+    "\"Brightness\":{\"value\":75,\"time\":1571479834000},"
+    "\"ColorTemperature\":{\"value\":4000,\"time\":1571479834000},"
+    "\"RSSI\":{\"value\":-62,\"time\":1571479834000}},"
+    "\"method\":\"thing.event.property.post\"}";
+
+/* topology of a gateway with eight Zigbee sub-devices */
+static const char g_json_topo_reply[] =
+    "{\"code\":200,\"data\":["
+    "{\"deviceName\":\"000D6F000ABCDE01\",\"productKey\":\"a1Zb6hJxPTy\"},"
+    "{\"deviceName\":\"000D6F000ABCDE02\",\"productKey\":\"a1Zb6hJxPTy\"},"
+    "{\"deviceName\":\"000D6F000ABCDE03\",\"productKey\":\"a1Zb6hJxPTy\"},"
+    "{\"deviceName\":\"000D6F000ABCDE04\",\"productKey\":\"a1Zb6hJxPTy\"},"
+    "{\"deviceName\":\"000D6F000C1F3A11\",\"productKey\":\"a1kQx9LmZ2p\"},"
+    "{\"deviceName\":\"000D6F000C1F3A12\",\"productKey\":\"a1kQx9LmZ2p\"},"
+    "{\"deviceName\":\"000D6F000C1F3A13\",\"productKey\":\"a1kQx9LmZ2p\"},"
+    "{\"deviceName\":\"000D6F000D40B7E5\",\"productKey\":\"a1Hc3TnRw8v\"}],"
+    "\"id\":\"123\",\"message\":\"success\",\"method\":\"thing.topo.get\",\"version\":\"1.0\"}";
+
+/* firmware upgrade notification */
+static const char g_json_ota_upgrade[] =
+    "{\"code\":\"1000\",\"data\":{\"size\":262144,\"sign\":\"93230c3bde425a9d7984a594ac55ea1e\","
+    "\"version\":\"2.1.0\",\"url\":\"https://iotx-ota.oss-cn-shanghai.aliyuncs.com/ota/"
+    "3f0a8f6e1b2c4d5e/ck2xq9w7e000032y7r3m4n5b6.bin?Expires=1571566234&OSSAccessKeyId="
+    "cS8uRRy54RszYWna&Signature=Hq8HpGmQF9yrD1%2Bm6kUjR0ZqWmQ%3D\",\"signMethod\":\"Md5\","
+    "\"md5\":\"93230c3bde425a9d7984a594ac55ea1e\"},\"id\":1571479834000,\"message\":\"success\"}";
+
+/* json_len and the packets are filled in by main() */
+static bench_payload_t g_payloads[] = {
+    {
+        .name = "property.set", .topic = "/sys/a1h5gKPj2DC/host_gateway/thing/service/property/set",
+        .json = g_json_property_set, .keys = {"method", "id", "params"}
+    },
+    {
+        .name = "property.post", .topic = "/sys/a1Zb6hJxPTy/000D6F000ABCDE01/thing/event/property/post",
+        .json = g_json_property_post, .keys = {"id", "params", "method"}
+    },
+    {
+        .name = "topo.reply", .topic = "/sys/a1h5gKPj2DC/host_gateway/thing/topo/get_reply",
+        .json = g_json_topo_reply, .keys = {"code", "data", "id"}
+    },
+    {
+        .name = "ota.upgrade", .topic = "/ota/device/upgrade/a1h5gKPj2DC/host_gateway",
+        .json = g_json_ota_upgrade, .keys = {"code", "data", "id"}
+    },
+};
+
+#define BENCH_PAYLOAD_NUM   (sizeof(g_payloads) / sizeof(g_payloads[0]))
+
+static const uint8_t g_bench_key[] = "host_gateway_device_secret_0000";
+
+/* results are folded in here so the calls cannot be optimized away */
+static volatile uint32_t g_bench_sink;
+
+static uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int bench_lite_cjson(bench_payload_t *p)
+{
+    lite_cjson_t root, item;
+    int idx;
+
+    if (lite_cjson_parse(p->json, p->json_len, &root) != 0) {
+        return -1;
+    }
+    for (idx = 0; idx < BENCH_KEYS_MAX; idx++) {
+        if (lite_cjson_object_item(&root, p->keys[idx], strlen(p->keys[idx]), &item) != 0) {
+            return -1;
+        }
+        g_bench_sink += item.value_length;
+    }
+    return 0;
+}
+
+static int bench_json_parser(bench_payload_t *p)
+{
+    char *value;
+    int value_len, value_type, idx;
+
+    for (idx = 0; idx < BENCH_KEYS_MAX; idx++) {
+        value = json_get_value_by_name((char *)p->json, p->json_len, (char *)p->keys[idx], &value_len, &value_type);
+        if (NULL == value) {
+            return -1;
+        }
+        g_bench_sink += value_len;
+    }
+    return 0;
+}
+
+static int bench_cjson(bench_payload_t *p)
+{
+    cJSON *root, *item;
+    int idx;
+
+    root = cJSON_Parse(p->json);
+    if (NULL == root) {
+        return -1;
+    }
+    for (idx = 0; idx < BENCH_KEYS_MAX; idx++) {
+        item = cJSON_GetObjectItem(root, p->keys[idx]);
+        if (NULL == item) {
+            cJSON_Delete(root);
+            return -1;
+        }
+        g_bench_sink += item->type;
+    }
+    cJSON_Delete(root);
+    return 0;
+}
+
+static int bench_mqtt_serialize(bench_payload_t *p)
+{
+    MQTTString topic = MQTTString_initializer;
+    unsigned char buf[BENCH_PACKET_MAX];
+    int len;
+
+    topic.cstring = (char *)p->topic;
+    len = MQTTSerialize_publish(buf, sizeof(buf), 0, 1, 0, 0x1234, topic, (unsigned char *)p->json, p->json_len);
+    if (len <= 0) {
+        return -1;
+    }
+    if (0 == p->mqtt_pkt_len) {
+        memcpy(p->mqtt_pkt, buf, len);
+        p->mqtt_pkt_len = len;
+    }
+    g_bench_sink += buf[len - 1];
+    return 0;
+}
+
+static int bench_mqtt_deserialize(bench_payload_t *p)
+{
+    MQTTString topic = MQTTString_initializer;
+    unsigned char dup, retained;
+    unsigned short packet_id;
+    unsigned char *payload;
+    int qos, payload_len;
+
+    if (MQTTDeserialize_publish(&dup, &qos, &retained, &packet_id, &topic, &payload, &payload_len,
+                                p->mqtt_pkt, p->mqtt_pkt_len) != 1) {
+        return -1;
+    }
+    g_bench_sink += payload_len + topic.lenstring.len;
+    return 0;
+}
+
+static int bench_coap_serialize(bench_payload_t *p)
+{
+    CoAPMessage message;
+    unsigned char buf[BENCH_PACKET_MAX];
+    unsigned char token[4] = {0x5a, 0x17, 0x02, 0xc4};
+    const char *segment, *end;
+    int len;
+
+    CoAPMessage_init(&message);
+    CoAPMessageType_set(&message, COAP_MESSAGE_TYPE_CON);
+    CoAPMessageCode_set(&message, COAP_MSG_CODE_POST);
+    CoAPMessageId_set(&message, 0x1234);
+    CoAPMessageToken_set(&message, token, sizeof(token));
+
+    /* one Uri-Path option per topic level, as the ALCS server maps them */
+    for (segment = p->topic + 1; *segment != '\0'; segment = (*end != '\0') ? end + 1 : end) {
+        end = strchr(segment, '/');
+        if (NULL == end) {
+            end = segment + strlen(segment);
+        }
+        CoAPStrOption_add(&message, COAP_OPTION_URI_PATH, (unsigned char *)segment, end - segment);
+    }
+    CoAPUintOption_add(&message, COAP_OPTION_CONTENT_FORMAT, COAP_CT_APP_JSON);
+    CoAPMessagePayload_set(&message, (unsigned char *)p->json, p->json_len);
+
+    len = CoAPSerialize_Message(&message, buf, sizeof(buf));
+    CoAPMessage_destory(&message);
+    if (len <= 0) {
+        return -1;
+    }
+    if (0 == p->coap_pkt_len) {
+        memcpy(p->coap_pkt, buf, len);
+        p->coap_pkt_len = len;
+    }
+    g_bench_sink += buf[len - 1];
+    return 0;
+}
+
+static int bench_coap_deserialize(bench_payload_t *p)
+{
+    CoAPMessage message;
+
+    if (CoAPDeserialize_Message(&message, p->coap_pkt, p->coap_pkt_len) != 0) {
+        return -1;
+    }
+    g_bench_sink += message.payloadlen + message.optcount;
+    return 0;
+}
+
+static int bench_sha256(bench_payload_t *p)
+{
+    uint8_t digest[32];
+
+    utils_sha256((const uint8_t *)p->json, p->json_len, digest);
+    g_bench_sink += digest[0];
+    return 0;
+}
+
+/* host/codec_sha256_small.c, the same sha256 built with INFRA_SHA256_SMALLER */
+void codec_sha256_small(const uint8_t *input, uint32_t ilen, uint8_t output[32]);
+
+static int bench_sha256_small(bench_payload_t *p)
+{
+    static const bench_payload_t *checked = NULL;
+    uint8_t digest[32];
+    uint8_t check[32];
+
+    codec_sha256_small((const uint8_t *)p->json, p->json_len, digest);
+    /* the first call per payload, in the warm up, against the unrolled kernel */
+    if (checked != p) {
+        utils_sha256((const uint8_t *)p->json, p->json_len, check);
+        if (memcmp(digest, check, sizeof(digest)) != 0) {
+            return -1;
+        }
+        checked = p;
+    }
+    g_bench_sink += digest[0];
+    return 0;
+}
+
+/* the whole corpus in one call, against the sum of the sha256 rows */
+static int bench_sha256_multi(bench_payload_t *p)
+{
+    const uint8_t *input[BENCH_PAYLOAD_NUM];
+    uint32_t ilen[BENCH_PAYLOAD_NUM];
+    uint8_t digest[BENCH_PAYLOAD_NUM][32];
+    uint32_t idx;
+
+    for (idx = 0; idx < BENCH_PAYLOAD_NUM; idx++) {
+        input[idx] = (const uint8_t *)g_payloads[idx].json;
+        ilen[idx] = g_payloads[idx].json_len;
+    }
+    utils_sha256_multi(input, ilen, digest, BENCH_PAYLOAD_NUM);
+    g_bench_sink += digest[0][0];
+    return 0;
+}
+
+static int bench_hmac_sha256(bench_payload_t *p)
+{
+    uint8_t digest[32];
+
+    utils_hmac_sha256((const uint8_t *)p->json, p->json_len, g_bench_key, sizeof(g_bench_key) - 1, digest);
+    g_bench_sink += digest[0];
+    return 0;
+}
+
+static int bench_sha1(bench_payload_t *p)
+{
+    unsigned char digest[20];
+
+    utils_sha1((const unsigned char *)p->json, p->json_len, digest);
+    g_bench_sink += digest[0];
+    return 0;
+}
+
+static int bench_md5(bench_payload_t *p)
+{
+    unsigned char digest[16];
+
+    utils_md5((const unsigned char *)p->json, p->json_len, digest);
+    g_bench_sink += digest[0];
+    return 0;
+}
+
+static int bench_sign_mqtt(bench_payload_t *p)
+{
+    static iotx_dev_meta_info_t meta;
+    iotx_sign_mqtt_t signout;
+
+    if ('\0' == meta.product_key[0]) {
+        HAL_GetProductKey(meta.product_key);
+        HAL_GetDeviceName(meta.device_name);
+        HAL_GetDeviceSecret(meta.device_secret);
+    }
+    if (IOT_Sign_MQTT(IOTX_CLOUD_REGION_SHANGHAI, &meta, &signout) != 0) {
+        return -1;
+    }
+    g_bench_sink += signout.password[0];
+    return 0;
+}
+
+#define BENCH_SUBDEV_PK          "a1bench0001"
+#define BENCH_SUBDEV_DN          "00158d0001a2b3c4_01"
+#define BENCH_SUBDEV_TIMESTAMP   "1234567"
+
+/* what a combine login signed before the sign material was kept per device */
+static int bench_sign_subdev_raw(bench_payload_t *p)
+{
+    char client_id[IOTX_PRODUCT_KEY_LEN + 1 + IOTX_DEVICE_NAME_LEN + 21];
+    char source[256];
+    char sign[DEV_SIGN_SUBDEV_SIGN_LEN] = {0};
+
+    HAL_Snprintf(client_id, sizeof(client_id), "%s.%s|_v=sdk-c-"IOTX_SDK_VERSION"|", BENCH_SUBDEV_PK,
+                 BENCH_SUBDEV_DN);
+    HAL_Snprintf(source, sizeof(source), "clientId%sdeviceName%sproductKey%stimestamp%s", client_id,
+                 BENCH_SUBDEV_DN, BENCH_SUBDEV_PK, BENCH_SUBDEV_TIMESTAMP);
+    utils_hmac_sha1(source, strlen(source), sign, (const char *)g_bench_key, sizeof(g_bench_key) - 1);
+    g_bench_sink += sign[0];
+    return 0;
+}
+
+static int bench_sign_subdev(bench_payload_t *p)
+{
+    static iotx_sign_subdev_t subdev;
+    char sign[DEV_SIGN_SUBDEV_SIGN_LEN];
+
+    if ('\0' == subdev.clientid[0]) {
+        char expect[DEV_SIGN_SUBDEV_SIGN_LEN] = {0};
+        char source[256];
+
+        if (IOT_Sign_Subdev_Init(&subdev, BENCH_SUBDEV_PK, BENCH_SUBDEV_DN, (const char *)g_bench_key) != 0 ||
+            IOT_Sign_Subdev(&subdev, BENCH_SUBDEV_TIMESTAMP, sign) != 0) {
+            return -1;
+        }
+        HAL_Snprintf(source, sizeof(source), "clientId%sdeviceName%sproductKey%stimestamp%s", subdev.clientid,
+                     BENCH_SUBDEV_DN, BENCH_SUBDEV_PK, BENCH_SUBDEV_TIMESTAMP);
+        utils_hmac_sha1(source, strlen(source), expect, (const char *)g_bench_key, sizeof(g_bench_key) - 1);
+        if (0 != strcmp(sign, expect)) {
+            return -1;
+        }
+    }
+    if (IOT_Sign_Subdev(&subdev, BENCH_SUBDEV_TIMESTAMP, sign) != 0) {
+        return -1;
+    }
+    g_bench_sink += sign[0];
+    return 0;
+}
+
+#ifdef CODEC_BENCH_AES
+static session_item g_bench_session;
+
+/* what every ALCS message paid, twice, before sessions kept their keys expanded */
+static int bench_aes_key_setup(bench_payload_t *p)
+{
+    p_HAL_Aes128_t aes = HAL_Aes128_Init((const uint8_t *)g_bench_session.sessionKey,
+                                         (const uint8_t *)"a1b1c1d1e1f1g1h1", HAL_AES_ENCRYPTION);
+
+    if (NULL == aes) {
+        return -1;
+    }
+    HAL_Aes128_Destroy(aes);
+    return 0;
+}
+
+static int bench_alcs_encrypt(bench_payload_t *p)
+{
+    unsigned char buf[BENCH_PACKET_MAX];
+    int len;
+
+    len = alcs_encrypt(p->json, p->json_len, &g_bench_session, buf);
+    if (len <= 0) {
+        return -1;
+    }
+    if (0 == p->alcs_pkt_len) {
+        memcpy(p->alcs_pkt, buf, len);
+        p->alcs_pkt_len = len;
+    }
+    g_bench_sink += buf[len - 1];
+    return 0;
+}
+
+static int bench_alcs_decrypt(bench_payload_t *p)
+{
+    char buf[BENCH_PACKET_MAX];
+
+    if (alcs_decrypt((const char *)p->alcs_pkt, p->alcs_pkt_len, &g_bench_session, buf) != p->json_len) {
+        return -1;
+    }
+    g_bench_sink += buf[0];
+    return 0;
+}
+#endif
+
+static const bench_case_t g_cases[] = {
+    {"lite_cjson",      1, bench_lite_cjson},
+    {"json_parser",     1, bench_json_parser},
+    {"cjson",           1, bench_cjson},
+    {"mqtt_serialize",  1, bench_mqtt_serialize},
+    {"mqtt_deserialize", 1, bench_mqtt_deserialize},
+    {"coap_serialize",  1, bench_coap_serialize},
+    {"coap_deserialize", 1, bench_coap_deserialize},
+    {"sha256",          1, bench_sha256},
+    {"sha256_small",    1, bench_sha256_small},
+    {"sha256_multi",    0, bench_sha256_multi},
+    {"hmac_sha256",     1, bench_hmac_sha256},
+    {"sha1",            1, bench_sha1},
+    {"md5",             1, bench_md5},
+    {"sign_mqtt",       0, bench_sign_mqtt},
+    {"sign_subdev_raw", 0, bench_sign_subdev_raw},
+    {"sign_subdev",     0, bench_sign_subdev},
+#ifdef CODEC_BENCH_AES
+    {"aes_key_setup",   0, bench_aes_key_setup},
+    {"alcs_encrypt",    1, bench_alcs_encrypt},
+    {"alcs_decrypt",    1, bench_alcs_decrypt},
+#endif
+};
+
+#define BENCH_CASE_NUM      (sizeof(g_cases) / sizeof(g_cases[0]))
+
+static int bench_run(const bench_case_t *bc, bench_payload_t *p, uint32_t iterations)
+{
+    hal_heap_stats_t before, after;
+    uint64_t start, elapsed;
+    uint32_t idx;
+
+    /* warm up */
+    for (idx = 0; idx < iterations / 10 + 1; idx++) {
+        if (bc->run(p) != 0) {
+            printf("  %-17s %-14s failed\n", bc->name, bc->per_payload ? p->name : "-");
+            return -1;
+        }
+    }
+
+    HAL_Heap_GetStats(&before);
+    start = bench_now_ns();
+    for (idx = 0; idx < iterations; idx++) {
+        bc->run(p);
+    }
+    elapsed = bench_now_ns() - start;
+    HAL_Heap_GetStats(&after);
+
+    printf("  %-17s %-14s %6d %10.1f %8.2f %10.1f\n", bc->name, bc->per_payload ? p->name : "-",
+           bc->per_payload ? p->json_len : 0, (double)elapsed / iterations,
+           (double)(after.allocs - before.allocs) / iterations,
+           (double)(after.alloc_bytes - before.alloc_bytes) / iterations);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *filter = NULL;
+    uint32_t    iterations = 100000;
+    uint32_t    idx, pidx;
+    int         failed = 0;
+    int         opt;
+
+    while ((opt = getopt(argc, argv, "n:f:")) != -1) {
+        switch (opt) {
+            case 'n':
+                iterations = (uint32_t)atoi(optarg);
+                break;
+            case 'f':
+                filter = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n iterations] [-f case filter]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (0 == iterations) {
+        fprintf(stderr, "invalid arguments, iterations > 0\n");
+        return 1;
+    }
+
+#ifdef CODEC_BENCH_AES
+    memcpy(g_bench_session.sessionKey, g_bench_key, sizeof(g_bench_session.sessionKey));
+    if (alcs_session_key_init(&g_bench_session) != 0) {
+        fprintf(stderr, "alcs_session_key_init failed\n");
+        return 1;
+    }
+#endif
+
+    for (pidx = 0; pidx < BENCH_PAYLOAD_NUM; pidx++) {
+        g_payloads[pidx].json_len = strlen(g_payloads[pidx].json);
+
+        /* the first serialize keeps its packet for the deserialize cases */
+        if (bench_mqtt_serialize(&g_payloads[pidx]) != 0 || bench_coap_serialize(&g_payloads[pidx]) != 0) {
+            fprintf(stderr, "%s does not serialize\n", g_payloads[pidx].name);
+            return 1;
+        }
+#ifdef CODEC_BENCH_AES
+        if (bench_alcs_encrypt(&g_payloads[pidx]) != 0) {
+            fprintf(stderr, "%s does not encrypt\n", g_payloads[pidx].name);
+            return 1;
+        }
+#endif
+    }
+
+    printf("codec_bench: %u iterations per case\n", iterations);
+    printf("  %-17s %-14s %6s %10s %8s %10s\n", "case", "payload", "bytes", "ns/op", "allocs", "alloc B/op");
+    for (idx = 0; idx < BENCH_CASE_NUM; idx++) {
+        if (NULL != filter && NULL == strstr(g_cases[idx].name, filter)) {
+            continue;
+        }
+        for (pidx = 0; pidx < (g_cases[idx].per_payload ? BENCH_PAYLOAD_NUM : 1); pidx++) {
+            if (bench_run(&g_cases[idx], &g_payloads[pidx], iterations) != 0) {
+                failed = 1;
+            }
+        }
+    }
+
+#ifdef CODEC_BENCH_AES
+    alcs_session_key_deinit(&g_bench_session);
+#endif
+    return failed;
+}
@@ -0,0 +1,21 @@
+/*
+ * The INFRA_SHA256_SMALLER kernel of infra/infra_sha256.c, built under
+ * codec_sha256_small_ names so that codec_bench times it next to the
+ * unrolled one the SDK library is built with.
+ */
+#define INFRA_SHA256_SMALLER
+
+#define utils_sha256_init           codec_sha256_small_init
+#define utils_sha256_free           codec_sha256_small_free
+#define utils_sha256_starts         codec_sha256_small_starts
+#define utils_sha256_update         codec_sha256_small_update
+#define utils_sha256_finish         codec_sha256_small_finish
+#define utils_sha256_process        codec_sha256_small_process
+#define utils_sha256                codec_sha256_small
+#define utils_sha256_multi          codec_sha256_small_multi
+#define utils_hmac_sha256_starts    codec_hmac_sha256_small_starts
+#define utils_hmac_sha256_update    codec_hmac_sha256_small_update
+#define utils_hmac_sha256_finish    codec_hmac_sha256_small_finish
+#define utils_hmac_sha256           codec_hmac_sha256_small
+
+#include "infra_sha256.c"
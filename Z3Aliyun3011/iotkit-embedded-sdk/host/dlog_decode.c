@@ -0,0 +1,573 @@
+/*
+ * Decoder of the infra_dlog stream.
+ *
+ * The firmware logs the address of each format string and its raw
+ * arguments (infra/infra_dlog.h), this formats them back with the strings
+ * read out of the ELF image that produced the stream: the .out of the IAR
+ * build for the target, the executable itself for the host build.
+ *
+ * The stream is the binary RTT channel "dlog" (or the IOTX_DLOG_FILE of a
+ * host program), or with -x a console capture holding the "@D" hex lines
+ * the target prints when it is built without RTT.
+ *
+ * usage: dlog_decode [-x] [-f timestamp hz] elf [stream]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <elf.h>
+
+#include "infra_config.h"
+#include "infra_log.h"
+#include "infra_dlog.h"
+
+typedef struct {
+    uint64_t vaddr;
+    uint64_t offset;
+    uint64_t size;
+} decode_segment_t;
+
+typedef struct {
+    unsigned char    *image;
+    size_t            size;
+    int               is64;
+    uint64_t          anchor;
+    decode_segment_t *segments;
+    int               segment_num;
+} decode_elf_t;
+
+typedef struct {
+    uint32_t freq;
+    uint32_t last_ts;
+    uint64_t ts;
+    int      started;
+} decode_clock_t;
+
+static const char *const g_level_names[] = {
+    "non", "crt", "err", "wrn", "inf", "dbg", "flw"
+};
+
+static unsigned char *decode_read_file(const char *path, size_t *size)
+{
+    FILE          *fp = fopen(path, "rb");
+    unsigned char *buf = NULL;
+    long           len;
+
+    if (NULL == fp) {
+        return NULL;
+    }
+    if (0 == fseek(fp, 0, SEEK_END) && (len = ftell(fp)) > 0 && 0 == fseek(fp, 0, SEEK_SET)) {
+        buf = (unsigned char *)malloc(len);
+        if (NULL != buf && 1 != fread(buf, len, 1, fp)) {
+            free(buf);
+            buf = NULL;
+        }
+        *size = len;
+    }
+    fclose(fp);
+
+    return buf;
+}
+
+/* segments from the program headers, the anchor from the symbol tables */
+static int decode_elf_load(decode_elf_t *elf, const char *path)
+{
+    uint64_t phoff, shoff;
+    int      phnum, shnum, phentsize, shentsize;
+    int      i;
+    uint64_t j;
+
+    memset(elf, 0, sizeof(decode_elf_t));
+    elf->image = decode_read_file(path, &elf->size);
+    if (NULL == elf->image || elf->size < EI_NIDENT || 0 != memcmp(elf->image, ELFMAG, SELFMAG)) {
+        fprintf(stderr, "%s: not an ELF file\n", path);
+        return -1;
+    }
+    if (ELFDATA2LSB != elf->image[EI_DATA]) {
+        fprintf(stderr, "%s: big endian ELF not supported\n", path);
+        return -1;
+    }
+    elf->is64 = (ELFCLASS64 == elf->image[EI_CLASS]);
+
+    if (elf->is64) {
+        Elf64_Ehdr *eh = (Elf64_Ehdr *)elf->image;
+        phoff = eh->e_phoff;
+        phnum = eh->e_phnum;
+        phentsize = eh->e_phentsize;
+        shoff = eh->e_shoff;
+        shnum = eh->e_shnum;
+        shentsize = eh->e_shentsize;
+    } else {
+        Elf32_Ehdr *eh = (Elf32_Ehdr *)elf->image;
+        phoff = eh->e_phoff;
+        phnum = eh->e_phnum;
+        phentsize = eh->e_phentsize;
+        shoff = eh->e_shoff;
+        shnum = eh->e_shnum;
+        shentsize = eh->e_shentsize;
+    }
+    if (phoff + (uint64_t)phnum * phentsize > elf->size || shoff + (uint64_t)shnum * shentsize > elf->size) {
+        fprintf(stderr, "%s: truncated ELF\n", path);
+        return -1;
+    }
+
+    elf->segments = (decode_segment_t *)calloc(phnum + 1, sizeof(decode_segment_t));
+    for (i = 0; i < phnum; i++) {
+        unsigned char *ph = elf->image + phoff + (uint64_t)i * phentsize;
+        decode_segment_t *seg = &elf->segments[elf->segment_num];
+
+        if (elf->is64) {
+            Elf64_Phdr *p = (Elf64_Phdr *)ph;
+            if (PT_LOAD != p->p_type) {
+                continue;
+            }
+            seg->vaddr = p->p_vaddr;
+            seg->offset = p->p_offset;
+            seg->size = p->p_filesz;
+        } else {
+            Elf32_Phdr *p = (Elf32_Phdr *)ph;
+            if (PT_LOAD != p->p_type) {
+                continue;
+            }
+            seg->vaddr = p->p_vaddr;
+            seg->offset = p->p_offset;
+            seg->size = p->p_filesz;
+        }
+        if (seg->offset + seg->size <= elf->size) {
+            elf->segment_num++;
+        }
+    }
+
+    for (i = 0; i < shnum && 0 == elf->anchor; i++) {
+        uint64_t sh_type, sh_offset, sh_size, sh_link, sh_entsize, str_offset, str_size;
+        unsigned char *sh = elf->image + shoff + (uint64_t)i * shentsize;
+        unsigned char *link;
+
+        if (elf->is64) {
+            Elf64_Shdr *s = (Elf64_Shdr *)sh;
+            sh_type = s->sh_type;
+            sh_offset = s->sh_offset;
+            sh_size = s->sh_size;
+            sh_link = s->sh_link;
+            sh_entsize = s->sh_entsize;
+        } else {
+            Elf32_Shdr *s = (Elf32_Shdr *)sh;
+            sh_type = s->sh_type;
+            sh_offset = s->sh_offset;
+            sh_size = s->sh_size;
+            sh_link = s->sh_link;
+            sh_entsize = s->sh_entsize;
+        }
+        if ((SHT_SYMTAB != sh_type && SHT_DYNSYM != sh_type) || 0 == sh_entsize || sh_link >= (uint64_t)shnum
+            || sh_offset + sh_size > elf->size) {
+            continue;
+        }
+
+        link = elf->image + shoff + sh_link * shentsize;
+        str_offset = elf->is64 ? ((Elf64_Shdr *)link)->sh_offset : ((Elf32_Shdr *)link)->sh_offset;
+        str_size = elf->is64 ? ((Elf64_Shdr *)link)->sh_size : ((Elf32_Shdr *)link)->sh_size;
+        if (str_offset + str_size > elf->size) {
+            continue;
+        }
+
+        for (j = 0; j < sh_size / sh_entsize; j++) {
+            uint64_t name, value;
+
+            if (elf->is64) {
+                Elf64_Sym *sym = (Elf64_Sym *)(elf->image + sh_offset + j * sh_entsize);
+                name = sym->st_name;
+                value = sym->st_value;
+            } else {
+                Elf32_Sym *sym = (Elf32_Sym *)(elf->image + sh_offset + j * sh_entsize);
+                name = sym->st_name;
+                value = sym->st_value;
+            }
+            if (name < str_size && 0 == strcmp((char *)elf->image + str_offset + name, "g_dlog_anchor")) {
+                elf->anchor = value;
+                break;
+            }
+        }
+    }
+    if (0 == elf->anchor) {
+        fprintf(stderr, "%s: no g_dlog_anchor symbol, stripped or built without INFRA_DLOG?\n", path);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* the string at anchor + offset in the image, NULL when it is not in a loaded segment */
+static const char *decode_elf_string(decode_elf_t *elf, uint32_t offset, uint64_t *addr)
+{
+    uint64_t vaddr;
+    int      i;
+
+    if (DLOG_OFFSET_NONE == offset) {
+        *addr = 0;
+        return NULL;
+    }
+    if (elf->is64) {
+        vaddr = elf->anchor + (int64_t)(int32_t)offset;
+    } else {
+        vaddr = (uint32_t)(elf->anchor + offset);
+    }
+    *addr = vaddr;
+
+    for (i = 0; i < elf->segment_num; i++) {
+        decode_segment_t *seg = &elf->segments[i];
+
+        if (vaddr >= seg->vaddr && vaddr < seg->vaddr + seg->size
+            && NULL != memchr(elf->image + seg->offset + (vaddr - seg->vaddr), '\0', seg->vaddr + seg->size - vaddr)) {
+            return (const char *)elf->image + seg->offset + (vaddr - seg->vaddr);
+        }
+    }
+
+    return NULL;
+}
+
+static int decode_take(const uint32_t *args, int num, int *pos, uint64_t *value, int words)
+{
+    if (*pos + words > num) {
+        return -1;
+    }
+    *value = args[(*pos)++];
+    if (2 == words) {
+        *value |= (uint64_t)args[(*pos)++] << 32;
+    }
+    return 0;
+}
+
+/* the walk _dlog_put_args() does, printing instead of storing */
+static void decode_format(decode_elf_t *elf, const char *fmt, const uint32_t *args, int num, char *out, size_t size)
+{
+    const char *p = fmt;
+    size_t      len = 0;
+    char        spec[32];
+    char        str[INFRA_DLOG_STR_MAX + 1];
+    int         spec_len;
+    int         pos = 0;
+    int         lmod;
+    int         words;
+    uint64_t    value;
+    union {
+        double   d;
+        uint64_t u;
+    } dbl;
+
+#define DECODE_APPEND(...) \
+    do { \
+        if (len < size) { \
+            int n = snprintf(out + len, size - len, __VA_ARGS__); \
+            len += (n > 0) ? (size_t)n : 0; \
+        } \
+    } while (0)
+
+    while (*p != '\0') {
+        if (*p != '%') {
+            DECODE_APPEND("%c", *p++);
+            continue;
+        }
+        if (p[1] == '%') {
+            DECODE_APPEND("%%");
+            p += 2;
+            continue;
+        }
+
+        /* rebuild the spec without length modifiers, with the '*' values filled in */
+        spec_len = 0;
+        spec[spec_len++] = *p++;
+        while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') {
+            spec[spec_len++] = *p++;
+        }
+        if (*p == '*') {
+            if (decode_take(args, num, &pos, &value, 1) < 0) {
+                goto missing;
+            }
+            spec_len += snprintf(spec + spec_len, sizeof(spec) - spec_len, "%d", (int)(int32_t)value);
+            p++;
+        }
+        while (*p >= '0' && *p <= '9' && spec_len < 20) {
+            spec[spec_len++] = *p++;
+        }
+        if (*p == '.') {
+            spec[spec_len++] = *p++;
+            if (*p == '*') {
+                if (decode_take(args, num, &pos, &value, 1) < 0) {
+                    goto missing;
+                }
+                spec_len += snprintf(spec + spec_len, sizeof(spec) - spec_len, "%d", (int)(int32_t)value);
+                p++;
+            }
+            while (*p >= '0' && *p <= '9' && spec_len < 26) {
+                spec[spec_len++] = *p++;
+            }
+        }
+
+        lmod = 0;
+        while (*p == 'h' || *p == 'l' || *p == 'z' || *p == 't' || *p == 'j' || *p == 'L') {
+            if (*p == 'l') {
+                lmod = (lmod == 1) ? 2 : 1;
+            } else if (*p == 'j') {
+                lmod = 2;
+            } else if (*p == 'z' || *p == 't') {
+                lmod = 3;
+            }
+            p++;
+        }
+        spec[spec_len] = '\0';
+
+        switch (*p) {
+            case 'd':
+            case 'i':
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+            case 'c': {
+                words = (lmod == 2 || (lmod != 0 && elf->is64)) ? 2 : 1;
+                if (decode_take(args, num, &pos, &value, words) < 0) {
+                    goto missing;
+                }
+                if (*p == 'c') {
+                    DECODE_APPEND(strcat(spec, "c"), (int)value);
+                    break;
+                }
+                if (1 == words && (*p == 'd' || *p == 'i')) {
+                    value = (uint64_t)(int64_t)(int32_t)value;
+                }
+                spec[spec_len++] = 'l';
+                spec[spec_len++] = 'l';
+                spec[spec_len++] = *p;
+                spec[spec_len] = '\0';
+                DECODE_APPEND(spec, (long long)value);
+                break;
+            }
+            case 'e':
+            case 'E':
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A': {
+                if (decode_take(args, num, &pos, &dbl.u, 2) < 0) {
+                    goto missing;
+                }
+                spec[spec_len++] = *p;
+                spec[spec_len] = '\0';
+                DECODE_APPEND(spec, dbl.d);
+                break;
+            }
+            case 's': {
+                if (decode_take(args, num, &pos, &value, 1) < 0 || value > INFRA_DLOG_STR_MAX
+                    || pos + (int)((value + 3) / 4) > num) {
+                    goto missing;
+                }
+                memcpy(str, &args[pos], value);
+                str[value] = '\0';
+                pos += (value + 3) / 4;
+                DECODE_APPEND(strcat(spec, "s"), str);
+                break;
+            }
+            case 'p': {
+                if (decode_take(args, num, &pos, &value, elf->is64 ? 2 : 1) < 0) {
+                    goto missing;
+                }
+                DECODE_APPEND("0x%llx", (unsigned long long)value);
+                break;
+            }
+            case 'n':
+                break;
+            default:
+                goto missing;
+        }
+        if (*p != '\0') {
+            p++;
+        }
+    }
+    return;
+
+missing:
+    DECODE_APPEND("<?>");
+#undef DECODE_APPEND
+}
+
+static void decode_record(decode_elf_t *elf, decode_clock_t *clock, const uint32_t *rec, int words)
+{
+    uint32_t    hdr = rec[0];
+    int         level = DLOG_HDR_LEVEL(hdr);
+    const char *fmt, *func, *task;
+    uint64_t    fmt_addr, func_addr, task_addr;
+    char        text[1024];
+    char        task_buf[24];
+
+    /* unwrap the 32-bit timestamp, records of different tasks may be a little out of order */
+    if (clock->started) {
+        clock->ts += (int64_t)(int32_t)(rec[1] - clock->last_ts);
+    } else {
+        clock->ts = rec[1];
+        clock->started = 1;
+    }
+    clock->last_ts = rec[1];
+
+    if (DLOG_LEVEL_SYNC == level) {
+        clock->freq = rec[DLOG_RECORD_HDR_WORDS];
+        printf("[%14.6f] ---- timestamp %u Hz\n", (double)clock->ts / clock->freq, clock->freq);
+        return;
+    }
+    if (DLOG_LEVEL_DROPPED == level) {
+        printf("[%14.6f] ---- %u records dropped, ring full\n",
+               (double)clock->ts / clock->freq, rec[DLOG_RECORD_HDR_WORDS]);
+        return;
+    }
+
+    fmt = decode_elf_string(elf, rec[2], &fmt_addr);
+    func = decode_elf_string(elf, rec[3], &func_addr);
+    task = decode_elf_string(elf, rec[5], &task_addr);
+    if (NULL == task) {
+        snprintf(task_buf, sizeof(task_buf), (0 == task_addr) ? "-" : "0x%llx", (unsigned long long)task_addr);
+        task = task_buf;
+    }
+
+    text[0] = '\0';
+    if (NULL != fmt) {
+        decode_format(elf, fmt, rec + DLOG_RECORD_HDR_WORDS, words - DLOG_RECORD_HDR_WORDS, text, sizeof(text));
+    } else {
+        snprintf(text, sizeof(text), "<format 0x%llx not in the ELF>", (unsigned long long)fmt_addr);
+    }
+
+    /* drop the line ends the printf based macros used to add */
+    while (text[0] != '\0' && (text[strlen(text) - 1] == '\n' || text[strlen(text) - 1] == '\r')) {
+        text[strlen(text) - 1] = '\0';
+    }
+
+    printf("[%14.6f] %-12s %s %s(%u): %s%s\n",
+           (double)clock->ts / clock->freq,
+           task,
+           (level < (int)(sizeof(g_level_names) / sizeof(g_level_names[0]))) ? g_level_names[level] : "???",
+           (NULL != func) ? func : "?",
+           rec[4],
+           text,
+           (hdr & DLOG_HDR_TRUNCATED) ? " ..." : "");
+}
+
+static int decode_valid_header(uint32_t hdr)
+{
+    return (hdr & DLOG_HDR_MAGIC_MASK) == DLOG_HDR_MAGIC
+           && DLOG_HDR_WORDS(hdr) >= DLOG_RECORD_HDR_WORDS
+           && DLOG_HDR_WORDS(hdr) <= INFRA_DLOG_RECORD_WORDS_MAX;
+}
+
+/* raw little endian words, resynchronizing on the header magic after garbage */
+static int decode_binary(decode_elf_t *elf, decode_clock_t *clock, FILE *fp)
+{
+    uint32_t rec[INFRA_DLOG_RECORD_WORDS_MAX];
+    int      words;
+    int      skipped = 0;
+
+    while (1 == fread(&rec[0], sizeof(uint32_t), 1, fp)) {
+        if (!decode_valid_header(rec[0])) {
+            skipped++;
+            continue;
+        }
+        words = DLOG_HDR_WORDS(rec[0]);
+        if (1 != fread(&rec[1], (words - 1) * sizeof(uint32_t), 1, fp)) {
+            fprintf(stderr, "stream ends inside a record\n");
+            break;
+        }
+        decode_record(elf, clock, rec, words);
+    }
+    if (skipped > 0) {
+        fprintf(stderr, "%d words skipped outside records\n", skipped);
+    }
+
+    return 0;
+}
+
+/* "@D xxxxxxxx ..." lines of a console capture, everything else is ignored */
+static int decode_hex(decode_elf_t *elf, decode_clock_t *clock, FILE *fp)
+{
+    uint32_t rec[INFRA_DLOG_RECORD_WORDS_MAX];
+    char     line[1024];
+    char    *p, *end;
+    int      words;
+
+    while (NULL != fgets(line, sizeof(line), fp)) {
+        p = strstr(line, "@D ");
+        if (NULL == p) {
+            continue;
+        }
+        p += 2;
+        for (words = 0; words < INFRA_DLOG_RECORD_WORDS_MAX; words++) {
+            rec[words] = (uint32_t)strtoul(p, &end, 16);
+            if (end == p) {
+                break;
+            }
+            p = end;
+        }
+        if (words < DLOG_RECORD_HDR_WORDS || !decode_valid_header(rec[0]) || DLOG_HDR_WORDS(rec[0]) != words) {
+            fprintf(stderr, "bad record line: %s", line);
+            continue;
+        }
+        decode_record(elf, clock, rec, words);
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    decode_elf_t   elf;
+    decode_clock_t clock;
+    FILE          *fp = stdin;
+    int            hex = 0;
+    int            opt;
+
+    memset(&clock, 0, sizeof(clock));
+    clock.freq = 1000000;
+
+    while ((opt = getopt(argc, argv, "xf:")) != -1) {
+        switch (opt) {
+            case 'x':
+                hex = 1;
+                break;
+            case 'f':
+                clock.freq = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-x] [-f timestamp hz] elf [stream]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (optind >= argc || 0 == clock.freq) {
+        fprintf(stderr, "usage: %s [-x] [-f timestamp hz] elf [stream]\n", argv[0]);
+        return 1;
+    }
+
+    if (decode_elf_load(&elf, argv[optind]) < 0) {
+        return 1;
+    }
+    if (optind + 1 < argc) {
+        fp = fopen(argv[optind + 1], hex ? "r" : "rb");
+        if (NULL == fp) {
+            fprintf(stderr, "open %s failed\n", argv[optind + 1]);
+            return 1;
+        }
+    }
+
+    if (hex) {
+        decode_hex(&elf, &clock, fp);
+    } else {
+        decode_binary(&elf, &clock, fp);
+    }
+
+    if (stdin != fp) {
+        fclose(fp);
+    }
+    free(elf.segments);
+    free(elf.image);
+
+    return 0;
+}
@@ -0,0 +1,239 @@
+/*
+ * MQTT round trip benchmark for the host simulation build.
+ *
+ * Connects through IOT_MQTT_Construct() to the broker stand-in (or any
+ * MQTT 3.1.1 broker), subscribes to its own topic and publishes -n
+ * messages, keeping at most -w of them in flight. Every payload carries
+ * its send time, so each message received back gives one round trip
+ * sample through the whole client stack: serialize, HAL_TCP, broker,
+ * HAL_TCP, deserialize, topic dispatch.
+ *
+ * With -m the client is driven like the gateway cm_yield thread does it,
+ * waiting in HAL_Network_Wait() and calling IOT_MQTT_Process(), instead of
+ * IOT_MQTT_Yield().
+ *
+ * usage: mqtt_bench [-h host] [-p port] [-n count] [-s payload size] [-q qos] [-w window] [-m]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "infra_types.h"
+#include "infra_defs.h"
+#include "infra_compat.h"
+#include "mqtt_api.h"
+#include "mqtt_wrapper.h"
+#ifdef INFRA_TRACE
+    #include "infra_trace.h"
+#endif
+
+#define BENCH_PAYLOAD_MIN       (16)
+#define BENCH_PAYLOAD_MAX       (4096)
+
+typedef struct {
+    uint32_t    count;
+    uint32_t    sent;
+    uint32_t    received;
+    uint32_t    out_of_order;
+    uint64_t   *latency_us;
+} bench_ctx_t;
+
+static uint64_t bench_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int bench_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void bench_message_arrive(void *pcontext, void *pclient, iotx_mqtt_event_msg_pt msg)
+{
+    bench_ctx_t            *ctx = (bench_ctx_t *)pcontext;
+    iotx_mqtt_topic_info_pt topic_info = (iotx_mqtt_topic_info_pt)msg->msg;
+    uint64_t                stamp;
+    uint32_t                seq;
+
+    if (IOTX_MQTT_EVENT_PUBLISH_RECEIVED != msg->event_type
+        || topic_info->payload_len < BENCH_PAYLOAD_MIN) {
+        return;
+    }
+
+    memcpy(&stamp, topic_info->payload, sizeof(stamp));
+    memcpy(&seq, topic_info->payload + sizeof(stamp), sizeof(seq));
+
+    if (ctx->received < ctx->count) {
+        ctx->latency_us[ctx->received] = bench_now_us() - stamp;
+    }
+    if (seq != ctx->received) {
+        ctx->out_of_order++;
+    }
+    ctx->received++;
+}
+
+int main(int argc, char *argv[])
+{
+    iotx_mqtt_param_t   mqtt_params;
+    bench_ctx_t         ctx;
+    char                product_key[IOTX_PRODUCT_KEY_LEN + 1] = {0};
+    char                device_name[IOTX_DEVICE_NAME_LEN + 1] = {0};
+    char                topic[128];
+    const char         *host = "127.0.0.1";
+    uint16_t            port = 1883;
+    uint32_t            size = 64;
+    uint32_t            window = 1;
+    int                 qos = 0;
+    char               *payload;
+    void               *pclient;
+    uint64_t            start;
+    uint64_t            elapsed;
+    uint64_t            idle_since;
+    uintptr_t           net_handle;
+    uint32_t            next_ms;
+    int                 multiplexed = 0;
+    int                 opt;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.count = 10000;
+
+    while ((opt = getopt(argc, argv, "h:p:n:s:q:w:m")) != -1) {
+        switch (opt) {
+            case 'h':
+                host = optarg;
+                break;
+            case 'p':
+                port = (uint16_t)atoi(optarg);
+                break;
+            case 'n':
+                ctx.count = (uint32_t)atoi(optarg);
+                break;
+            case 's':
+                size = (uint32_t)atoi(optarg);
+                break;
+            case 'q':
+                qos = atoi(optarg);
+                break;
+            case 'w':
+                window = (uint32_t)atoi(optarg);
+                break;
+            case 'm':
+                multiplexed = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-h host] [-p port] [-n count] [-s size] [-q qos] [-w window] [-m]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (size < BENCH_PAYLOAD_MIN || size > BENCH_PAYLOAD_MAX || qos < 0 || qos > 1
+        || 0 == window || 0 == ctx.count) {
+        fprintf(stderr, "invalid arguments, size %d..%d, qos 0..1\n", BENCH_PAYLOAD_MIN, BENCH_PAYLOAD_MAX);
+        return 1;
+    }
+
+    ctx.latency_us = (uint64_t *)calloc(ctx.count, sizeof(uint64_t));
+    payload = (char *)calloc(1, size);
+    if (NULL == ctx.latency_us || NULL == payload) {
+        return 1;
+    }
+    memset(payload, 'x', size);
+
+    HAL_GetProductKey(product_key);
+    HAL_GetDeviceName(device_name);
+    snprintf(topic, sizeof(topic), "/%s/%s/user/bench", product_key, device_name);
+
+    memset(&mqtt_params, 0, sizeof(mqtt_params));
+    mqtt_params.host = host;
+    mqtt_params.port = port;
+    mqtt_params.request_timeout_ms = 2000;
+    mqtt_params.keepalive_interval_ms = 60000;
+    mqtt_params.read_buf_size = size + 256;
+    mqtt_params.write_buf_size = size + 256;
+    mqtt_params.clean_session = 1;
+
+    pclient = IOT_MQTT_Construct(&mqtt_params);
+    if (NULL == pclient) {
+        fprintf(stderr, "IOT_MQTT_Construct to %s:%u failed\n", host, port);
+        return 1;
+    }
+
+    if (IOT_MQTT_Subscribe_Sync(pclient, topic, IOTX_MQTT_QOS1, bench_message_arrive, &ctx, 2000) < 0) {
+        fprintf(stderr, "subscribe %s failed\n", topic);
+        IOT_MQTT_Destroy(&pclient);
+        return 1;
+    }
+
+    start = bench_now_us();
+    idle_since = start;
+    while (ctx.received < ctx.count) {
+        uint32_t received = ctx.received;
+
+        while (ctx.sent < ctx.count && ctx.sent - ctx.received < window) {
+            uint64_t stamp = bench_now_us();
+
+            memcpy(payload, &stamp, sizeof(stamp));
+            memcpy(payload + sizeof(stamp), &ctx.sent, sizeof(ctx.sent));
+            if (IOT_MQTT_Publish_Simple(pclient, topic, qos, payload, size) < 0) {
+                break;
+            }
+            ctx.sent++;
+        }
+
+        if (multiplexed) {
+            if (0 == IOT_MQTT_PollInfo(pclient, &net_handle, &next_ms)) {
+                HAL_Network_Wait(&net_handle, 1, (next_ms < 200) ? next_ms : 200);
+            }
+            IOT_MQTT_Process(pclient);
+        } else {
+            IOT_MQTT_Yield(pclient, 1);
+        }
+
+        /* give up on the messages still missing after a quiet second */
+        if (ctx.received != received) {
+            idle_since = bench_now_us();
+        } else if (bench_now_us() - idle_since > 1000000) {
+            fprintf(stderr, "timeout, %u of %u messages lost\n", ctx.sent - ctx.received, ctx.sent);
+            break;
+        }
+    }
+    elapsed = bench_now_us() - start;
+
+    if (ctx.received > 0) {
+        uint32_t samples = (ctx.received < ctx.count) ? ctx.received : ctx.count;
+
+        qsort(ctx.latency_us, samples, sizeof(uint64_t), bench_cmp);
+        printf("mqtt_bench: %u msgs of %u bytes, qos %d, window %u, %s\n", samples, size, qos, window,
+               multiplexed ? "HAL_Network_Wait" : "IOT_MQTT_Yield");
+        printf("  throughput %.0f msg/s, %.2f MB/s\n",
+               samples * 1e6 / elapsed, (double)samples * size / elapsed);
+        printf("  round trip us: min %llu p50 %llu p90 %llu p99 %llu max %llu\n",
+               (unsigned long long)ctx.latency_us[0],
+               (unsigned long long)ctx.latency_us[samples / 2],
+               (unsigned long long)ctx.latency_us[samples * 9 / 10],
+               (unsigned long long)ctx.latency_us[samples * 99 / 100],
+               (unsigned long long)ctx.latency_us[samples - 1]);
+        if (ctx.out_of_order > 0) {
+            printf("  %u messages out of order\n", ctx.out_of_order);
+        }
+#ifdef INFRA_TRACE
+        /* receive side stages only, these publishes do not go through dev_model */
+        iotx_trace_dump();
+#endif
+    }
+
+    IOT_MQTT_Destroy(&pclient);
+    free(ctx.latency_us);
+    free(payload);
+
+    return (ctx.received >= ctx.count) ? 0 : 1;
+}
@@ -0,0 +1,596 @@
+/*
+ * Local MQTT 3.1.1 broker stand-in for the host simulation build.
+ *
+ * Single threaded, poll() driven, no persistence and no authentication:
+ * CONNECT is always accepted, QoS 2 publishes are acknowledged and
+ * delivered as QoS 1, retained messages are not kept. That is all the
+ * SDK's MQTT client needs to be driven end to end on Linux.
+ *
+ * usage: mqtt_broker [-p port] [-v]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define BROKER_DEFAULT_PORT         (1883)
+#define BROKER_MAX_CLIENTS          (64)
+#define BROKER_MAX_SUBS             (64)
+#define BROKER_TOPIC_MAXLEN         (128)
+#define BROKER_PACKET_MAXLEN        (256 * 1024)
+
+#define MQTT_CONNECT                (1)
+#define MQTT_CONNACK                (2)
+#define MQTT_PUBLISH                (3)
+#define MQTT_PUBACK                 (4)
+#define MQTT_PUBREC                 (5)
+#define MQTT_PUBREL                 (6)
+#define MQTT_PUBCOMP                (7)
+#define MQTT_SUBSCRIBE              (8)
+#define MQTT_SUBACK                 (9)
+#define MQTT_UNSUBSCRIBE            (10)
+#define MQTT_UNSUBACK               (11)
+#define MQTT_PINGREQ                (12)
+#define MQTT_PINGRESP               (13)
+#define MQTT_DISCONNECT             (14)
+
+typedef struct {
+    char        filter[BROKER_TOPIC_MAXLEN];
+    uint8_t     qos;
+} broker_sub_t;
+
+typedef struct {
+    int             fd;
+    int             connected;
+    uint16_t        next_packet_id;
+    uint8_t        *in;
+    uint32_t        in_len;
+    uint32_t        in_size;
+    uint8_t        *out;
+    uint32_t        out_len;
+    uint32_t        out_size;
+    broker_sub_t    subs[BROKER_MAX_SUBS];
+    uint8_t         sub_count;
+} broker_client_t;
+
+static broker_client_t  g_clients[BROKER_MAX_CLIENTS];
+static int              g_verbose = 0;
+static volatile int     g_running = 1;
+static uint64_t         g_publish_in = 0;
+static uint64_t         g_publish_out = 0;
+
+#define broker_log(...) \
+    do { \
+        if (g_verbose) { \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    } while (0)
+
+static void broker_stop(int sig)
+{
+    (void)sig;
+    g_running = 0;
+}
+
+static int broker_reserve(uint8_t **buf, uint32_t *size, uint32_t needed)
+{
+    uint32_t new_size = (*size > 0) ? *size : 1024;
+    uint8_t *new_buf;
+
+    if (needed <= *size) {
+        return 0;
+    }
+
+    while (new_size < needed) {
+        new_size *= 2;
+    }
+
+    new_buf = (uint8_t *)realloc(*buf, new_size);
+    if (NULL == new_buf) {
+        return -1;
+    }
+
+    *buf = new_buf;
+    *size = new_size;
+    return 0;
+}
+
+static void broker_close(broker_client_t *client)
+{
+    broker_log("client fd %d closed", client->fd);
+    close(client->fd);
+    free(client->in);
+    free(client->out);
+    memset(client, 0, sizeof(broker_client_t));
+    client->fd = -1;
+}
+
+/* queues a packet, the poll loop flushes it when the socket is writable */
+static int broker_send(broker_client_t *client, uint8_t header, const uint8_t *var, uint32_t var_len,
+                       const uint8_t *payload, uint32_t payload_len)
+{
+    uint32_t remaining = var_len + payload_len;
+    uint8_t  encoded[5];
+    uint8_t  encoded_len = 0;
+
+    do {
+        uint8_t digit = remaining % 128;
+
+        remaining /= 128;
+        encoded[encoded_len++] = digit | ((remaining > 0) ? 0x80 : 0);
+    } while (remaining > 0);
+
+    if (0 != broker_reserve(&client->out, &client->out_size,
+                            client->out_len + 1 + encoded_len + var_len + payload_len)) {
+        return -1;
+    }
+
+    client->out[client->out_len++] = header;
+    memcpy(client->out + client->out_len, encoded, encoded_len);
+    client->out_len += encoded_len;
+    if (var_len > 0) {
+        memcpy(client->out + client->out_len, var, var_len);
+        client->out_len += var_len;
+    }
+    if (payload_len > 0) {
+        memcpy(client->out + client->out_len, payload, payload_len);
+        client->out_len += payload_len;
+    }
+
+    return 0;
+}
+
+static void broker_flush(broker_client_t *client)
+{
+    ssize_t sent;
+
+    while (client->out_len > 0) {
+        sent = send(client->fd, client->out, client->out_len, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            if (sent < 0 && (EAGAIN == errno || EWOULDBLOCK == errno)) {
+                return;
+            }
+            if (sent < 0 && EINTR == errno) {
+                continue;
+            }
+            broker_close(client);
+            return;
+        }
+        memmove(client->out, client->out + sent, client->out_len - sent);
+        client->out_len -= sent;
+    }
+}
+
+static void broker_send_ack(broker_client_t *client, uint8_t type, uint16_t packet_id)
+{
+    uint8_t var[2];
+
+    var[0] = packet_id >> 8;
+    var[1] = packet_id & 0xff;
+    broker_send(client, (type << 4) | ((MQTT_PUBREL == type) ? 0x02 : 0), var, 2, NULL, 0);
+}
+
+static int broker_read_string(const uint8_t *buf, uint32_t len, uint32_t *pos, char *out, uint32_t out_size)
+{
+    uint16_t str_len;
+
+    if (*pos + 2 > len) {
+        return -1;
+    }
+    str_len = (buf[*pos] << 8) | buf[*pos + 1];
+    *pos += 2;
+    if (*pos + str_len > len || str_len >= out_size) {
+        return -1;
+    }
+
+    memcpy(out, buf + *pos, str_len);
+    out[str_len] = '\0';
+    *pos += str_len;
+    return 0;
+}
+
+/* MQTT topic filter match with '+' and '#' wildcards */
+static int broker_topic_match(const char *filter, const char *topic)
+{
+    while (*filter != '\0') {
+        if ('#' == *filter) {
+            return 1;
+        }
+        if ('+' == *filter) {
+            while (*topic != '\0' && *topic != '/') {
+                topic++;
+            }
+            filter++;
+            continue;
+        }
+        if (*filter != *topic) {
+            /* "a/#" also matches "a" */
+            return ('/' == filter[0] && '#' == filter[1] && '\0' == *topic);
+        }
+        filter++;
+        topic++;
+    }
+
+    return ('\0' == *topic);
+}
+
+static void broker_route(const char *topic, const uint8_t *payload, uint32_t payload_len, uint8_t qos)
+{
+    uint8_t  var[2 + BROKER_TOPIC_MAXLEN + 2];
+    uint16_t topic_len = strlen(topic);
+    int      i;
+    int      j;
+
+    var[0] = topic_len >> 8;
+    var[1] = topic_len & 0xff;
+    memcpy(var + 2, topic, topic_len);
+
+    for (i = 0; i < BROKER_MAX_CLIENTS; i++) {
+        broker_client_t *client = &g_clients[i];
+        uint8_t          granted = 0;
+        int              matched = 0;
+        uint32_t         var_len = 2 + topic_len;
+
+        if (client->fd < 0 || !client->connected) {
+            continue;
+        }
+        for (j = 0; j < client->sub_count; j++) {
+            if (broker_topic_match(client->subs[j].filter, topic)) {
+                matched = 1;
+                if (client->subs[j].qos > granted) {
+                    granted = client->subs[j].qos;
+                }
+            }
+        }
+        if (!matched) {
+            continue;
+        }
+
+        if (qos < granted) {
+            granted = qos;
+        }
+        if (granted > 0) {
+            uint16_t packet_id = ++client->next_packet_id;
+
+            if (0 == packet_id) {
+                packet_id = ++client->next_packet_id;
+            }
+            var[var_len++] = packet_id >> 8;
+            var[var_len++] = packet_id & 0xff;
+        }
+
+        broker_send(client, (MQTT_PUBLISH << 4) | (granted << 1), var, var_len, payload, payload_len);
+        g_publish_out++;
+    }
+}
+
+static void broker_subscribe(broker_client_t *client, const uint8_t *buf, uint32_t len, int subscribe)
+{
+    uint8_t  codes[BROKER_MAX_SUBS];
+    uint8_t  code_count = 0;
+    uint32_t pos = 2;
+    char     filter[BROKER_TOPIC_MAXLEN];
+    uint16_t packet_id;
+    int      i;
+
+    if (len < 2) {
+        return;
+    }
+    packet_id = (buf[0] << 8) | buf[1];
+
+    while (pos < len && code_count < BROKER_MAX_SUBS) {
+        uint8_t qos = 0;
+
+        if (0 != broker_read_string(buf, len, &pos, filter, sizeof(filter))) {
+            break;
+        }
+        if (subscribe) {
+            if (pos >= len) {
+                break;
+            }
+            qos = buf[pos++] & 0x03;
+        }
+
+        for (i = 0; i < client->sub_count; i++) {
+            if (0 == strcmp(client->subs[i].filter, filter)) {
+                break;
+            }
+        }
+
+        if (subscribe) {
+            qos = (qos > 1) ? 1 : qos;
+            if (i == client->sub_count && client->sub_count < BROKER_MAX_SUBS) {
+                client->sub_count++;
+            }
+            if (i < client->sub_count) {
+                strcpy(client->subs[i].filter, filter);
+                client->subs[i].qos = qos;
+                codes[code_count++] = qos;
+            } else {
+                codes[code_count++] = 0x80;
+            }
+            broker_log("fd %d subscribe %s qos %d", client->fd, filter, qos);
+        } else if (i < client->sub_count) {
+            client->subs[i] = client->subs[--client->sub_count];
+            broker_log("fd %d unsubscribe %s", client->fd, filter);
+        }
+    }
+
+    if (subscribe) {
+        uint8_t var[2];
+
+        var[0] = packet_id >> 8;
+        var[1] = packet_id & 0xff;
+        broker_send(client, MQTT_SUBACK << 4, var, 2, codes, code_count);
+    } else {
+        broker_send_ack(client, MQTT_UNSUBACK, packet_id);
+    }
+}
+
+static void broker_publish(broker_client_t *client, uint8_t header, const uint8_t *buf, uint32_t len)
+{
+    uint8_t  qos = (header >> 1) & 0x03;
+    uint32_t pos = 0;
+    char     topic[BROKER_TOPIC_MAXLEN];
+    uint16_t packet_id = 0;
+
+    if (0 != broker_read_string(buf, len, &pos, topic, sizeof(topic))) {
+        broker_close(client);
+        return;
+    }
+    if (qos > 0) {
+        if (pos + 2 > len) {
+            broker_close(client);
+            return;
+        }
+        packet_id = (buf[pos] << 8) | buf[pos + 1];
+        pos += 2;
+    }
+
+    g_publish_in++;
+    broker_log("fd %d publish %s qos %d len %u", client->fd, topic, qos, len - pos);
+
+    if (1 == qos) {
+        broker_send_ack(client, MQTT_PUBACK, packet_id);
+    } else if (2 == qos) {
+        broker_send_ack(client, MQTT_PUBREC, packet_id);
+    }
+
+    broker_route(topic, buf + pos, len - pos, (qos > 1) ? 1 : qos);
+}
+
+/* handles one complete packet, returns -1 if the client was dropped */
+static int broker_handle(broker_client_t *client, uint8_t header, const uint8_t *buf, uint32_t len)
+{
+    uint8_t type = header >> 4;
+
+    if (!client->connected && MQTT_CONNECT != type) {
+        broker_close(client);
+        return -1;
+    }
+
+    switch (type) {
+        case MQTT_CONNECT: {
+            uint8_t ack[2] = {0, 0};
+
+            client->connected = 1;
+            broker_log("fd %d connected", client->fd);
+            broker_send(client, MQTT_CONNACK << 4, ack, 2, NULL, 0);
+        }
+        break;
+        case MQTT_PUBLISH:
+            broker_publish(client, header, buf, len);
+            break;
+        case MQTT_PUBREL:
+            if (len >= 2) {
+                broker_send_ack(client, MQTT_PUBCOMP, (buf[0] << 8) | buf[1]);
+            }
+            break;
+        case MQTT_SUBSCRIBE:
+            broker_subscribe(client, buf, len, 1);
+            break;
+        case MQTT_UNSUBSCRIBE:
+            broker_subscribe(client, buf, len, 0);
+            break;
+        case MQTT_PINGREQ:
+            broker_send(client, MQTT_PINGRESP << 4, NULL, 0, NULL, 0);
+            break;
+        case MQTT_DISCONNECT:
+            broker_close(client);
+            return -1;
+        default:
+            /* PUBACK, PUBREC, PUBCOMP for what we delivered, nothing is kept to retry */
+            break;
+    }
+
+    return (client->fd < 0) ? -1 : 0;
+}
+
+static void broker_read(broker_client_t *client)
+{
+    uint32_t pos = 0;
+    ssize_t  got;
+
+    if (0 != broker_reserve(&client->in, &client->in_size, client->in_len + 4096)) {
+        broker_close(client);
+        return;
+    }
+
+    got = recv(client->fd, client->in + client->in_len, client->in_size - client->in_len, 0);
+    if (got <= 0) {
+        if (got < 0 && (EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno)) {
+            return;
+        }
+        broker_close(client);
+        return;
+    }
+    client->in_len += got;
+
+    /* dispatch every complete packet in the buffer */
+    while (pos < client->in_len) {
+        uint32_t remaining = 0;
+        uint32_t multiplier = 1;
+        uint32_t hdr_len = 1;
+        uint8_t  header = client->in[pos];
+
+        while (1) {
+            uint8_t digit;
+
+            if (pos + hdr_len >= client->in_len) {
+                goto partial;
+            }
+            digit = client->in[pos + hdr_len++];
+            remaining += (digit & 0x7f) * multiplier;
+            multiplier *= 128;
+            if (!(digit & 0x80)) {
+                break;
+            }
+            if (hdr_len > 4) {
+                broker_close(client);
+                return;
+            }
+        }
+
+        if (remaining > BROKER_PACKET_MAXLEN) {
+            broker_close(client);
+            return;
+        }
+        if (pos + hdr_len + remaining > client->in_len) {
+            break;
+        }
+
+        if (0 != broker_handle(client, header, client->in + pos + hdr_len, remaining)) {
+            return;
+        }
+        pos += hdr_len + remaining;
+    }
+
+partial:
+    memmove(client->in, client->in + pos, client->in_len - pos);
+    client->in_len -= pos;
+}
+
+int main(int argc, char *argv[])
+{
+    struct sockaddr_in addr;
+    struct pollfd      pfds[BROKER_MAX_CLIENTS + 1];
+    int                port = BROKER_DEFAULT_PORT;
+    int                listen_fd;
+    int                opt = 1;
+    int                i;
+
+    while ((opt = getopt(argc, argv, "p:v")) != -1) {
+        switch (opt) {
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'v':
+                g_verbose = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-p port] [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    signal(SIGINT, broker_stop);
+    signal(SIGTERM, broker_stop);
+    signal(SIGPIPE, SIG_IGN);
+
+    for (i = 0; i < BROKER_MAX_CLIENTS; i++) {
+        g_clients[i].fd = -1;
+    }
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    opt = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (0 != bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) || 0 != listen(listen_fd, 16)) {
+        perror("mqtt_broker: bind");
+        return 1;
+    }
+
+    printf("mqtt_broker listening on port %d\n", port);
+    fflush(stdout);
+
+    while (g_running) {
+        int count = 1;
+
+        pfds[0].fd = listen_fd;
+        pfds[0].events = POLLIN;
+        for (i = 0; i < BROKER_MAX_CLIENTS; i++) {
+            pfds[i + 1].fd = g_clients[i].fd;
+            pfds[i + 1].events = POLLIN | ((g_clients[i].out_len > 0) ? POLLOUT : 0);
+            pfds[i + 1].revents = 0;
+            if (g_clients[i].fd >= 0) {
+                count = i + 2;
+            }
+        }
+
+        if (poll(pfds, count, 1000) < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            break;
+        }
+
+        if (pfds[0].revents & POLLIN) {
+            int fd = accept(listen_fd, NULL, NULL);
+
+            if (fd >= 0) {
+                for (i = 0; i < BROKER_MAX_CLIENTS && g_clients[i].fd >= 0; i++) {
+                }
+                if (i == BROKER_MAX_CLIENTS) {
+                    close(fd);
+                } else {
+                    opt = 1;
+                    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+                    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                    g_clients[i].fd = fd;
+                    broker_log("client fd %d accepted", fd);
+                }
+            }
+        }
+
+        for (i = 0; i < count - 1; i++) {
+            if (g_clients[i].fd < 0 || g_clients[i].fd != pfds[i + 1].fd) {
+                continue;
+            }
+            if (pfds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) {
+                broker_read(&g_clients[i]);
+            }
+        }
+
+        /* flush whatever the routing above queued, for every client */
+        for (i = 0; i < BROKER_MAX_CLIENTS; i++) {
+            if (g_clients[i].fd >= 0 && g_clients[i].out_len > 0) {
+                broker_flush(&g_clients[i]);
+            }
+        }
+    }
+
+    printf("mqtt_broker: %llu publishes in, %llu delivered\n",
+           (unsigned long long)g_publish_in, (unsigned long long)g_publish_out);
+
+    for (i = 0; i < BROKER_MAX_CLIENTS; i++) {
+        if (g_clients[i].fd >= 0) {
+            broker_close(&g_clients[i]);
+        }
+    }
+    close(listen_fd);
+
+    return 0;
+}
@@ -19,11 +19,18 @@
 #define INFRA_LOG_MUTE_CRT
 #endif /* #if 0 */
 #define INFRA_TIMER
+#define INFRA_TRACE
+/* deferred binary logs for host/dlog_decode, on by default with the RTT sink of IOTX_TRACE_SYSVIEW */
+#ifdef IOTX_TRACE_SYSVIEW
+#define INFRA_DLOG
+#endif
 #define INFRA_JSON_PARSER
 #define INFRA_CJSON
 #define INFRA_MD5
 #define INFRA_SHA1
 #define INFRA_SHA256
+/* rolled SHA-256 rounds: about 4 KB less flash, slower hashing of OTA images and signatures */
+//#define INFRA_SHA256_SMALLER
 #define INFRA_REPORT
 #define INFRA_HTTPC
 #define INFRA_COMPAT
@@ -52,5 +59,22 @@
 #define WIFI_PROVISION_ENABLED
 #define AWSS_SUPPORT_DEV_AP
 #define DEV_BIND_ENABLED
+#define OTA_RELAY_ENABLED
+
+#ifdef IOTX_HOST_BUILD
+/* host simulation build (CMakeLists.txt): plain MQTT to the local broker stand-in, no WiFi side */
+#undef SUPPORT_TLS
+#undef DYNAMIC_REGISTER
+#undef DEV_RESET
+#undef AWSS_SUPPORT_APLIST
+#undef AWSS_FRAMEWORKS
+#undef WIFI_PROVISION_ENABLED
+#undef AWSS_SUPPORT_DEV_AP
+#undef DEV_BIND_ENABLED
+/* keep recorded traces for percentiles, there is no SystemView on the host */
+#define INFRA_TRACE_RING_SIZE (256)
+/* the host sink writes the records to the IOTX_DLOG_FILE file for dlog_decode */
+#define INFRA_DLOG
+#endif
 
 #endif
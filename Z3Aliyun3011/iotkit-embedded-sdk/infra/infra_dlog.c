@@ -0,0 +1,401 @@
+#include "infra_config.h"
+
+#ifdef INFRA_DLOG
+/*
+ * Copyright (C) 2015-2018 Alibaba Group Holding Limited
+ */
+#include <string.h>
+#include <stdarg.h>
+
+#include "infra_types.h"
+#include "infra_defs.h"
+#include "infra_dlog.h"
+#include "wrappers_defs.h"
+
+#define DLOG_RING_MASK                  (INFRA_DLOG_RING_WORDS - 1)
+#define DLOG_DRAIN_INTERVAL_MS          (20)
+
+#if (INFRA_DLOG_RING_WORDS & DLOG_RING_MASK) != 0
+    #error "INFRA_DLOG_RING_WORDS must be a power of two"
+#endif
+
+uint32_t HAL_Trace_Timestamp(void);
+uint32_t HAL_Trace_TimestampFreq(void);
+
+/* the strings of a record are addressed from here, its address is looked up in the ELF by the decoder */
+const char g_dlog_anchor[] = "dlog";
+
+static volatile uint32_t g_dlog_ring[INFRA_DLOG_RING_WORDS];
+static volatile uint32_t g_dlog_head;       /* words reserved by the producers, free running */
+static volatile uint32_t g_dlog_tail;       /* words written out by the drain, free running */
+static volatile uint32_t g_dlog_recorded;
+static volatile uint32_t g_dlog_dropped;
+static volatile uint32_t g_dlog_high_water;
+static volatile uint32_t g_dlog_draining;
+static uint32_t          g_dlog_dropped_sent;
+static int               g_dlog_synced;
+static void             *g_dlog_task;
+
+static uint32_t _dlog_offset(const char *str)
+{
+    if (str == NULL) {
+        return DLOG_OFFSET_NONE;
+    }
+    return (uint32_t)((uintptr_t)str - (uintptr_t)g_dlog_anchor);
+}
+
+static void _dlog_atomic_add(volatile uint32_t *counter, uint32_t value)
+{
+    uint32_t old;
+
+    do {
+        old = *counter;
+    } while (!HAL_Atomic_CompareExchange(counter, old, old + value));
+}
+
+static int _dlog_put(uint32_t *rec, int *pos, uint32_t word)
+{
+    if (*pos >= INFRA_DLOG_RECORD_WORDS_MAX) {
+        return -1;
+    }
+    rec[(*pos)++] = word;
+    return 0;
+}
+
+static int _dlog_put64(uint32_t *rec, int *pos, uint64_t value)
+{
+    if (_dlog_put(rec, pos, (uint32_t)value) < 0) {
+        return -1;
+    }
+    return _dlog_put(rec, pos, (uint32_t)(value >> 32));
+}
+
+static int _dlog_put_string(uint32_t *rec, int *pos, const char *str, int precision)
+{
+    uint32_t len = 0;
+    uint32_t words;
+
+    if (str == NULL) {
+        str = "(null)";
+    }
+    while (len < INFRA_DLOG_STR_MAX && (precision < 0 || len < (uint32_t)precision) && str[len] != '\0') {
+        len++;
+    }
+
+    words = (len + 3) / 4;
+    if (*pos + 1 + (int)words > INFRA_DLOG_RECORD_WORDS_MAX) {
+        return -1;
+    }
+    rec[(*pos)++] = len;
+    if (words > 0) {
+        rec[*pos + words - 1] = 0;
+        memcpy(&rec[*pos], str, len);
+    }
+    *pos += words;
+
+    return 0;
+}
+
+/* copy the arguments of fmt into the record, the same walk the decoder does on the format string */
+static int _dlog_put_args(uint32_t *rec, int *pos, const char *fmt, va_list ap)
+{
+    const char *p = fmt;
+    int         lmod;
+    int         precision;
+    uint64_t    value;
+    union {
+        double   d;
+        uint64_t u;
+    } dbl;
+
+    while (*p != '\0') {
+        if (*p++ != '%') {
+            continue;
+        }
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+
+        while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') {
+            p++;
+        }
+        if (*p == '*') {
+            if (_dlog_put(rec, pos, (uint32_t)va_arg(ap, int)) < 0) {
+                return -1;
+            }
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+        precision = -1;
+        if (*p == '.') {
+            p++;
+            precision = 0;
+            if (*p == '*') {
+                precision = va_arg(ap, int);
+                if (_dlog_put(rec, pos, (uint32_t)precision) < 0) {
+                    return -1;
+                }
+                p++;
+            }
+            while (*p >= '0' && *p <= '9') {
+                precision = precision * 10 + (*p++ - '0');
+            }
+        }
+
+        /* 0 int, 1 long, 2 long long, 3 size_t, 4 long double */
+        lmod = 0;
+        while (*p == 'h' || *p == 'l' || *p == 'z' || *p == 't' || *p == 'j' || *p == 'L') {
+            if (*p == 'l') {
+                lmod = (lmod == 1) ? 2 : 1;
+            } else if (*p == 'j') {
+                lmod = 2;
+            } else if (*p == 'z' || *p == 't') {
+                lmod = 3;
+            } else if (*p == 'L') {
+                lmod = 4;
+            }
+            p++;
+        }
+
+        switch (*p) {
+            case 'd':
+            case 'i':
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+            case 'c': {
+                if (lmod == 2) {
+                    value = (uint64_t)va_arg(ap, long long);
+                } else if (lmod == 1) {
+                    value = (uint64_t)va_arg(ap, long);
+                } else if (lmod == 3) {
+                    value = (uint64_t)va_arg(ap, size_t);
+                } else {
+                    value = (uint64_t)va_arg(ap, int);
+                }
+                if ((lmod == 2 || (lmod == 1 && sizeof(long) == 8) || (lmod == 3 && sizeof(size_t) == 8))
+                    ? _dlog_put64(rec, pos, value) : _dlog_put(rec, pos, (uint32_t)value)) {
+                    return -1;
+                }
+                break;
+            }
+            case 'e':
+            case 'E':
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A': {
+                dbl.d = (lmod == 4) ? (double)va_arg(ap, long double) : va_arg(ap, double);
+                if (_dlog_put64(rec, pos, dbl.u) < 0) {
+                    return -1;
+                }
+                break;
+            }
+            case 's': {
+                if (_dlog_put_string(rec, pos, va_arg(ap, const char *), precision) < 0) {
+                    return -1;
+                }
+                break;
+            }
+            case 'p': {
+                value = (uint64_t)(uintptr_t)va_arg(ap, void *);
+                if ((sizeof(void *) == 8) ? _dlog_put64(rec, pos, value) : _dlog_put(rec, pos, (uint32_t)value)) {
+                    return -1;
+                }
+                break;
+            }
+            case 'n': {
+                (void)va_arg(ap, void *);
+                break;
+            }
+            default:
+                /* unknown conversion, the types of the arguments after it are unknown too */
+                return -1;
+        }
+        if (*p != '\0') {
+            p++;
+        }
+    }
+
+    return 0;
+}
+
+static void _dlog_commit(const uint32_t *rec, uint32_t words)
+{
+    uint32_t head;
+    uint32_t tail;
+    uint32_t used;
+    uint32_t i;
+
+    do {
+        head = g_dlog_head;
+        tail = g_dlog_tail;
+        used = head - tail + words;
+        if (used > INFRA_DLOG_RING_WORDS) {
+            _dlog_atomic_add(&g_dlog_dropped, 1);
+            return;
+        }
+    } while (!HAL_Atomic_CompareExchange(&g_dlog_head, head, head + words));
+
+    for (i = 1; i < words; i++) {
+        g_dlog_ring[(head + i) & DLOG_RING_MASK] = rec[i];
+    }
+    /* the drain reads up to the first slot still 0, the header goes last */
+    HAL_Atomic_CompareExchange(&g_dlog_ring[head & DLOG_RING_MASK], 0, rec[0]);
+
+    _dlog_atomic_add(&g_dlog_recorded, 1);
+    if (used > g_dlog_high_water) {
+        g_dlog_high_water = used;
+    }
+}
+
+void iotx_dlog_vrecord(int level, const char *func, int line, const char *fmt, va_list ap)
+{
+    uint32_t rec[INFRA_DLOG_RECORD_WORDS_MAX];
+    uint32_t flags = 0;
+    int      pos = DLOG_RECORD_HDR_WORDS;
+    va_list  args;
+
+    rec[1] = HAL_Trace_Timestamp();
+    rec[2] = _dlog_offset(fmt);
+    rec[3] = _dlog_offset(func);
+    rec[4] = (uint32_t)line;
+    rec[5] = _dlog_offset(HAL_ThreadName());
+
+    va_copy(args, ap);
+    if (fmt != NULL && _dlog_put_args(rec, &pos, fmt, args) < 0) {
+        flags |= DLOG_HDR_TRUNCATED;
+    }
+    va_end(args);
+
+    rec[0] = DLOG_HDR_MAGIC | flags | ((uint32_t)(level & 0x7F) << 16) | (uint32_t)pos;
+    _dlog_commit(rec, (uint32_t)pos);
+}
+
+void iotx_dlog(int level, const char *func, int line, const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    iotx_dlog_vrecord(level, func, line, fmt, ap);
+    va_end(ap);
+}
+
+static int _dlog_write_meta(int level, uint32_t value)
+{
+    uint32_t rec[DLOG_RECORD_HDR_WORDS + 1];
+
+    rec[0] = DLOG_HDR_MAGIC | ((uint32_t)level << 16) | (DLOG_RECORD_HDR_WORDS + 1);
+    rec[1] = HAL_Trace_Timestamp();
+    rec[2] = DLOG_OFFSET_NONE;
+    rec[3] = DLOG_OFFSET_NONE;
+    rec[4] = 0;
+    rec[5] = DLOG_OFFSET_NONE;
+    rec[6] = value;
+
+    return (HAL_DLog_Write(rec, sizeof(rec)) == (int)sizeof(rec)) ? 0 : -1;
+}
+
+int iotx_dlog_drain(void)
+{
+    uint32_t out[INFRA_DLOG_RECORD_WORDS_MAX];
+    uint32_t tail;
+    uint32_t hdr;
+    uint32_t words;
+    uint32_t dropped;
+    uint32_t i;
+    int      count = 0;
+
+    /* one drain at a time, the CLI may flush while the task runs */
+    if (!HAL_Atomic_CompareExchange(&g_dlog_draining, 0, 1)) {
+        return 0;
+    }
+
+    if (!g_dlog_synced) {
+        if (_dlog_write_meta(DLOG_LEVEL_SYNC, HAL_Trace_TimestampFreq()) < 0) {
+            goto out;
+        }
+        g_dlog_synced = 1;
+    }
+
+    dropped = g_dlog_dropped;
+    if (dropped != g_dlog_dropped_sent) {
+        if (_dlog_write_meta(DLOG_LEVEL_DROPPED, dropped - g_dlog_dropped_sent) < 0) {
+            goto out;
+        }
+        g_dlog_dropped_sent = dropped;
+    }
+
+    while (1) {
+        tail = g_dlog_tail;
+        hdr = g_dlog_ring[tail & DLOG_RING_MASK];
+        if ((hdr & DLOG_HDR_MAGIC_MASK) != DLOG_HDR_MAGIC) {
+            break;
+        }
+
+        words = DLOG_HDR_WORDS(hdr);
+        for (i = 0; i < words; i++) {
+            out[i] = g_dlog_ring[(tail + i) & DLOG_RING_MASK];
+        }
+        if (HAL_DLog_Write(out, words * sizeof(uint32_t)) != (int)(words * sizeof(uint32_t))) {
+            /* no room in the sink, try again on the next drain */
+            break;
+        }
+
+        for (i = 0; i < words; i++) {
+            g_dlog_ring[(tail + i) & DLOG_RING_MASK] = 0;
+        }
+        HAL_Atomic_CompareExchange(&g_dlog_tail, tail, tail + words);
+        count++;
+    }
+
+out:
+    g_dlog_draining = 0;
+    return count;
+}
+
+static void *_dlog_drain_task(void *arg)
+{
+    (void)arg;
+
+    while (1) {
+        iotx_dlog_drain();
+        HAL_SleepMs(DLOG_DRAIN_INTERVAL_MS);
+    }
+
+    return NULL;
+}
+
+int iotx_dlog_init(void)
+{
+    hal_os_thread_param_t param;
+    int                   stack_used = 0;
+
+    if (g_dlog_task != NULL) {
+        return 0;
+    }
+
+    memset(&param, 0, sizeof(param));
+    param.priority = 8;     /* below the timer and wifi tasks */
+    param.stack_size = 1024;
+    param.detach_state = 1;
+    param.name = "dlog";
+
+    return HAL_ThreadCreate(&g_dlog_task, _dlog_drain_task, NULL, &param, &stack_used);
+}
+
+void iotx_dlog_get_stats(iotx_dlog_stats_t *stats)
+{
+    stats->recorded = g_dlog_recorded;
+    stats->dropped = g_dlog_dropped;
+    stats->ring_words = INFRA_DLOG_RING_WORDS;
+    stats->used_words = g_dlog_head - g_dlog_tail;
+    stats->high_water_words = g_dlog_high_water;
+}
+#endif
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2015-2018 Alibaba Group Holding Limited
+ */
+
+#ifndef _INFRA_DLOG_H_
+#define _INFRA_DLOG_H_
+
+#include <stdarg.h>
+#include "infra_types.h"
+
+/*
+ * Deferred binary log. A log call does not format anything: it copies the
+ * address of the format string, the arguments, a timestamp and the task
+ * name into a ring in RAM and returns. A low priority task drains the ring
+ * through HAL_DLog_Write() (SEGGER RTT on target, a file on the host) and
+ * host/dlog_decode formats the stream afterwards, reading the format
+ * strings out of the ELF of the firmware.
+ *
+ * Strings are addressed as offsets from g_dlog_anchor, so the stream
+ * decodes the same against a position independent host binary. %s
+ * arguments are copied, truncated to INFRA_DLOG_STR_MAX bytes, since they
+ * may point to the stack. %n is not supported.
+ *
+ * Any task or interrupt may log: space in the ring is reserved with a
+ * compare-and-swap and a record becomes visible to the drain when its
+ * header word is written. A record that does not fit is dropped and
+ * counted, the producers never wait for the drain.
+ */
+
+#ifndef INFRA_DLOG_RING_WORDS
+    #define INFRA_DLOG_RING_WORDS       (1024)  /* power of two */
+#endif
+#ifndef INFRA_DLOG_STR_MAX
+    #define INFRA_DLOG_STR_MAX          (32)
+#endif
+#define INFRA_DLOG_RECORD_WORDS_MAX     (64)
+
+/* header word of a record */
+#define DLOG_HDR_MAGIC                  (0xD1000000u)
+#define DLOG_HDR_MAGIC_MASK             (0xFF000000u)
+#define DLOG_HDR_TRUNCATED              (0x00800000u)   /* arguments cut to fit INFRA_DLOG_RECORD_WORDS_MAX */
+#define DLOG_HDR_LEVEL(hdr)             (((hdr) >> 16) & 0x7F)
+#define DLOG_HDR_WORDS(hdr)             ((hdr) & 0xFFFF)
+
+/* levels above the LOG_xxx_LEVEL ones, for records the drain writes itself */
+#define DLOG_LEVEL_SYNC                 (0x7F)  /* timestamp frequency, sent first */
+#define DLOG_LEVEL_DROPPED              (0x7E)  /* records dropped since the previous one */
+
+/* offset of a string from g_dlog_anchor, for a NULL pointer */
+#define DLOG_OFFSET_NONE                (0x80000000u)
+
+/*
+ * Record layout, in 32-bit words:
+ *   0  header: magic | truncated | level << 16 | words
+ *   1  HAL_Trace_Timestamp()
+ *   2  format offset
+ *   3  function offset
+ *   4  line
+ *   5  task name offset
+ *   6+ arguments in format order: one word per int, long and pointer on
+ *      32-bit targets, two (low first) for long long, double and the longs
+ *      and pointers of a 64-bit host; a string is its length then its bytes
+ *      padded to a word. A sync record carries the timestamp frequency in
+ *      place of the arguments, a dropped record the number of records.
+ */
+#define DLOG_RECORD_HDR_WORDS           (6)
+
+typedef struct {
+    uint32_t recorded;
+    uint32_t dropped;
+    uint32_t ring_words;
+    uint32_t used_words;
+    uint32_t high_water_words;
+} iotx_dlog_stats_t;
+
+extern const char g_dlog_anchor[];
+
+/* start the drain task, records logged before are kept in the ring */
+int iotx_dlog_init(void);
+
+void iotx_dlog(int level, const char *func, int line, const char *fmt, ...);
+void iotx_dlog_vrecord(int level, const char *func, int line, const char *fmt, va_list ap);
+
+/* write out what the ring holds, returns the number of records written */
+int iotx_dlog_drain(void);
+
+void iotx_dlog_get_stats(iotx_dlog_stats_t *stats);
+
+#endif  /* _INFRA_DLOG_H_ */
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2015-2018 Alibaba Group Holding Limited
+ */
+
+
+
+
+#ifndef _INFRA_HASH_WORD_H_
+#define _INFRA_HASH_WORD_H_
+
+#include <string.h>
+#include "infra_types.h"
+
+/*
+ * Message word loads of the MD5, SHA-1 and SHA-256 kernels.
+ *
+ * On little endian cores that load unaligned words, a message word is
+ * one load, plus one byte reverse for the big endian digests: LDR + REV
+ * on ARMv7-M, where a word put together a byte at a time takes four
+ * loads and three shifted ORs. Elsewhere INFRA_HASH_LOAD_LE32 is left
+ * undefined and the kernels keep their byte-wise GET_UINT32 macros.
+ */
+#if defined(__ICCARM__) && defined(__ARM_ARCH) && (__ARM_ARCH >= 7) && !defined(__ARM_BIG_ENDIAN)
+    #include <intrinsics.h>
+
+    #define INFRA_HASH_LOAD_LE32(p)     (*(__packed const uint32_t *)(p))
+    #define INFRA_HASH_LOAD_BE32(p)     __REV(INFRA_HASH_LOAD_LE32(p))
+#elif defined(__GNUC__) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) && \
+      (defined(__x86_64__) || defined(__i386__) || defined(__ARM_FEATURE_UNALIGNED))
+    static inline uint32_t infra_hash_load_le32(const unsigned char *p)
+    {
+        uint32_t word;
+
+        memcpy(&word, p, sizeof(word));
+        return word;
+    }
+
+    #define INFRA_HASH_LOAD_LE32(p)     infra_hash_load_le32(p)
+    #define INFRA_HASH_LOAD_BE32(p)     __builtin_bswap32(infra_hash_load_le32(p))
+#endif
+
+#endif
@@ -28,15 +28,49 @@
 
 int HAL_Snprintf(char *str, const int len, const char *fmt, ...);
 void HAL_SleepMs(uint32_t ms);
+uint64_t HAL_UptimeMs(void);
+void *HAL_MutexCreate(void);
+void HAL_MutexLock(void *mutex);
+void HAL_MutexUnlock(void *mutex);
+uint32_t HAL_Network_Session(uintptr_t handle);
 
 #define HTTPCLIENT_MIN(x,y) (((x)<(y))?(x):(y))
 #define HTTPCLIENT_MAX(x,y) (((x)>(y))?(x):(y))
 
 
 #define HTTPCLIENT_READ_BUF_SIZE     (1024)          /* read payload */
-#define HTTPCLIENT_RAED_HEAD_SIZE (32)            /* read header */
+#define HTTPCLIENT_RAED_HEAD_SIZE (16)            /* read header, no response is shorter */
 #define HTTPCLIENT_SEND_BUF_SIZE  (1024)          /* send */
 
+/*
+ * Idle keep-alive connections. A read waits until it gets all it asked for,
+ * so on a connection left open nothing past the end of a response is asked
+ * for: the header is read up to its blank line and the body to its length.
+ */
+#ifndef HTTPCLIENT_POOL_SIZE
+    #define HTTPCLIENT_POOL_SIZE      (2)
+#endif
+#define HTTPCLIENT_POOL_IDLE_MS   (30000)         /* servers drop idle connections, older ones are not reused */
+/*
+ * The WGM110 holds a single TLS connection at a time, an idle HTTPS one kept
+ * here would keep MQTT from connecting. Only plain connections are kept.
+ */
+#ifndef HTTPCLIENT_POOL_TLS
+    #define HTTPCLIENT_POOL_TLS       (0)
+#endif
+
+/* chunked transfer decoding */
+enum {
+    HTTPCLIENT_CHUNKED_SIZE,        /* chunk size line */
+    HTTPCLIENT_CHUNKED_EXT,         /* rest of the size line */
+    HTTPCLIENT_CHUNKED_DATA,        /* retrieve_len bytes of data */
+    HTTPCLIENT_CHUNKED_DATA_END,    /* CRLF after the data */
+    HTTPCLIENT_CHUNKED_TRAILER,     /* start of a trailer line, or of the final blank line */
+    HTTPCLIENT_CHUNKED_TRAILER_LINE,
+    HTTPCLIENT_CHUNKED_DONE,
+    HTTPCLIENT_CHUNKED_ERROR
+};
+
 #define HTTPCLIENT_MAX_URL_LEN   (256)
 
 #define HTTP_RETRIEVE_MORE_DATA   (1)            /**< More data needs to be retrieved. */
@@ -54,6 +88,137 @@ static int _http_get_response_body(httpclient_t *client, char *data, int len, ui
 static int _http_parse_response_header(httpclient_t *client, char *data, int len, uint32_t timeout,
                                        httpclient_data_t *client_data);
 
+typedef struct {
+    utils_network_t net;
+    char            host[HTTPCLIENT_HOST_LEN];
+    uint64_t        idle_since;
+    uint32_t        session;        /* HAL_Network_Session() of the handle when it was kept */
+} httpclient_pool_t;
+
+#if HTTPCLIENT_POOL_SIZE > 0
+static httpclient_pool_t g_httpc_pool[HTTPCLIENT_POOL_SIZE];
+static void *g_httpc_pool_mutex = NULL;
+
+static void _http_pool_lock(void)
+{
+    if (NULL == g_httpc_pool_mutex) {
+        g_httpc_pool_mutex = HAL_MutexCreate();
+    }
+    HAL_MutexLock(g_httpc_pool_mutex);
+}
+
+/*
+ * with the pool locked: let go of connections idle for too long, and forget
+ * those the server closed, their handle may already be another connection's
+ */
+static void _http_pool_expire(uint64_t now)
+{
+    int i;
+
+    for (i = 0; i < HTTPCLIENT_POOL_SIZE; i++) {
+        httpclient_pool_t *entry = &g_httpc_pool[i];
+
+        if (0 == entry->net.handle) {
+            continue;
+        }
+        if (HAL_Network_Session(entry->net.handle) != entry->session) {
+            httpc_debug("connection to %s closed while idle", entry->host);
+        } else if (now - entry->idle_since > HTTPCLIENT_POOL_IDLE_MS) {
+            entry->net.disconnect(&entry->net);
+        } else {
+            continue;
+        }
+        entry->net.handle = 0;
+    }
+}
+
+/* drop the expired connections without waiting for the next request to look for one */
+static void _http_pool_tidy(void)
+{
+    _http_pool_lock();
+    _http_pool_expire(HAL_UptimeMs());
+    HAL_MutexUnlock(g_httpc_pool_mutex);
+}
+
+/* take an idle connection to host:port, over TLS when ca_crt is set; 0 when there is none */
+static int _http_pool_take(httpclient_t *client, int port, const char *ca_crt)
+{
+    int      i;
+    int      found = 0;
+    uint64_t now = HAL_UptimeMs();
+
+    if ('\0' == client->host[0]) {
+        return 0;
+    }
+
+    _http_pool_lock();
+    _http_pool_expire(now);
+    for (i = 0; i < HTTPCLIENT_POOL_SIZE; i++) {
+        httpclient_pool_t *entry = &g_httpc_pool[i];
+
+        if (0 == entry->net.handle) {
+            continue;
+        }
+        if (!found && entry->net.port == port && entry->net.ca_crt == ca_crt
+            && 0 == strcmp(entry->host, client->host)) {
+            memcpy(&client->net, &entry->net, sizeof(utils_network_t));
+            client->net.pHostAddress = client->host;
+            entry->net.handle = 0;
+            found = 1;
+        }
+    }
+    HAL_MutexUnlock(g_httpc_pool_mutex);
+
+    if (found) {
+        httpc_debug("reuse connection to %s:%d", client->host, port);
+    }
+    return found;
+}
+
+/*
+ * keep the connection of the client for another request, the one idle for longest makes room;
+ * 0 when it is not kept
+ */
+static int _http_pool_put(httpclient_t *client)
+{
+    int      i;
+    int      slot = -1;
+    uint64_t now = HAL_UptimeMs();
+
+    _http_pool_lock();
+    _http_pool_expire(now);
+    if (!HTTPCLIENT_POOL_TLS && NULL != client->net.ca_crt) {
+        HAL_MutexUnlock(g_httpc_pool_mutex);
+        return 0;
+    }
+    for (i = 0; i < HTTPCLIENT_POOL_SIZE; i++) {
+        if (0 == g_httpc_pool[i].net.handle) {
+            slot = i;
+            break;
+        }
+        /* else the one idle for longest makes room */
+        if (slot < 0 || g_httpc_pool[i].idle_since < g_httpc_pool[slot].idle_since) {
+            slot = i;
+        }
+    }
+    if (0 != g_httpc_pool[slot].net.handle) {
+        g_httpc_pool[slot].net.disconnect(&g_httpc_pool[slot].net);
+    }
+    memcpy(&g_httpc_pool[slot].net, &client->net, sizeof(utils_network_t));
+    memcpy(g_httpc_pool[slot].host, client->host, sizeof(client->host));
+    g_httpc_pool[slot].net.pHostAddress = g_httpc_pool[slot].host;
+    g_httpc_pool[slot].idle_since = now;
+    g_httpc_pool[slot].session = HAL_Network_Session(client->net.handle);
+    HAL_MutexUnlock(g_httpc_pool_mutex);
+
+    return 1;
+}
+#else
+#define _http_pool_take(client, port, ca_crt)   (0)
+#define _http_pool_put(client)                  (0)
+#define _http_pool_tidy()
+#endif
+
 static int _utils_parse_url(const char *url, char *host,
                             char *path)
 {
@@ -266,16 +431,160 @@ static int _utils_fill_rx_buf(int *recv_count, int len_to_write_to_respons_buf,
         count += len_to_write_to_respons_buf;
         client_data->response_buf[count] = '\0';
         client_data->retrieve_len -= len_to_write_to_respons_buf;
+        client_data->response_received_len += len_to_write_to_respons_buf;
         *recv_count = count;
         return SUCCESS_RETURN;
     } else {
         memcpy(client_data->response_buf + count, data, client_data->response_buf_len - 1 - count);
         client_data->response_buf[client_data->response_buf_len - 1] = '\0';
         client_data->retrieve_len -= (client_data->response_buf_len - 1 - count);
+        client_data->response_received_len += (client_data->response_buf_len - 1 - count);
         return HTTP_RETRIEVE_MORE_DATA;
     }
 }
 
+/*
+ * Strip the chunked framing off len bytes of the body in place, returns the
+ * count of data bytes left at the start of buf, -1 on a malformed body.
+ * retrieve_len holds what is left of the current chunk.
+ */
+static int _http_chunked_decode(httpclient_data_t *client_data, char *buf, int len)
+{
+    int in = 0;
+    int out = 0;
+
+    while (in < len) {
+        char c = buf[in];
+
+        switch (client_data->chunk_state) {
+            case HTTPCLIENT_CHUNKED_SIZE: {
+                int digit = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 :
+                            (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+
+                if (digit >= 0) {
+                    if (client_data->retrieve_len > 0x7FFFFFF) {
+                        client_data->chunk_state = HTTPCLIENT_CHUNKED_ERROR;
+                        return -1;
+                    }
+                    client_data->retrieve_len = client_data->retrieve_len * 16 + digit;
+                    in++;
+                    break;
+                }
+                client_data->chunk_state = HTTPCLIENT_CHUNKED_EXT;
+            }
+            /* fall through */
+            case HTTPCLIENT_CHUNKED_EXT:
+                in++;
+                if ('\n' == c) {
+                    client_data->chunk_state = (client_data->retrieve_len > 0) ? HTTPCLIENT_CHUNKED_DATA :
+                                               HTTPCLIENT_CHUNKED_TRAILER;
+                }
+                break;
+            case HTTPCLIENT_CHUNKED_DATA: {
+                int n = HTTPCLIENT_MIN(len - in, client_data->retrieve_len);
+
+                memmove(buf + out, buf + in, n);
+                in += n;
+                out += n;
+                client_data->retrieve_len -= n;
+                if (0 == client_data->retrieve_len) {
+                    client_data->chunk_state = HTTPCLIENT_CHUNKED_DATA_END;
+                }
+                break;
+            }
+            case HTTPCLIENT_CHUNKED_DATA_END:
+                in++;
+                if ('\n' == c) {
+                    client_data->chunk_state = HTTPCLIENT_CHUNKED_SIZE;
+                } else if ('\r' != c) {
+                    client_data->chunk_state = HTTPCLIENT_CHUNKED_ERROR;
+                    return -1;
+                }
+                break;
+            case HTTPCLIENT_CHUNKED_TRAILER:
+            case HTTPCLIENT_CHUNKED_TRAILER_LINE:
+                in++;
+                if ('\n' == c) {
+                    client_data->chunk_state = (HTTPCLIENT_CHUNKED_TRAILER == client_data->chunk_state) ?
+                                               HTTPCLIENT_CHUNKED_DONE : HTTPCLIENT_CHUNKED_TRAILER;
+                } else if ('\r' != c) {
+                    client_data->chunk_state = HTTPCLIENT_CHUNKED_TRAILER_LINE;
+                }
+                break;
+            default:
+                /* nothing may follow the body */
+                client_data->chunk_state = HTTPCLIENT_CHUNKED_ERROR;
+                return -1;
+        }
+    }
+
+    return out;
+}
+
+static int _http_get_chunked_body(httpclient_t *client, char *data, int len, uint32_t timeout_ms,
+                                  httpclient_data_t *client_data)
+{
+    int written = 0;
+    unsigned int dead_loop_count = 0;
+    unsigned int extend_count = 0;
+    iotx_time_t timer;
+
+    iotx_time_init(&timer);
+    utils_time_countdown_ms(&timer, timeout_ms);
+
+    client_data->is_more = IOT_TRUE;
+
+    /* body bytes read along with the header */
+    len = _http_chunked_decode(client_data, data, len);
+    if (len < 0 || len > client_data->response_buf_len - 1) {
+        httpc_err("bad chunked body");
+        return ERROR_HTTP_PRTCL;
+    }
+    memcpy(client_data->response_buf, data, len);
+    written = len;
+
+    while (HTTPCLIENT_CHUNKED_DONE != client_data->chunk_state) {
+        int ret;
+        int received = 0;
+        int space = client_data->response_buf_len - 1 - written;
+        /* the framing is read a byte at a time, so nothing past the body is asked for */
+        int max_len_to_receive = (HTTPCLIENT_CHUNKED_DATA == client_data->chunk_state) ?
+                                 client_data->retrieve_len + 2 : 1;
+
+        if (space <= 0) {
+            client_data->response_buf[written] = '\0';
+            client_data->response_received_len += written;
+            return HTTP_RETRIEVE_MORE_DATA;
+        }
+        max_len_to_receive = HTTPCLIENT_MIN(max_len_to_receive, space);
+        max_len_to_receive = HTTPCLIENT_MIN(max_len_to_receive, HTTPCLIENT_CHUNK_SIZE - 1);
+
+        ret = _http_recv(client, client_data->response_buf + written, max_len_to_receive, &received,
+                         iotx_time_left(&timer));
+        if (ret == ERROR_HTTP_CONN) {
+            return ret;
+        }
+        len = _http_chunked_decode(client_data, client_data->response_buf + written, received);
+        if (len < 0) {
+            httpc_err("bad chunked body");
+            return ERROR_HTTP_PRTCL;
+        }
+        written += len;
+
+        ret = _utils_check_deadloop(received, &timer, ret, &dead_loop_count, &extend_count);
+        if (ERROR_HTTP_CONN == ret) {
+            return ret;
+        }
+    }
+
+    client_data->response_buf[written] = '\0';
+    client_data->response_received_len += written;
+    client_data->is_more = IOT_FALSE;
+    client->is_idle = IOT_TRUE;
+
+    return SUCCESS_RETURN;
+}
+
 static int _http_get_response_body(httpclient_t *client, char *data, int data_len_actually_received,
                                    uint32_t timeout_ms, httpclient_data_t *client_data)
 {
@@ -289,6 +598,10 @@ static int _http_get_response_body(httpclient_t *client, char *data, int data_le
     /* Receive data */
     /* httpc_debug("Current data: %s", data); */
 
+    if (client_data->is_chunked) {
+        return _http_get_chunked_body(client, data, data_len_actually_received, timeout_ms, client_data);
+    }
+
     client_data->is_more = IOT_TRUE;
 
     /* the header is not received finished */
@@ -332,20 +645,81 @@ static int _http_get_response_body(httpclient_t *client, char *data, int data_le
             }
         } while (client_data->retrieve_len);
         client_data->is_more = IOT_FALSE;
+        client->is_idle = IOT_TRUE;
         break;
     }
 
     return SUCCESS_RETURN;
 }
 
+/* value of a response header, field names are case-insensitive; NULL when it is absent */
+static const char *_http_find_header(const char *headers, const char *name)
+{
+    int         name_len = strlen(name);
+    const char *line = headers;
+
+    while (NULL != line && '\0' != *line) {
+        int i;
+
+        for (i = 0; i < name_len; i++) {
+            char c = line[i];
+
+            if (c >= 'A' && c <= 'Z') {
+                c += 'a' - 'A';
+            }
+            if (c != name[i]) {
+                break;
+            }
+        }
+        if (i == name_len && ':' == line[i]) {
+            line += name_len + 1;
+            while (' ' == *line || '\t' == *line) {
+                line++;
+            }
+            return line;
+        }
+
+        line = strstr(line, "\r\n");
+        if (NULL != line) {
+            line += 2;
+        }
+    }
+
+    return NULL;
+}
+
+static int _http_value_is(const char *value, const char *token)
+{
+    int len = strlen(token);
+    int i;
+
+    if (NULL == value) {
+        return 0;
+    }
+    for (i = 0; i < len; i++) {
+        char c = value[i];
+
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        }
+        if (c != token[i]) {
+            return 0;
+        }
+    }
+
+    return ('\r' == value[len] || ' ' == value[len] || ';' == value[len]);
+}
+
 static int _http_parse_response_header(httpclient_t *client, char *data, int len, uint32_t timeout_ms,
                                        httpclient_data_t *client_data)
 {
-    int crlf_pos;
     iotx_time_t timer;
-    char *tmp_ptr, *ptr_body_end;
+    char *ptr_body_end;
+    const char *tmp_ptr;
     int new_trf_len, ret;
     char *crlf_ptr;
+    int http11;
+    char saved;
 
     iotx_time_init(&timer);
     utils_time_countdown_ms(&timer, timeout_ms);
@@ -360,25 +734,25 @@ static int _http_parse_response_header(httpclient_t *client, char *data, int len
        <blank line> (CRLF)
 
       [<response-body>] */
-    crlf_ptr = strstr(data, "\r\n");
-    if (crlf_ptr == NULL) {
-        httpc_err("\r\n not found");
-        return ERROR_HTTP_UNRESOLVED_DNS;
-    }
-
-    crlf_pos = crlf_ptr - data;
-    data[crlf_pos] = '\0';
-    client->response_code = atoi(data + 9);
-    httpc_debug("Reading headers: %s", data);
-    memmove(data, &data[crlf_pos + 2], len - (crlf_pos + 2) + 1); /* Be sure to move NULL-terminating char as well */
-    len -= (crlf_pos + 2);       /* remove status_line length */
-    client_data->is_chunked = IOT_FALSE;
 
     /*If not ending of response body*/
     /* try to read more header again until find response head ending "\r\n\r\n" */
     while (NULL == (ptr_body_end = strstr(data, "\r\n\r\n"))) {
+        /* the header has at least as many bytes left as "\r\n\r\n" still misses */
+        int max_len_to_receive = 4;
+
+        if (len >= 1 && '\r' == data[len - 1]) {
+            max_len_to_receive = (len >= 3 && 0 == strncmp(data + len - 3, "\r\n\r", 3)) ? 1 : 3;
+        } else if (len >= 2 && 0 == strncmp(data + len - 2, "\r\n", 2)) {
+            max_len_to_receive = 2;
+        }
+        if (len + max_len_to_receive > HTTPCLIENT_READ_BUF_SIZE - 1) {
+            httpc_err("header too long");
+            return ERROR_HTTP;
+        }
+
         /* try to read more header */
-        ret = _http_recv(client, data + len, HTTPCLIENT_RAED_HEAD_SIZE, &new_trf_len, iotx_time_left(&timer));
+        ret = _http_recv(client, data + len, max_len_to_receive, &new_trf_len, iotx_time_left(&timer));
         if (ret == ERROR_HTTP_CONN) {
             return ret;
         }
@@ -386,14 +760,41 @@ static int _http_parse_response_header(httpclient_t *client, char *data, int len
         data[len] = '\0';
     }
 
+    crlf_ptr = strstr(data, "\r\n");
+    if (crlf_ptr == NULL) {
+        httpc_err("\r\n not found");
+        return ERROR_HTTP_UNRESOLVED_DNS;
+    }
+
+    /* look at the header only, not at the body bytes read with it */
+    saved = ptr_body_end[2];
+    ptr_body_end[2] = '\0';
+    crlf_ptr[0] = '\0';
+
+    http11 = (0 == strncmp(data, "HTTP/1.1", 8));
+    client->response_code = atoi(data + 9);
+    httpc_debug("Reading headers: %s", data);
+    client_data->is_chunked = IOT_FALSE;
+
+    /* HTTP/1.1 connections stay open unless the server says otherwise */
+    client->keep_alive = http11 && !_http_value_is(_http_find_header(crlf_ptr + 2, "connection"), "close");
+
     /* parse response_content_len */
-    if (NULL != (tmp_ptr = strstr(data, "Content-Length"))) {
-        client_data->response_content_len = atoi(tmp_ptr + strlen("Content-Length: "));
+    client_data->chunk_state = HTTPCLIENT_CHUNKED_SIZE;
+    if (client->response_code == 204 || client->response_code == 304) {
+        client_data->response_content_len = 0;
+        client_data->retrieve_len = 0;
+    } else if (_http_value_is(_http_find_header(crlf_ptr + 2, "transfer-encoding"), "chunked")) {
+        client_data->is_chunked = IOT_TRUE;
+        client_data->retrieve_len = 0;
+    } else if (NULL != (tmp_ptr = _http_find_header(crlf_ptr + 2, "content-length"))) {
+        client_data->response_content_len = atoi(tmp_ptr);
         client_data->retrieve_len = client_data->response_content_len;
     } else {
         httpc_err("Could not parse header");
         return ERROR_HTTP;
     }
+    ptr_body_end[2] = saved;
 
     /* remove header length */
     /* len is Had read body's length */
@@ -401,7 +802,6 @@ static int _http_parse_response_header(httpclient_t *client, char *data, int len
     /* the remain length is client_data->response_content_len - len */
     len = len - (ptr_body_end + 4 - data);
     memmove(data, ptr_body_end + 4, len + 1);
-    client_data->response_received_len += len;
     return _http_get_response_body(client, data, len, iotx_time_left(&timer), client_data);
 }
 
@@ -496,19 +896,32 @@ int httpclient_recv_response(httpclient_t *client, uint32_t timeout_ms, httpclie
 void httpclient_close(httpclient_t *client)
 {
     if (client->net.handle > 0) {
-        client->net.disconnect(&client->net);
+        if (0 == HAL_Network_Session(client->net.handle)) {
+            /* closed by the server, the handle may be another connection's by now */
+            httpc_debug("connection to %s already closed", client->host);
+            _http_pool_tidy();
+        } else if (client->keep_alive && client->is_idle && '\0' != client->host[0] && _http_pool_put(client)) {
+            /* a connection with a response left unread cannot take another request */
+            httpc_debug("keep connection to %s", client->host);
+        } else {
+            client->net.disconnect(&client->net);
+            _http_pool_tidy();
+        }
     }
     client->net.handle = 0;
+    client->is_idle = IOT_FALSE;
     httpc_info("client disconnected");
 }
 
 static int _http_send(httpclient_t *client, const char *url, int port, const char *ca_crt,
-                      HTTPCLIENT_REQUEST_TYPE method, httpclient_data_t *client_data)
+                      HTTPCLIENT_REQUEST_TYPE method, httpclient_data_t *client_data, int *reused)
 {
     int ret;
     char host[HTTPCLIENT_MAX_URL_LEN] = { 0 };
     char path[HTTPCLIENT_MAX_URL_LEN] = { 0 };
 
+    *reused = IOT_FALSE;
+
     /* First we need to parse the url (http[s]://host[:port][/[path]]) */
     ret = _utils_parse_url(url, host, path);
     if (ret != SUCCESS_RETURN) {
@@ -516,53 +929,125 @@ static int _http_send(httpclient_t *client, const char *url, int port, const cha
         return ret;
     }
 
-    if (0 == client->net.handle) {
-        /* Establish connection if no. */
-        ret = iotx_net_init(&client->net, host, port, ca_crt);
-        if (0 != ret) {
-            return ret;
+    if (0 != client->net.handle && !client->is_idle) {
+        httpclient_close(client);
+    }
+
+    if (0 != client->net.handle) {
+        /* the connection of the last request */
+        *reused = IOT_TRUE;
+    } else {
+        /* the host keys the pool, one that does not fit is not pooled */
+        if (strlen(host) < sizeof(client->host)) {
+            memcpy(client->host, host, strlen(host) + 1);
+        } else {
+            client->host[0] = '\0';
         }
 
-        ret = httpclient_connect(client);
-        if (0 != ret) {
-            httpclient_close(client);
-            return ret;
+        if (_http_pool_take(client, port, ca_crt)) {
+            *reused = IOT_TRUE;
+        } else {
+            /* Establish connection if no. */
+            ret = iotx_net_init(&client->net, host, port, ca_crt);
+            if (0 != ret) {
+                return ret;
+            }
+
+            ret = httpclient_connect(client);
+            if (0 != ret) {
+                httpclient_close(client);
+                return ret;
+            }
         }
+    }
 
-        ret = _http_send_request(client, host, path, method, client_data);
-        if (0 != ret) {
-            httpc_err("_http_send_request is error, ret = %d", ret);
-            httpclient_close(client);
+    client->is_idle = IOT_FALSE;
+    client->keep_alive = IOT_FALSE;
+    client->response_code = 0;
+    client_data->is_more = IOT_FALSE;
+    client_data->response_received_len = 0;
+
+    ret = _http_send_request(client, host, path, method, client_data);
+    if (0 != ret) {
+        httpc_err("_http_send_request is error, ret = %d", ret);
+        httpclient_close(client);
+        return ret;
+    }
+    return SUCCESS_RETURN;
+}
+
+/* hand what is in response_buf to body_cb, and read on until the body ends */
+static int _http_stream_body(httpclient_t *client, uint32_t timeout_ms, httpclient_data_t *client_data)
+{
+    int ret;
+    int delivered = 0;
+
+    while (1) {
+        int len = client_data->response_received_len - delivered;
+
+        if (len > 0 && client_data->body_cb(client_data->body_ctx, client_data->response_buf, len) < 0) {
+            httpc_info("body_cb stopped the transfer");
+            return ERROR_HTTP_BREAK;
+        }
+        delivered += len;
+
+        if (!client_data->is_more) {
+            return SUCCESS_RETURN;
+        }
+
+        ret = httpclient_recv_response(client, timeout_ms, client_data);
+        if (ret < 0) {
             return ret;
         }
     }
-    return SUCCESS_RETURN;
 }
 
 int httpclient_common(httpclient_t *client, const char *url, int port, const char *ca_crt,
                       HTTPCLIENT_REQUEST_TYPE method, uint32_t timeout_ms, httpclient_data_t *client_data)
 {
     iotx_time_t timer;
-    int ret = _http_send(client, url, port, ca_crt, method, client_data);
-    if (SUCCESS_RETURN != ret) {
-        return ret;
-    }
+    int reused = IOT_FALSE;
+    int ret;
 
-    iotx_time_init(&timer);
-    utils_time_countdown_ms(&timer, timeout_ms);
+    /* a kept connection the server dropped while idle fails before any response, send again on another */
+    while (1) {
+        ret = _http_send(client, url, port, ca_crt, method, client_data, &reused);
+        if (SUCCESS_RETURN != ret) {
+            if (reused) {
+                continue;
+            }
+            return ret;
+        }
+
+        iotx_time_init(&timer);
+        utils_time_countdown_ms(&timer, timeout_ms);
+
+        if ((NULL != client_data->response_buf)
+            && (0 != client_data->response_buf_len)) {
+            ret = httpclient_recv_response(client, iotx_time_left(&timer), client_data);
+            if (ret < 0) {
+                httpc_err("httpclient_recv_response is error,ret = %d", ret);
+                httpclient_close(client);
+                if (reused && 0 == client->response_code) {
+                    httpc_info("kept connection is gone, reconnect");
+                    continue;
+                }
+                return ret;
+            }
+        }
+        break;
+    }
 
-    if ((NULL != client_data->response_buf)
-        && (0 != client_data->response_buf_len)) {
-        ret = httpclient_recv_response(client, iotx_time_left(&timer), client_data);
+    if (NULL != client_data->body_cb) {
+        ret = _http_stream_body(client, timeout_ms, client_data);
         if (ret < 0) {
-            httpc_err("httpclient_recv_response is error,ret = %d", ret);
             httpclient_close(client);
             return ret;
         }
     }
 
     if (! client_data->is_more) {
-        /* Close the HTTP if no more data. */
+        /* Close the HTTP if no more data, a connection the server keeps open is kept for the next request. */
         httpc_info("close http channel");
         httpclient_close(client);
     }
@@ -577,7 +1062,8 @@ int iotx_post(httpclient_t *client,
               const char *ca_crt,
               httpclient_data_t *client_data)
 {
-    return _http_send(client, url, port, ca_crt, HTTPCLIENT_POST, client_data);
+    int reused;
+
+    return _http_send(client, url, port, ca_crt, HTTPCLIENT_POST, client_data, &reused);
 }
 #endif
-
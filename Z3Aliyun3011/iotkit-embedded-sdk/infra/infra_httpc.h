@@ -31,6 +31,14 @@ extern "C" {
  *  - Step4: Repeat Steps 2 and 3 to execute more requests.
  *  - Step5: Call #httpclient_close() to close the connection.
  *  - Sample code: Please refer to the example under <sdk_root>/project/mt7687_hdk/apps/http_client/http_client_keepalive folder.
+ * - \b Connection \b reuse
+ *  - #httpclient_close() of a connection whose last response was read to its end, and that the server keeps open, puts it
+ *    in a small pool instead of closing it. The next request to the same host and port takes it from there, so it skips
+ *    the TCP setup. A pooled connection the server dropped in the meantime is replaced by a new one.
+ *  - Only plain HTTP connections are kept by default. The WGM110 has a single TLS connection, an idle HTTPS one would
+ *    keep MQTT from connecting. Define HTTPCLIENT_POOL_TLS to 1 to keep HTTPS connections too.
+ *  - Bodies sent with "Transfer-Encoding: chunked" are decoded, only the data reaches the response buffer.
+ *  - With httpclient_data_t::body_cb set, #httpclient_common() reads the whole body and hands it over a buffer at a time.
  */
 
 /** @defgroup httpclient_define Define
@@ -41,6 +49,9 @@ extern "C" {
 
 /** @brief   This macro defines the HTTPS port.  */
 #define HTTPS_PORT 443
+
+/** @brief   Longest host name a connection can be pooled for.  */
+#define HTTPCLIENT_HOST_LEN (64)
 /**
  * @}
  */
@@ -69,8 +80,17 @@ typedef struct {
     char               *header;         /**< Custom header. */
     char               *auth_user;      /**< Username for basic authentication. */
     char               *auth_password;  /**< Password for basic authentication. */
+    int                 keep_alive;     /**< The server keeps the connection open after the response. */
+    int                 is_idle;        /**< The last response was read to its end, the connection can take another request. */
+    char                host[HTTPCLIENT_HOST_LEN];  /**< Host of the connection, empty when it is too long to be pooled. */
 } httpclient_t;
 
+/**
+ * @brief   Receives the body from #httpclient_common() a buffer at a time.
+ * @return  0 to go on, < 0 to stop the transfer, which then fails with ERROR_HTTP_BREAK.
+ */
+typedef int (*httpclient_body_cb_t)(void *ctx, const char *data, int len);
+
 /** @brief   This structure defines the HTTP data structure.  */
 typedef struct {
     int     is_more;                /**< Indicates if more data needs to be retrieved. */
@@ -83,6 +103,9 @@ typedef struct {
     char   *post_content_type;      /**< Content type of the post data. */
     char   *post_buf;               /**< User data to be posted. */
     char   *response_buf;           /**< Buffer to store the response data. */
+    int     chunk_state;            /**< Where the chunked decoding is, internal. */
+    httpclient_body_cb_t body_cb;   /**< Optional, takes the body as it arrives, response_buf is its buffer. */
+    void   *body_ctx;               /**< Passed to body_cb. */
 } httpclient_data_t;
 
 int iotx_post(httpclient_t *client,
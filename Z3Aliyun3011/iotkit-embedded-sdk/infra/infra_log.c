@@ -8,6 +8,9 @@ extern void HAL_MutexDestroy(void *);
 #include <stdarg.h>
 #include "infra_compat.h"
 #include "infra_log.h"
+#ifdef INFRA_DLOG
+    #include "infra_dlog.h"
+#endif
 #if defined(INFRA_CJSON)
     #include "infra_cjson.h"
 #endif
@@ -38,6 +41,12 @@ void LITE_syslog_routine(char *m, const char *f, const int l, const int level, c
         return;
     }
 
+#ifdef INFRA_DLOG
+    /* formatted later by host/dlog_decode, nothing printed on the calling task */
+    iotx_dlog_vrecord(level, f, l, fmt, *params);
+    return;
+#endif
+
 #if !defined(_WIN32)
     LITE_printf("%s%s", "\033", lvl_color[level]);
     LITE_printf(LOG_PREFIX_FMT, lvl_names[level], f, l);
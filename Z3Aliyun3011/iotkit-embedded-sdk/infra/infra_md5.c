@@ -9,6 +9,7 @@
 #include <string.h>
 
 #include "infra_md5.h"
+#include "infra_hash_word.h"
 
 #define MD5_KEY_IOPAD_SIZE  (64)
 #define MD5_DIGEST_SIZE     (16)
@@ -25,6 +26,10 @@ static void utils_md5_zeroize(void *v, size_t n)
 /*
  * 32-bit integer manipulation macros (little endian)
  */
+#if defined(INFRA_HASH_LOAD_LE32) && !defined(IOT_MD5_GET_UINT32_LE)
+#define IOT_MD5_GET_UINT32_LE(n,b,i)    { (n) = INFRA_HASH_LOAD_LE32((b) + (i)); }
+#endif
+
 #ifndef IOT_MD5_GET_UINT32_LE
 #define IOT_MD5_GET_UINT32_LE(n,b,i)                            \
     {                                                       \
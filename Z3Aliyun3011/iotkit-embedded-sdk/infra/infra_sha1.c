@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "infra_sha1.h"
+#include "infra_hash_word.h"
 
 #define SHA1_KEY_IOPAD_SIZE (64)
 #define SHA1_DIGEST_SIZE    (20)
@@ -20,6 +21,10 @@ static void utils_sha1_zeroize( void *v, uint32_t n ) {
 /*
  * 32-bit integer manipulation macros (big endian)
  */
+#if defined(INFRA_HASH_LOAD_BE32) && !defined(GET_UINT32_BE)
+#define GET_UINT32_BE(n,b,i)    { (n) = INFRA_HASH_LOAD_BE32((b) + (i)); }
+#endif
+
 #ifndef GET_UINT32_BE
 #define GET_UINT32_BE(n,b,i)                            \
 {                                                       \
@@ -328,59 +333,70 @@ static int8_t utils_hb2hex(uint8_t hb)
     return (int8_t)(hb < 10 ? '0' + hb : hb - 10 + 'a');
 }
 
-void utils_hmac_sha1(const char *msg, int msg_len, char *digest, const char *key, int key_len)
+/*
+ * HMAC-SHA1 context setup: both key pads are hashed here, once per key
+ */
+void utils_hmac_sha1_starts(iot_hmac_sha1_context *ctx, const unsigned char *key, uint32_t key_len)
 {
     iot_sha1_context context;
-    unsigned char k_ipad[SHA1_KEY_IOPAD_SIZE];    /* inner padding - key XORd with ipad  */
-    unsigned char k_opad[SHA1_KEY_IOPAD_SIZE];    /* outer padding - key XORd with opad */
-    unsigned char out[SHA1_DIGEST_SIZE];
+    unsigned char k_pad[SHA1_KEY_IOPAD_SIZE];     /* key XORd with ipad, then with opad */
+    unsigned char sum[SHA1_DIGEST_SIZE];
     int i;
 
-    if ((NULL == msg) || (NULL == digest) || (NULL == key)) {
-        return;
+    /* a key longer than a block is replaced by its digest */
+    if (key_len > SHA1_KEY_IOPAD_SIZE) {
+        utils_sha1(key, key_len, sum);
+        key = sum;
+        key_len = SHA1_DIGEST_SIZE;
     }
 
-    if (key_len > SHA1_KEY_IOPAD_SIZE) {
-        return;
+    memset(k_pad, 0, sizeof(k_pad));
+    memcpy(k_pad, key, key_len);
+    for (i = 0; i < SHA1_KEY_IOPAD_SIZE; i++) {
+        k_pad[i] ^= 0x36;
     }
 
-    /* start out by storing key in pads */
-    memset(k_ipad, 0, sizeof(k_ipad));
-    memset(k_opad, 0, sizeof(k_opad));
-    memcpy(k_ipad, key, key_len);
-    memcpy(k_opad, key, key_len);
+    /* the inner pass is left open for the message */
+    utils_sha1_init(&ctx->inner);
+    utils_sha1_starts(&ctx->inner);
+    utils_sha1_update(&ctx->inner, k_pad, SHA1_KEY_IOPAD_SIZE);
 
-    /* XOR key with ipad and opad values */
+    /* the outer pad fills a block, its state is all there is to keep */
     for (i = 0; i < SHA1_KEY_IOPAD_SIZE; i++) {
-        k_ipad[i] ^= 0x36;
-        k_opad[i] ^= 0x5c;
+        k_pad[i] ^= 0x36 ^ 0x5c;
     }
+    utils_sha1_init(&context);
+    utils_sha1_starts(&context);
+    utils_sha1_update(&context, k_pad, SHA1_KEY_IOPAD_SIZE);
+    memcpy(ctx->outer, context.state, sizeof(ctx->outer));
 
-    /* perform inner SHA */
-    utils_sha1_init(&context);                                      /* init context for 1st pass */
-    utils_sha1_starts(&context);                                    /* setup context for 1st pass */
-    utils_sha1_update(&context, k_ipad, SHA1_KEY_IOPAD_SIZE);            /* start with inner pad */
-    utils_sha1_update(&context, (unsigned char *) msg, msg_len);    /* then text of datagram */
-    utils_sha1_finish(&context, out);                               /* finish up 1st pass */
-
-    /* perform outer SHA */
-    utils_sha1_init(&context);                              /* init context for 2nd pass */
-    utils_sha1_starts(&context);                            /* setup context for 2nd pass */
-    utils_sha1_update(&context, k_opad, SHA1_KEY_IOPAD_SIZE);    /* start with outer pad */
-    utils_sha1_update(&context, out, SHA1_DIGEST_SIZE);     /* then results of 1st hash */
-    utils_sha1_finish(&context, out);                       /* finish up 2nd pass */
+    utils_sha1_zeroize(k_pad, sizeof(k_pad));
+    utils_sha1_free(&context);
+}
 
-    for (i = 0; i < SHA1_DIGEST_SIZE; ++i) {
-        digest[i * 2] = utils_hb2hex(out[i] >> 4);
-        digest[i * 2 + 1] = utils_hb2hex(out[i]);
-    }
+void utils_hmac_sha1_update(iot_hmac_sha1_context *ctx, const unsigned char *msg, uint32_t msg_len)
+{
+    utils_sha1_update(&ctx->inner, msg, msg_len);
 }
 
-void utils_hmac_sha1_hex(const char *msg, int msg_len, char *digest, const char *key, int key_len)
+void utils_hmac_sha1_finish(iot_hmac_sha1_context *ctx, unsigned char output[20])
 {
     iot_sha1_context context;
-    unsigned char k_ipad[SHA1_KEY_IOPAD_SIZE];    /* inner padding - key XORd with ipad  */
-    unsigned char k_opad[SHA1_KEY_IOPAD_SIZE];    /* outer padding - key XORd with opad */
+
+    utils_sha1_finish(&ctx->inner, output);
+
+    /* resume the outer pass after its pad block */
+    utils_sha1_init(&context);
+    memcpy(context.state, ctx->outer, sizeof(ctx->outer));
+    context.total[0] = SHA1_KEY_IOPAD_SIZE;
+    utils_sha1_update(&context, output, SHA1_DIGEST_SIZE);
+    utils_sha1_finish(&context, output);
+    utils_sha1_free(&context);
+}
+
+void utils_hmac_sha1(const char *msg, int msg_len, char *digest, const char *key, int key_len)
+{
+    iot_hmac_sha1_context context;
     unsigned char out[SHA1_DIGEST_SIZE];
     int i;
 
@@ -392,32 +408,31 @@ void utils_hmac_sha1_hex(const char *msg, int msg_len, char *digest, const char
         return;
     }
 
-    /* start out by storing key in pads */
-    memset(k_ipad, 0, sizeof(k_ipad));
-    memset(k_opad, 0, sizeof(k_opad));
-    memcpy(k_ipad, key, key_len);
-    memcpy(k_opad, key, key_len);
+    utils_hmac_sha1_starts(&context, (const unsigned char *)key, key_len);
+    utils_hmac_sha1_update(&context, (const unsigned char *)msg, msg_len);
+    utils_hmac_sha1_finish(&context, out);
 
-    /* XOR key with ipad and opad values */
-    for (i = 0; i < SHA1_KEY_IOPAD_SIZE; i++) {
-        k_ipad[i] ^= 0x36;
-        k_opad[i] ^= 0x5c;
+    for (i = 0; i < SHA1_DIGEST_SIZE; ++i) {
+        digest[i * 2] = utils_hb2hex(out[i] >> 4);
+        digest[i * 2 + 1] = utils_hb2hex(out[i]);
+    }
+}
+
+void utils_hmac_sha1_hex(const char *msg, int msg_len, char *digest, const char *key, int key_len)
+{
+    iot_hmac_sha1_context context;
+
+    if ((NULL == msg) || (NULL == digest) || (NULL == key)) {
+        return;
+    }
+
+    if (key_len > SHA1_KEY_IOPAD_SIZE) {
+        return;
     }
 
-    /* perform inner SHA */
-    utils_sha1_init(&context);                                      /* init context for 1st pass */
-    utils_sha1_starts(&context);                                    /* setup context for 1st pass */
-    utils_sha1_update(&context, k_ipad, SHA1_KEY_IOPAD_SIZE);            /* start with inner pad */
-    utils_sha1_update(&context, (unsigned char *) msg, msg_len);    /* then text of datagram */
-    utils_sha1_finish(&context, out);                               /* finish up 1st pass */
-
-    /* perform outer SHA */
-    utils_sha1_init(&context);                              /* init context for 2nd pass */
-    utils_sha1_starts(&context);                            /* setup context for 2nd pass */
-    utils_sha1_update(&context, k_opad, SHA1_KEY_IOPAD_SIZE);    /* start with outer pad */
-    utils_sha1_update(&context, out, SHA1_DIGEST_SIZE);     /* then results of 1st hash */
-    utils_sha1_finish(&context, out);                       /* finish up 2nd pass */
-    memcpy(digest, out, SHA1_DIGEST_SIZE);
+    utils_hmac_sha1_starts(&context, (const unsigned char *)key, key_len);
+    utils_hmac_sha1_update(&context, (const unsigned char *)msg, msg_len);
+    utils_hmac_sha1_finish(&context, (unsigned char *)digest);
 }
 
 #endif
\ No newline at end of file
@@ -80,6 +80,42 @@ void utils_sha1_process(iot_sha1_context *ctx, const unsigned char data[64]);
  */
 void utils_sha1(const unsigned char *input, uint32_t ilen, unsigned char output[20]);
 
+/**
+ * \brief          HMAC-SHA1 context structure. The key pads are hashed by
+ *                 utils_hmac_sha1_starts(); a copy of the context taken then
+ *                 signs another message with the same key without them.
+ */
+typedef struct {
+    iot_sha1_context inner;     /*!< key XORd with ipad, then the message */
+    uint32_t outer[5];          /*!< state after the key XORd with opad */
+} iot_hmac_sha1_context;
+
+/**
+ * \brief          HMAC-SHA1 context setup
+ *
+ * \param ctx      context to be initialized
+ * \param key      HMAC key
+ * \param key_len  length of the key
+ */
+void utils_hmac_sha1_starts(iot_hmac_sha1_context *ctx, const unsigned char *key, uint32_t key_len);
+
+/**
+ * \brief          HMAC-SHA1 process buffer
+ *
+ * \param ctx      HMAC-SHA1 context
+ * \param msg      buffer holding the data
+ * \param msg_len  length of the input data
+ */
+void utils_hmac_sha1_update(iot_hmac_sha1_context *ctx, const unsigned char *msg, uint32_t msg_len);
+
+/**
+ * \brief          HMAC-SHA1 final digest
+ *
+ * \param ctx      HMAC-SHA1 context
+ * \param output   HMAC-SHA1 result
+ */
+void utils_hmac_sha1_finish(iot_hmac_sha1_context *ctx, unsigned char output[20]);
+
 void utils_hmac_sha1(const char *msg, int msg_len, char *digest, const char *key, int key_len);
 void utils_hmac_sha1_hex(const char *msg, int msg_len, char *digest, const char *key, int key_len);
 
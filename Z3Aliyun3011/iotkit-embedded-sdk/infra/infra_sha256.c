@@ -5,11 +5,10 @@
 
 #ifdef INFRA_SHA256
 
-#define INFRA_SHA256_SMALLER
-
 #include <stdlib.h>
 #include <string.h>
 #include "infra_sha256.h"
+#include "infra_hash_word.h"
 
 #define SHA256_KEY_IOPAD_SIZE   (64)
 #define SHA256_DIGEST_SIZE      (32)
@@ -17,6 +16,10 @@
 /*
  * 32-bit integer manipulation macros (big endian)
  */
+#if defined(INFRA_HASH_LOAD_BE32) && !defined(GET_UINT32_BE)
+#define GET_UINT32_BE(n,b,i)    { (n) = INFRA_HASH_LOAD_BE32((b) + (i)); }
+#endif
+
 #ifndef GET_UINT32_BE
 #define GET_UINT32_BE(n,b,i)                            \
     do {                                                    \
@@ -112,11 +115,21 @@ static const uint32_t K[] = {
 #define F0(x,y,z) ((x & y) | (z & (x | y)))
 #define F1(x,y,z) (z ^ (x & (y ^ z)))
 
+#if defined(INFRA_SHA256_SMALLER)
 #define R(t)                                    \
     (                                               \
             W[t] = S1(W[t -  2]) + W[t -  7] +          \
                    S0(W[t - 15]) + W[t - 16]            \
     )
+#else
+/* W[t], in place of W[t - 16] in a 16 word window */
+#define R(t)                                            \
+    (                                                   \
+            W[(t) & 15] += S1(W[((t) -  2) & 15]) +     \
+                           W[((t) -  7) & 15] +         \
+                           S0(W[((t) - 15) & 15])       \
+    )
+#endif
 
 #define P(a,b,c,d,e,f,g,h,x,K)                  \
     {                                               \
@@ -125,9 +138,43 @@ static const uint32_t K[] = {
         d += temp1; h = temp1 + temp2;              \
     }
 
+#if !defined(INFRA_SHA256_SMALLER)
+/* message words of the first 16 rounds, and of the others */
+#define W0(t)   W[t]
+#define W1(t)   R(t)
+
+/* rounds i..i+15, window index and round number agree modulo 16 */
+#define ROUNDS_16(A, X, i)                                                      \
+    {                                                                           \
+        P(A[0], A[1], A[2], A[3], A[4], A[5], A[6], A[7], X( 0), K[(i) +  0]);  \
+        P(A[7], A[0], A[1], A[2], A[3], A[4], A[5], A[6], X( 1), K[(i) +  1]);  \
+        P(A[6], A[7], A[0], A[1], A[2], A[3], A[4], A[5], X( 2), K[(i) +  2]);  \
+        P(A[5], A[6], A[7], A[0], A[1], A[2], A[3], A[4], X( 3), K[(i) +  3]);  \
+        P(A[4], A[5], A[6], A[7], A[0], A[1], A[2], A[3], X( 4), K[(i) +  4]);  \
+        P(A[3], A[4], A[5], A[6], A[7], A[0], A[1], A[2], X( 5), K[(i) +  5]);  \
+        P(A[2], A[3], A[4], A[5], A[6], A[7], A[0], A[1], X( 6), K[(i) +  6]);  \
+        P(A[1], A[2], A[3], A[4], A[5], A[6], A[7], A[0], X( 7), K[(i) +  7]);  \
+        P(A[0], A[1], A[2], A[3], A[4], A[5], A[6], A[7], X( 8), K[(i) +  8]);  \
+        P(A[7], A[0], A[1], A[2], A[3], A[4], A[5], A[6], X( 9), K[(i) +  9]);  \
+        P(A[6], A[7], A[0], A[1], A[2], A[3], A[4], A[5], X(10), K[(i) + 10]);  \
+        P(A[5], A[6], A[7], A[0], A[1], A[2], A[3], A[4], X(11), K[(i) + 11]);  \
+        P(A[4], A[5], A[6], A[7], A[0], A[1], A[2], A[3], X(12), K[(i) + 12]);  \
+        P(A[3], A[4], A[5], A[6], A[7], A[0], A[1], A[2], X(13), K[(i) + 13]);  \
+        P(A[2], A[3], A[4], A[5], A[6], A[7], A[0], A[1], X(14), K[(i) + 14]);  \
+        P(A[1], A[2], A[3], A[4], A[5], A[6], A[7], A[0], X(15), K[(i) + 15]);  \
+    }
+#endif /* !INFRA_SHA256_SMALLER */
+
 void utils_sha256_process(iot_sha256_context *ctx, const unsigned char data[64])
 {
+#if defined(INFRA_SHA256_SMALLER)
     uint32_t temp1, temp2, W[64];
+#else
+    /* the schedule is a 16 word window, each word expanded by the round
+       that uses it: 64 bytes of stack instead of 256, and short live
+       ranges next to the working variables in ARMv7-M's registers */
+    uint32_t temp1, temp2, W[16];
+#endif
     uint32_t A[8];
     unsigned int i;
 
@@ -160,26 +207,9 @@ void utils_sha256_process(iot_sha256_context *ctx, const unsigned char data[64])
         GET_UINT32_BE(W[i], data, 4 * i);
     }
 
-    for (i = 0; i < 16; i += 8) {
-        P(A[0], A[1], A[2], A[3], A[4], A[5], A[6], A[7], W[i + 0], K[i + 0]);
-        P(A[7], A[0], A[1], A[2], A[3], A[4], A[5], A[6], W[i + 1], K[i + 1]);
-        P(A[6], A[7], A[0], A[1], A[2], A[3], A[4], A[5], W[i + 2], K[i + 2]);
-        P(A[5], A[6], A[7], A[0], A[1], A[2], A[3], A[4], W[i + 3], K[i + 3]);
-        P(A[4], A[5], A[6], A[7], A[0], A[1], A[2], A[3], W[i + 4], K[i + 4]);
-        P(A[3], A[4], A[5], A[6], A[7], A[0], A[1], A[2], W[i + 5], K[i + 5]);
-        P(A[2], A[3], A[4], A[5], A[6], A[7], A[0], A[1], W[i + 6], K[i + 6]);
-        P(A[1], A[2], A[3], A[4], A[5], A[6], A[7], A[0], W[i + 7], K[i + 7]);
-    }
-
-    for (i = 16; i < 64; i += 8) {
-        P(A[0], A[1], A[2], A[3], A[4], A[5], A[6], A[7], R(i + 0), K[i + 0]);
-        P(A[7], A[0], A[1], A[2], A[3], A[4], A[5], A[6], R(i + 1), K[i + 1]);
-        P(A[6], A[7], A[0], A[1], A[2], A[3], A[4], A[5], R(i + 2), K[i + 2]);
-        P(A[5], A[6], A[7], A[0], A[1], A[2], A[3], A[4], R(i + 3), K[i + 3]);
-        P(A[4], A[5], A[6], A[7], A[0], A[1], A[2], A[3], R(i + 4), K[i + 4]);
-        P(A[3], A[4], A[5], A[6], A[7], A[0], A[1], A[2], R(i + 5), K[i + 5]);
-        P(A[2], A[3], A[4], A[5], A[6], A[7], A[0], A[1], R(i + 6), K[i + 6]);
-        P(A[1], A[2], A[3], A[4], A[5], A[6], A[7], A[0], R(i + 7), K[i + 7]);
+    ROUNDS_16(A, W0, 0);
+    for (i = 16; i < 64; i += 16) {
+        ROUNDS_16(A, W1, i);
     }
 #endif /* INFRA_SHA256_SMALLER */
 
@@ -187,6 +217,7 @@ void utils_sha256_process(iot_sha256_context *ctx, const unsigned char data[64])
         ctx->state[i] += A[i];
     }
 }
+
 void utils_sha256_update(iot_sha256_context *ctx, const unsigned char *input, uint32_t ilen)
 {
     size_t fill;
@@ -275,46 +306,123 @@ void utils_sha256(const uint8_t *input, uint32_t ilen, uint8_t output[32])
     utils_sha256_free(&ctx);
 }
 
-void utils_hmac_sha256(const uint8_t *msg, uint32_t msg_len, const uint8_t *key, uint32_t key_len, uint8_t output[32])
+void utils_sha256_multi(const uint8_t *input[], const uint32_t ilen[], uint8_t output[][32], uint32_t count)
+{
+    iot_sha256_context ctx;
+    const uint8_t *block;
+    uint8_t tail[2 * 64];
+    uint32_t n, left, tail_len;
+
+    for (n = 0; n < count; n++) {
+        utils_sha256_starts(&ctx);
+
+        /* the whole blocks straight from the message */
+        for (block = input[n]; block + 64 <= input[n] + ilen[n]; block += 64) {
+            utils_sha256_process(&ctx, block);
+        }
+
+        /* then the rest of it with the padding and the length */
+        left = ilen[n] & 0x3F;
+        tail_len = (left < 56) ? 64 : 128;
+        memset(tail, 0, tail_len);
+        memcpy(tail, block, left);
+        tail[left] = 0x80;
+        PUT_UINT32_BE(ilen[n] >> 29, tail, tail_len - 8);
+        PUT_UINT32_BE(ilen[n] << 3,  tail, tail_len - 4);
+        for (block = tail; block < tail + tail_len; block += 64) {
+            utils_sha256_process(&ctx, block);
+        }
+
+        PUT_UINT32_BE(ctx.state[0], output[n],  0);
+        PUT_UINT32_BE(ctx.state[1], output[n],  4);
+        PUT_UINT32_BE(ctx.state[2], output[n],  8);
+        PUT_UINT32_BE(ctx.state[3], output[n], 12);
+        PUT_UINT32_BE(ctx.state[4], output[n], 16);
+        PUT_UINT32_BE(ctx.state[5], output[n], 20);
+        PUT_UINT32_BE(ctx.state[6], output[n], 24);
+        PUT_UINT32_BE(ctx.state[7], output[n], 28);
+    }
+
+    utils_sha256_zeroize(tail, sizeof(tail));
+    utils_sha256_free(&ctx);
+}
+
+/*
+ * HMAC-SHA256 context setup: both key pads are hashed here, once per key
+ */
+void utils_hmac_sha256_starts(iot_hmac_sha256_context *ctx, const uint8_t *key, uint32_t key_len)
 {
     iot_sha256_context context;
-    uint8_t k_ipad[SHA256_KEY_IOPAD_SIZE];    /* inner padding - key XORd with ipad  */
-    uint8_t k_opad[SHA256_KEY_IOPAD_SIZE];    /* outer padding - key XORd with opad */
+    uint8_t k_pad[SHA256_KEY_IOPAD_SIZE];     /* key XORd with ipad, then with opad */
+    uint8_t sum[SHA256_DIGEST_SIZE];
     int32_t i;
 
-    if ((NULL == msg) || (NULL == key) || (NULL == output)) {
-        return;
+    /* a key longer than a block is replaced by its digest */
+    if (key_len > SHA256_KEY_IOPAD_SIZE) {
+        utils_sha256(key, key_len, sum);
+        key = sum;
+        key_len = SHA256_DIGEST_SIZE;
     }
 
-    if (key_len > SHA256_KEY_IOPAD_SIZE) {
-        return;
+    memset(k_pad, 0, sizeof(k_pad));
+    memcpy(k_pad, key, key_len);
+    for (i = 0; i < SHA256_KEY_IOPAD_SIZE; i++) {
+        k_pad[i] ^= 0x36;
     }
 
-    /* start out by storing key in pads */
-    memset(k_ipad, 0, sizeof(k_ipad));
-    memset(k_opad, 0, sizeof(k_opad));
-    memcpy(k_ipad, key, key_len);
-    memcpy(k_opad, key, key_len);
+    /* the inner pass is left open for the message */
+    utils_sha256_init(&ctx->inner);
+    utils_sha256_starts(&ctx->inner);
+    utils_sha256_update(&ctx->inner, k_pad, SHA256_KEY_IOPAD_SIZE);
 
-    /* XOR key with ipad and opad values */
+    /* the outer pad fills a block, its state is all there is to keep */
     for (i = 0; i < SHA256_KEY_IOPAD_SIZE; i++) {
-        k_ipad[i] ^= 0x36;
-        k_opad[i] ^= 0x5c;
+        k_pad[i] ^= 0x36 ^ 0x5c;
+    }
+    utils_sha256_init(&context);
+    utils_sha256_starts(&context);
+    utils_sha256_update(&context, k_pad, SHA256_KEY_IOPAD_SIZE);
+    memcpy(ctx->outer, context.state, sizeof(ctx->outer));
+
+    utils_sha256_zeroize(k_pad, sizeof(k_pad));
+    utils_sha256_free(&context);
+}
+
+void utils_hmac_sha256_update(iot_hmac_sha256_context *ctx, const uint8_t *msg, uint32_t msg_len)
+{
+    utils_sha256_update(&ctx->inner, msg, msg_len);
+}
+
+void utils_hmac_sha256_finish(iot_hmac_sha256_context *ctx, uint8_t output[32])
+{
+    iot_sha256_context context;
+
+    utils_sha256_finish(&ctx->inner, output);
+
+    /* resume the outer pass after its pad block */
+    utils_sha256_init(&context);
+    memcpy(context.state, ctx->outer, sizeof(ctx->outer));
+    context.total[0] = SHA256_KEY_IOPAD_SIZE;
+    utils_sha256_update(&context, output, SHA256_DIGEST_SIZE);
+    utils_sha256_finish(&context, output);
+    utils_sha256_free(&context);
+}
+
+void utils_hmac_sha256(const uint8_t *msg, uint32_t msg_len, const uint8_t *key, uint32_t key_len, uint8_t output[32])
+{
+    iot_hmac_sha256_context context;
+
+    if ((NULL == msg) || (NULL == key) || (NULL == output)) {
+        return;
+    }
+
+    if (key_len > SHA256_KEY_IOPAD_SIZE) {
+        return;
     }
 
-    /* perform inner SHA */
-    utils_sha256_init(&context);                                      /* init context for 1st pass */
-    utils_sha256_starts(&context);                                    /* setup context for 1st pass */
-    utils_sha256_update(&context, k_ipad, SHA256_KEY_IOPAD_SIZE);     /* start with inner pad */
-    utils_sha256_update(&context, msg, msg_len);                      /* then text of datagram */
-    utils_sha256_finish(&context, output);                            /* finish up 1st pass */
-
-    /* perform outer SHA */
-    utils_sha256_init(&context);                              /* init context for 2nd pass */
-    utils_sha256_starts(&context);                            /* setup context for 2nd pass */
-    utils_sha256_update(&context, k_opad, SHA256_KEY_IOPAD_SIZE);    /* start with outer pad */
-    utils_sha256_update(&context, output, SHA256_DIGEST_SIZE);     /* then results of 1st hash */
-    utils_sha256_finish(&context, output);                       /* finish up 2nd pass */
+    utils_hmac_sha256_starts(&context, key, key_len);
+    utils_hmac_sha256_update(&context, msg, msg_len);
+    utils_hmac_sha256_finish(&context, output);
 }
 
 #endif
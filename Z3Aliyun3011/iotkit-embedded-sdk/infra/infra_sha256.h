@@ -78,6 +78,57 @@ void utils_sha256_process(iot_sha256_context *ctx, const unsigned char data[64])
  */
 void utils_sha256(const uint8_t *input, uint32_t ilen, uint8_t output[32]);
 
+/**
+ * \brief          Output[i] = SHA-256( input[i] ), i < count
+ *
+ *                 Each message is compressed straight from its buffer, its
+ *                 last block padded on the stack, without going through the
+ *                 context buffer. The messages are hashed one after the
+ *                 other, not interleaved. Only host/codec_bench calls it.
+ *
+ * \param input    buffers holding the messages
+ * \param ilen     lengths of the messages
+ * \param output   SHA-256 checksum results
+ * \param count    number of messages
+ */
+void utils_sha256_multi(const uint8_t *input[], const uint32_t ilen[], uint8_t output[][32], uint32_t count);
+
+/**
+ * \brief          HMAC-SHA256 context structure. The key pads are hashed by
+ *                 utils_hmac_sha256_starts(); a copy of the context taken then
+ *                 signs another message with the same key without them.
+ */
+typedef struct {
+    iot_sha256_context inner;   /*!< key XORd with ipad, then the message */
+    uint32_t outer[8];          /*!< state after the key XORd with opad */
+} iot_hmac_sha256_context;
+
+/**
+ * \brief          HMAC-SHA256 context setup
+ *
+ * \param ctx      context to be initialized
+ * \param key      HMAC key
+ * \param key_len  length of the key
+ */
+void utils_hmac_sha256_starts(iot_hmac_sha256_context *ctx, const uint8_t *key, uint32_t key_len);
+
+/**
+ * \brief          HMAC-SHA256 process buffer
+ *
+ * \param ctx      HMAC-SHA256 context
+ * \param msg      buffer holding the data
+ * \param msg_len  length of the input data
+ */
+void utils_hmac_sha256_update(iot_hmac_sha256_context *ctx, const uint8_t *msg, uint32_t msg_len);
+
+/**
+ * \brief          HMAC-SHA256 final digest
+ *
+ * \param ctx      HMAC-SHA256 context
+ * \param output   HMAC-SHA256 result
+ */
+void utils_hmac_sha256_finish(iot_hmac_sha256_context *ctx, uint8_t output[32]);
+
 void utils_hmac_sha256(const uint8_t *msg, uint32_t msg_len, const uint8_t *key, uint32_t key_len, uint8_t output[32]);
 
 #endif
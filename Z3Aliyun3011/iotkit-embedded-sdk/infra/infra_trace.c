@@ -0,0 +1,238 @@
+#include "infra_config.h"
+
+#ifdef INFRA_TRACE
+/*
+ * Copyright (C) 2015-2018 Alibaba Group Holding Limited
+ */
+#include <string.h>
+#ifdef INFRA_TRACE_RING_SIZE
+    #include <stdlib.h>
+#endif
+
+#include "infra_types.h"
+#include "infra_trace.h"
+
+/* log2 buckets in microseconds, the last one also takes everything above 512 ms */
+#define TRACE_HIST_BUCKETS      (20)
+
+/* g_trace_hist[N] is the stage ending at point N, so slot 0 is free for the end to end total */
+#define TRACE_STAGE_TOTAL       (0)
+
+uint32_t HAL_Trace_Timestamp(void);
+uint32_t HAL_Trace_TimestampFreq(void);
+void HAL_Printf(const char *fmt, ...);
+#ifndef INFRA_TRACE_RING_SIZE
+void HAL_Trace_Point(uint32_t id, int point);
+#endif
+
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t bucket[TRACE_HIST_BUCKETS];
+} trace_hist_t;
+
+static const char *const g_trace_stage_name[IOTX_TRACE_POINT_MAX] = {
+    "total",
+    "wifi rx",
+    "mqtt parse",
+    "dm process",
+    "ipc wait",
+    "cjson",
+    "zigbee send"
+};
+
+static iotx_trace_t g_trace_current;
+static uint32_t     g_trace_next_id;
+static uint32_t     g_trace_recorded;
+static trace_hist_t g_trace_hist[IOTX_TRACE_POINT_MAX];
+
+#ifdef INFRA_TRACE_RING_SIZE
+static iotx_trace_t g_trace_ring[INFRA_TRACE_RING_SIZE];
+static uint32_t     g_trace_sorted[INFRA_TRACE_RING_SIZE];
+#endif
+
+static uint32_t _trace_elapsed_us(uint32_t from, uint32_t to)
+{
+    uint32_t freq = HAL_Trace_TimestampFreq();
+
+    /* unsigned difference, right across a wrap of the timestamp counter */
+    if (freq == 1000000) {
+        return to - from;
+    }
+    return (uint32_t)((uint64_t)(to - from) * 1000000 / freq);
+}
+
+static void _trace_hist_add(trace_hist_t *hist, uint32_t us)
+{
+    int idx = 0;
+
+    while (idx < TRACE_HIST_BUCKETS - 1 && (us >> (idx + 1)) != 0) {
+        idx++;
+    }
+
+    hist->count++;
+    hist->sum_us += us;
+    if (us > hist->max_us) {
+        hist->max_us = us;
+    }
+    hist->bucket[idx]++;
+}
+
+static int _trace_has(const iotx_trace_t *trace, int point)
+{
+    return (trace->mask & (1u << point)) != 0;
+}
+
+static void _trace_record(const iotx_trace_t *trace)
+{
+    int point;
+
+    if (trace->mask == 0) {
+        return;
+    }
+
+    for (point = 1; point < IOTX_TRACE_POINT_MAX; point++) {
+        if (_trace_has(trace, point - 1) && _trace_has(trace, point)) {
+            _trace_hist_add(&g_trace_hist[point], _trace_elapsed_us(trace->ts[point - 1], trace->ts[point]));
+        }
+    }
+    if (_trace_has(trace, IOTX_TRACE_WIFI_RX) && _trace_has(trace, IOTX_TRACE_ZIGBEE_SEND)) {
+        _trace_hist_add(&g_trace_hist[TRACE_STAGE_TOTAL],
+                        _trace_elapsed_us(trace->ts[IOTX_TRACE_WIFI_RX], trace->ts[IOTX_TRACE_ZIGBEE_SEND]));
+    }
+
+#ifdef INFRA_TRACE_RING_SIZE
+    memcpy(&g_trace_ring[g_trace_recorded % INFRA_TRACE_RING_SIZE], trace, sizeof(iotx_trace_t));
+#endif
+    g_trace_recorded++;
+}
+
+void iotx_trace_begin(void)
+{
+    _trace_record(&g_trace_current);
+    memset(&g_trace_current, 0, sizeof(iotx_trace_t));
+
+    g_trace_current.id = ++g_trace_next_id;
+    g_trace_current.mask = 1u << IOTX_TRACE_WIFI_RX;
+    g_trace_current.ts[IOTX_TRACE_WIFI_RX] = HAL_Trace_Timestamp();
+#ifndef INFRA_TRACE_RING_SIZE
+    HAL_Trace_Point(g_trace_current.id, IOTX_TRACE_WIFI_RX);
+#endif
+}
+
+void iotx_trace_point(iotx_trace_point_t point)
+{
+    if (g_trace_current.mask == 0 || point >= IOTX_TRACE_POINT_MAX) {
+        return;
+    }
+
+    g_trace_current.ts[point] = HAL_Trace_Timestamp();
+    g_trace_current.mask |= 1u << point;
+#ifndef INFRA_TRACE_RING_SIZE
+    HAL_Trace_Point(g_trace_current.id, point);
+#endif
+}
+
+void iotx_trace_end(iotx_trace_point_t point)
+{
+    if (g_trace_current.mask == 0) {
+        return;
+    }
+
+    iotx_trace_point(point);
+    _trace_record(&g_trace_current);
+    memset(&g_trace_current, 0, sizeof(iotx_trace_t));
+}
+
+void iotx_trace_detach(iotx_trace_t *trace)
+{
+    memcpy(trace, &g_trace_current, sizeof(iotx_trace_t));
+    memset(&g_trace_current, 0, sizeof(iotx_trace_t));
+}
+
+void iotx_trace_attach(const iotx_trace_t *trace)
+{
+    _trace_record(&g_trace_current);
+    memcpy(&g_trace_current, trace, sizeof(iotx_trace_t));
+}
+
+#ifdef INFRA_TRACE_RING_SIZE
+static int _trace_cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void _trace_dump_percentiles(void)
+{
+    uint32_t held = (g_trace_recorded < INFRA_TRACE_RING_SIZE) ? g_trace_recorded : INFRA_TRACE_RING_SIZE;
+    uint32_t idx = 0, num = 0;
+    int stage, from, to;
+
+    HAL_Printf("last %u traces, us:\r\n", (unsigned int)held);
+    HAL_Printf("  %-12s %8s %8s %8s\r\n", "stage", "p50", "p90", "p99");
+    for (stage = 0; stage < IOTX_TRACE_POINT_MAX; stage++) {
+        from = (stage == TRACE_STAGE_TOTAL) ? IOTX_TRACE_WIFI_RX : stage - 1;
+        to = (stage == TRACE_STAGE_TOTAL) ? IOTX_TRACE_ZIGBEE_SEND : stage;
+
+        for (idx = 0, num = 0; idx < held; idx++) {
+            if (_trace_has(&g_trace_ring[idx], from) && _trace_has(&g_trace_ring[idx], to)) {
+                g_trace_sorted[num++] = _trace_elapsed_us(g_trace_ring[idx].ts[from], g_trace_ring[idx].ts[to]);
+            }
+        }
+        if (num == 0) {
+            continue;
+        }
+
+        qsort(g_trace_sorted, num, sizeof(uint32_t), _trace_cmp_u32);
+        HAL_Printf("  %-12s %8u %8u %8u\r\n", g_trace_stage_name[stage],
+                   (unsigned int)g_trace_sorted[num * 50 / 100],
+                   (unsigned int)g_trace_sorted[num * 90 / 100],
+                   (unsigned int)g_trace_sorted[num * 99 / 100]);
+    }
+}
+#endif
+
+void iotx_trace_dump(void)
+{
+    trace_hist_t *hist = NULL;
+    int stage, idx;
+
+    /* read without locking against the yield thread, a sample may be torn */
+    HAL_Printf("%u traces recorded\r\n", (unsigned int)g_trace_recorded);
+    HAL_Printf("  %-12s %8s %8s %8s\r\n", "stage", "count", "avg us", "max us");
+    for (stage = 0; stage < IOTX_TRACE_POINT_MAX; stage++) {
+        hist = &g_trace_hist[stage];
+        HAL_Printf("  %-12s %8u %8u %8u\r\n", g_trace_stage_name[stage], (unsigned int)hist->count,
+                   (unsigned int)(hist->count ? hist->sum_us / hist->count : 0), (unsigned int)hist->max_us);
+    }
+
+    HAL_Printf("histograms, bucket lower bound us:count\r\n");
+    for (stage = 0; stage < IOTX_TRACE_POINT_MAX; stage++) {
+        hist = &g_trace_hist[stage];
+        if (hist->count == 0) {
+            continue;
+        }
+        HAL_Printf("  %-12s", g_trace_stage_name[stage]);
+        for (idx = 0; idx < TRACE_HIST_BUCKETS; idx++) {
+            if (hist->bucket[idx] != 0) {
+                HAL_Printf(" %u:%u", (idx == 0) ? 0u : (1u << idx), (unsigned int)hist->bucket[idx]);
+            }
+        }
+        HAL_Printf("\r\n");
+    }
+
+#ifdef INFRA_TRACE_RING_SIZE
+    _trace_dump_percentiles();
+#endif
+}
+
+void iotx_trace_reset(void)
+{
+    memset(g_trace_hist, 0, sizeof(g_trace_hist));
+    g_trace_recorded = 0;
+}
+#endif
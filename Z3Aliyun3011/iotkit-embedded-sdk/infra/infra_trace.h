@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2015-2018 Alibaba Group Holding Limited
+ */
+
+#ifndef _INFRA_TRACE_H_
+#define _INFRA_TRACE_H_
+
+#include "infra_types.h"
+
+/*
+ * Latency trace of a cloud downstream message, from the network to the
+ * Zigbee command it turns into. Each point stamps the current trace; the
+ * stage ending at point N is the time between point N-1 and point N.
+ *
+ * All points run on the IOT_Linkkit_Yield() thread, so there is a single
+ * current trace. It is detached into the dm_ipc node when the message is
+ * queued and attached again when iotx_dm_dispatch() pops it, so messages
+ * read in one yield keep their own stamps.
+ *
+ * A trace is recorded into the per-stage histograms when it ends, or when
+ * it is replaced by the next one without reaching the end (messages that
+ * are not property sets). On target every point is also sent to SEGGER
+ * SystemView through HAL_Trace_Point(); with INFRA_TRACE_RING_SIZE (host
+ * build) the recorded traces are kept in a ring for percentiles instead.
+ */
+typedef enum {
+    IOTX_TRACE_WIFI_RX,             /* first byte of the packet read from the network */
+    IOTX_TRACE_MQTT_RECV,           /* whole packet in the MQTT read buffer */
+    IOTX_TRACE_MQTT_PUBLISH,        /* PUBLISH deserialized, delivered to the topic handlers */
+    IOTX_TRACE_DM_IPC_INSERT,       /* event queued for the user callbacks */
+    IOTX_TRACE_DM_DISPATCH,         /* event popped by IOT_Linkkit_Yield() */
+    IOTX_TRACE_PROPERTY_PARSED,     /* property set payload parsed by cJSON */
+    IOTX_TRACE_ZIGBEE_SEND,         /* command handed to the device table */
+    IOTX_TRACE_POINT_MAX
+} iotx_trace_point_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t mask;                  /* bit N set when point N is stamped */
+    uint32_t ts[IOTX_TRACE_POINT_MAX];
+} iotx_trace_t;
+
+/* start a new trace at IOTX_TRACE_WIFI_RX */
+void iotx_trace_begin(void);
+
+/* stamp the current trace, ignored when there is none */
+void iotx_trace_point(iotx_trace_point_t point);
+
+/* stamp the current trace and record it */
+void iotx_trace_end(iotx_trace_point_t point);
+
+/* move the current trace out to / back in from a queued message */
+void iotx_trace_detach(iotx_trace_t *trace);
+void iotx_trace_attach(const iotx_trace_t *trace);
+
+/* print the per-stage latency histograms with HAL_Printf() */
+void iotx_trace_dump(void);
+void iotx_trace_reset(void);
+
+#endif  /* _INFRA_TRACE_H_ */
@@ -6,6 +6,9 @@
 #ifdef LOG_REPORT_TO_CLOUD
     #include "iotx_log_report.h"
 #endif
+#ifdef INFRA_TRACE
+    #include "infra_trace.h"
+#endif
 static int _in_yield_cb;
 
 #ifndef PLATFORM_HAS_DYNMEM
@@ -303,10 +306,93 @@ static int _reset_send_buffer(iotx_mc_client_t *c)
 #endif
 }
 
+#ifdef IOTX_MC_RX_POOL
+/*
+ * Receive buffers are taken from a pool shared by the clients and given back
+ * once the packet is handled, so a steady flow of packets allocates nothing.
+ * A PUBLISH handler may hold the packet it is called for, the buffer then
+ * stays out of the pool until the last hold is released, from any task.
+ */
+static iotx_mc_rxbuf_t g_mqtt_rx_pool[IOTX_MC_RX_POOL_SIZE];
+static void *g_mqtt_rx_pool_mutex = NULL;
+static int g_mqtt_rx_pool_misses = 0;
+
+static void _rx_pool_lock(void)
+{
+    if (NULL == g_mqtt_rx_pool_mutex) {
+        g_mqtt_rx_pool_mutex = HAL_MutexCreate();
+    }
+    HAL_MutexLock(g_mqtt_rx_pool_mutex);
+}
+
+static void _rx_pool_unlock(void)
+{
+    HAL_MutexUnlock(g_mqtt_rx_pool_mutex);
+}
+
+/* an idle entry for the reading client, the one with the largest buffer; NULL when all are held */
+static iotx_mc_rxbuf_t *_rx_pool_take(void)
+{
+    int i;
+    iotx_mc_rxbuf_t *rxbuf = NULL;
+
+    _rx_pool_lock();
+    for (i = 0; i < IOTX_MC_RX_POOL_SIZE; i++) {
+        if (g_mqtt_rx_pool[i].refs == 0 && (rxbuf == NULL || g_mqtt_rx_pool[i].size > rxbuf->size)) {
+            rxbuf = &g_mqtt_rx_pool[i];
+        }
+    }
+    if (rxbuf != NULL) {
+        rxbuf->refs = 1;
+    } else {
+        g_mqtt_rx_pool_misses++;
+    }
+    _rx_pool_unlock();
+
+    return rxbuf;
+}
+
+static void _rx_pool_put(iotx_mc_rxbuf_t *rxbuf)
+{
+    _rx_pool_lock();
+    if (--rxbuf->refs == 0 && rxbuf->size > IOTX_MC_RX_POOL_KEEP_LEN) {
+        mqtt_free(rxbuf->buf);
+        rxbuf->buf = NULL;
+        rxbuf->size = 0;
+    }
+    _rx_pool_unlock();
+}
+
+/* free the buffers nobody uses, when a client goes */
+static void _rx_pool_trim(void)
+{
+    int i;
+
+    _rx_pool_lock();
+    for (i = 0; i < IOTX_MC_RX_POOL_SIZE; i++) {
+        if (g_mqtt_rx_pool[i].refs == 0 && g_mqtt_rx_pool[i].buf != NULL) {
+            mqtt_free(g_mqtt_rx_pool[i].buf);
+            g_mqtt_rx_pool[i].buf = NULL;
+            g_mqtt_rx_pool[i].size = 0;
+        }
+    }
+    _rx_pool_unlock();
+}
+#endif
+
 static int _reset_recv_buffer(iotx_mc_client_t *c)
 {
 #ifdef PLATFORM_HAS_DYNMEM
 #if  WITH_MQTT_DYN_BUF
+#ifdef IOTX_MC_RX_POOL
+    if (c != NULL && c->rxbuf != NULL) {
+        _rx_pool_put(c->rxbuf);
+        c->rxbuf = NULL;
+        c->buf_read = NULL;
+        c->buf_size_read = 0;
+        return 0;
+    }
+#endif
     if (c == NULL || c->buf_read == NULL) {
         return FAIL_RETURN;
     }
@@ -370,6 +456,19 @@ static int _alloc_recv_buffer(iotx_mc_client_t *c, int len)
     if (tmp_len > c->buf_size_read_max) {
         tmp_len = c->buf_size_read_max;
     }
+#ifdef IOTX_MC_RX_POOL
+    if (c->buf_read == NULL) {
+        c->rxbuf = _rx_pool_take();
+        if (c->rxbuf != NULL && c->rxbuf->buf != NULL) {
+            c->buf_read = c->rxbuf->buf;
+            c->buf_size_read = c->rxbuf->size;
+        }
+    }
+    /* a pooled buffer is never shrunk */
+    if (c->rxbuf != NULL && c->buf_read != NULL && tmp_len <= c->buf_size_read) {
+        return SUCCESS_RETURN;
+    }
+#endif
     if (c->buf_read != NULL) { /* do realloc */
         char *temp = mqtt_malloc(tmp_len);
         if (temp == NULL) {
@@ -389,6 +488,12 @@ static int _alloc_recv_buffer(iotx_mc_client_t *c, int len)
         memset(c->buf_read, 0, tmp_len);
     }
     c->buf_size_read = tmp_len;
+#ifdef IOTX_MC_RX_POOL
+    if (c->rxbuf != NULL) {
+        c->rxbuf->buf = c->buf_read;
+        c->rxbuf->size = tmp_len;
+    }
+#endif
     return SUCCESS_RETURN;
 #else
     return 0;
@@ -542,6 +647,9 @@ static int iotx_mc_read_packet(iotx_mc_client_t *c, iotx_time_t *timer, unsigned
         HAL_MutexUnlock(c->lock_read_buf);
         return MQTT_NETWORK_ERROR;
     }
+#ifdef INFRA_TRACE
+    iotx_trace_begin();
+#endif
 
     len = 1;
 
@@ -665,6 +773,9 @@ static int iotx_mc_read_packet(iotx_mc_client_t *c, iotx_time_t *timer, unsigned
         c->buf_read[len + rem_len] = '\0';
     }
     HAL_MutexUnlock(c->lock_read_buf);
+#ifdef INFRA_TRACE
+    iotx_trace_point(IOTX_TRACE_MQTT_RECV);
+#endif
     return SUCCESS_RETURN;
 }
 
@@ -823,6 +934,23 @@ static int _mqtt_connect(void *client)
 }
 
 #if !WITH_MQTT_ONLY_QOS0
+/* number of publishes waiting for ack, lock_list_pub held */
+static int iotx_mc_pub_wait_count(iotx_mc_client_t *c)
+{
+#ifdef PLATFORM_HAS_DYNMEM
+    return list_entry_number(&c->list_pub_wait_ack);
+#else
+    int idx, count = 0;
+
+    for (idx = 0; idx < IOTX_MC_PUBWAIT_LIST_MAX_LEN; idx++) {
+        if (c->list_pub_wait_ack[idx].used) {
+            count++;
+        }
+    }
+    return count;
+#endif
+}
+
 static int iotx_mc_push_pubInfo_to(iotx_mc_client_t *c, int len, unsigned short msgId, iotx_mc_pub_info_t **node)
 {
 #ifdef PLATFORM_HAS_DYNMEM
@@ -837,7 +965,11 @@ static int iotx_mc_push_pubInfo_to(iotx_mc_client_t *c, int len, unsigned short
         return FAIL_RETURN;
     }
 
+#ifdef PLATFORM_HAS_DYNMEM
+    if (len < 0) {
+#else
     if ((len < 0) || (len > c->buf_size_send)) {
+#endif
         mqtt_err("the param of len is error!");
 #ifndef PLATFORM_HAS_DYNMEM
         if (len >= c->buf_size_send) {
@@ -867,10 +999,13 @@ static int iotx_mc_push_pubInfo_to(iotx_mc_client_t *c, int len, unsigned short
     iotx_time_start(&repubInfo->pub_start_time);
     repubInfo->buf = (unsigned char *)repubInfo + sizeof(iotx_mc_pub_info_t);
 
-    memcpy(repubInfo->buf, c->buf_send, len);
+    /* buf is filled by the caller while the packet is streamed out */
     INIT_LIST_HEAD(&repubInfo->linked_list);
 
     list_add_tail(&repubInfo->linked_list, &c->list_pub_wait_ack);
+    if (list_number + 1 > c->pub_wait_high_water) {
+        c->pub_wait_high_water = list_number + 1;
+    }
 
     *node = repubInfo;
     return SUCCESS_RETURN;
@@ -881,9 +1016,11 @@ static int iotx_mc_push_pubInfo_to(iotx_mc_client_t *c, int len, unsigned short
             c->list_pub_wait_ack[idx].msg_id = msgId;
             c->list_pub_wait_ack[idx].len = len;
             iotx_time_start(&c->list_pub_wait_ack[idx].pub_start_time);
-            memcpy(c->list_pub_wait_ack[idx].buf, c->buf_send, len);
             c->list_pub_wait_ack[idx].used = 1;
             *node = &c->list_pub_wait_ack[idx];
+            if (iotx_mc_pub_wait_count(c) > c->pub_wait_high_water) {
+                c->pub_wait_high_water = iotx_mc_pub_wait_count(c);
+            }
             return SUCCESS_RETURN;
         }
     }
@@ -1414,6 +1551,13 @@ static int iotx_mc_handle_recv_PUBLISH(iotx_mc_client_t *c)
     topic_msg.ptopic = NULL;
     topic_msg.topic_len = 0;
 
+    /* move the topic back over its length field, so that it ends with a NUL in place */
+    if (topicName.lenstring.len > 0) {
+        memmove(topicName.lenstring.data - 1, topicName.lenstring.data, topicName.lenstring.len);
+        topicName.lenstring.data--;
+        topicName.lenstring.data[topicName.lenstring.len] = '\0';
+    }
+
     mqtt_debug("delivering msg ...");
 
 #if WITH_MQTT_FLOW_CTRL
@@ -1437,6 +1581,9 @@ static int iotx_mc_handle_recv_PUBLISH(iotx_mc_client_t *c)
     }
 #endif
 
+#ifdef INFRA_TRACE
+    iotx_trace_point(IOTX_TRACE_MQTT_PUBLISH);
+#endif
     iotx_mc_deliver_message(c, &topicName, &topic_msg);
 
     if (topic_msg.qos == IOTX_MQTT_QOS0) {
@@ -1474,6 +1621,15 @@ static int iotx_mc_handle_recv_UNSUBACK(iotx_mc_client_t *c)
     return SUCCESS_RETURN;
 }
 
+static void iotx_mc_check_keepalive_probes(iotx_mc_client_t *c)
+{
+    if (IOTX_MC_KEEPALIVE_PROBE_MAX < c->keepalive_probes) {
+        iotx_mc_set_client_state(c, IOTX_MC_STATE_DISCONNECTED);
+        c->keepalive_probes = 0;
+        mqtt_debug("keepalive_probes more than %u, disconnected\n", IOTX_MC_KEEPALIVE_PROBE_MAX);
+    }
+}
+
 static int iotx_mc_cycle(iotx_mc_client_t *c, iotx_time_t *timer)
 {
     unsigned int packetType;
@@ -1490,11 +1646,7 @@ static int iotx_mc_cycle(iotx_mc_client_t *c, iotx_time_t *timer)
         return MQTT_STATE_ERROR;
     }
 
-    if (IOTX_MC_KEEPALIVE_PROBE_MAX < c->keepalive_probes) {
-        iotx_mc_set_client_state(c, IOTX_MC_STATE_DISCONNECTED);
-        c->keepalive_probes = 0;
-        mqtt_debug("keepalive_probes more than %u, disconnected\n", IOTX_MC_KEEPALIVE_PROBE_MAX);
-    }
+    iotx_mc_check_keepalive_probes(c);
 
     /* read the socket, see what work is due */
     rc = iotx_mc_read_packet(c, timer, &packetType);
@@ -2481,12 +2633,99 @@ static int MQTTUnsubscribe(iotx_mc_client_t *c, const char *topicFilter, unsigne
     return SUCCESS_RETURN;
 }
 
-int MQTTPublish(iotx_mc_client_t *c, const char *topicName, iotx_mqtt_topic_info_pt topic_msg)
+/* State of one PUBLISH whose payload is streamed through c->buf_send */
+typedef struct {
+    iotx_mc_client_t   *c;
+    iotx_time_t        *timer;
+    int                 used;       /* bytes pending in c->buf_send */
+    int                 left;       /* payload bytes not written yet */
+    int                 sent;       /* bytes handed to the transport */
+    unsigned char      *keep;       /* republish copy of the packet, QoS1 only */
+    int                 rc;
+} iotx_mc_pub_stream_t;
+
+static int _pub_stream_flush(iotx_mc_pub_stream_t *s, const char *buf, int len)
+{
+    if (len > 0 && s->rc == SUCCESS_RETURN) {
+        s->rc = iotx_mc_send_packet(s->c, (char *)buf, len, s->timer);
+        s->sent += len;
+    }
+
+    return s->rc;
+}
+
+/* iotx_mqtt_payload_write_fpt of MQTTPublish_stream(), coalesces small writes into send buffer sized chunks */
+static int _pub_stream_write(void *stream, const void *data, int len)
+{
+    iotx_mc_pub_stream_t *s = (iotx_mc_pub_stream_t *)stream;
+    const char *ptr = (const char *)data;
+    int room = 0;
+    int size = 0;
+
+    if (s == NULL || len < 0 || (data == NULL && len > 0)) {
+        return FAIL_RETURN;
+    }
+    if (s->rc != SUCCESS_RETURN) {
+        return s->rc;
+    }
+    if (len > s->left) {
+        mqtt_err("payload overflow, len: %d, left: %d", len, s->left);
+        s->rc = MQTT_PUBLISH_PACKET_ERROR;
+        return s->rc;
+    }
+
+#if !WITH_MQTT_ONLY_QOS0
+    if (s->keep != NULL) {
+        memcpy(s->keep, ptr, len);
+        s->keep += len;
+    }
+#endif
+    s->left -= len;
+
+    size = s->c->buf_size_send;
+    if (len >= size) {
+        /* no point in chunking what is already in memory, send it as is */
+        if (_pub_stream_flush(s, s->c->buf_send, s->used) == SUCCESS_RETURN) {
+            s->used = 0;
+            _pub_stream_flush(s, ptr, len);
+        }
+        return (s->rc == SUCCESS_RETURN) ? len : s->rc;
+    }
+
+    while (len > 0) {
+        room = size - s->used;
+        room = (len < room) ? len : room;
+        memcpy(s->c->buf_send + s->used, ptr, room);
+        s->used += room;
+        ptr += room;
+        len -= room;
 
+        if (s->used == size) {
+            if (_pub_stream_flush(s, s->c->buf_send, s->used) != SUCCESS_RETURN) {
+                return s->rc;
+            }
+            s->used = 0;
+        }
+    }
+
+    return (int)(ptr - (const char *)data);
+}
+
+/*
+ * Send a PUBLISH whose payload is either topic_msg->payload or emitted by produce().
+ * Only the header and one chunk of payload ever sit in c->buf_send, the QoS1 republish
+ * copy is the single full copy of the packet.
+ */
+static int MQTTPublish_stream(iotx_mc_client_t *c, const char *topicName, iotx_mqtt_topic_info_pt topic_msg,
+                              iotx_mqtt_payload_produce_fpt produce, void *user_data)
 {
     iotx_time_t         timer;
     MQTTString          topic = MQTTString_initializer;
+    iotx_mc_pub_stream_t stream;
     int                 len = 0;
+    int                 hdr_len = 0;
+    int                 payload_len = 0;
+    int                 rc = SUCCESS_RETURN;
 #if !WITH_MQTT_ONLY_QOS0
     iotx_mc_pub_info_t  *node = NULL;
 #endif
@@ -2499,30 +2738,31 @@ int MQTTPublish(iotx_mc_client_t *c, const char *topicName, iotx_mqtt_topic_info
     }
 
     topic.cstring = (char *)topicName;
+    payload_len = topic_msg->payload_len;
     iotx_time_init(&timer);
     utils_time_countdown_ms(&timer, c->request_timeout_ms);
 
     HAL_MutexLock(c->lock_list_pub);
     HAL_MutexLock(c->lock_write_buf);
 
-    if (_alloc_send_buffer(c, strlen(topicName) + topic_msg->payload_len) < 0) {
+    if (_alloc_send_buffer(c, strlen(topicName) +
+                           (payload_len < IOTX_MC_PUB_CHUNK_LEN ? payload_len : IOTX_MC_PUB_CHUNK_LEN)) < 0) {
         HAL_MutexUnlock(c->lock_write_buf);
         HAL_MutexUnlock(c->lock_list_pub);
         return FAIL_RETURN;
     }
 
-    len = MQTTSerialize_publish((unsigned char *)c->buf_send,
-                                c->buf_size_send,
-                                0,
-                                topic_msg->qos,
-                                topic_msg->retain,
-                                topic_msg->packet_id,
-                                topic,
-                                (unsigned char *)topic_msg->payload,
-                                topic_msg->payload_len);
-    if (len <= 0) {
-        mqtt_err("MQTTSerialize_publish is error, len=%d, buf_size_send=%u, payloadlen=%u",
-                 len,
+    hdr_len = MQTTSerialize_publishHeader((unsigned char *)c->buf_send,
+                                          c->buf_size_send,
+                                          0,
+                                          topic_msg->qos,
+                                          topic_msg->retain,
+                                          topic_msg->packet_id,
+                                          topic,
+                                          payload_len);
+    if (hdr_len <= 0) {
+        mqtt_err("MQTTSerialize_publishHeader is error, len=%d, buf_size_send=%u, payloadlen=%u",
+                 hdr_len,
                  c->buf_size_send,
                  topic_msg->payload_len);
         _reset_send_buffer(c);
@@ -2530,6 +2770,14 @@ int MQTTPublish(iotx_mc_client_t *c, const char *topicName, iotx_mqtt_topic_info
         HAL_MutexUnlock(c->lock_list_pub);
         return MQTT_PUBLISH_PACKET_ERROR;
     }
+    len = hdr_len + payload_len;
+
+    memset(&stream, 0, sizeof(iotx_mc_pub_stream_t));
+    stream.c = c;
+    stream.timer = &timer;
+    stream.used = hdr_len;
+    stream.left = payload_len;
+    stream.rc = SUCCESS_RETURN;
 
 #if !WITH_MQTT_ONLY_QOS0
     node = NULL;
@@ -2543,10 +2791,32 @@ int MQTTPublish(iotx_mc_client_t *c, const char *topicName, iotx_mqtt_topic_info
             HAL_MutexUnlock(c->lock_list_pub);
             return MQTT_PUSH_TO_LIST_ERROR;
         }
+        memcpy(node->buf, c->buf_send, hdr_len);
+        stream.keep = node->buf + hdr_len;
     }
 #endif
     /* send the publish packet */
-    if (iotx_mc_send_packet(c, c->buf_send, len, &timer) != SUCCESS_RETURN) {
+    if (produce != NULL) {
+        if (produce(user_data, _pub_stream_write, &stream) < 0 && stream.rc == SUCCESS_RETURN) {
+            stream.rc = MQTT_PUBLISH_PACKET_ERROR;
+        }
+    } else {
+        _pub_stream_write(&stream, topic_msg->payload, payload_len);
+    }
+    if (stream.rc == SUCCESS_RETURN && stream.left != 0) {
+        mqtt_err("payload underflow, %d bytes missing", stream.left);
+        stream.rc = MQTT_PUBLISH_PACKET_ERROR;
+    }
+    if (stream.rc == SUCCESS_RETURN) {
+        _pub_stream_flush(&stream, c->buf_send, stream.used);
+    }
+
+    rc = stream.rc;
+    if (rc != SUCCESS_RETURN && stream.sent > 0) {
+        /* part of the packet is on the wire already, only a reconnect resyncs the stream */
+        rc = MQTT_NETWORK_ERROR;
+    }
+    if (rc != SUCCESS_RETURN) {
 #if !WITH_MQTT_ONLY_QOS0
         if (topic_msg->qos > IOTX_MQTT_QOS0) {
             /* If not even successfully sent to IP stack, meaningless to wait QOS1 ack, give up waiting */
@@ -2561,15 +2831,17 @@ int MQTTPublish(iotx_mc_client_t *c, const char *topicName, iotx_mqtt_topic_info
         _reset_send_buffer(c);
         HAL_MutexUnlock(c->lock_write_buf);
         HAL_MutexUnlock(c->lock_list_pub);
-        return MQTT_NETWORK_ERROR;
+        return rc;
     }
 
 #ifdef INFRA_LOG_NETWORK_PAYLOAD
     json_payload = (const char *)topic_msg->payload;
 
     mqtt_info("Upstream Topic: '%s'", topicName);
-    mqtt_info("Upstream Payload:");
-    iotx_facility_json_print(json_payload, LOG_INFO_LEVEL, '>');
+    if (json_payload != NULL) {
+        mqtt_info("Upstream Payload:");
+        iotx_facility_json_print(json_payload, LOG_INFO_LEVEL, '>');
+    }
 
 #endif  /* #ifdef INFRA_LOG */
 
@@ -2580,6 +2852,11 @@ int MQTTPublish(iotx_mc_client_t *c, const char *topicName, iotx_mqtt_topic_info
     return SUCCESS_RETURN;
 }
 
+int MQTTPublish(iotx_mc_client_t *c, const char *topicName, iotx_mqtt_topic_info_pt topic_msg)
+{
+    return MQTTPublish_stream(c, topicName, topic_msg, NULL, NULL);
+}
+
 static int MQTTDisconnect(iotx_mc_client_t *c)
 {
     int             rc = FAIL_RETURN;
@@ -2765,6 +3042,10 @@ int wrapper_mqtt_release(void **c)
         mqtt_free(pClient->buf_send);
         pClient->buf_send = NULL;
     }
+#ifdef IOTX_MC_RX_POOL
+    _reset_recv_buffer(pClient);
+    _rx_pool_trim();
+#endif
     if (pClient->buf_read != NULL) {
         mqtt_free(pClient->buf_read);
         pClient->buf_read = NULL;
@@ -2815,6 +3096,156 @@ int wrapper_mqtt_yield(void *client, int timeout_ms)
     return 0;
 }
 
+#if !WITH_MQTT_ONLY_QOS0
+/* ms until the first QoS1 publish waiting for its ack is due for a republish */
+static uint32_t _pub_wait_next_ms(iotx_mc_client_t *pClient)
+{
+    uint32_t next_ms = (uint32_t)-1;
+    uint32_t timeout_ms = pClient->request_timeout_ms * 2;
+    uint32_t spent;
+#ifdef PLATFORM_HAS_DYNMEM
+    iotx_mc_pub_info_t *node = NULL;
+#else
+    int idx;
+#endif
+
+    HAL_MutexLock(pClient->lock_list_pub);
+#ifdef PLATFORM_HAS_DYNMEM
+    list_for_each_entry(node, &pClient->list_pub_wait_ack, linked_list, iotx_mc_pub_info_t) {
+        if (IOTX_MC_NODE_STATE_INVALID == node->node_state) {
+            continue;
+        }
+        spent = utils_time_spend(&node->pub_start_time);
+        if (spent >= timeout_ms) {
+            next_ms = 0;
+            break;
+        }
+        if (timeout_ms - spent < next_ms) {
+            next_ms = timeout_ms - spent;
+        }
+    }
+#else
+    for (idx = 0; idx < IOTX_MC_PUBWAIT_LIST_MAX_LEN; idx++) {
+        if (pClient->list_pub_wait_ack[idx].used == 0
+            || IOTX_MC_NODE_STATE_INVALID == pClient->list_pub_wait_ack[idx].node_state) {
+            continue;
+        }
+        spent = utils_time_spend(&pClient->list_pub_wait_ack[idx].pub_start_time);
+        if (spent >= timeout_ms) {
+            next_ms = 0;
+            break;
+        }
+        if (timeout_ms - spent < next_ms) {
+            next_ms = timeout_ms - spent;
+        }
+    }
+#endif
+    HAL_MutexUnlock(pClient->lock_list_pub);
+
+    return next_ms;
+}
+#endif
+
+int wrapper_mqtt_poll_info(void *client, uintptr_t *handle, uint32_t *next_ms)
+{
+    iotx_mc_client_t *pClient = (iotx_mc_client_t *)client;
+
+    if (pClient == NULL || handle == NULL || next_ms == NULL) {
+        return NULL_VALUE_ERROR;
+    }
+
+    *handle = 0;
+    switch (iotx_mc_get_client_state(pClient)) {
+        case IOTX_MC_STATE_CONNECTED: {
+#ifndef ASYNC_PROTOCOL_STACK
+            *handle = pClient->ipstack.handle;
+#endif
+            *next_ms = iotx_time_left(&pClient->next_ping_time);
+#if !WITH_MQTT_ONLY_QOS0
+            /* the republish of an unacked QoS1 publish is a timer too */
+            {
+                uint32_t pub_ms = _pub_wait_next_ms(pClient);
+
+                if (pub_ms < *next_ms) {
+                    *next_ms = pub_ms;
+                }
+            }
+#endif
+            break;
+        }
+        case IOTX_MC_STATE_DISCONNECTED: {
+            /* the disconnect callback and the reconnect timer are set up in the next process */
+            *next_ms = 0;
+            break;
+        }
+        case IOTX_MC_STATE_DISCONNECTED_RECONNECTING:
+        case IOTX_MC_STATE_CONNECT_BLOCK: {
+            *next_ms = iotx_time_left(&pClient->reconnect_param.reconnect_next_time);
+            break;
+        }
+        default: {
+            /* not connected yet, nothing is due */
+            *next_ms = (uint32_t)-1;
+            break;
+        }
+    }
+
+    return SUCCESS_RETURN;
+}
+
+int wrapper_mqtt_process(void *client)
+{
+    int               rc = SUCCESS_RETURN;
+    int               ready = 0;
+    uintptr_t         handle = 0;
+    iotx_time_t       timer;
+    iotx_mc_client_t *pClient = (iotx_mc_client_t *)client;
+
+    if (pClient == NULL) {
+        return NULL_VALUE_ERROR;
+    }
+
+    HAL_MutexLock(pClient->lock_yield);
+    /* Keep MQTT alive or reconnect if connection abort */
+    iotx_mc_keepalive(pClient);
+    HAL_MutexUnlock(pClient->lock_yield);
+
+#ifndef ASYNC_PROTOCOL_STACK
+    /* read every packet already queued on the socket, without waiting for more */
+    while (iotx_mc_get_client_state(pClient) == IOTX_MC_STATE_CONNECTED) {
+        handle = pClient->ipstack.handle;
+        ready = HAL_Network_Wait(&handle, 1, 0);
+
+        HAL_MutexLock(pClient->lock_yield);
+        if (ready <= 0) {
+            iotx_mc_check_keepalive_probes(pClient);
+            HAL_MutexUnlock(pClient->lock_yield);
+            break;
+        }
+
+        /* the header byte is there, the rest of the packet gets request_timeout_ms */
+        iotx_time_init(&timer);
+        utils_time_countdown_ms(&timer, pClient->request_timeout_ms);
+        rc = iotx_mc_cycle(pClient, &timer);
+        HAL_MutexUnlock(pClient->lock_yield);
+        if (SUCCESS_RETURN != rc) {
+            mqtt_err("error occur rc=%d", rc);
+            break;
+        }
+    }
+#endif
+
+    if (pClient->client_state == IOTX_MC_STATE_CONNECTED) {
+#if !WITH_MQTT_ONLY_QOS0
+        /* check list of wait publish ACK to remove node that is ACKED or timeout */
+        HAL_MutexLock(pClient->lock_yield);
+        MQTTPubInfoProc(pClient);
+        HAL_MutexUnlock(pClient->lock_yield);
+#endif
+    }
+
+    return 0;
+}
 
 /* check MQTT client is in normal state */
 /* 0, in abnormal state; 1, in normal state */
@@ -2831,6 +3262,76 @@ int wrapper_mqtt_check_state(void *client)
     return 0;
 }
 
+int wrapper_mqtt_get_stats(void *client, iotx_mqtt_stats_t *stats)
+{
+    iotx_mc_client_t *pClient = (iotx_mc_client_t *)client;
+
+    if (pClient == NULL || stats == NULL) {
+        return NULL_VALUE_ERROR;
+    }
+
+    memset(stats, 0, sizeof(iotx_mqtt_stats_t));
+#if !WITH_MQTT_ONLY_QOS0
+    HAL_MutexLock(pClient->lock_list_pub);
+    stats->pub_wait = iotx_mc_pub_wait_count(pClient);
+    stats->pub_wait_high_water = pClient->pub_wait_high_water;
+    HAL_MutexUnlock(pClient->lock_list_pub);
+#ifdef PLATFORM_HAS_DYNMEM
+    stats->pub_wait_max = IOTX_MC_REPUB_NUM_MAX;
+#else
+    stats->pub_wait_max = IOTX_MC_PUBWAIT_LIST_MAX_LEN;
+#endif
+#endif
+#ifdef IOTX_MC_RX_POOL
+    {
+        int i;
+
+        _rx_pool_lock();
+        for (i = 0; i < IOTX_MC_RX_POOL_SIZE; i++) {
+            if (g_mqtt_rx_pool[i].refs > 0) {
+                stats->rx_pool_used++;
+            }
+        }
+        stats->rx_pool_misses = g_mqtt_rx_pool_misses;
+        _rx_pool_unlock();
+        stats->rx_pool_size = IOTX_MC_RX_POOL_SIZE;
+    }
+#endif
+
+    return SUCCESS_RETURN;
+}
+
+void *wrapper_mqtt_hold_packet(void *client)
+{
+#ifdef IOTX_MC_RX_POOL
+    iotx_mc_client_t *pClient = (iotx_mc_client_t *)client;
+    iotx_mc_rxbuf_t *rxbuf = NULL;
+
+    /* the packet being delivered, from a handler in the yield task */
+    if (pClient == NULL || !_in_yield_cb || pClient->rxbuf == NULL) {
+        return NULL;
+    }
+
+    rxbuf = pClient->rxbuf;
+    _rx_pool_lock();
+    rxbuf->refs++;
+    _rx_pool_unlock();
+
+    return rxbuf;
+#else
+    return NULL;
+#endif
+}
+
+void wrapper_mqtt_release_packet(void *packet)
+{
+#ifdef IOTX_MC_RX_POOL
+    if (packet != NULL) {
+        _rx_pool_put((iotx_mc_rxbuf_t *)packet);
+    }
+#endif
+}
+
 int wrapper_mqtt_subscribe(void *client,
                            const char *topicFilter,
                            iotx_mqtt_qos_t qos,
@@ -3076,12 +3577,13 @@ int wrapper_mqtt_unsubscribe(void *client, const char *topicFilter)
     return (int)msgId;
 }
 
-int wrapper_mqtt_publish(void *client, const char *topicName, iotx_mqtt_topic_info_pt topic_msg)
+static int _wrapper_mqtt_publish(void *client, const char *topicName, iotx_mqtt_topic_info_pt topic_msg,
+                                 iotx_mqtt_payload_produce_fpt produce, void *user_data)
 {
     uint16_t msg_id = 0;
     int rc = FAIL_RETURN;
     iotx_mc_client_t *c = (iotx_mc_client_t *)client;
-    if (c == NULL || topicName == NULL || topic_msg == NULL || topic_msg->payload == NULL) {
+    if (c == NULL || topicName == NULL || topic_msg == NULL || (topic_msg->payload == NULL && produce == NULL)) {
         return NULL_VALUE_ERROR;
     }
 
@@ -3110,10 +3612,12 @@ int wrapper_mqtt_publish(void *client, const char *topicName, iotx_mqtt_topic_in
 
 #if defined(INSPECT_MQTT_FLOW) && defined(INFRA_LOG)
     HEXDUMP_DEBUG(topicName, strlen(topicName));
-    HEXDUMP_DEBUG(topic_msg->payload, topic_msg->payload_len);
+    if (topic_msg->payload != NULL) {
+        HEXDUMP_DEBUG(topic_msg->payload, topic_msg->payload_len);
+    }
 #endif
 
-    rc = MQTTPublish(c, topicName, topic_msg);
+    rc = MQTTPublish_stream(c, topicName, topic_msg, produce, user_data);
     if (rc != SUCCESS_RETURN) { /* send the subscribe packet */
         if (rc == MQTT_NETWORK_ERROR) {
             iotx_mc_set_client_state(c, IOTX_MC_STATE_DISCONNECTED);
@@ -3125,6 +3629,21 @@ int wrapper_mqtt_publish(void *client, const char *topicName, iotx_mqtt_topic_in
     return (int)msg_id;
 }
 
+int wrapper_mqtt_publish(void *client, const char *topicName, iotx_mqtt_topic_info_pt topic_msg)
+{
+    return _wrapper_mqtt_publish(client, topicName, topic_msg, NULL, NULL);
+}
+
+int wrapper_mqtt_publish_stream(void *client, const char *topicName, iotx_mqtt_topic_info_pt topic_msg,
+                                iotx_mqtt_payload_produce_fpt produce, void *user_data)
+{
+    if (produce == NULL) {
+        return NULL_VALUE_ERROR;
+    }
+
+    return _wrapper_mqtt_publish(client, topicName, topic_msg, produce, user_data);
+}
+
 #ifdef ASYNC_PROTOCOL_STACK
 int wrapper_mqtt_nwk_event_handler(void *client, iotx_mqtt_nwk_event_t event, iotx_mqtt_nwk_param_t *param)
 {
@@ -28,6 +28,10 @@
 
 #define MQTT_DYNBUF_RECV_MARGIN                      (8)
 
+#if defined(PLATFORM_HAS_DYNMEM) && WITH_MQTT_DYN_BUF && (IOTX_MC_RX_POOL_SIZE > 0)
+    #define IOTX_MC_RX_POOL
+#endif
+
 typedef enum {
     IOTX_MC_CONNECTION_ACCEPTED = 0,
     IOTX_MC_CONNECTION_REFUSED_UNACCEPTABLE_PROTOCOL_VERSION = 1,
@@ -86,6 +90,15 @@ typedef struct REPUBLISH_INFO {
 #endif
 } iotx_mc_pub_info_t, *iotx_mc_pub_info_pt;
 #endif
+#ifdef IOTX_MC_RX_POOL
+/* receive buffer of the pool */
+typedef struct {
+    char                       *buf;
+    uint32_t                    size;
+    int                         refs;               /* 0 when idle, the reading client and each hold count one */
+} iotx_mc_rxbuf_t;
+#endif
+
 /* Reconnected parameter of MQTT client */
 typedef struct {
     iotx_time_t         reconnect_next_time;        /* the next time point of reconnect */
@@ -121,6 +134,9 @@ typedef struct Client {
 #ifdef PLATFORM_HAS_DYNMEM
     char                           *buf_send;                                   /* pointer of send buffer */
     char                           *buf_read;                                   /* pointer of read buffer */
+#ifdef IOTX_MC_RX_POOL
+    iotx_mc_rxbuf_t                *rxbuf;                                      /* pool entry of buf_read, NULL if allocated apart */
+#endif
 #else
     char                            buf_send[IOTX_MC_TX_MAX_LEN];
     char                            buf_read[IOTX_MC_RX_MAX_LEN];
@@ -141,6 +157,7 @@ typedef struct Client {
 #else
     iotx_mc_pub_info_t              list_pub_wait_ack[IOTX_MC_PUBWAIT_LIST_MAX_LEN];
 #endif
+    int                             pub_wait_high_water;                        /* most publishes ever waiting for ack */
 #endif
 #ifdef PLATFORM_HAS_DYNMEM
     struct list_head                list_sub_sync_ack;
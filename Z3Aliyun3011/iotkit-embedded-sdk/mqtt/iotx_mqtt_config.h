@@ -29,6 +29,21 @@
     #define WITH_MQTT_ZIP_TOPIC                 (0)
 #endif
 
+/* chunk of a streaming publish payload flushed to the transport at once */
+#ifndef IOTX_MC_PUB_CHUNK_LEN
+    #define IOTX_MC_PUB_CHUNK_LEN               (512)
+#endif
+
+/* receive buffers kept for reuse, the packet of a PUBLISH may be held in one until its message is dispatched */
+#ifndef IOTX_MC_RX_POOL_SIZE
+    #define IOTX_MC_RX_POOL_SIZE                (4)
+#endif
+
+/* an idle pooled receive buffer larger than this is freed rather than kept */
+#ifndef IOTX_MC_RX_POOL_KEEP_LEN
+    #define IOTX_MC_RX_POOL_KEEP_LEN            (512)
+#endif
+
 /* maximum republish elements in list */
 #define IOTX_MC_REPUB_NUM_MAX                   (20)
 
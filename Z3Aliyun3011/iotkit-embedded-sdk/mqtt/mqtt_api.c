@@ -623,6 +623,28 @@ int IOT_MQTT_Yield(void *handle, int timeout_ms)
     return wrapper_mqtt_yield(pClient, timeout_ms);
 }
 
+int IOT_MQTT_PollInfo(void *handle, uintptr_t *net_handle, uint32_t *next_ms)
+{
+    void *pClient = (handle ? handle : g_mqtt_client);
+    if (pClient == NULL) {
+        mqtt_err("handler is null");
+        return NULL_VALUE_ERROR;
+    }
+
+    return wrapper_mqtt_poll_info(pClient, net_handle, next_ms);
+}
+
+int IOT_MQTT_Process(void *handle)
+{
+    void *pClient = (handle ? handle : g_mqtt_client);
+    if (pClient == NULL) {
+        mqtt_err("handler is null");
+        return NULL_VALUE_ERROR;
+    }
+
+    return wrapper_mqtt_process(pClient);
+}
+
 /* check whether MQTT connection is established or not */
 int IOT_MQTT_CheckStateNormal(void *handle)
 {
@@ -635,6 +657,32 @@ int IOT_MQTT_CheckStateNormal(void *handle)
     return wrapper_mqtt_check_state(pClient);
 }
 
+int IOT_MQTT_GetStats(void *handle, iotx_mqtt_stats_t *stats)
+{
+    void *pClient = (handle ? handle : g_mqtt_client);
+    if (pClient == NULL) {
+        mqtt_err("handler is null");
+        return NULL_VALUE_ERROR;
+    }
+
+    return wrapper_mqtt_get_stats(pClient, stats);
+}
+
+void *IOT_MQTT_HoldPacket(void *handle)
+{
+    void *pClient = (handle ? handle : g_mqtt_client);
+    if (pClient == NULL) {
+        return NULL;
+    }
+
+    return wrapper_mqtt_hold_packet(pClient);
+}
+
+void IOT_MQTT_ReleasePacket(void *packet)
+{
+    wrapper_mqtt_release_packet(packet);
+}
+
 int IOT_MQTT_Subscribe(void *handle,
                        const char *topic_filter,
                        iotx_mqtt_qos_t qos,
@@ -768,6 +816,55 @@ int IOT_MQTT_Publish_Simple(void *handle, const char *topic_name, int qos, void
     return rc;
 }
 
+static int _mqtt_payload_measure(void *stream, const void *data, int len)
+{
+    if (len < 0) {
+        return FAIL_RETURN;
+    }
+
+    *(int *)stream += len;
+    return len;
+}
+
+int IOT_MQTT_Publish_Stream(void *handle, const char *topic_name, int qos, int payload_len,
+                            iotx_mqtt_payload_produce_fpt produce, void *user_data)
+{
+    iotx_mqtt_topic_info_t mqtt_msg;
+    void *client = handle ? handle : g_mqtt_client;
+    int rc = -1;
+
+    if (client == NULL || topic_name == NULL || strlen(topic_name) == 0 || produce == NULL) {
+        mqtt_err("params err");
+        return NULL_VALUE_ERROR;
+    }
+
+    /* length unknown, a dry run of the producer measures it */
+    if (payload_len < 0) {
+        payload_len = 0;
+        if (produce(user_data, _mqtt_payload_measure, &payload_len) < 0) {
+            mqtt_err("payload produce failed");
+            return -1;
+        }
+    }
+
+    memset(&mqtt_msg, 0x0, sizeof(iotx_mqtt_topic_info_t));
+
+    mqtt_msg.qos         = qos;
+    mqtt_msg.retain      = 0;
+    mqtt_msg.dup         = 0;
+    mqtt_msg.payload     = NULL;
+    mqtt_msg.payload_len = payload_len;
+
+    rc = wrapper_mqtt_publish_stream(client, topic_name, &mqtt_msg, produce, user_data);
+
+    if (rc < 0) {
+        mqtt_err("IOT_MQTT_Publish_Stream failed\n");
+        return -1;
+    }
+
+    return rc;
+}
+
 int IOT_MQTT_Nwk_Event_Handler(void *handle, iotx_mqtt_nwk_event_t event, iotx_mqtt_nwk_param_t *param)
 {
 #ifdef ASYNC_PROTOCOL_STACK
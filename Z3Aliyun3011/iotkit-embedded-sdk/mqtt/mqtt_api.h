@@ -75,7 +75,7 @@ typedef struct {
     uint8_t         retain;
     uint16_t        topic_len;
     uint32_t        payload_len;
-    const char     *ptopic;
+    const char     *ptopic;         /* of a received message, also ends with a NUL */
     const char     *payload;
 } iotx_mqtt_topic_info_t, *iotx_mqtt_topic_info_pt;
 
@@ -124,6 +124,31 @@ typedef struct {
  */
 typedef void (*iotx_mqtt_event_handle_func_fpt)(void *pcontext, void *pclient, iotx_mqtt_event_msg_pt msg);
 
+/**
+ * @brief It define a datatype of function pointer.
+ *        It appends @len bytes of payload to the PUBLISH packet being sent.
+ *
+ * @param stream : The stream handed to the payload producer.
+ * @param data : The payload bytes.
+ * @param len : The number of payload bytes.
+ *
+ * @return @len on success, otherwise a negative error code and the publish is aborted.
+ */
+typedef int (*iotx_mqtt_payload_write_fpt)(void *stream, const void *data, int len);
+
+/**
+ * @brief It define a datatype of function pointer.
+ *        This type of function emits the payload of a streaming publish through @write.
+ *        It runs with the MQTT send buffer locked, so it must not call back into the MQTT API.
+ *
+ * @param user_data : The user data passed to IOT_MQTT_Publish_Stream().
+ * @param write : The payload writer.
+ * @param stream : The first argument of @write.
+ *
+ * @return 0 on success, negative value to abort the publish.
+ */
+typedef int (*iotx_mqtt_payload_produce_fpt)(void *user_data, iotx_mqtt_payload_write_fpt write, void *stream);
+
 
 /* The structure of MQTT event handle */
 typedef struct {
@@ -216,6 +241,31 @@ int IOT_MQTT_Destroy(void **phandle);
  */
 int IOT_MQTT_Yield(void *handle, int timeout_ms);
 
+/**
+ * @brief Get what the MQTT client waits for, for a caller that multiplexes
+ *        several connections with HAL_Network_Wait() instead of IOT_MQTT_Yield().
+ *
+ * @param [in] handle: specify the MQTT client, NULL for the default one.
+ * @param [out] net_handle: the network handle to wait readable on, 0 when not connected.
+ * @param [out] next_ms: milliseconds until the next keepalive, reconnect or QoS1 republish is due.
+ *
+ * @retval -1 :  Get failed.
+ * @retval  0 :  Get successful.
+ * @see IOT_MQTT_Process.
+ */
+int IOT_MQTT_PollInfo(void *handle, uintptr_t *net_handle, uint32_t *next_ms);
+
+/**
+ * @brief Same work as IOT_MQTT_Yield() without waiting: keepalive or reconnect,
+ *        every packet already received, then the QoS1 republish checks.
+ *
+ * @param [in] handle: specify the MQTT client, NULL for the default one.
+ *
+ * @return status.
+ * @see IOT_MQTT_PollInfo.
+ */
+int IOT_MQTT_Process(void *handle);
+
 /**
  * @brief check whether MQTT connection is established or not.
  *
@@ -320,6 +370,28 @@ int IOT_MQTT_Publish(void *handle, const char *topic_name, iotx_mqtt_topic_info_
  * @see None.
  */
 int IOT_MQTT_Publish_Simple(void *handle, const char *topic_name, int qos, void *data, int len);
+/**
+ * @brief Publish message to specific topic, the payload is produced incrementally.
+ *        The payload goes to the network in chunks of the send buffer, so it is neither
+ *        formatted into a separate buffer first nor limited by the send buffer size.
+ *
+ * @param [in] handle: specify the MQTT client.
+ * @param [in] topic_name: specify the topic name.
+ * @param [in] qos: specify the MQTT Requested QoS.
+ * @param [in] payload_len: specify the payload length, -1 if unknown, then @produce is
+ *             called twice, once to measure the payload and once to send it.
+ * @param [in] produce: specify the payload producer, it must emit the same bytes every call.
+ * @param [in] user_data: specify the first argument of @produce.
+ *
+ * @retval -1 :  Publish failed.
+ * @retval  0 :  Publish successful, where QoS is 0.
+ * @retval >0 :  Publish successful, where QoS is >= 0.
+        The value is a unique ID of this request.
+        The ID will be passed back when callback 'iotx_mqtt_param_t:handle_event'.
+ * @see None.
+ */
+int IOT_MQTT_Publish_Stream(void *handle, const char *topic_name, int qos, int payload_len,
+                            iotx_mqtt_payload_produce_fpt produce, void *user_data);
 /* From mqtt_client.h */
 /** @} */ /* end of api_mqtt */
 
@@ -338,6 +410,49 @@ int IOT_MQTT_Publish_Simple(void *handle, const char *topic_name, int qos, void
  */
 int IOT_MQTT_Nwk_Event_Handler(void *handle, iotx_mqtt_nwk_event_t event, iotx_mqtt_nwk_param_t *param);
 
+typedef struct {
+    int pub_wait;               /* QoS1 publishes waiting for their PUBACK */
+    int pub_wait_high_water;
+    int pub_wait_max;           /* size of the pub-wait list */
+    int rx_pool_used;           /* receive buffers read into or held, of all clients */
+    int rx_pool_size;
+    int rx_pool_misses;         /* packets read into a buffer of their own, the pool being all used */
+} iotx_mqtt_stats_t;
+
+/**
+ * @brief Get the runtime statistics of the MQTT client.
+ *
+ * @param [in] handle: specify the MQTT client, NULL for the default one.
+ * @param [out] stats: the statistics.
+ *
+ * @retval -1 :  Get failed.
+ * @retval  0 :  Get successful.
+ *
+ */
+int IOT_MQTT_GetStats(void *handle, iotx_mqtt_stats_t *stats);
+
+/**
+ * @brief Hold the received packet an IOTX_MQTT_EVENT_PUBLISH_RECEIVED handler is called for,
+ *        so that the topic and payload it was given stay valid after it returns, until
+ *        IOT_MQTT_ReleasePacket(). Each call is one more hold. The packet keeps one of the
+ *        IOTX_MC_RX_POOL_SIZE receive buffers out of use meanwhile.
+ *
+ * @param [in] handle: specify the MQTT client, NULL for the default one.
+ *
+ * @retval NULL :  The packet can not be held, called outside of the handler or not read into the pool.
+ * @retval others :  The held packet.
+ *
+ */
+void *IOT_MQTT_HoldPacket(void *handle);
+
+/**
+ * @brief Release a hold of IOT_MQTT_HoldPacket(), from any task, even after the client is destroyed.
+ *
+ * @param [in] packet: the held packet, NULL is ignored.
+ *
+ */
+void IOT_MQTT_ReleasePacket(void *packet);
+
 /* MQTT Configurations
  *
  * These switches will affect mqtt_api.c and IOT_MQTT_XXX() functions' behaviour
@@ -39,12 +39,16 @@ int HAL_Kv_Get(const char *key, void *val, int *buffer_len);
     int32_t HAL_TCP_Write(uintptr_t fd, const char *buf, uint32_t len, uint32_t timeout_ms);
     int32_t HAL_TCP_Read(uintptr_t fd, char *buf, uint32_t len, uint32_t timeout_ms);
 #endif
+int HAL_Network_Wait(const uintptr_t handles[], int count, uint32_t timeout_ms);
 
 /* mqtt protocol wrapper */
 void *wrapper_mqtt_init(iotx_mqtt_param_t *mqtt_params);
 int wrapper_mqtt_connect(void *client);
 int wrapper_mqtt_yield(void *client, int timeout_ms);
+int wrapper_mqtt_poll_info(void *client, uintptr_t *handle, uint32_t *next_ms);
+int wrapper_mqtt_process(void *client);
 int wrapper_mqtt_check_state(void *client);
+int wrapper_mqtt_get_stats(void *client, iotx_mqtt_stats_t *stats);
 int wrapper_mqtt_subscribe(void *client,
                            const char *topicFilter,
                            iotx_mqtt_qos_t qos,
@@ -58,7 +62,11 @@ int wrapper_mqtt_subscribe_sync(void *client,
                                 int timeout_ms);
 int wrapper_mqtt_unsubscribe(void *client, const char *topicFilter);
 int wrapper_mqtt_publish(void *client, const char *topicName, iotx_mqtt_topic_info_pt topic_msg);
+int wrapper_mqtt_publish_stream(void *client, const char *topicName, iotx_mqtt_topic_info_pt topic_msg,
+                                iotx_mqtt_payload_produce_fpt produce, void *user_data);
 int wrapper_mqtt_release(void **pclient);
+void *wrapper_mqtt_hold_packet(void *client);
+void wrapper_mqtt_release_packet(void *packet);
 int wrapper_mqtt_nwk_event_handler(void *client, iotx_mqtt_nwk_event_t event, iotx_mqtt_nwk_param_t *param);
 
 
@@ -0,0 +1,780 @@
+/*
+ * Copyright (C) 2015-2018 Alibaba Group Holding Limited
+ */
+
+#include "ota_relay_internal.h"
+
+#ifdef OTA_RELAY_ENABLED
+
+static void                      *g_relay_mutex = NULL;
+static void                      *g_relay_sem = NULL;
+static void                      *g_relay_task = NULL;
+static iotx_ota_relay_ready_cb_t  g_relay_ready_cb = NULL;
+static uint32_t                   g_relay_capacity = 0;
+static iotx_ota_relay_state_t     g_relay_state = OTA_RELAY_STATE_IDLE;
+static ota_relay_record_t         g_relay_record;
+static uint32_t                   g_relay_persisted = 0;   /* record.stored last written to the KV store */
+static iotx_ota_relay_image_t     g_relay_image;            /* valid in OTA_RELAY_STATE_READY */
+static uint32_t                   g_relay_generation = 0;
+static ota_relay_page_t           g_relay_pages[OTA_RELAY_PAGE_COUNT];
+static uint32_t                   g_relay_page_clock = 0;
+static iotx_ota_relay_stats_t     g_relay_stats;
+static ota_relay_hash_t           g_relay_hash;
+static uint32_t                   g_relay_chunk = 2 * OTA_RELAY_CHUNK_MIN;
+static uint32_t                   g_relay_rate = 0;         /* bytes/s, averaged over the chunks */
+
+/* download queued for the relay task by IOT_OtaRelay_Start() */
+static char                      *g_relay_job_url = NULL;
+static uint32_t                   g_relay_job_size = 0;
+static char                       g_relay_job_digest[64 + 1];
+
+static uint16_t _relay_get_le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t _relay_get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* 32 hex characters are an MD5, 64 a SHA-256; returns the digest length */
+static int _relay_hex_to_digest(const char *hex, uint8_t digest[32])
+{
+    int i;
+    int len;
+
+    if (hex == NULL || (strlen(hex) != 32 && strlen(hex) != 64)) {
+        return FAIL_RETURN;
+    }
+
+    len = strlen(hex);
+    memset(digest, 0, 32);
+    for (i = 0; i < len; i++) {
+        char    c = hex[i];
+        uint8_t nibble;
+
+        if (c >= '0' && c <= '9') {
+            nibble = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            nibble = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            nibble = c - 'A' + 10;
+        } else {
+            return FAIL_RETURN;
+        }
+
+        if ((i & 1) == 0) {
+            digest[i / 2] = nibble << 4;
+        } else {
+            digest[i / 2] |= nibble;
+        }
+    }
+
+    return len / 2;
+}
+
+static int _relay_parse_header(const uint8_t *data, uint32_t len, iotx_ota_relay_image_t *image)
+{
+    uint32_t pos;
+
+    if (len < OTA_RELAY_HEADER_MIN_LEN || _relay_get_le32(data) != OTA_RELAY_FILE_ID) {
+        return FAIL_RETURN;
+    }
+
+    memset(image, 0, sizeof(iotx_ota_relay_image_t));
+    image->header_version = _relay_get_le16(data + 4);
+    image->header_length = _relay_get_le16(data + 6);
+    image->field_control = _relay_get_le16(data + 8);
+    image->manufacturer_id = _relay_get_le16(data + 10);
+    image->image_type = _relay_get_le16(data + 12);
+    image->file_version = _relay_get_le32(data + 14);
+    image->stack_version = _relay_get_le16(data + 18);
+    memcpy(image->header_string, data + 20, OTA_RELAY_HEADER_STRING_LEN);
+    image->image_size = _relay_get_le32(data + 52);
+
+    if (image->header_length < OTA_RELAY_HEADER_MIN_LEN || image->header_length > len) {
+        return FAIL_RETURN;
+    }
+
+    pos = OTA_RELAY_HEADER_MIN_LEN;
+    if (image->field_control & OTA_RELAY_FC_SECURITY_CREDENTIAL) {
+        image->security_credential_version = data[pos];
+        pos += 1;
+    }
+    if (image->field_control & OTA_RELAY_FC_DEVICE_SPECIFIC) {
+        memcpy(image->destination, data + pos, sizeof(image->destination));
+        pos += sizeof(image->destination);
+    }
+    if (image->field_control & OTA_RELAY_FC_HW_VERSIONS) {
+        image->min_hw_version = _relay_get_le16(data + pos);
+        image->max_hw_version = _relay_get_le16(data + pos + 2);
+        pos += 4;
+    }
+
+    return (pos <= image->header_length) ? SUCCESS_RETURN : FAIL_RETURN;
+}
+
+static void _relay_record_save(void)
+{
+    if (HAL_Kv_Set(OTA_RELAY_KV_KEY, &g_relay_record, sizeof(ota_relay_record_t), 1) != 0) {
+        relay_err("save download state failed");
+    }
+    g_relay_persisted = g_relay_record.stored;
+}
+
+static void _relay_pages_invalidate(void)
+{
+    int i;
+
+    for (i = 0; i < OTA_RELAY_PAGE_COUNT; i++) {
+        g_relay_pages[i].offset = 0xFFFFFFFF;
+        g_relay_pages[i].len = 0;
+    }
+}
+
+/*
+ * with g_relay_mutex held: forget the cached file and erase the cache, so the
+ * next download of any file, the same one included, starts on erased flash
+ */
+static void _relay_record_drop(void)
+{
+    memset(&g_relay_record, 0, sizeof(ota_relay_record_t));
+    g_relay_persisted = 0;
+    g_relay_hash.offset = OTA_RELAY_HASH_NONE;
+    HAL_Kv_Del(OTA_RELAY_KV_KEY);
+    if (HAL_ImageCache_Erase() != 0) {
+        relay_err("erase image cache failed");
+    }
+    _relay_pages_invalidate();
+}
+
+/* with g_relay_mutex held */
+static int _relay_load_image(void)
+{
+    uint8_t header[OTA_RELAY_HEADER_MAX_LEN];
+    uint32_t len = OTA_RELAY_MIN(sizeof(header), g_relay_record.size);
+
+    if (HAL_ImageCache_Read(0, header, len) != 0) {
+        return FAIL_RETURN;
+    }
+    if (_relay_parse_header(header, len, &g_relay_image) != SUCCESS_RETURN
+        || g_relay_image.image_size != g_relay_record.size) {
+        return FAIL_RETURN;
+    }
+
+    _relay_pages_invalidate();
+    g_relay_image.generation = ++g_relay_generation;
+    g_relay_state = OTA_RELAY_STATE_READY;
+
+    return SUCCESS_RETURN;
+}
+
+static void _relay_hash_update(const uint8_t *data, uint32_t len)
+{
+    if (g_relay_hash.sha256) {
+        utils_sha256_update(&g_relay_hash.ctx.sha256, data, len);
+    } else {
+        utils_md5_update(&g_relay_hash.ctx.md5, data, len);
+    }
+    g_relay_hash.offset += len;
+}
+
+/*
+ * Bring the digest up to what the cache holds. Within a boot the digest
+ * follows the download through its retries, only the part stored before a
+ * reboot or by another file is read back.
+ */
+static int _relay_hash_catch_up(void)
+{
+    uint8_t *buf;
+
+    if (g_relay_hash.offset == g_relay_record.stored
+        && g_relay_hash.sha256 == ((g_relay_record.flags & OTA_RELAY_RECORD_SHA256) != 0)) {
+        return SUCCESS_RETURN;
+    }
+
+    g_relay_hash.offset = 0;
+    g_relay_hash.sha256 = ((g_relay_record.flags & OTA_RELAY_RECORD_SHA256) != 0);
+    if (g_relay_hash.sha256) {
+        utils_sha256_init(&g_relay_hash.ctx.sha256);
+        utils_sha256_starts(&g_relay_hash.ctx.sha256);
+    } else {
+        utils_md5_init(&g_relay_hash.ctx.md5);
+        utils_md5_starts(&g_relay_hash.ctx.md5);
+    }
+    if (g_relay_record.stored == 0) {
+        return SUCCESS_RETURN;
+    }
+
+    buf = relay_malloc(OTA_RELAY_PAGE_SIZE);
+    if (buf == NULL) {
+        g_relay_hash.offset = OTA_RELAY_HASH_NONE;
+        return FAIL_RETURN;
+    }
+    while (g_relay_hash.offset < g_relay_record.stored) {
+        uint32_t len = OTA_RELAY_MIN(OTA_RELAY_PAGE_SIZE, g_relay_record.stored - g_relay_hash.offset);
+
+        if (HAL_ImageCache_Read(g_relay_hash.offset, buf, len) != 0) {
+            g_relay_hash.offset = OTA_RELAY_HASH_NONE;
+            relay_free(buf);
+            return FAIL_RETURN;
+        }
+        _relay_hash_update(buf, len);
+    }
+    relay_free(buf);
+
+    return SUCCESS_RETURN;
+}
+
+static int _relay_hash_check(void)
+{
+    uint8_t digest[32];
+    int     len = g_relay_hash.sha256 ? 32 : 16;
+
+    if (g_relay_hash.offset != g_relay_record.size) {
+        return FAIL_RETURN;
+    }
+    if (g_relay_hash.sha256) {
+        utils_sha256_finish(&g_relay_hash.ctx.sha256, digest);
+        utils_sha256_free(&g_relay_hash.ctx.sha256);
+    } else {
+        utils_md5_finish(&g_relay_hash.ctx.md5, digest);
+        utils_md5_free(&g_relay_hash.ctx.md5);
+    }
+    g_relay_hash.offset = OTA_RELAY_HASH_NONE;
+
+    return (memcmp(digest, g_relay_record.digest, len) == 0) ? SUCCESS_RETURN : FAIL_RETURN;
+}
+
+/* size the next chunk to what the link moved lately */
+static void _relay_chunk_adapt(uint32_t bytes, uint32_t elapsed_ms)
+{
+    uint32_t rate;
+    uint32_t chunk;
+
+    if (bytes == 0) {
+        return;
+    }
+    rate = (uint32_t)((uint64_t)bytes * 1000 / (elapsed_ms ? elapsed_ms : 1));
+    g_relay_rate = g_relay_rate ? (3 * g_relay_rate + rate) / 4 : rate;
+
+    chunk = (uint32_t)((uint64_t)g_relay_rate * OTA_RELAY_CHUNK_TARGET_MS / 1000);
+    chunk -= chunk % OTA_RELAY_CHUNK_MIN;
+    if (chunk < OTA_RELAY_CHUNK_MIN) {
+        chunk = OTA_RELAY_CHUNK_MIN;
+    } else if (chunk > OTA_RELAY_CHUNK_MAX) {
+        chunk = OTA_RELAY_CHUNK_MAX;
+    }
+    g_relay_chunk = chunk;
+}
+
+/* write body bytes to the cache, the first *skip of them are dropped */
+static int _relay_store(const uint8_t *data, uint32_t len, uint32_t *skip)
+{
+    if (*skip >= len) {
+        *skip -= len;
+        return SUCCESS_RETURN;
+    }
+    data += *skip;
+    len -= *skip;
+    *skip = 0;
+
+    if (len > g_relay_record.size - g_relay_record.stored) {
+        relay_err("server sent more than the file size");
+        return FAIL_RETURN;
+    }
+    if (HAL_ImageCache_Write(g_relay_record.stored, data, len) != 0) {
+        relay_err("image cache write failed @%u", (unsigned int)g_relay_record.stored);
+        return FAIL_RETURN;
+    }
+    _relay_hash_update(data, len);
+
+    HAL_MutexLock(g_relay_mutex);
+    g_relay_record.stored += len;
+    g_relay_stats.fetch_bytes += len;
+    HAL_MutexUnlock(g_relay_mutex);
+
+    if (g_relay_record.stored - g_relay_persisted >= OTA_RELAY_PERSIST_INTERVAL) {
+        _relay_record_save();
+    }
+
+    return SUCCESS_RETURN;
+}
+
+/* one GET of the rest of the file, from g_relay_record.stored on */
+static int _relay_fetch_range(const char *url)
+{
+    int               res = 0;
+    int               port = HTTP_PORT;
+    const char       *ca_crt = NULL;
+    uint32_t          offset = g_relay_record.stored;
+    uint32_t          skip = 0;
+    int               consumed = 0;
+    uint64_t          round_start;
+    char              range[40];
+    char             *buf = NULL;
+    httpclient_t      client;
+    httpclient_data_t client_data;
+
+    /* httpc keeps the last byte of the buffer for a '\0' */
+    buf = relay_malloc(OTA_RELAY_CHUNK_MAX + 1);
+    if (buf == NULL) {
+        return FAIL_RETURN;
+    }
+
+    memset(&client, 0, sizeof(httpclient_t));
+    memset(&client_data, 0, sizeof(httpclient_data_t));
+    client_data.response_buf = buf;
+    client_data.response_buf_len = g_relay_chunk + 1;
+
+    if (strncmp(url, "https://", 8) == 0) {
+#ifdef SUPPORT_TLS
+        extern const char *iotx_ca_crt;
+        ca_crt = iotx_ca_crt;
+#endif
+        port = HTTPS_PORT;
+    }
+
+    if (offset > 0) {
+        HAL_Snprintf(range, sizeof(range), "Range: bytes=%u-\r\n", (unsigned int)offset);
+        client.header = range;
+    }
+
+    HAL_MutexLock(g_relay_mutex);
+    g_relay_stats.resumes += (offset > 0) ? 1 : 0;
+    g_relay_stats.fetch_requests++;
+    HAL_MutexUnlock(g_relay_mutex);
+
+    relay_debug("GET @%u, chunk %u, %u bytes/s", (unsigned int)offset, (unsigned int)g_relay_chunk,
+                (unsigned int)g_relay_rate);
+    res = httpclient_common(&client, url, port, ca_crt, HTTPCLIENT_GET, OTA_RELAY_FETCH_TIMEOUT_MS, &client_data);
+    if (res < 0) {
+        relay_err("request failed: %d", res);
+        relay_free(buf);
+        return FAIL_RETURN;
+    }
+
+    /* a server that ignores the range sends the whole file again */
+    if (client.response_code == 206 && (uint32_t)client_data.response_content_len == g_relay_record.size - offset) {
+        skip = 0;
+    } else if (client.response_code == 200 && (uint32_t)client_data.response_content_len == g_relay_record.size) {
+        skip = offset;
+    } else {
+        relay_err("unexpected response %d, %d bytes", client.response_code, client_data.response_content_len);
+        httpclient_close(&client);
+        relay_free(buf);
+        return FAIL_RETURN;
+    }
+
+    while (1) {
+        /* httpc reports progress by what is left to retrieve */
+        int got = client_data.response_content_len - client_data.retrieve_len - consumed;
+
+        if (got > 0) {
+            if (_relay_store((uint8_t *)buf, got, &skip) != SUCCESS_RETURN) {
+                res = FAIL_RETURN;
+                break;
+            }
+            consumed += got;
+        }
+
+        if (!client_data.is_more) {
+            break;
+        }
+
+        client_data.response_buf_len = g_relay_chunk + 1;
+        round_start = HAL_UptimeMs();
+        res = httpclient_recv_response(&client, OTA_RELAY_FETCH_TIMEOUT_MS, &client_data);
+        if (res < 0) {
+            relay_err("receive failed: %d @%u", res, (unsigned int)g_relay_record.stored);
+            /* the link is having trouble, risk less of it on the next try */
+            g_relay_chunk = OTA_RELAY_CHUNK_MIN;
+            break;
+        }
+        _relay_chunk_adapt(client_data.response_content_len - client_data.retrieve_len - consumed,
+                           (uint32_t)(HAL_UptimeMs() - round_start));
+    }
+
+    httpclient_close(&client);
+    relay_free(buf);
+
+    return (res < 0) ? FAIL_RETURN : SUCCESS_RETURN;
+}
+
+int IOT_OtaRelay_Init(iotx_ota_relay_ready_cb_t ready_cb)
+{
+    int len = sizeof(ota_relay_record_t);
+
+    if (g_relay_mutex != NULL) {
+        return SUCCESS_RETURN;
+    }
+
+    g_relay_mutex = HAL_MutexCreate();
+    if (g_relay_mutex == NULL) {
+        return FAIL_RETURN;
+    }
+
+    if (HAL_ImageCache_Open(&g_relay_capacity) != 0) {
+        relay_err("no image cache");
+        HAL_MutexDestroy(g_relay_mutex);
+        g_relay_mutex = NULL;
+        return FAIL_RETURN;
+    }
+
+    g_relay_ready_cb = ready_cb;
+    g_relay_state = OTA_RELAY_STATE_IDLE;
+    g_relay_hash.offset = OTA_RELAY_HASH_NONE;
+    _relay_pages_invalidate();
+
+    memset(&g_relay_record, 0, sizeof(ota_relay_record_t));
+    if (HAL_Kv_Get(OTA_RELAY_KV_KEY, &g_relay_record, &len) != 0
+        || len != sizeof(ota_relay_record_t)
+        || g_relay_record.magic != OTA_RELAY_RECORD_MAGIC
+        || g_relay_record.stored > g_relay_record.size
+        || g_relay_record.size > g_relay_capacity) {
+        memset(&g_relay_record, 0, sizeof(ota_relay_record_t));
+    }
+    g_relay_persisted = g_relay_record.stored;
+
+    HAL_MutexLock(g_relay_mutex);
+    if (g_relay_record.flags & OTA_RELAY_RECORD_READY) {
+        if (_relay_load_image() != SUCCESS_RETURN) {
+            relay_err("cached image is unreadable");
+            _relay_record_drop();
+        }
+    } else if (g_relay_record.stored > 0) {
+        /* a download was cut off, kept for when the same file is asked for again */
+        g_relay_state = OTA_RELAY_STATE_FAILED;
+    }
+    HAL_MutexUnlock(g_relay_mutex);
+
+    relay_info("image cache %u bytes, %u/%u cached", (unsigned int)g_relay_capacity,
+               (unsigned int)g_relay_record.stored, (unsigned int)g_relay_record.size);
+
+    return SUCCESS_RETURN;
+}
+
+int IOT_OtaRelay_Fetch(const char *url, uint32_t size, const char *digest_hex)
+{
+    uint8_t  digest[32];
+    uint32_t flags;
+    int      retry = 0;
+
+    if (g_relay_mutex == NULL || url == NULL || size < OTA_RELAY_HEADER_MIN_LEN) {
+        return FAIL_RETURN;
+    }
+    switch (_relay_hex_to_digest(digest_hex, digest)) {
+        case 16:
+            flags = 0;
+            break;
+        case 32:
+            flags = OTA_RELAY_RECORD_SHA256;
+            break;
+        default:
+            return FAIL_RETURN;
+    }
+    if (size > g_relay_capacity) {
+        relay_err("image of %u bytes does not fit the cache", (unsigned int)size);
+        return FAIL_RETURN;
+    }
+
+    HAL_MutexLock(g_relay_mutex);
+    if (g_relay_state == OTA_RELAY_STATE_FETCHING) {
+        HAL_MutexUnlock(g_relay_mutex);
+        return FAIL_RETURN;
+    }
+
+    if (g_relay_record.magic == OTA_RELAY_RECORD_MAGIC && g_relay_record.size == size
+        && (g_relay_record.flags & OTA_RELAY_RECORD_SHA256) == flags
+        && memcmp(g_relay_record.digest, digest, sizeof(digest)) == 0) {
+        if (g_relay_state == OTA_RELAY_STATE_READY) {
+            HAL_MutexUnlock(g_relay_mutex);
+            return SUCCESS_RETURN;
+        }
+        relay_info("resume download @%u", (unsigned int)g_relay_record.stored);
+    } else {
+        /* another file: it replaces the cached one, the nodes still downloading it are aborted */
+        if (HAL_ImageCache_Erase() != 0) {
+            HAL_MutexUnlock(g_relay_mutex);
+            return FAIL_RETURN;
+        }
+        memset(&g_relay_record, 0, sizeof(ota_relay_record_t));
+        g_relay_record.magic = OTA_RELAY_RECORD_MAGIC;
+        g_relay_record.flags = flags;
+        g_relay_record.size = size;
+        memcpy(g_relay_record.digest, digest, sizeof(digest));
+        _relay_record_save();
+    }
+    _relay_pages_invalidate();
+    g_relay_state = OTA_RELAY_STATE_FETCHING;
+    HAL_MutexUnlock(g_relay_mutex);
+
+    if (_relay_hash_catch_up() != SUCCESS_RETURN) {
+        relay_err("cached part is unreadable");
+        HAL_MutexLock(g_relay_mutex);
+        g_relay_state = OTA_RELAY_STATE_FAILED;
+        HAL_MutexUnlock(g_relay_mutex);
+        return FAIL_RETURN;
+    }
+
+    while (g_relay_record.stored < size) {
+        if (_relay_fetch_range(url) == SUCCESS_RETURN && g_relay_record.stored == size) {
+            break;
+        }
+        if (++retry > OTA_RELAY_FETCH_RETRIES) {
+            break;
+        }
+        HAL_SleepMs(OTA_RELAY_FETCH_RETRY_DELAY_MS);
+    }
+    _relay_record_save();
+
+    if (g_relay_record.stored < size) {
+        relay_err("download stopped @%u/%u", (unsigned int)g_relay_record.stored, (unsigned int)size);
+        HAL_MutexLock(g_relay_mutex);
+        g_relay_state = OTA_RELAY_STATE_FAILED;
+        HAL_MutexUnlock(g_relay_mutex);
+        return FAIL_RETURN;
+    }
+
+    if (_relay_hash_check() != SUCCESS_RETURN) {
+        relay_err("digest mismatch, image dropped");
+        HAL_MutexLock(g_relay_mutex);
+        g_relay_stats.verify_failures++;
+        _relay_record_drop();
+        g_relay_state = OTA_RELAY_STATE_FAILED;
+        HAL_MutexUnlock(g_relay_mutex);
+        return FAIL_RETURN;
+    }
+
+    HAL_MutexLock(g_relay_mutex);
+    g_relay_record.flags |= OTA_RELAY_RECORD_READY;
+    _relay_record_save();
+    if (_relay_load_image() != SUCCESS_RETURN) {
+        relay_err("not a Zigbee OTA file");
+        _relay_record_drop();
+        g_relay_state = OTA_RELAY_STATE_FAILED;
+        HAL_MutexUnlock(g_relay_mutex);
+        return FAIL_RETURN;
+    }
+    HAL_MutexUnlock(g_relay_mutex);
+
+    relay_info("image 0x%04x/0x%04x v0x%08x ready", g_relay_image.manufacturer_id, g_relay_image.image_type,
+               (unsigned int)g_relay_image.file_version);
+    if (g_relay_ready_cb != NULL) {
+        g_relay_ready_cb();
+    }
+
+    return SUCCESS_RETURN;
+}
+
+static void *_relay_task(void *arg)
+{
+    while (1) {
+        char     *url;
+        uint32_t  size;
+        char      digest[sizeof(g_relay_job_digest)];
+
+        HAL_SemaphoreWait(g_relay_sem, PLATFORM_WAIT_INFINITE);
+
+        HAL_MutexLock(g_relay_mutex);
+        url = g_relay_job_url;
+        size = g_relay_job_size;
+        memcpy(digest, g_relay_job_digest, sizeof(digest));
+        g_relay_job_url = NULL;
+        HAL_MutexUnlock(g_relay_mutex);
+
+        if (url != NULL) {
+            IOT_OtaRelay_Fetch(url, size, digest);
+            relay_free(url);
+        }
+    }
+
+    return NULL;
+}
+
+int IOT_OtaRelay_Start(const char *url, uint32_t size, const char *digest)
+{
+    hal_os_thread_param_t param;
+    int                   stack_used = 0;
+    int                   url_len;
+    char                 *job_url;
+
+    if (g_relay_mutex == NULL || url == NULL || digest == NULL
+        || (strlen(digest) != 32 && strlen(digest) != 64)) {
+        return FAIL_RETURN;
+    }
+    url_len = strlen(url);
+    if (url_len >= OTA_RELAY_URL_MAXLEN) {
+        return FAIL_RETURN;
+    }
+
+    if (g_relay_task == NULL) {
+        g_relay_sem = HAL_SemaphoreCreate();
+        if (g_relay_sem == NULL) {
+            return FAIL_RETURN;
+        }
+
+        memset(&param, 0, sizeof(param));
+        param.priority = 8;     /* with the dlog drain, below the timer and wifi tasks */
+        param.stack_size = 4096;
+        param.detach_state = 1;
+        param.name = "ota_relay";
+        if (HAL_ThreadCreate(&g_relay_task, _relay_task, NULL, &param, &stack_used) != 0) {
+            HAL_SemaphoreDestroy(g_relay_sem);
+            g_relay_sem = NULL;
+            g_relay_task = NULL;
+            return FAIL_RETURN;
+        }
+    }
+
+    job_url = relay_malloc(url_len + 1);
+    if (job_url == NULL) {
+        return FAIL_RETURN;
+    }
+    memcpy(job_url, url, url_len + 1);
+
+    HAL_MutexLock(g_relay_mutex);
+    if (g_relay_job_url != NULL || g_relay_state == OTA_RELAY_STATE_FETCHING) {
+        HAL_MutexUnlock(g_relay_mutex);
+        relay_free(job_url);
+        return FAIL_RETURN;
+    }
+    g_relay_job_url = job_url;
+    g_relay_job_size = size;
+    memcpy(g_relay_job_digest, digest, strlen(digest) + 1);
+    HAL_MutexUnlock(g_relay_mutex);
+
+    HAL_SemaphorePost(g_relay_sem);
+
+    return SUCCESS_RETURN;
+}
+
+int IOT_OtaRelay_GetImage(iotx_ota_relay_image_t *image)
+{
+    int res = FAIL_RETURN;
+
+    if (g_relay_mutex == NULL || image == NULL) {
+        return FAIL_RETURN;
+    }
+
+    HAL_MutexLock(g_relay_mutex);
+    if (g_relay_state == OTA_RELAY_STATE_READY) {
+        memcpy(image, &g_relay_image, sizeof(iotx_ota_relay_image_t));
+        res = SUCCESS_RETURN;
+    }
+    HAL_MutexUnlock(g_relay_mutex);
+
+    return res;
+}
+
+/* with g_relay_mutex held */
+static ota_relay_page_t *_relay_page_get(uint32_t page_offset)
+{
+    ota_relay_page_t *page = &g_relay_pages[0];
+    int               i;
+
+    g_relay_page_clock++;
+    for (i = 0; i < OTA_RELAY_PAGE_COUNT; i++) {
+        if (g_relay_pages[i].offset == page_offset) {
+            g_relay_pages[i].last_use = g_relay_page_clock;
+            g_relay_stats.page_hits++;
+            return &g_relay_pages[i];
+        }
+        if (g_relay_pages[i].last_use < page->last_use) {
+            page = &g_relay_pages[i];
+        }
+    }
+
+    g_relay_stats.page_misses++;
+    page->offset = 0xFFFFFFFF;
+    page->len = OTA_RELAY_MIN(OTA_RELAY_PAGE_SIZE, g_relay_image.image_size - page_offset);
+    if (HAL_ImageCache_Read(page_offset, page->data, page->len) != 0) {
+        return NULL;
+    }
+    page->offset = page_offset;
+    page->last_use = g_relay_page_clock;
+
+    return page;
+}
+
+int IOT_OtaRelay_Read(uint32_t generation, uint32_t offset, uint8_t *buf, uint32_t len)
+{
+    uint32_t done = 0;
+
+    if (g_relay_mutex == NULL || buf == NULL) {
+        return FAIL_RETURN;
+    }
+
+    HAL_MutexLock(g_relay_mutex);
+    if (g_relay_state != OTA_RELAY_STATE_READY || generation != g_relay_image.generation) {
+        HAL_MutexUnlock(g_relay_mutex);
+        return FAIL_RETURN;
+    }
+
+    if (offset < g_relay_image.image_size) {
+        len = OTA_RELAY_MIN(len, g_relay_image.image_size - offset);
+    } else {
+        len = 0;
+    }
+
+    /* blocks of nodes downloading side by side mostly fall in the same pages */
+    while (done < len) {
+        uint32_t          page_offset = (offset + done) - (offset + done) % OTA_RELAY_PAGE_SIZE;
+        uint32_t          in_page = (offset + done) - page_offset;
+        uint32_t          chunk;
+        ota_relay_page_t *page = _relay_page_get(page_offset);
+
+        if (page == NULL) {
+            HAL_MutexUnlock(g_relay_mutex);
+            return FAIL_RETURN;
+        }
+        chunk = OTA_RELAY_MIN(len - done, page->len - in_page);
+        memcpy(buf + done, page->data + in_page, chunk);
+        done += chunk;
+    }
+
+    g_relay_stats.reads++;
+    g_relay_stats.read_bytes += done;
+    HAL_MutexUnlock(g_relay_mutex);
+
+    return (int)done;
+}
+
+int IOT_OtaRelay_Clear(void)
+{
+    if (g_relay_mutex == NULL) {
+        return FAIL_RETURN;
+    }
+
+    HAL_MutexLock(g_relay_mutex);
+    if (g_relay_state == OTA_RELAY_STATE_FETCHING) {
+        HAL_MutexUnlock(g_relay_mutex);
+        return FAIL_RETURN;
+    }
+    _relay_record_drop();
+    g_relay_generation++;
+    g_relay_state = OTA_RELAY_STATE_IDLE;
+    HAL_MutexUnlock(g_relay_mutex);
+
+    return SUCCESS_RETURN;
+}
+
+void IOT_OtaRelay_GetStats(iotx_ota_relay_stats_t *stats)
+{
+    if (g_relay_mutex == NULL) {
+        memset(stats, 0, sizeof(iotx_ota_relay_stats_t));
+        return;
+    }
+
+    HAL_MutexLock(g_relay_mutex);
+    memcpy(stats, &g_relay_stats, sizeof(iotx_ota_relay_stats_t));
+    stats->state = g_relay_state;
+    stats->size = g_relay_record.size;
+    stats->stored = g_relay_record.stored;
+    stats->fetch_rate = g_relay_rate;
+    stats->chunk_size = g_relay_chunk;
+    HAL_MutexUnlock(g_relay_mutex);
+}
+
+#endif  /* OTA_RELAY_ENABLED */
@@ -0,0 +1,129 @@
+#ifndef __OTA_RELAY_API_H__
+#define __OTA_RELAY_API_H__
+
+#include "infra_types.h"
+#include "infra_defs.h"
+
+/*
+ * Sub-device OTA relay. The gateway downloads a Zigbee OTA upgrade file
+ * once into an image cache (external flash on target, a file on the host)
+ * and the Zigbee OTA server reads the blocks it sends to the nodes out of
+ * that cache, so any number of nodes upgrade from a single download.
+ *
+ * The download is streamed into the cache and its progress is kept in the
+ * KV store: a download that was cut off, even by a reboot, resumes with a
+ * range request from the last recorded offset when the same file (same
+ * size and digest) is requested again. The digest, MD5 or SHA-256, is
+ * computed as the blocks are written, so a finished download is verified
+ * without reading the image back. Each read off the link is sized to what
+ * the link moved lately.
+ */
+
+#define OTA_RELAY_HEADER_STRING_LEN     (32)
+
+/* field control bits of the header, for the optional fields present */
+#define OTA_RELAY_FC_SECURITY_CREDENTIAL    (0x0001)
+#define OTA_RELAY_FC_DEVICE_SPECIFIC        (0x0002)
+#define OTA_RELAY_FC_HW_VERSIONS            (0x0004)
+
+typedef enum {
+    OTA_RELAY_STATE_IDLE,       /* no image in the cache */
+    OTA_RELAY_STATE_FETCHING,
+    OTA_RELAY_STATE_READY,      /* a complete, verified image is in the cache */
+    OTA_RELAY_STATE_FAILED      /* the last download gave up, what it got is kept for a retry */
+} iotx_ota_relay_state_t;
+
+/* fields of the Zigbee OTA file header of the cached image */
+typedef struct {
+    uint16_t header_version;
+    uint16_t header_length;
+    uint16_t field_control;
+    uint16_t manufacturer_id;
+    uint16_t image_type;
+    uint32_t file_version;
+    uint16_t stack_version;
+    char     header_string[OTA_RELAY_HEADER_STRING_LEN + 1];
+    uint32_t image_size;        /* the whole file, header included */
+    uint8_t  security_credential_version;
+    uint8_t  destination[8];
+    uint16_t min_hw_version;
+    uint16_t max_hw_version;
+    uint32_t generation;        /* changes whenever another image becomes ready */
+} iotx_ota_relay_image_t;
+
+typedef struct {
+    iotx_ota_relay_state_t state;
+    uint32_t size;              /* of the file being fetched or cached */
+    uint32_t stored;            /* bytes of it in the cache */
+    uint32_t fetch_bytes;       /* downloaded since boot */
+    uint32_t fetch_requests;    /* HTTP requests, one per attempt */
+    uint32_t resumes;           /* requests that started past offset 0 */
+    uint32_t verify_failures;
+    uint32_t fetch_rate;        /* bytes/s, averaged over the last reads */
+    uint32_t chunk_size;        /* bytes asked for per read */
+    uint32_t reads;
+    uint32_t read_bytes;
+    uint32_t page_hits;
+    uint32_t page_misses;
+} iotx_ota_relay_stats_t;
+
+/* called from the download task when an image becomes ready */
+typedef void (*iotx_ota_relay_ready_cb_t)(void);
+
+/**
+ * @brief   open the image cache and restore the state of the last download.
+ *
+ * @retval  -1 : failure
+ * @retval  0 : sucess
+ */
+int IOT_OtaRelay_Init(iotx_ota_relay_ready_cb_t ready_cb);
+
+/**
+ * @brief   download an OTA file into the cache, in the calling task.
+ *
+ * @param url. http or https URL of the file.
+ * @param size. size of the file.
+ * @param digest. MD5 of the file as 32 hex characters, or its SHA-256 as 64.
+ *
+ * @retval  -1 : failure, the part downloaded is kept and a later call for the same file resumes from it
+ * @retval  0 : the file is in the cache, either downloaded or already there
+ */
+int IOT_OtaRelay_Fetch(const char *url, uint32_t size, const char *digest);
+
+/**
+ * @brief   same as IOT_OtaRelay_Fetch() but in the relay task, returns at once.
+ *
+ * @retval  -1 : failure, a download is already running or the parameters are invalid
+ * @retval  0 : the download is queued
+ */
+int IOT_OtaRelay_Start(const char *url, uint32_t size, const char *digest);
+
+/**
+ * @brief   get the header of the cached image.
+ *
+ * @retval  -1 : no complete image in the cache
+ * @retval  0 : sucess
+ */
+int IOT_OtaRelay_GetImage(iotx_ota_relay_image_t *image);
+
+/**
+ * @brief   read the cached image.
+ *
+ * @param generation. generation of the image the caller expects, from IOT_OtaRelay_GetImage().
+ *
+ * @retval  -1 : failure, no image or another generation
+ * @retval  >= 0 : bytes read, short at the end of the image
+ */
+int IOT_OtaRelay_Read(uint32_t generation, uint32_t offset, uint8_t *buf, uint32_t len);
+
+/**
+ * @brief   drop the cached image and the download state.
+ *
+ * @retval  -1 : failure, a download is running
+ * @retval  0 : sucess
+ */
+int IOT_OtaRelay_Clear(void);
+
+void IOT_OtaRelay_GetStats(iotx_ota_relay_stats_t *stats);
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef _OTA_RELAY_INTERNAL_H_
+#define _OTA_RELAY_INTERNAL_H_
+
+#include <stdio.h>
+#include <string.h>
+#include "infra_config.h"
+#include "infra_types.h"
+#include "infra_defs.h"
+#include "infra_httpc.h"
+#include "infra_md5.h"
+#include "infra_sha256.h"
+#include "ota_relay_wrapper.h"
+#include "ota_relay_api.h"
+
+#ifdef INFRA_LOG
+#include "infra_log.h"
+#define relay_err(...)                log_err("relay", __VA_ARGS__)
+#define relay_info(...)               log_info("relay", __VA_ARGS__)
+#define relay_debug(...)              log_debug("relay", __VA_ARGS__)
+#else
+#define relay_info(...)               do{HAL_Printf(__VA_ARGS__);HAL_Printf("\r\n");}while(0)
+#define relay_err(...)                do{HAL_Printf(__VA_ARGS__);HAL_Printf("\r\n");}while(0)
+#define relay_debug(...)              do{HAL_Printf(__VA_ARGS__);HAL_Printf("\r\n");}while(0)
+#endif
+
+#define OTA_RELAY_MIN(x, y)           (((x) < (y)) ? (x) : (y))
+
+#define relay_malloc(size)            HAL_Malloc(size)
+#define relay_free(ptr)               {HAL_Free((void *)ptr);ptr = NULL;}
+
+/* Zigbee OTA upgrade file header, little endian */
+#define OTA_RELAY_FILE_ID                   (0x0BEEF11E)
+#define OTA_RELAY_HEADER_MIN_LEN            (56)
+#define OTA_RELAY_HEADER_MAX_LEN            (69)
+
+/* blocks of the cached image kept in RAM, shared by all the nodes downloading it */
+#ifndef OTA_RELAY_PAGE_SIZE
+    #define OTA_RELAY_PAGE_SIZE             (512)
+#endif
+#ifndef OTA_RELAY_PAGE_COUNT
+    #define OTA_RELAY_PAGE_COUNT            (4)
+#endif
+
+#define OTA_RELAY_KV_KEY                    "ota_relay"
+#define OTA_RELAY_RECORD_MAGIC              (0x4F524C32)    /* "ORL2" */
+#define OTA_RELAY_RECORD_READY              (0x00000001)
+#define OTA_RELAY_RECORD_SHA256             (0x00000002)    /* digest is a SHA-256, else an MD5 */
+/* the download offset is written to the KV store every this many bytes */
+#define OTA_RELAY_PERSIST_INTERVAL          (16 * 1024)
+#define OTA_RELAY_FETCH_RETRIES             (5)
+#define OTA_RELAY_FETCH_RETRY_DELAY_MS      (3000)
+#define OTA_RELAY_FETCH_TIMEOUT_MS          (10000)
+/*
+ * The body is taken from httpc and written to the cache a chunk at a time.
+ * What a cut connection leaves in the chunk is lost, so the chunk is sized
+ * to what the link moves in OTA_RELAY_CHUNK_TARGET_MS: small on a slow or
+ * flaky link, large for fewer and longer flash writes on a good one.
+ */
+#define OTA_RELAY_CHUNK_MIN                 (512)
+#define OTA_RELAY_CHUNK_MAX                 (4096)
+#define OTA_RELAY_CHUNK_TARGET_MS           (1000)
+#define OTA_RELAY_URL_MAXLEN                (512)
+
+/* state of the download kept in the KV store, 64 bytes at most on target */
+typedef struct {
+    uint32_t magic;
+    uint32_t flags;
+    uint32_t size;
+    uint32_t stored;
+    uint8_t  digest[32];        /* an MD5 takes the first 16 bytes */
+} ota_relay_record_t;
+
+/* digest of the image computed as it is stored, so no read-back pass is needed */
+#define OTA_RELAY_HASH_NONE                 (0xFFFFFFFF)
+typedef struct {
+    uint32_t offset;            /* bytes of the image hashed, OTA_RELAY_HASH_NONE when not started */
+    int      sha256;
+    union {
+        iot_md5_context    md5;
+        iot_sha256_context sha256;
+    } ctx;
+} ota_relay_hash_t;
+
+typedef struct {
+    uint32_t offset;            /* of the page in the image, 0xFFFFFFFF when empty */
+    uint32_t len;
+    uint32_t last_use;
+    uint8_t  data[OTA_RELAY_PAGE_SIZE];
+} ota_relay_page_t;
+
+#endif
+
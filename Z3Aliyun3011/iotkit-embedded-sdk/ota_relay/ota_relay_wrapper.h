@@ -0,0 +1,16 @@
+#ifndef _OTA_RELAY_WRAPPER_H_
+#define _OTA_RELAY_WRAPPER_H_
+
+#include "infra_types.h"
+#include "wrappers_defs.h"
+
+int HAL_Snprintf(char *str, const int len, const char *fmt, ...);
+void HAL_Printf(const char *fmt, ...);
+
+int HAL_ImageCache_Open(uint32_t *capacity);
+int HAL_ImageCache_Erase(void);
+int HAL_ImageCache_Write(uint32_t offset, const void *data, uint32_t len);
+int HAL_ImageCache_Read(uint32_t offset, void *buf, uint32_t len);
+
+#endif
+
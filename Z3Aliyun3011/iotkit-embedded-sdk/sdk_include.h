@@ -14,6 +14,7 @@
 #include "dev_sign_wrapper.h"
 #include "coap_wrapper.h"
 #include "mqtt_wrapper.h"
+#include "ota_relay_wrapper.h"
 #include "dev_reset_api.h"
 #include "dev_model_api.h"
 #include "alcs_api.h"
@@ -23,5 +24,6 @@
 #include "dev_sign_api.h"
 #include "coap_api.h"
 #include "mqtt_api.h"
+#include "ota_relay_api.h"
 
 #endif
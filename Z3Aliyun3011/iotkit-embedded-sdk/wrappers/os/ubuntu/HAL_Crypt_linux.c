@@ -0,0 +1,101 @@
+/**
+ * NOTE:
+ *
+ * HAL_Aes128_xxx API on OpenSSL libcrypto for the host simulation build,
+ * the target one is on mbedtls in wrappers/wrapper.c. Only CBC is needed
+ * outside the WiFi provisioning code.
+ *
+ */
+#include <string.h>
+#include <openssl/evp.h>
+
+#include "infra_types.h"
+#include "infra_defs.h"
+#include "infra_compat.h"
+#include "wrappers_defs.h"
+
+#define AES_BLOCK_SIZE 16
+
+p_HAL_Aes128_t HAL_Aes128_Init(
+            _IN_ const uint8_t *key,
+            _IN_ const uint8_t *iv,
+            _IN_ AES_DIR_t dir)
+{
+    EVP_CIPHER_CTX *ctx;
+
+    if (!key || !iv) {
+        return NULL;
+    }
+
+    ctx = EVP_CIPHER_CTX_new();
+    if (NULL == ctx) {
+        return NULL;
+    }
+
+    /* the chaining value is kept by the context between calls, as mbedtls does with its iv */
+    if (1 != EVP_CipherInit_ex(ctx, EVP_aes_128_cbc(), NULL, key, iv, (HAL_AES_ENCRYPTION == dir) ? 1 : 0)) {
+        EVP_CIPHER_CTX_free(ctx);
+        return NULL;
+    }
+    EVP_CIPHER_CTX_set_padding(ctx, 0);
+
+    return (p_HAL_Aes128_t)ctx;
+}
+
+int HAL_Aes128_Destroy(_IN_ p_HAL_Aes128_t aes)
+{
+    if (!aes) {
+        return -1;
+    }
+
+    EVP_CIPHER_CTX_free((EVP_CIPHER_CTX *)aes);
+    return 0;
+}
+
+int HAL_Aes128_Set_Iv(_IN_ p_HAL_Aes128_t aes, _IN_ const uint8_t *iv)
+{
+    if (!aes || !iv) {
+        return -1;
+    }
+
+    /* no cipher and no key keeps the expanded key, only the iv is loaded again */
+    if (1 != EVP_CipherInit_ex((EVP_CIPHER_CTX *)aes, NULL, NULL, NULL, iv, -1)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static int hal_aes128_cbc(p_HAL_Aes128_t aes, const void *src, size_t blockNum, void *dst)
+{
+    int outl = 0;
+
+    if (!aes || !src || !dst) {
+        return -1;
+    }
+
+    if (1 != EVP_CipherUpdate((EVP_CIPHER_CTX *)aes, dst, &outl, src, (int)(blockNum * AES_BLOCK_SIZE))
+        || outl != (int)(blockNum * AES_BLOCK_SIZE)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int HAL_Aes128_Cbc_Encrypt(
+            _IN_ p_HAL_Aes128_t aes,
+            _IN_ const void *src,
+            _IN_ size_t blockNum,
+            _OU_ void *dst)
+{
+    return hal_aes128_cbc(aes, src, blockNum, dst);
+}
+
+int HAL_Aes128_Cbc_Decrypt(
+            _IN_ p_HAL_Aes128_t aes,
+            _IN_ const void *src,
+            _IN_ size_t blockNum,
+            _OU_ void *dst)
+{
+    return hal_aes128_cbc(aes, src, blockNum, dst);
+}
@@ -0,0 +1,876 @@
+/**
+ * NOTE:
+ *
+ * POSIX implementation of the OS part of the HAL_xxx API, used by the host
+ * simulation build (see CMakeLists.txt). wrappers/wrapper.c is the target one.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <limits.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "infra_types.h"
+#include "infra_defs.h"
+#include "infra_compat.h"
+#include "wrappers_defs.h"
+
+#define HAL_HOST_PRODUCT_KEY        "a1h5gKPj2DC"
+#define HAL_HOST_PRODUCT_SECRET     "Cd6woPQPuI67K9Je"
+#define HAL_HOST_DEVICE_NAME        "host_gateway"
+#define HAL_HOST_DEVICE_SECRET      "host_gateway_device_secret_0000"
+#define HAL_HOST_KV_FILE            "iotx_kv.db"
+#define HAL_HOST_IMAGE_CACHE_FILE   "iotx_image_cache.bin"
+#define HAL_HOST_IMAGE_CACHE_SIZE   (1024 * 1024)
+
+#define HAL_HOST_TIMER_NUMBER       (16)
+
+/* identity and kv file can be overridden from the environment */
+static const char *hal_host_env(const char *name, const char *def)
+{
+    const char *value = getenv(name);
+
+    return (NULL != value && '\0' != value[0]) ? value : def;
+}
+
+int HAL_Snprintf(char *str, const int len, const char *fmt, ...)
+{
+    va_list args;
+    int     rc;
+
+    va_start(args, fmt);
+    rc = vsnprintf(str, len, fmt, args);
+    va_end(args);
+
+    return rc;
+}
+
+int HAL_Vsnprintf(char *str, const int len, const char *format, va_list ap)
+{
+    return vsnprintf(str, len, format, ap);
+}
+
+void HAL_Printf(const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+
+    fflush(stdout);
+}
+
+/* size of the block kept in front of it, 16 bytes to keep malloc()'s alignment */
+#define HAL_HOST_HEAP_HEADER        (16)
+
+static pthread_mutex_t g_heap_mutex = PTHREAD_MUTEX_INITIALIZER;
+static hal_heap_stats_t g_heap_stats = {
+    0, 0, 0, 0, 0,
+    {
+        {32, 0, 0, 0}, {64, 0, 0, 0}, {128, 0, 0, 0}, {256, 0, 0, 0},
+        {512, 0, 0, 0}, {1024, 0, 0, 0}, {4096, 0, 0, 0}, {0, 0, 0, 0}
+    }
+};
+
+static void hal_heap_account(uint32_t size, int alloc)
+{
+    hal_heap_class_stats_t *pclass = NULL;
+    int i;
+
+    for (i = 0; i < HAL_HEAP_SIZE_CLASSES - 1; i++) {
+        if (size <= g_heap_stats.size_class[i].limit) {
+            break;
+        }
+    }
+    pclass = &g_heap_stats.size_class[i];
+
+    pthread_mutex_lock(&g_heap_mutex);
+    if (alloc) {
+        g_heap_stats.allocs++;
+        g_heap_stats.alloc_bytes += size;
+        pclass->blocks++;
+        pclass->bytes += size;
+        if (pclass->bytes > pclass->peak_bytes) {
+            pclass->peak_bytes = pclass->bytes;
+        }
+        g_heap_stats.in_use += size;
+        if (g_heap_stats.in_use > g_heap_stats.peak) {
+            g_heap_stats.peak = g_heap_stats.in_use;
+        }
+    } else {
+        pclass->blocks--;
+        pclass->bytes -= size;
+        g_heap_stats.in_use -= size;
+    }
+    pthread_mutex_unlock(&g_heap_mutex);
+}
+
+void *HAL_Malloc(uint32_t size)
+{
+    uint8_t *pdata = (uint8_t *)malloc(size + HAL_HOST_HEAP_HEADER);
+
+    if (NULL == pdata) {
+        pthread_mutex_lock(&g_heap_mutex);
+        g_heap_stats.failures++;
+        pthread_mutex_unlock(&g_heap_mutex);
+        return NULL;
+    }
+
+    memcpy(pdata, &size, sizeof(size));
+    hal_heap_account(size, 1);
+    return pdata + HAL_HOST_HEAP_HEADER;
+}
+
+void HAL_Free(void *ptr)
+{
+    uint8_t *pdata = (uint8_t *)ptr;
+    uint32_t size;
+
+    if (NULL == ptr) {
+        return;
+    }
+
+    pdata -= HAL_HOST_HEAP_HEADER;
+    memcpy(&size, pdata, sizeof(size));
+    hal_heap_account(size, 0);
+    free(pdata);
+}
+
+void HAL_Heap_GetStats(hal_heap_stats_t *stats)
+{
+    pthread_mutex_lock(&g_heap_mutex);
+    memcpy(stats, &g_heap_stats, sizeof(hal_heap_stats_t));
+    pthread_mutex_unlock(&g_heap_mutex);
+}
+
+void HAL_Reboot(void)
+{
+    HAL_Printf("[%s][%d] reboot requested, exiting\r\n", __func__, __LINE__);
+    exit(EXIT_FAILURE);
+}
+
+int HAL_GetProductKey(char product_key[IOTX_PRODUCT_KEY_LEN + 1])
+{
+    snprintf(product_key, IOTX_PRODUCT_KEY_LEN + 1, "%s",
+             hal_host_env("IOTX_PRODUCT_KEY", HAL_HOST_PRODUCT_KEY));
+    return strlen(product_key);
+}
+
+int HAL_GetProductSecret(char product_secret[IOTX_PRODUCT_SECRET_LEN + 1])
+{
+    snprintf(product_secret, IOTX_PRODUCT_SECRET_LEN + 1, "%s",
+             hal_host_env("IOTX_PRODUCT_SECRET", HAL_HOST_PRODUCT_SECRET));
+    return strlen(product_secret);
+}
+
+int HAL_GetDeviceName(char device_name[IOTX_DEVICE_NAME_LEN + 1])
+{
+    snprintf(device_name, IOTX_DEVICE_NAME_LEN + 1, "%s",
+             hal_host_env("IOTX_DEVICE_NAME", HAL_HOST_DEVICE_NAME));
+    return strlen(device_name);
+}
+
+/* same kv key as the target, falls back to a fixed secret the broker stand-in ignores */
+int HAL_GetDeviceSecret(char device_secret[IOTX_DEVICE_SECRET_LEN + 1])
+{
+    char device_name[IOTX_DEVICE_NAME_LEN + 1] = {0};
+    char kv_key[63] = {0};
+    int  bufflen = IOTX_DEVICE_SECRET_LEN + 1;
+
+    HAL_GetDeviceName(device_name);
+    snprintf(kv_key, sizeof(kv_key), "DYNAMIC_REG_%s", device_name);
+
+    if (0 != HAL_Kv_Get(kv_key, device_secret, &bufflen)) {
+        snprintf(device_secret, IOTX_DEVICE_SECRET_LEN + 1, "%s",
+                 hal_host_env("IOTX_DEVICE_SECRET", HAL_HOST_DEVICE_SECRET));
+    }
+
+    return strlen(device_secret);
+}
+
+int HAL_SetDeviceSecret(char *device_secret)
+{
+    char device_name[IOTX_DEVICE_NAME_LEN + 1] = {0};
+    char kv_key[63] = {0};
+
+    HAL_GetDeviceName(device_name);
+    snprintf(kv_key, sizeof(kv_key), "DYNAMIC_REG_%s", device_name);
+    return HAL_Kv_Set(kv_key, device_secret, strlen(device_secret) + 1, 0);
+}
+
+int HAL_GetFirmwareVersion(char *version)
+{
+    sprintf(version, "fw-0.0.1-host");
+    return strlen(version);
+}
+
+void *HAL_MutexCreate(void)
+{
+    pthread_mutex_t *mutex = (pthread_mutex_t *)HAL_Malloc(sizeof(pthread_mutex_t));
+
+    if (NULL == mutex) {
+        return NULL;
+    }
+
+    if (0 != pthread_mutex_init(mutex, NULL)) {
+        HAL_Free(mutex);
+        return NULL;
+    }
+
+    return mutex;
+}
+
+void HAL_MutexDestroy(void *mutex)
+{
+    if (NULL == mutex) {
+        return;
+    }
+
+    pthread_mutex_destroy((pthread_mutex_t *)mutex);
+    HAL_Free(mutex);
+}
+
+void HAL_MutexLock(void *mutex)
+{
+    if (NULL != mutex) {
+        pthread_mutex_lock((pthread_mutex_t *)mutex);
+    }
+}
+
+void HAL_MutexUnlock(void *mutex)
+{
+    if (NULL != mutex) {
+        pthread_mutex_unlock((pthread_mutex_t *)mutex);
+    }
+}
+
+uint32_t HAL_Random(uint32_t region)
+{
+    return (region > 0) ? ((uint32_t)random() % region) : 0;
+}
+
+void HAL_Srandom(uint32_t seed)
+{
+    srandom(seed);
+}
+
+void HAL_SleepMs(uint32_t ms)
+{
+    struct timespec ts;
+
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000;
+    while (0 != nanosleep(&ts, &ts) && EINTR == errno) {
+    }
+}
+
+uint64_t HAL_UptimeMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* infra_trace timestamps in microseconds, wrapping */
+uint32_t HAL_Trace_Timestamp(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+uint32_t HAL_Trace_TimestampFreq(void)
+{
+    return 1000000;
+}
+
+int HAL_Atomic_CompareExchange(volatile uint32_t *ptr, uint32_t expected, uint32_t desired)
+{
+    return __atomic_compare_exchange_n(ptr, &expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST) ? 1 : 0;
+}
+
+static pthread_once_t g_dlog_once = PTHREAD_ONCE_INIT;
+static FILE          *g_dlog_file;
+
+static void hal_dlog_open(void)
+{
+    const char *path = hal_host_env("IOTX_DLOG_FILE", NULL);
+
+    if (NULL != path) {
+        g_dlog_file = fopen(path, "wb");
+        if (NULL == g_dlog_file) {
+            HAL_Printf("[%s][%d] open %s failed\r\n", __func__, __LINE__, path);
+        }
+    }
+}
+
+/* infra_dlog stream to the file named by IOTX_DLOG_FILE, dropped without one */
+int HAL_DLog_Write(const void *data, uint32_t len)
+{
+    pthread_once(&g_dlog_once, hal_dlog_open);
+    if (NULL != g_dlog_file && 1 != fwrite(data, len, 1, g_dlog_file)) {
+        return -1;
+    }
+    return (int)len;
+}
+
+/* absolute CLOCK_REALTIME deadline timeout_ms from now, for the timed waits */
+static void hal_deadline(struct timespec *ts, uint32_t timeout_ms)
+{
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += timeout_ms / 1000;
+    ts->tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+typedef struct {
+    void       *(*work_routine)(void *);
+    void       *arg;
+    const char *name;
+} hal_thread_start_t;
+
+static __thread const char *g_hal_thread_name;
+
+/* keeps the name for HAL_ThreadName(), pthread names are not const strings */
+static void *hal_thread_start(void *param)
+{
+    hal_thread_start_t start = *(hal_thread_start_t *)param;
+
+    free(param);
+    g_hal_thread_name = start.name;
+    return start.work_routine(start.arg);
+}
+
+const char *HAL_ThreadName(void)
+{
+    return g_hal_thread_name;
+}
+
+int HAL_ThreadCreate(
+            _OU_ void **thread_handle,
+            _IN_ void *(*work_routine)(void *),
+            _IN_ void *arg,
+            _IN_ hal_os_thread_param_t *hal_os_thread_param,
+            _OU_ int *stack_used)
+{
+    pthread_t           thread;
+    pthread_attr_t      attr;
+    hal_thread_start_t *start;
+    int                 ret;
+
+    if (stack_used) {
+        *stack_used = 0;
+    }
+
+    /* plain malloc, the thread frees it and HAL_Malloc() would count it */
+    start = (hal_thread_start_t *)malloc(sizeof(hal_thread_start_t));
+    if (NULL == start) {
+        return -1;
+    }
+    start->work_routine = work_routine;
+    start->arg = arg;
+    start->name = (NULL != hal_os_thread_param) ? hal_os_thread_param->name : NULL;
+
+    pthread_attr_init(&attr);
+    if (NULL != hal_os_thread_param) {
+        /* the target sizes its stacks for Cortex-M, keep the host default unless it is bigger */
+        if (hal_os_thread_param->stack_size > 256 * 1024) {
+            pthread_attr_setstacksize(&attr, hal_os_thread_param->stack_size);
+        }
+        if (hal_os_thread_param->detach_state) {
+            pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        }
+    }
+
+    ret = pthread_create(&thread, &attr, hal_thread_start, start);
+    pthread_attr_destroy(&attr);
+    if (0 != ret) {
+        free(start);
+        HAL_Printf("[%s][%d] pthread_create failed %d\r\n", __func__, __LINE__, ret);
+        return -1;
+    }
+
+    *thread_handle = (void *)thread;
+    return 0;
+}
+
+void HAL_ThreadDelete(_IN_ void *thread_handle)
+{
+    if (NULL == thread_handle) {
+        pthread_exit(0);
+    } else {
+        pthread_cancel((pthread_t)thread_handle);
+        pthread_join((pthread_t)thread_handle, 0);
+    }
+}
+
+void *HAL_SemaphoreCreate(void)
+{
+    sem_t *sem = (sem_t *)HAL_Malloc(sizeof(sem_t));
+
+    if (NULL == sem) {
+        return NULL;
+    }
+
+    if (0 != sem_init(sem, 0, 0)) {
+        HAL_Free(sem);
+        return NULL;
+    }
+
+    return sem;
+}
+
+void HAL_SemaphoreDestroy(_IN_ void *sem)
+{
+    sem_destroy((sem_t *)sem);
+    HAL_Free(sem);
+}
+
+void HAL_SemaphorePost(_IN_ void *sem)
+{
+    sem_post((sem_t *)sem);
+}
+
+int HAL_SemaphoreWait(_IN_ void *sem, _IN_ uint32_t timeout_ms)
+{
+    struct timespec ts;
+    int             ret;
+
+    if (PLATFORM_WAIT_INFINITE == timeout_ms) {
+        while (0 != (ret = sem_wait((sem_t *)sem)) && EINTR == errno) {
+        }
+        return (0 == ret) ? 0 : -1;
+    }
+
+    hal_deadline(&ts, timeout_ms);
+    while (0 != (ret = sem_timedwait((sem_t *)sem, &ts)) && EINTR == errno) {
+    }
+
+    return (0 == ret) ? 0 : -1;
+}
+
+/* one-shot timers served by a single thread, like the target wrapper */
+typedef struct {
+    uint8_t              used;
+    uint8_t              running;
+    uint64_t             deadline;
+    timer_callback       callback;
+    void                *callback_arg;
+} HalTmrHandle_S;
+
+static HalTmrHandle_S   g_hal_timer_array[HAL_HOST_TIMER_NUMBER];
+static pthread_mutex_t  g_timer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   g_timer_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t   g_timer_once = PTHREAD_ONCE_INIT;
+
+void *HAL_Timer_Task(void *para)
+{
+    (void)para;
+
+    pthread_mutex_lock(&g_timer_mutex);
+    while (1) {
+        uint64_t now = HAL_UptimeMs();
+        uint64_t next = 0;
+        uint8_t  i;
+
+        for (i = 0; i < HAL_HOST_TIMER_NUMBER; i++) {
+            HalTmrHandle_S *ptimer = &g_hal_timer_array[i];
+
+            if (!ptimer->used || !ptimer->running) {
+                continue;
+            }
+
+            if (ptimer->deadline <= now) {
+                ptimer->running = 0;
+                if (NULL != ptimer->callback) {
+                    timer_callback callback = ptimer->callback;
+                    void *arg = ptimer->callback_arg;
+
+                    pthread_mutex_unlock(&g_timer_mutex);
+                    callback(arg);
+                    pthread_mutex_lock(&g_timer_mutex);
+                }
+                /* the callback may have changed the array, rescan it */
+                next = now;
+                break;
+            }
+
+            if (0 == next || ptimer->deadline < next) {
+                next = ptimer->deadline;
+            }
+        }
+
+        if (next == now) {
+            continue;
+        }
+
+        if (0 == next) {
+            pthread_cond_wait(&g_timer_cond, &g_timer_mutex);
+        } else {
+            struct timespec ts;
+
+            hal_deadline(&ts, (uint32_t)(next - now));
+            pthread_cond_timedwait(&g_timer_cond, &g_timer_mutex, &ts);
+        }
+    }
+
+    return NULL;
+}
+
+static void hal_timer_start_task(void)
+{
+    void                   *taskid = NULL;
+    hal_os_thread_param_t   param;
+
+    memset(&param, 0, sizeof(param));
+    param.detach_state = 1;
+    param.name = "wrap_timer";
+
+    if (0 != HAL_ThreadCreate(&taskid, HAL_Timer_Task, NULL, &param, NULL)) {
+        HAL_Printf("[%s][%d] timer task create failed\r\n", __func__, __LINE__);
+    }
+}
+
+int HAL_Timer_Task_Init()
+{
+    pthread_once(&g_timer_once, hal_timer_start_task);
+    return 0;
+}
+
+void *HAL_Timer_Create(const char *name, timer_callback func, void *user_data)
+{
+    uint8_t i;
+
+    (void)name;
+
+    HAL_Timer_Task_Init();
+
+    pthread_mutex_lock(&g_timer_mutex);
+    for (i = 0; i < HAL_HOST_TIMER_NUMBER; i++) {
+        if (!g_hal_timer_array[i].used) {
+            memset(&g_hal_timer_array[i], 0, sizeof(HalTmrHandle_S));
+            g_hal_timer_array[i].callback = func;
+            g_hal_timer_array[i].callback_arg = user_data;
+            g_hal_timer_array[i].used = 1;
+            pthread_mutex_unlock(&g_timer_mutex);
+            return &g_hal_timer_array[i];
+        }
+    }
+    pthread_mutex_unlock(&g_timer_mutex);
+
+    HAL_Printf("[%s][%d] no free timer\r\n", __func__, __LINE__);
+    return NULL;
+}
+
+int HAL_Timer_Start(void *timer, int ms)
+{
+    HalTmrHandle_S *ptimer = (HalTmrHandle_S *)timer;
+
+    if (NULL == ptimer) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_timer_mutex);
+    ptimer->deadline = HAL_UptimeMs() + ms;
+    ptimer->running = 1;
+    pthread_cond_signal(&g_timer_cond);
+    pthread_mutex_unlock(&g_timer_mutex);
+
+    return 0;
+}
+
+int HAL_Timer_Stop(void *timer)
+{
+    HalTmrHandle_S *ptimer = (HalTmrHandle_S *)timer;
+
+    if (NULL == ptimer) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_timer_mutex);
+    ptimer->running = 0;
+    pthread_mutex_unlock(&g_timer_mutex);
+
+    return 0;
+}
+
+int HAL_Timer_Delete(void *timer)
+{
+    HalTmrHandle_S *ptimer = (HalTmrHandle_S *)timer;
+
+    if (NULL == ptimer) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_timer_mutex);
+    ptimer->running = 0;
+    ptimer->used = 0;
+    pthread_mutex_unlock(&g_timer_mutex);
+
+    return 0;
+}
+
+/* first IPv4 address of a non loopback interface, 127.0.0.1 if there is none */
+uint32_t HAL_Wifi_Get_IP(_OU_ char ip_str[NETWORK_ADDR_LEN], _IN_ const char *ifname)
+{
+    struct ifaddrs *ifaddr = NULL;
+    struct ifaddrs *ifa;
+    uint32_t        ipaddr = htonl(INADDR_LOOPBACK);
+
+    if (0 == getifaddrs(&ifaddr)) {
+        for (ifa = ifaddr; NULL != ifa; ifa = ifa->ifa_next) {
+            if (NULL == ifa->ifa_addr || AF_INET != ifa->ifa_addr->sa_family
+                || (ifa->ifa_flags & IFF_LOOPBACK)) {
+                continue;
+            }
+            if (NULL != ifname && '\0' != ifname[0] && 0 != strcmp(ifname, ifa->ifa_name)) {
+                continue;
+            }
+            ipaddr = ((struct sockaddr_in *)ifa->ifa_addr)->sin_addr.s_addr;
+            break;
+        }
+        freeifaddrs(ifaddr);
+    }
+
+    inet_ntop(AF_INET, &ipaddr, ip_str, NETWORK_ADDR_LEN);
+    return ipaddr;
+}
+
+char *HAL_Wifi_Get_Mac(_OU_ char mac_str[HAL_MAC_LEN])
+{
+    snprintf(mac_str, HAL_MAC_LEN, "%s", "02:00:00:00:00:01");
+    return mac_str;
+}
+
+/*
+ * kv store in a flat file of [key len][key][value len][value] records, the
+ * whole file is read on lookup and rewritten on update. Good enough for the
+ * handful of keys the SDK keeps.
+ */
+#define HAL_KV_KEY_MAXLEN           (64)
+#define HAL_KV_VALUE_MAXLEN         (4096)
+
+static pthread_mutex_t g_kv_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct {
+    uint32_t    key_len;
+    char        key[HAL_KV_KEY_MAXLEN];
+    uint32_t    value_len;
+    uint8_t     value[HAL_KV_VALUE_MAXLEN];
+} HalKvRecord_S;
+
+static int hal_kv_read_record(FILE *fp, HalKvRecord_S *record)
+{
+    if (1 != fread(&record->key_len, sizeof(record->key_len), 1, fp)
+        || record->key_len >= HAL_KV_KEY_MAXLEN
+        || record->key_len != fread(record->key, 1, record->key_len, fp)
+        || 1 != fread(&record->value_len, sizeof(record->value_len), 1, fp)
+        || record->value_len > HAL_KV_VALUE_MAXLEN
+        || record->value_len != fread(record->value, 1, record->value_len, fp)) {
+        return -1;
+    }
+
+    record->key[record->key_len] = '\0';
+    return 0;
+}
+
+static int hal_kv_write_record(FILE *fp, const char *key, const void *val, uint32_t len)
+{
+    uint32_t key_len = strlen(key);
+
+    if (1 != fwrite(&key_len, sizeof(key_len), 1, fp)
+        || key_len != fwrite(key, 1, key_len, fp)
+        || 1 != fwrite(&len, sizeof(len), 1, fp)
+        || len != fwrite(val, 1, len, fp)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* copies every record but key to a temporary file, appends val if given and renames it over the store */
+static int hal_kv_rewrite(const char *key, const void *val, int len)
+{
+    const char    *path = hal_host_env("IOTX_KV_FILE", HAL_HOST_KV_FILE);
+    char           tmp_path[PATH_MAX];
+    FILE          *in;
+    FILE          *out;
+    HalKvRecord_S *record;
+    int            ret = 0;
+
+    record = (HalKvRecord_S *)HAL_Malloc(sizeof(HalKvRecord_S));
+    if (NULL == record) {
+        return -1;
+    }
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    out = fopen(tmp_path, "wb");
+    if (NULL == out) {
+        HAL_Free(record);
+        return -1;
+    }
+
+    in = fopen(path, "rb");
+    if (NULL != in) {
+        while (0 == ret && 0 == hal_kv_read_record(in, record)) {
+            if (0 != strcmp(record->key, key)) {
+                ret = hal_kv_write_record(out, record->key, record->value, record->value_len);
+            }
+        }
+        fclose(in);
+    }
+
+    if (0 == ret && NULL != val) {
+        ret = hal_kv_write_record(out, key, val, len);
+    }
+
+    if (0 != fclose(out) || 0 != ret || 0 != rename(tmp_path, path)) {
+        unlink(tmp_path);
+        ret = -1;
+    }
+
+    HAL_Free(record);
+    return ret;
+}
+
+int HAL_Kv_Set(const char *key, const void *val, int len, int sync)
+{
+    int ret;
+
+    (void)sync;
+
+    if (NULL == key || NULL == val || len < 0
+        || strlen(key) >= HAL_KV_KEY_MAXLEN || len > HAL_KV_VALUE_MAXLEN) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_kv_mutex);
+    ret = hal_kv_rewrite(key, val, len);
+    pthread_mutex_unlock(&g_kv_mutex);
+
+    return ret;
+}
+
+int HAL_Kv_Get(const char *key, void *buffer, int *buffer_len)
+{
+    FILE          *fp;
+    HalKvRecord_S *record;
+    int            ret = -1;
+
+    if (NULL == key || NULL == buffer || NULL == buffer_len) {
+        return -1;
+    }
+
+    record = (HalKvRecord_S *)HAL_Malloc(sizeof(HalKvRecord_S));
+    if (NULL == record) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_kv_mutex);
+    fp = fopen(hal_host_env("IOTX_KV_FILE", HAL_HOST_KV_FILE), "rb");
+    if (NULL != fp) {
+        while (0 == hal_kv_read_record(fp, record)) {
+            if (0 != strcmp(record->key, key)) {
+                continue;
+            }
+            if ((int)record->value_len <= *buffer_len) {
+                memcpy(buffer, record->value, record->value_len);
+                *buffer_len = record->value_len;
+                ret = 0;
+            }
+            break;
+        }
+        fclose(fp);
+    }
+    pthread_mutex_unlock(&g_kv_mutex);
+
+    HAL_Free(record);
+    return ret;
+}
+
+int HAL_Kv_Del(const char *key)
+{
+    int ret;
+
+    if (NULL == key) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_kv_mutex);
+    ret = hal_kv_rewrite(key, NULL, 0);
+    pthread_mutex_unlock(&g_kv_mutex);
+
+    return ret;
+}
+
+/* sub-device OTA image cache, a file standing in for the external flash */
+static pthread_mutex_t g_image_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int             g_image_cache_fd = -1;
+
+int HAL_ImageCache_Open(uint32_t *capacity)
+{
+    pthread_mutex_lock(&g_image_cache_mutex);
+    if (g_image_cache_fd < 0) {
+        g_image_cache_fd = open(hal_host_env("IOTX_IMAGE_CACHE_FILE", HAL_HOST_IMAGE_CACHE_FILE),
+                                O_RDWR | O_CREAT, 0644);
+    }
+    pthread_mutex_unlock(&g_image_cache_mutex);
+
+    if (g_image_cache_fd < 0) {
+        return -1;
+    }
+    *capacity = HAL_HOST_IMAGE_CACHE_SIZE;
+    return 0;
+}
+
+int HAL_ImageCache_Erase(void)
+{
+    int ret;
+
+    pthread_mutex_lock(&g_image_cache_mutex);
+    ret = (g_image_cache_fd >= 0 && 0 == ftruncate(g_image_cache_fd, 0)) ? 0 : -1;
+    pthread_mutex_unlock(&g_image_cache_mutex);
+
+    return ret;
+}
+
+int HAL_ImageCache_Write(uint32_t offset, const void *data, uint32_t len)
+{
+    if (g_image_cache_fd < 0 || offset + len > HAL_HOST_IMAGE_CACHE_SIZE) {
+        return -1;
+    }
+    return (pwrite(g_image_cache_fd, data, len, offset) == (ssize_t)len) ? 0 : -1;
+}
+
+int HAL_ImageCache_Read(uint32_t offset, void *buf, uint32_t len)
+{
+    ssize_t got;
+
+    if (g_image_cache_fd < 0 || offset + len > HAL_HOST_IMAGE_CACHE_SIZE) {
+        return -1;
+    }
+    got = pread(g_image_cache_fd, buf, len, offset);
+    if (got < 0) {
+        return -1;
+    }
+    /* past what was written reads as erased flash */
+    memset((uint8_t *)buf + got, 0xFF, len - got);
+    return 0;
+}
@@ -0,0 +1,208 @@
+/**
+ * NOTE:
+ *
+ * POSIX sockets implementation of the HAL_TCP_xxx API for the host
+ * simulation build, semantics as documented in wrappers/wrapper.c.
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "infra_types.h"
+#include "infra_defs.h"
+#include "wrappers_defs.h"
+
+extern void HAL_Printf(const char *fmt, ...);
+
+/* milliseconds left until deadline, 0 once it has passed */
+static uint32_t hal_tcp_left_ms(uint64_t deadline)
+{
+    uint64_t now = HAL_UptimeMs();
+
+    return (now >= deadline) ? 0 : (uint32_t)(deadline - now);
+}
+
+uintptr_t HAL_TCP_Establish(const char *host, uint16_t port)
+{
+    struct addrinfo  hints;
+    struct addrinfo *addrs = NULL;
+    struct addrinfo *cur;
+    char             service[6];
+    int              fd = -1;
+    int              opt = 1;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    snprintf(service, sizeof(service), "%u", port);
+
+    if (0 != getaddrinfo(host, service, &hints, &addrs)) {
+        HAL_Printf("[%s][%d] getaddrinfo %s failed\r\n", __func__, __LINE__, host);
+        return (uintptr_t)-1;
+    }
+
+    for (cur = addrs; NULL != cur; cur = cur->ai_next) {
+        fd = socket(cur->ai_family, cur->ai_socktype, cur->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (0 == connect(fd, cur->ai_addr, cur->ai_addrlen)) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(addrs);
+
+    if (fd < 0) {
+        HAL_Printf("[%s][%d] connect %s:%u failed\r\n", __func__, __LINE__, host, port);
+        return (uintptr_t)-1;
+    }
+
+    /* the MQTT client writes header and payload separately */
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    return (uintptr_t)fd;
+}
+
+int HAL_TCP_Destroy(uintptr_t fd)
+{
+    shutdown((int)fd, SHUT_RDWR);
+    return (0 == close((int)fd)) ? 0 : -1;
+}
+
+int32_t HAL_TCP_Read(uintptr_t fd, char *buf, uint32_t len, uint32_t timeout_ms)
+{
+    uint64_t      deadline = HAL_UptimeMs() + timeout_ms;
+    uint32_t      len_recv = 0;
+    struct pollfd pfd;
+    ssize_t       ret;
+
+    pfd.fd = (int)fd;
+    pfd.events = POLLIN;
+
+    while (len_recv < len) {
+        ret = recv((int)fd, buf + len_recv, len - len_recv, 0);
+        if (ret > 0) {
+            len_recv += ret;
+            continue;
+        }
+        if (0 == ret) {
+            /* closed by the peer */
+            return (len_recv > 0) ? (int32_t)len_recv : -1;
+        }
+        if (EINTR == errno) {
+            continue;
+        }
+        if (EAGAIN != errno && EWOULDBLOCK != errno) {
+            return (len_recv > 0) ? (int32_t)len_recv : -2;
+        }
+
+        ret = poll(&pfd, 1, hal_tcp_left_ms(deadline));
+        if (0 == ret) {
+            break;
+        }
+        if (ret < 0 && EINTR != errno) {
+            return (len_recv > 0) ? (int32_t)len_recv : -2;
+        }
+    }
+
+    return (int32_t)len_recv;
+}
+
+int32_t HAL_TCP_Write(uintptr_t fd, const char *buf, uint32_t len, uint32_t timeout_ms)
+{
+    uint64_t      deadline = HAL_UptimeMs() + timeout_ms;
+    uint32_t      len_sent = 0;
+    struct pollfd pfd;
+    ssize_t       ret;
+
+    pfd.fd = (int)fd;
+    pfd.events = POLLOUT;
+
+    while (len_sent < len) {
+        ret = send((int)fd, buf + len_sent, len - len_sent, MSG_NOSIGNAL);
+        if (ret > 0) {
+            len_sent += ret;
+            continue;
+        }
+        if (ret < 0 && EINTR == errno) {
+            continue;
+        }
+        if (ret < 0 && EAGAIN != errno && EWOULDBLOCK != errno) {
+            return -1;
+        }
+
+        ret = poll(&pfd, 1, hal_tcp_left_ms(deadline));
+        if (0 == ret) {
+            break;
+        }
+        if (ret < 0 && EINTR != errno) {
+            return -1;
+        }
+    }
+
+    return (int32_t)len_sent;
+}
+
+int HAL_Network_Wait(const uintptr_t handles[], int count, uint32_t timeout_ms)
+{
+    uint64_t      deadline = HAL_UptimeMs() + timeout_ms;
+    struct pollfd pfd[32];
+    int           index[32];
+    int           num = 0;
+    int           mask = 0;
+    int           ret;
+    int           i;
+
+    if (NULL == handles || count < 0 || count > 32) {
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (0 == handles[i] || (uintptr_t)-1 == handles[i]) {
+            continue;
+        }
+        pfd[num].fd = (int)handles[i];
+        pfd[num].events = POLLIN;
+        pfd[num].revents = 0;
+        index[num++] = i;
+    }
+
+    do {
+        /* with no handle at all this is just a sleep */
+        ret = poll(pfd, num, hal_tcp_left_ms(deadline));
+    } while (ret < 0 && EINTR == errno);
+    if (ret < 0) {
+        return -1;
+    }
+
+    for (i = 0; i < num; i++) {
+        /* hangups and errors count as readable, the read reports them */
+        if (0 != pfd[i].revents) {
+            mask |= 1 << index[i];
+        }
+    }
+
+    return mask;
+}
+
+uint32_t HAL_Network_Session(uintptr_t handle)
+{
+    if (0 == handle || (uintptr_t)-1 == handle) {
+        return 0;
+    }
+    /* a descriptor is not given to another connection before it is closed */
+    return (-1 == fcntl((int)handle, F_GETFD)) ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+/**
+ * NOTE:
+ *
+ * POSIX sockets implementation of the HAL_UDP_xxx API used by the CoAP
+ * server, for the host simulation build. Each socket gets a receive buffer
+ * for HAL_UDP_recvfrom_borrow() and a pipe HAL_UDP_wakeup() writes to.
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "infra_types.h"
+#include "infra_defs.h"
+#include "infra_compat.h"
+#include "wrappers_defs.h"
+
+#define HAL_UDP_SOCKET_NUMBER       (4)
+#define HAL_UDP_RECV_BUFFER_LEN     (1500)
+
+typedef struct {
+    int             fd;
+    int             wakeup[2];
+    unsigned char   buffer[HAL_UDP_RECV_BUFFER_LEN];
+} HalUdpSocket_S;
+
+static HalUdpSocket_S   g_hal_udp_sockets[HAL_UDP_SOCKET_NUMBER];
+static pthread_mutex_t  g_hal_udp_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+extern void HAL_Printf(const char *fmt, ...);
+
+static HalUdpSocket_S *hal_udp_socket(intptr_t sockfd)
+{
+    uint8_t i;
+
+    for (i = 0; i < HAL_UDP_SOCKET_NUMBER; i++) {
+        if (g_hal_udp_sockets[i].fd == (int)sockfd && g_hal_udp_sockets[i].fd > 0) {
+            return &g_hal_udp_sockets[i];
+        }
+    }
+
+    return NULL;
+}
+
+intptr_t HAL_UDP_create_without_connect(_IN_ const char *host, _IN_ unsigned short port)
+{
+    struct sockaddr_in  addr;
+    HalUdpSocket_S     *sock = NULL;
+    int                 opt = 1;
+    int                 fd;
+    uint8_t             i;
+
+    fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd < 0) {
+        return (intptr_t)-1;
+    }
+
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &opt, sizeof(opt));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = (NULL != host) ? inet_addr(host) : htonl(INADDR_ANY);
+    if (0 != bind(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+        HAL_Printf("[%s][%d] bind port %u failed\r\n", __func__, __LINE__, port);
+        close(fd);
+        return (intptr_t)-1;
+    }
+
+    pthread_mutex_lock(&g_hal_udp_mutex);
+    for (i = 0; i < HAL_UDP_SOCKET_NUMBER; i++) {
+        if (g_hal_udp_sockets[i].fd <= 0) {
+            sock = &g_hal_udp_sockets[i];
+            break;
+        }
+    }
+    if (NULL != sock && 0 == pipe(sock->wakeup)) {
+        fcntl(sock->wakeup[0], F_SETFL, O_NONBLOCK);
+        fcntl(sock->wakeup[1], F_SETFL, O_NONBLOCK);
+        sock->fd = fd;
+    } else {
+        sock = NULL;
+    }
+    pthread_mutex_unlock(&g_hal_udp_mutex);
+
+    if (NULL == sock) {
+        close(fd);
+        return (intptr_t)-1;
+    }
+
+    return (intptr_t)fd;
+}
+
+int HAL_UDP_joinmulticast(_IN_ intptr_t sockfd,
+                          _IN_ char *p_group)
+{
+    struct ip_mreq mreq;
+    int            loop = 0;
+
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.imr_multiaddr.s_addr = inet_addr(p_group);
+    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+
+    setsockopt((int)sockfd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    if (0 != setsockopt((int)sockfd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq))) {
+        HAL_Printf("[%s][%d] join %s failed\r\n", __func__, __LINE__, p_group);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* waits for a datagram or a wakeup, returns 1 when the socket is readable */
+static int hal_udp_wait(HalUdpSocket_S *sock, unsigned int timeout_ms)
+{
+    struct pollfd pfd[2];
+    char          drain[16];
+    int           ret;
+
+    pfd[0].fd = sock->fd;
+    pfd[0].events = POLLIN;
+    pfd[1].fd = sock->wakeup[0];
+    pfd[1].events = POLLIN;
+
+    do {
+        ret = poll(pfd, 2, (int)timeout_ms);
+    } while (ret < 0 && EINTR == errno);
+
+    if (ret > 0 && (pfd[1].revents & POLLIN)) {
+        while (read(sock->wakeup[0], drain, sizeof(drain)) > 0) {
+        }
+    }
+
+    return (ret > 0 && (pfd[0].revents & POLLIN)) ? 1 : 0;
+}
+
+static int hal_udp_recv(int fd, NetworkAddr *p_remote, unsigned char *p_data, unsigned int datalen)
+{
+    struct sockaddr_in addr;
+    socklen_t          addr_len = sizeof(addr);
+    ssize_t            ret;
+
+    ret = recvfrom(fd, p_data, datalen, MSG_DONTWAIT, (struct sockaddr *)&addr, &addr_len);
+    if (ret <= 0) {
+        return -1;
+    }
+
+    if (NULL != p_remote) {
+        p_remote->port = ntohs(addr.sin_port);
+        inet_ntop(AF_INET, &addr.sin_addr, (char *)p_remote->addr, NETWORK_ADDR_LEN);
+    }
+
+    return (int)ret;
+}
+
+int HAL_UDP_recvfrom(_IN_ intptr_t sockfd,
+                     _OU_ NetworkAddr *p_remote,
+                     _OU_ unsigned char *p_data,
+                     _IN_ unsigned int datalen,
+                     _IN_ unsigned int timeout_ms)
+{
+    HalUdpSocket_S *sock = hal_udp_socket(sockfd);
+
+    if (NULL == sock || !hal_udp_wait(sock, timeout_ms)) {
+        return -1;
+    }
+
+    return hal_udp_recv(sock->fd, p_remote, p_data, datalen);
+}
+
+int HAL_UDP_recvfrom_borrow(_IN_ intptr_t sockfd,
+                            _OU_ NetworkAddr *p_remote,
+                            _OU_ unsigned char **pp_data,
+                            _IN_ unsigned int timeout_ms)
+{
+    HalUdpSocket_S *sock = hal_udp_socket(sockfd);
+    int             ret;
+
+    if (NULL == sock || !hal_udp_wait(sock, timeout_ms)) {
+        return -1;
+    }
+
+    ret = hal_udp_recv(sock->fd, p_remote, sock->buffer, sizeof(sock->buffer));
+    if (ret > 0) {
+        *pp_data = sock->buffer;
+    }
+
+    return ret;
+}
+
+void HAL_UDP_recvfrom_release(_IN_ intptr_t sockfd)
+{
+    /* the buffer is reused by the next borrow */
+    (void)sockfd;
+}
+
+void HAL_UDP_wakeup(_IN_ intptr_t sockfd)
+{
+    HalUdpSocket_S *sock = hal_udp_socket(sockfd);
+    char            one = 1;
+
+    if (NULL != sock && write(sock->wakeup[1], &one, 1) < 0) {
+        /* pipe already full, the reader is woken up anyway */
+    }
+}
+
+int HAL_UDP_sendto(_IN_ intptr_t sockfd,
+                   _IN_ const NetworkAddr *p_remote,
+                   _IN_ const unsigned char *p_data,
+                   _IN_ unsigned int datalen,
+                   _IN_ unsigned int timeout_ms)
+{
+    struct sockaddr_in addr;
+    ssize_t            ret;
+
+    (void)timeout_ms;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(p_remote->port);
+    addr.sin_addr.s_addr = inet_addr((const char *)p_remote->addr);
+
+    ret = sendto((int)sockfd, p_data, datalen, 0, (struct sockaddr *)&addr, sizeof(addr));
+    if (ret <= 0) {
+        HAL_Printf("[%s][%d] sendto %s:%u failed\r\n", __func__, __LINE__, p_remote->addr, p_remote->port);
+        return -1;
+    }
+
+    return (int)ret;
+}
+
+int HAL_UDP_close_without_connect(_IN_ intptr_t sockfd)
+{
+    HalUdpSocket_S *sock;
+
+    pthread_mutex_lock(&g_hal_udp_mutex);
+    sock = hal_udp_socket(sockfd);
+    if (NULL != sock) {
+        close(sock->wakeup[0]);
+        close(sock->wakeup[1]);
+        sock->fd = 0;
+    }
+    pthread_mutex_unlock(&g_hal_udp_mutex);
+
+    return (0 == close((int)sockfd)) ? 0 : -1;
+}
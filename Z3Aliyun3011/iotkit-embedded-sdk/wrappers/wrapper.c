@@ -21,6 +21,12 @@
 #include <common/include/rtos_prio.h>
 
 #include "mbedtls/aes.h"
+#include "em_device.h"
+#include "api/btl_interface.h"
+#ifdef IOTX_TRACE_SYSVIEW
+#include "SEGGER_SYSVIEW.h"
+#include "SEGGER_RTT.h"
+#endif
 
 #include "wifi/wgm110.h"
 
@@ -29,6 +35,52 @@
 #define MS_TO_TICK(ms) ((ms) * OS_CFG_TICK_RATE_HZ / 1000)
 
 static uint32_t g_heap_used = 0;
+static hal_heap_stats_t g_heap_stats = {
+    0, 0, 0, 0, 0,
+    {
+        {32, 0, 0, 0}, {64, 0, 0, 0}, {128, 0, 0, 0}, {256, 0, 0, 0},
+        {512, 0, 0, 0}, {1024, 0, 0, 0}, {4096, 0, 0, 0}, {0, 0, 0, 0}
+    }
+};
+static int g_timer_used_peak = 0;
+
+static hal_heap_class_stats_t *hal_heap_class(uint32_t size)
+{
+    int i;
+
+    for (i = 0; i < HAL_HEAP_SIZE_CLASSES - 1; i++) {
+        if (size <= g_heap_stats.size_class[i].limit) {
+            break;
+        }
+    }
+    return &g_heap_stats.size_class[i];
+}
+
+static void hal_heap_account(uint32_t size, int alloc)
+{
+    hal_heap_class_stats_t *pclass = hal_heap_class(size);
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    if (alloc) {
+        g_heap_stats.allocs++;
+        g_heap_stats.alloc_bytes += size;
+        pclass->blocks++;
+        pclass->bytes += size;
+        if (pclass->bytes > pclass->peak_bytes) {
+            pclass->peak_bytes = pclass->bytes;
+        }
+        g_heap_stats.in_use += size;
+        if (g_heap_stats.in_use > g_heap_stats.peak) {
+            g_heap_stats.peak = g_heap_stats.in_use;
+        }
+    } else {
+        pclass->blocks--;
+        pclass->bytes -= size;
+        g_heap_stats.in_use -= size;
+    }
+    CPU_CRITICAL_EXIT();
+}
 
 
 int HAL_Snprintf(char *str, const int len, const char *fmt, ...)
@@ -70,6 +122,7 @@ void *HAL_Malloc(uint32_t size)
 {
     uint8_t *pdata = (uint8_t *)malloc(size + 8);
     if (NULL == pdata) {
+        g_heap_stats.failures++;
         printf("\033[31m[%s][%d]not enough mem\r\n", __func__, __LINE__);
         printf("\33[37m");
         return NULL;
@@ -81,6 +134,7 @@ void *HAL_Malloc(uint32_t size)
     *(uint8_t *)(pdata + 3) = '!';
     *(uint32_t *)(pdata + 4) = size;
     g_heap_used += size;
+    hal_heap_account(size, 1);
     //printf("\033[31m[%s][%d]heap used 0x%x bytes\r\n", __func__, __LINE__, g_heap_used);
     //printf("\33[37m");
     return pdata + 8;
@@ -112,11 +166,27 @@ void HAL_Free(void *ptr)
     }
 
     g_heap_used -= *(uint32_t *)(pdata - 4);
+    hal_heap_account(*(uint32_t *)(pdata - 4), 0);
     //printf("\033[31m[%s][%d]heap used 0x%x bytes\r\n", __func__, __LINE__, g_heap_used);
     //printf("\33[37m");
     free(pdata - 8);
 }
 
+/**
+ * @brief Get the HAL_Malloc() accounting: bytes in use and peak, overall and per size class.
+ *
+ * @param [out] stats @n the statistics.
+ * @return None.
+ */
+void HAL_Heap_GetStats(hal_heap_stats_t *stats)
+{
+    CPU_SR_ALLOC();
+
+    CPU_CRITICAL_ENTER();
+    memcpy(stats, &g_heap_stats, sizeof(hal_heap_stats_t));
+    CPU_CRITICAL_EXIT();
+}
+
 void HAL_Reboot(void)
 {
     while (1) {
@@ -392,6 +462,130 @@ uint64_t HAL_UptimeMs(void)
 	return halCommonGetInt64uMillisecondTick();
 }
 
+#if defined(INFRA_TRACE) || defined(INFRA_DLOG)
+/**
+ * @brief Timestamp for infra_trace and infra_dlog: the Cortex-M cycle counter, as SystemView uses.
+ *
+ * @return the number of core clock cycles, wrapping.
+ */
+uint32_t HAL_Trace_Timestamp(void)
+{
+    if (0 == (DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+    return DWT->CYCCNT;
+}
+
+uint32_t HAL_Trace_TimestampFreq(void)
+{
+    return SystemCoreClockGet();
+}
+#endif
+
+#ifdef INFRA_TRACE
+#ifdef IOTX_TRACE_SYSVIEW
+/* event N is trace point N (iotx_trace_point_t), the parameter is the trace id */
+static SEGGER_SYSVIEW_MODULE g_trace_sysview_module = {
+    "M=Linkkit, 0 WiFiRx id=%u, 1 MqttRecv id=%u, 2 MqttPublish id=%u, 3 IpcInsert id=%u, "
+    "4 Dispatch id=%u, 5 PropertyParsed id=%u, 6 ZigbeeSend id=%u",
+    7,
+    0,
+    NULL,
+    NULL
+};
+#endif
+
+/**
+ * @brief Send a trace point to SEGGER SystemView over RTT.
+ *
+ * @note Only when the systemview sources are part of the build (IOTX_TRACE_SYSVIEW),
+ *       the histograms of infra_trace work without them.
+ */
+void HAL_Trace_Point(uint32_t id, int point)
+{
+#ifdef IOTX_TRACE_SYSVIEW
+    if (0 == g_trace_sysview_module.EventOffset) {
+        SEGGER_SYSVIEW_RegisterModule(&g_trace_sysview_module);
+    }
+    SEGGER_SYSVIEW_RecordU32(g_trace_sysview_module.EventOffset + point, id);
+#else
+    (void)id;
+    (void)point;
+#endif
+}
+#endif
+
+/**
+ * @brief Compare and swap with LDREX/STREX, usable from interrupts.
+ *
+ * @return 1 when *ptr held expected and was set to desired, 0 otherwise.
+ */
+int HAL_Atomic_CompareExchange(volatile uint32_t *ptr, uint32_t expected, uint32_t desired)
+{
+    __DMB();
+    do {
+        if (__LDREXW(ptr) != expected) {
+            __CLREX();
+            __DMB();
+            return 0;
+        }
+    } while (0 != __STREXW(desired, ptr));
+    __DMB();
+
+    return 1;
+}
+
+const char *HAL_ThreadName(void)
+{
+    if (OSIntNestingCtr > 0) {
+        return "isr";
+    }
+    return (NULL != OSTCBCurPtr) ? OSTCBCurPtr->NamePtr : NULL;
+}
+
+#ifdef INFRA_DLOG
+#ifdef IOTX_TRACE_SYSVIEW
+/* RTT channel 1 is SystemView's, the J-Link reads the log from the next one */
+#define HAL_DLOG_RTT_CHANNEL    (2)
+#define HAL_DLOG_RTT_SIZE       (2048)
+
+static char g_dlog_rtt_buf[HAL_DLOG_RTT_SIZE];
+static int  g_dlog_rtt_configured = 0;
+#endif
+
+/**
+ * @brief Sink of the infra_dlog drain task.
+ *
+ * @note Over RTT when the systemview sources are part of the build, else
+ *       as "@D" lines of hex words on the console for host/dlog_decode -x.
+ *       Either way the write happens on the low priority drain task.
+ */
+int HAL_DLog_Write(const void *data, uint32_t len)
+{
+#ifdef IOTX_TRACE_SYSVIEW
+    if (!g_dlog_rtt_configured) {
+        SEGGER_RTT_ConfigUpBuffer(HAL_DLOG_RTT_CHANNEL, "dlog", g_dlog_rtt_buf, sizeof(g_dlog_rtt_buf),
+                                  SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+        g_dlog_rtt_configured = 1;
+    }
+    return (int)SEGGER_RTT_Write(HAL_DLOG_RTT_CHANNEL, data, len);
+#else
+    const uint32_t *words = (const uint32_t *)data;
+    uint32_t        i;
+
+    printf("@D");
+    for (i = 0; i < len / sizeof(uint32_t); i++) {
+        printf(" %08lx", (unsigned long)words[i]);
+    }
+    printf("\r\n");
+
+    return (int)len;
+#endif
+}
+#endif
+
 typedef struct {
     mbedtls_aes_context ctx;
     uint8_t iv[16];
@@ -440,6 +634,16 @@ int HAL_Aes128_Destroy(_IN_ p_HAL_Aes128_t aes)
     return 0;
 }
 
+int HAL_Aes128_Set_Iv(_IN_ p_HAL_Aes128_t aes, _IN_ const uint8_t *iv)
+{
+    if (!aes || !iv) return -1;
+
+    /* the key schedule is kept, only the chaining value starts over */
+    memcpy(((platform_aes_t *)aes)->iv, iv, 16);
+
+    return 0;
+}
+
 int HAL_Aes128_Cbc_Encrypt(
             _IN_ p_HAL_Aes128_t aes,
             _IN_ const void *src,
@@ -782,6 +986,9 @@ void *HAL_Timer_Create(const char *name, timer_callback func, void *user_data)
             g_hal_timer_array[i].callback_arg = user_data;
             g_hal_timer_array[i].running = false;
             g_hal_timer_array[i].used = true;
+            if (i + 1 > g_timer_used_peak) {
+                g_timer_used_peak = i + 1;
+            }
             HAL_MutexUnlock(g_timer_mutex);            
             return &g_hal_timer_array[i];
         }
@@ -827,6 +1034,26 @@ int HAL_Timer_Delete(void *timer)
     return 0;
 }
 
+void HAL_Timer_GetStats(hal_timer_stats_t *stats)
+{
+    uint8_t i;
+
+    memset(stats, 0, sizeof(hal_timer_stats_t));
+    stats->slots = sizeof(g_hal_timer_array) / sizeof(g_hal_timer_array[0]);
+
+    HAL_MutexLock(g_timer_mutex);
+    for (i = 0; i < stats->slots; i++) {
+        if (true == g_hal_timer_array[i].used) {
+            stats->used++;
+            if (true == g_hal_timer_array[i].running) {
+                stats->running++;
+            }
+        }
+    }
+    stats->peak = g_timer_used_peak;
+    HAL_MutexUnlock(g_timer_mutex);
+}
+
 char *HAL_Wifi_Get_Mac(_OU_ char mac_str[HAL_MAC_LEN])
 {
     uint8_t mac[6] = {0};
@@ -980,6 +1207,64 @@ int HAL_Kv_Del(const char *key)
     return ret;
 }
 
+/*
+ * The sub-device OTA image cache is a storage slot of the Gecko bootloader,
+ * in the external SPI flash. The last slot is used so that slot 0 stays for
+ * the images of the gateway itself, which takes two slots at least.
+ */
+static uint32_t g_image_cache_slot = 0xFFFFFFFF;
+static uint32_t g_image_cache_size = 0;
+
+int HAL_ImageCache_Open(uint32_t *capacity)
+{
+    BootloaderStorageInformation_t info;
+    BootloaderStorageSlot_t        slot;
+
+    if (0xFFFFFFFF == g_image_cache_slot) {
+        if (BOOTLOADER_OK != bootloader_init()) {
+            return -1;
+        }
+        bootloader_getStorageInfo(&info);
+        /* with a single slot there is none to spare for the cache */
+        if (info.numStorageSlots < 2
+            || BOOTLOADER_OK != bootloader_getStorageSlotInfo(info.numStorageSlots - 1, &slot)) {
+            printf("\033[31m[%s][%d] no spare bootloader storage slot\r\n", __func__, __LINE__);
+            printf("\33[37m");
+            return -1;
+        }
+        g_image_cache_slot = info.numStorageSlots - 1;
+        g_image_cache_size = slot.length;
+    }
+
+    *capacity = g_image_cache_size;
+    return 0;
+}
+
+int HAL_ImageCache_Erase(void)
+{
+    if (0xFFFFFFFF == g_image_cache_slot) {
+        return -1;
+    }
+    return (BOOTLOADER_OK == bootloader_eraseStorageSlot(g_image_cache_slot)) ? 0 : -1;
+}
+
+int HAL_ImageCache_Write(uint32_t offset, const void *data, uint32_t len)
+{
+    if (0xFFFFFFFF == g_image_cache_slot || offset + len > g_image_cache_size) {
+        return -1;
+    }
+    /* the slot is erased as a whole first, plain writes are enough */
+    return (BOOTLOADER_OK == bootloader_writeStorage(g_image_cache_slot, offset, (uint8_t *)data, len)) ? 0 : -1;
+}
+
+int HAL_ImageCache_Read(uint32_t offset, void *buf, uint32_t len)
+{
+    if (0xFFFFFFFF == g_image_cache_slot || offset + len > g_image_cache_size) {
+        return -1;
+    }
+    return (BOOTLOADER_OK == bootloader_readStorage(g_image_cache_slot, offset, (uint8_t *)buf, len)) ? 0 : -1;
+}
+
 /**
  * @brief Destroy the specific TCP connection.
  *
@@ -1115,6 +1400,71 @@ int32_t HAL_TCP_Write(uintptr_t fd, const char *buf, uint32_t len, uint32_t time
     return wifi_tcpip_write((uint8_t)fd, (uint8_t *)buf, (int)len, (int)timeout_ms);
 }
 
+/**
+ * @brief Wait until at least one of the TCP/SSL/UDP handles has data to read.
+ *
+ * @param [in] handles @n Handles to wait on, entries of 0 or -1 are skipped.
+ * @param [in] count @n Number of handles, at most 32.
+ * @param [in] timeout_ms @n Maximum wait, 0 to only check.
+ *
+ * @retval       -1 : Invalid argument.
+ * @retval        0 : Nothing readable in 'timeout_ms'.
+ * @retval      > 0 : Bit i set when handles[i] is readable.
+ * @see None.
+ */
+int HAL_Network_Wait(const uintptr_t handles[], int count, uint32_t timeout_ms)
+{
+    uint8_t endpoints[32];
+    int     index[32];
+    int     num = 0;
+    int     ready;
+    int     mask = 0;
+    int     i;
+
+    if (handles == NULL || count < 0 || count > 32) {
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (handles[i] == 0 || handles[i] == (uintptr_t)-1) {
+            continue;
+        }
+        endpoints[num] = (uint8_t)handles[i];
+        index[num++] = i;
+    }
+
+    if (num == 0) {
+        HAL_SleepMs(timeout_ms);
+        return 0;
+    }
+
+    ready = wifi_endpoint_wait(endpoints, num, (int)timeout_ms);
+    for (i = 0; i < num; i++) {
+        if (ready & (1 << i)) {
+            mask |= 1 << index[i];
+        }
+    }
+
+    return mask;
+}
+
+/**
+ * @brief Tell whether a TCP/SSL handle still is the connection it was opened as.
+ *
+ * @param [in] handle @n Handle returned by HAL_TCP_Establish() or HAL_SSL_Establish().
+ *
+ * @retval        0 : The connection is down, nothing is left to destroy.
+ * @retval      > 0 : Id of the connection, another one when the handle was given to another connection.
+ * @see None.
+ */
+uint32_t HAL_Network_Session(uintptr_t handle)
+{
+    if (handle == 0 || handle == (uintptr_t)-1) {
+        return 0;
+    }
+    return wifi_endpoint_session((uint8_t)handle);
+}
+
 intptr_t HAL_UDP_create_without_connect(_IN_ const char *host, _IN_ unsigned short port)
 {
     //printf("[%s][%d]trace\r\n", __func__, __LINE__);
@@ -1171,6 +1521,35 @@ int HAL_UDP_recvfrom(_IN_ intptr_t sockfd,
     return ret;
 }
 
+int HAL_UDP_recvfrom_borrow(_IN_ intptr_t sockfd,
+                            _OU_ NetworkAddr *p_remote,
+                            _OU_ unsigned char **pp_data,
+                            _IN_ unsigned int timeout_ms)
+{
+    int         ret = 0;
+    UDP_Addr    udpaddr;
+
+    ret = wifi_udp_read_borrow((uint8_t)sockfd, (uint8_t **)pp_data, (int)timeout_ms, &udpaddr);
+    if (ret <= 0) {
+        return -1;
+    }
+
+    p_remote->port = udpaddr.port;
+    sprintf((char *)p_remote->addr, "%d.%d.%d.%d", udpaddr.ipaddr & 0xFF, (udpaddr.ipaddr >> 8) & 0xFF, (udpaddr.ipaddr >> 16) & 0xFF, (udpaddr.ipaddr >> 24) & 0xFF);
+    return ret;
+}
+
+void HAL_UDP_recvfrom_release(_IN_ intptr_t sockfd)
+{
+    wifi_udp_read_release((uint8_t)sockfd);
+}
+
+void HAL_UDP_wakeup(_IN_ intptr_t sockfd)
+{
+    (void)sockfd;
+    wifi_udp_read_wakeup();
+}
+
 int HAL_UDP_sendto(_IN_ intptr_t sockfd,
                    _IN_ const NetworkAddr *p_remote,
                    _IN_ const unsigned char *p_data,
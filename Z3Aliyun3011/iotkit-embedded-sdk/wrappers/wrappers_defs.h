@@ -88,5 +88,49 @@ extern void *HAL_Timer_Task(void *para);
 extern int HAL_Timer_Task_Init();
 extern uint64_t HAL_UptimeMs(void);
 
+#define HAL_HEAP_SIZE_CLASSES   (8)
+
+typedef struct {
+    uint32_t limit;             /* largest block size of the class, 0 for the open ended last one */
+    uint32_t blocks;
+    uint32_t bytes;
+    uint32_t peak_bytes;
+} hal_heap_class_stats_t;
+
+typedef struct {
+    uint32_t in_use;
+    uint32_t peak;
+    uint32_t failures;
+    uint32_t allocs;            /* HAL_Malloc() calls so far, for per operation deltas */
+    uint32_t alloc_bytes;       /* bytes they asked for, wraps around */
+    hal_heap_class_stats_t size_class[HAL_HEAP_SIZE_CLASSES];
+} hal_heap_stats_t;
+
+typedef struct {
+    int slots;
+    int used;
+    int running;
+    int peak;                   /* highest slot ever used, slots are taken first free first */
+} hal_timer_stats_t;
+
+extern void HAL_Heap_GetStats(hal_heap_stats_t *stats);
+extern void HAL_Timer_GetStats(hal_timer_stats_t *stats);
+extern uint32_t HAL_Trace_Timestamp(void);
+extern uint32_t HAL_Trace_TimestampFreq(void);
+extern void HAL_Trace_Point(uint32_t id, int point);
+/* 1 when *ptr held expected and now holds desired, a full barrier either way */
+extern int HAL_Atomic_CompareExchange(volatile uint32_t *ptr, uint32_t expected, uint32_t desired);
+/* name the current task was created with, NULL when unknown */
+extern const char *HAL_ThreadName(void);
+/* infra_dlog sink, all of len or nothing: returns len, 0 when there is no room now */
+extern int HAL_DLog_Write(const void *data, uint32_t len);
+/* sub-device OTA image cache: erase it all, then write each byte once, in any order */
+extern int HAL_ImageCache_Open(uint32_t *capacity);
+extern int HAL_ImageCache_Erase(void);
+extern int HAL_ImageCache_Write(uint32_t offset, const void *data, uint32_t len);
+extern int HAL_ImageCache_Read(uint32_t offset, void *buf, uint32_t len);
+/* id of the connection a TCP/SSL handle is, changes when the handle is reused, 0 once it is down */
+extern uint32_t HAL_Network_Session(uintptr_t handle);
+
 #endif
 
@@ -0,0 +1,740 @@
+/*
+ * ota-relay-server.c
+ *
+ * Zigbee OTA server over the image cache of the SDK ota_relay module, see
+ * ota-relay-server.h.
+ */
+
+#include PLATFORM_HEADER
+#include "app/framework/include/af.h"
+#include "iotkit-embedded-sdk/infra/infra_config.h"
+#include "iotkit-embedded-sdk/ota_relay/ota_relay_api.h"
+#include "ota-relay-server.h"
+
+#ifdef OTA_RELAY_ENABLED
+
+// Field control bit of a Query Next Image Request
+#define QUERY_FC_HARDWARE_VERSION             0x01
+
+// Fixed part of the client request payloads
+#define QUERY_NEXT_IMAGE_REQUEST_LEN          9
+#define IMAGE_BLOCK_REQUEST_LEN               14
+#define IMAGE_PAGE_REQUEST_LEN                18
+#define UPGRADE_END_REQUEST_LEN               9
+
+#define OTA_RELAY_SERVER_NO_WAIT              0xFFFFFFFFUL
+
+typedef struct {
+  EmberNodeId nodeId;             // EMBER_NULL_NODE_ID when the slot is free
+  uint8_t clientEndpoint;
+  uint8_t serverEndpoint;
+  uint32_t lastActiveMs;
+  // image page in progress, none when pageLeft is 0
+  EmberAfOtaImageId pageImage;
+  uint32_t pageOffset;
+  uint32_t pageLeft;
+  uint8_t pageMaxDataSize;
+  uint16_t pageSpacingMs;
+  uint32_t pageNextMs;
+} OtaRelaySession;
+
+static OtaRelaySession sessions[OTA_RELAY_SERVER_MAX_SESSIONS];
+static uint8_t nextSession;
+static uint32_t lastTxMs;
+static uint32_t notifiedGeneration;
+static OtaRelayServerStats serverStats;
+
+static bool imageIdMatches(const EmberAfOtaImageId *id,
+                           const iotx_ota_relay_image_t *image)
+{
+  return (id->manufacturerId == image->manufacturer_id
+          && id->imageTypeId == image->image_type
+          && id->firmwareVersion == image->file_version);
+}
+
+static void imageIdFromImage(EmberAfOtaImageId *id,
+                             const iotx_ota_relay_image_t *image)
+{
+  MEMSET(id, 0, sizeof(EmberAfOtaImageId));
+  id->manufacturerId = image->manufacturer_id;
+  id->imageTypeId = image->image_type;
+  id->firmwareVersion = image->file_version;
+}
+
+static void imageIdFromPayload(EmberAfOtaImageId *id,
+                               const EmberAfClusterCommand *cmd,
+                               uint16_t index)
+{
+  MEMSET(id, 0, sizeof(EmberAfOtaImageId));
+  id->manufacturerId = emberAfGetInt16u(cmd->buffer, index, cmd->bufLen);
+  id->imageTypeId = emberAfGetInt16u(cmd->buffer, index + 2, cmd->bufLen);
+  id->firmwareVersion = emberAfGetInt32u(cmd->buffer, index + 4, cmd->bufLen);
+}
+
+// Returns the ms left until deadline, 0 once it has passed.
+static uint32_t msUntil(uint32_t deadline, uint32_t now)
+{
+  return ((int32_t)(deadline - now) > 0) ? (deadline - now) : 0;
+}
+
+// Finds the session of a node, or opens one when create is set and a slot is
+// free. Sessions of nodes that went quiet are closed on the way.
+static OtaRelaySession *findSession(EmberNodeId nodeId, bool create)
+{
+  uint32_t now = halCommonGetInt32uMillisecondTick();
+  OtaRelaySession *found = NULL;
+  OtaRelaySession *freeSlot = NULL;
+  uint8_t i;
+
+  for (i = 0; i < OTA_RELAY_SERVER_MAX_SESSIONS; i++) {
+    OtaRelaySession *session = &sessions[i];
+    if (session->nodeId != EMBER_NULL_NODE_ID
+        && session->nodeId != nodeId
+        && (elapsedTimeInt32u(session->lastActiveMs, now)
+            > OTA_RELAY_SERVER_SESSION_TIMEOUT_MS)) {
+      emberAfOtaBootloadClusterPrintln("OTA relay: node 0x%2x timed out",
+                                       session->nodeId);
+      session->nodeId = EMBER_NULL_NODE_ID;
+      serverStats.sessions--;
+    }
+    if (session->nodeId == nodeId) {
+      found = session;
+    } else if (session->nodeId == EMBER_NULL_NODE_ID && freeSlot == NULL) {
+      freeSlot = session;
+    }
+  }
+
+  if (found == NULL && create && freeSlot != NULL) {
+    MEMSET(freeSlot, 0, sizeof(OtaRelaySession));
+    freeSlot->nodeId = nodeId;
+    serverStats.sessions++;
+    found = freeSlot;
+  }
+  if (found != NULL) {
+    found->lastActiveMs = now;
+  }
+  return found;
+}
+
+static void closeSession(OtaRelaySession *session)
+{
+  session->nodeId = EMBER_NULL_NODE_ID;
+  session->pageLeft = 0;
+  serverStats.sessions--;
+}
+
+static void fillStatusOnly(uint8_t commandId, uint8_t status)
+{
+  emberAfFillExternalBuffer((ZCL_CLUSTER_SPECIFIC_COMMAND
+                             | ZCL_FRAME_CONTROL_SERVER_TO_CLIENT
+                             | ZCL_DISABLE_DEFAULT_RESPONSE_MASK),
+                            ZCL_OTA_BOOTLOAD_CLUSTER_ID,
+                            commandId,
+                            "u",
+                            status);
+}
+
+// The client is to retry after OTA_RELAY_SERVER_WAIT_SECONDS: a current time
+// of 0 makes the request time relative.
+static void sendWaitForData(void)
+{
+  serverStats.waits++;
+  emberAfFillExternalBuffer((ZCL_CLUSTER_SPECIFIC_COMMAND
+                             | ZCL_FRAME_CONTROL_SERVER_TO_CLIENT
+                             | ZCL_DISABLE_DEFAULT_RESPONSE_MASK),
+                            ZCL_OTA_BOOTLOAD_CLUSTER_ID,
+                            ZCL_IMAGE_BLOCK_RESPONSE_COMMAND_ID,
+                            "uww",
+                            EMBER_ZCL_STATUS_WAIT_FOR_DATA,
+                            0UL,
+                            (uint32_t)OTA_RELAY_SERVER_WAIT_SECONDS);
+  emberAfSendResponse();
+}
+
+// Fills an Image Block Response with up to maxDataSize bytes of the image at
+// offset, or with ABORT when they cannot be read. Returns the bytes filled.
+static uint8_t fillImageBlock(EmberNodeId nodeId,
+                              const EmberAfOtaImageId *id,
+                              uint32_t offset,
+                              uint8_t maxDataSize)
+{
+  uint8_t data[OTA_RELAY_SERVER_MAX_BLOCK_SIZE];
+  uint32_t readLength = 0;
+  uint8_t size = emberAfOtaServerBlockSizeCallback(nodeId);
+
+  if (size > maxDataSize) {
+    size = maxDataSize;
+  }
+  if (size > sizeof(data)) {
+    size = sizeof(data);
+  }
+
+  if (size == 0
+      || (emberAfOtaStorageReadImageDataCallback(id, offset, size, data, &readLength)
+          != EMBER_AF_OTA_STORAGE_SUCCESS)
+      || readLength == 0) {
+    serverStats.aborts++;
+    fillStatusOnly(ZCL_IMAGE_BLOCK_RESPONSE_COMMAND_ID, EMBER_ZCL_STATUS_ABORT);
+    return 0;
+  }
+
+  emberAfFillCommandOtaBootloadClusterImageBlockResponse(EMBER_ZCL_STATUS_SUCCESS,
+                                                         id->manufacturerId,
+                                                         id->imageTypeId,
+                                                         id->firmwareVersion,
+                                                         offset,
+                                                         (uint8_t)readLength,
+                                                         data,
+                                                         (uint8_t)readLength);
+  serverStats.blocksSent++;
+  serverStats.bytesSent += readLength;
+  return (uint8_t)readLength;
+}
+
+static void queryNextImageRequest(EmberAfClusterCommand *cmd)
+{
+  uint16_t index = cmd->payloadStartIndex;
+  EmberAfOtaImageId currentId;
+  EmberAfOtaImageId nextId = emberAfInvalidImageId;
+  uint16_t hardwareVersion;
+  bool hasHardwareVersion;
+  uint32_t imageSize = 0;
+  uint8_t status;
+
+  serverStats.queries++;
+  if (cmd->bufLen < index + QUERY_NEXT_IMAGE_REQUEST_LEN) {
+    emberAfSendImmediateDefaultResponse(EMBER_ZCL_STATUS_MALFORMED_COMMAND);
+    return;
+  }
+  hasHardwareVersion = ((emberAfGetInt8u(cmd->buffer, index, cmd->bufLen)
+                         & QUERY_FC_HARDWARE_VERSION) != 0);
+  imageIdFromPayload(&currentId, cmd, index + 1);
+  if (hasHardwareVersion) {
+    if (cmd->bufLen < index + QUERY_NEXT_IMAGE_REQUEST_LEN + 2) {
+      emberAfSendImmediateDefaultResponse(EMBER_ZCL_STATUS_MALFORMED_COMMAND);
+      return;
+    }
+    hardwareVersion = emberAfGetInt16u(cmd->buffer,
+                                       index + QUERY_NEXT_IMAGE_REQUEST_LEN,
+                                       cmd->bufLen);
+  }
+
+  status = emberAfOtaServerQueryCallback(&currentId,
+                                         hasHardwareVersion ? &hardwareVersion : NULL,
+                                         &nextId);
+  if (status == EMBER_ZCL_STATUS_SUCCESS) {
+    imageSize = emberAfOtaStorageGetTotalImageSizeCallback(&nextId);
+    if (imageSize == 0) {
+      status = EMBER_ZCL_STATUS_NO_IMAGE_AVAILABLE;
+    }
+  }
+
+  if (status == EMBER_ZCL_STATUS_SUCCESS) {
+    emberAfOtaBootloadClusterPrintln("OTA relay: node 0x%2x gets version 0x%4x",
+                                     cmd->source, nextId.firmwareVersion);
+    emberAfFillCommandOtaBootloadClusterQueryNextImageResponse(status,
+                                                               nextId.manufacturerId,
+                                                               nextId.imageTypeId,
+                                                               nextId.firmwareVersion,
+                                                               imageSize);
+  } else {
+    fillStatusOnly(ZCL_QUERY_NEXT_IMAGE_RESPONSE_COMMAND_ID, status);
+  }
+  emberAfSendResponse();
+}
+
+static void imageBlockRequest(EmberAfClusterCommand *cmd)
+{
+  uint16_t index = cmd->payloadStartIndex;
+  OtaRelaySession *session;
+  EmberAfOtaImageId id;
+  uint32_t offset;
+  uint8_t maxDataSize;
+
+  serverStats.blockRequests++;
+  if (cmd->bufLen < index + IMAGE_BLOCK_REQUEST_LEN) {
+    emberAfSendImmediateDefaultResponse(EMBER_ZCL_STATUS_MALFORMED_COMMAND);
+    return;
+  }
+  imageIdFromPayload(&id, cmd, index + 1);
+  offset = emberAfGetInt32u(cmd->buffer, index + 9, cmd->bufLen);
+  maxDataSize = emberAfGetInt8u(cmd->buffer, index + 13, cmd->bufLen);
+
+  session = findSession(cmd->source, true);
+  if (session == NULL) {
+    sendWaitForData();
+    return;
+  }
+  // a block request means the node gave up on the page it asked for
+  session->pageLeft = 0;
+
+  fillImageBlock(cmd->source, &id, offset, maxDataSize);
+  emberAfSendResponse();
+}
+
+static void imagePageRequest(EmberAfClusterCommand *cmd)
+{
+  uint16_t index = cmd->payloadStartIndex;
+  OtaRelaySession *session;
+  EmberAfOtaImageId id;
+  uint32_t offset;
+  uint32_t imageSize;
+
+  serverStats.pageRequests++;
+  if (cmd->bufLen < index + IMAGE_PAGE_REQUEST_LEN) {
+    emberAfSendImmediateDefaultResponse(EMBER_ZCL_STATUS_MALFORMED_COMMAND);
+    return;
+  }
+
+  imageIdFromPayload(&id, cmd, index + 1);
+  offset = emberAfGetInt32u(cmd->buffer, index + 9, cmd->bufLen);
+  imageSize = emberAfOtaStorageGetTotalImageSizeCallback(&id);
+  if (offset >= imageSize) {
+    serverStats.aborts++;
+    fillStatusOnly(ZCL_IMAGE_BLOCK_RESPONSE_COMMAND_ID, EMBER_ZCL_STATUS_ABORT);
+    emberAfSendResponse();
+    return;
+  }
+
+  session = findSession(cmd->source, true);
+  if (session == NULL) {
+    sendWaitForData();
+    return;
+  }
+
+  session->pageImage = id;
+  session->pageOffset = offset;
+  session->pageMaxDataSize = emberAfGetInt8u(cmd->buffer, index + 13, cmd->bufLen);
+  // the last page stops at the end of the image
+  session->pageLeft = emberAfGetInt16u(cmd->buffer, index + 14, cmd->bufLen);
+  if (session->pageLeft > imageSize - offset) {
+    session->pageLeft = imageSize - offset;
+  }
+  session->pageSpacingMs = emberAfGetInt16u(cmd->buffer, index + 16, cmd->bufLen);
+  if (session->pageSpacingMs < OTA_RELAY_SERVER_MIN_SPACING_MS) {
+    session->pageSpacingMs = OTA_RELAY_SERVER_MIN_SPACING_MS;
+  }
+  session->pageNextMs = halCommonGetInt32uMillisecondTick();
+  session->clientEndpoint = cmd->apsFrame->sourceEndpoint;
+  session->serverEndpoint = cmd->apsFrame->destinationEndpoint;
+
+  // the blocks of the page are the response, sent from the event
+  emberEventControlSetActive(otaRelayEventControl);
+}
+
+static void upgradeEndRequest(EmberAfClusterCommand *cmd)
+{
+  uint16_t index = cmd->payloadStartIndex;
+  OtaRelaySession *session;
+  EmberAfOtaImageId id;
+  uint32_t upgradeTime = 0;
+  uint8_t status;
+
+  serverStats.upgradeEnds++;
+  if (cmd->bufLen < index + UPGRADE_END_REQUEST_LEN) {
+    emberAfSendImmediateDefaultResponse(EMBER_ZCL_STATUS_MALFORMED_COMMAND);
+    return;
+  }
+  status = emberAfGetInt8u(cmd->buffer, index, cmd->bufLen);
+  imageIdFromPayload(&id, cmd, index + 1);
+
+  session = findSession(cmd->source, false);
+  if (session != NULL) {
+    closeSession(session);
+  }
+  emberAfOtaBootloadClusterPrintln("OTA relay: node 0x%2x download ended, status 0x%x",
+                                   cmd->source, status);
+
+  if (!emberAfOtaServerUpgradeEndRequestCallback(cmd->source, status, &upgradeTime, &id)
+      || status != EMBER_ZCL_STATUS_SUCCESS) {
+    emberAfSendImmediateDefaultResponse(status == EMBER_ZCL_STATUS_SUCCESS
+                                        ? EMBER_ZCL_STATUS_ABORT
+                                        : EMBER_ZCL_STATUS_SUCCESS);
+    return;
+  }
+
+  // a current time of 0 makes the upgrade time relative
+  emberAfFillCommandOtaBootloadClusterUpgradeEndResponse(id.manufacturerId,
+                                                         id.imageTypeId,
+                                                         id.firmwareVersion,
+                                                         0UL,
+                                                         upgradeTime);
+  emberAfSendResponse();
+}
+
+static void imageReady(void)
+{
+  // called from the relay task, the notify goes out from the event
+  emberEventControlSetActive(otaRelayEventControl);
+}
+
+void otaRelayServerInit(void)
+{
+  iotx_ota_relay_image_t image;
+  uint8_t i;
+
+  for (i = 0; i < OTA_RELAY_SERVER_MAX_SESSIONS; i++) {
+    sessions[i].nodeId = EMBER_NULL_NODE_ID;
+  }
+
+  if (0 != IOT_OtaRelay_Init(imageReady)) {
+    emberAfCorePrintln("OTA relay: init failed");
+    return;
+  }
+  // an image restored from the cache is not news, the nodes find it when
+  // they query
+  if (0 == IOT_OtaRelay_GetImage(&image)) {
+    notifiedGeneration = image.generation;
+  }
+}
+
+bool otaRelayServerCommandReceived(EmberAfClusterCommand *cmd)
+{
+  if (cmd->apsFrame->clusterId != ZCL_OTA_BOOTLOAD_CLUSTER_ID
+      || !cmd->clusterSpecific
+      || cmd->mfgSpecific
+      || cmd->direction != ZCL_DIRECTION_CLIENT_TO_SERVER) {
+    return false;
+  }
+
+  switch (cmd->commandId) {
+    case ZCL_QUERY_NEXT_IMAGE_REQUEST_COMMAND_ID:
+      queryNextImageRequest(cmd);
+      return true;
+    case ZCL_IMAGE_BLOCK_REQUEST_COMMAND_ID:
+      imageBlockRequest(cmd);
+      return true;
+    case ZCL_IMAGE_PAGE_REQUEST_COMMAND_ID:
+      imagePageRequest(cmd);
+      return true;
+    case ZCL_UPGRADE_END_REQUEST_COMMAND_ID:
+      upgradeEndRequest(cmd);
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Sends the next block of the page of a session, ends the page when it is
+// complete or a block could not be read or sent.
+static void sendPageBlock(OtaRelaySession *session, uint32_t now)
+{
+  uint8_t maxDataSize = session->pageMaxDataSize;
+  uint8_t sent;
+
+  if (session->pageLeft < maxDataSize) {
+    maxDataSize = (uint8_t)session->pageLeft;
+  }
+  sent = fillImageBlock(session->nodeId,
+                        &session->pageImage,
+                        session->pageOffset,
+                        maxDataSize);
+  emberAfSetCommandEndpoints(session->serverEndpoint, session->clientEndpoint);
+  if (emberAfSendCommandUnicast(EMBER_OUTGOING_DIRECT, session->nodeId)
+      != EMBER_SUCCESS
+      || sent == 0) {
+    // the node asks again for what it is missing
+    session->pageLeft = 0;
+    return;
+  }
+
+  session->pageOffset += sent;
+  session->pageLeft -= sent;
+  session->pageNextMs = now + session->pageSpacingMs;
+  session->lastActiveMs = now;
+}
+
+void otaRelayServerTick(void)
+{
+  iotx_ota_relay_image_t image;
+  EmberAfOtaImageId id;
+  OtaRelaySession *due = NULL;
+  uint32_t now = halCommonGetInt32uMillisecondTick();
+  uint32_t wait = OTA_RELAY_SERVER_NO_WAIT;
+  uint8_t i;
+
+  if (0 == IOT_OtaRelay_GetImage(&image)
+      && image.generation != notifiedGeneration) {
+    notifiedGeneration = image.generation;
+    imageIdFromImage(&id, &image);
+    if (emberAfOtaServerSendImageNotifyCallback(EMBER_RX_ON_WHEN_IDLE_BROADCAST_ADDRESS,
+                                                EMBER_BROADCAST_ENDPOINT,
+                                                3,
+                                                OTA_RELAY_SERVER_NOTIFY_JITTER,
+                                                &id)) {
+      serverStats.notifies++;
+    }
+  }
+
+  // one page block per gap, round robin over the sessions that are due, so
+  // one node with a short spacing cannot take all the air time
+  for (i = 0; i < OTA_RELAY_SERVER_MAX_SESSIONS; i++) {
+    OtaRelaySession *session = &sessions[(nextSession + i) % OTA_RELAY_SERVER_MAX_SESSIONS];
+    if (session->nodeId == EMBER_NULL_NODE_ID || session->pageLeft == 0) {
+      continue;
+    }
+    if (due == NULL && msUntil(session->pageNextMs, now) == 0
+        && msUntil(lastTxMs + OTA_RELAY_SERVER_TX_GAP_MS, now) == 0) {
+      due = session;
+      nextSession = (nextSession + i + 1) % OTA_RELAY_SERVER_MAX_SESSIONS;
+      sendPageBlock(session, now);
+      lastTxMs = now;
+      if (session->pageLeft == 0) {
+        continue;
+      }
+    }
+    if (msUntil(session->pageNextMs, now) < wait) {
+      wait = msUntil(session->pageNextMs, now);
+    }
+  }
+
+  if (wait != OTA_RELAY_SERVER_NO_WAIT) {
+    if (wait < msUntil(lastTxMs + OTA_RELAY_SERVER_TX_GAP_MS, now)) {
+      wait = msUntil(lastTxMs + OTA_RELAY_SERVER_TX_GAP_MS, now);
+    }
+    emberEventControlSetDelayMS(otaRelayEventControl, wait);
+  }
+}
+
+void otaRelayServerGetStats(OtaRelayServerStats *stats)
+{
+  *stats = serverStats;
+}
+
+uint8_t emberAfOtaServerQueryCallback(const EmberAfOtaImageId* currentImageId,
+                                      uint16_t* hardwareVersion,
+                                      EmberAfOtaImageId* nextUpgradeImageId)
+{
+  EmberAfOtaImageId id = emberAfOtaStorageSearchCallback(currentImageId->manufacturerId,
+                                                         currentImageId->imageTypeId,
+                                                         hardwareVersion);
+
+  // only upgrades, a node already on the cached version or a later one stays
+  if (id.manufacturerId != currentImageId->manufacturerId
+      || id.imageTypeId != currentImageId->imageTypeId
+      || id.firmwareVersion <= currentImageId->firmwareVersion) {
+    return EMBER_ZCL_STATUS_NO_IMAGE_AVAILABLE;
+  }
+  *nextUpgradeImageId = id;
+  return EMBER_ZCL_STATUS_SUCCESS;
+}
+
+bool emberAfOtaServerSendImageNotifyCallback(EmberNodeId dest,
+                                             uint8_t endpoint,
+                                             uint8_t payloadType,
+                                             uint8_t queryJitter,
+                                             const EmberAfOtaImageId* id)
+{
+  // the payload type says how many of the image id fields go along
+  static const char * const formats[] = { "uu", "uuv", "uuvv", "uuvvw" };
+  EmberStatus status;
+
+  if (payloadType >= COUNTOF(formats)) {
+    return false;
+  }
+  emberAfFillExternalBuffer((ZCL_CLUSTER_SPECIFIC_COMMAND
+                             | ZCL_FRAME_CONTROL_SERVER_TO_CLIENT
+                             | ZCL_DISABLE_DEFAULT_RESPONSE_MASK),
+                            ZCL_OTA_BOOTLOAD_CLUSTER_ID,
+                            ZCL_IMAGE_NOTIFY_COMMAND_ID,
+                            formats[payloadType],
+                            payloadType,
+                            queryJitter,
+                            id->manufacturerId,
+                            id->imageTypeId,
+                            id->firmwareVersion);
+  emberAfSetCommandEndpoints(emberAfPrimaryEndpoint(), endpoint);
+  if (emberIsZigbeeBroadcastAddress(dest)) {
+    status = emberAfSendCommandBroadcast(dest);
+  } else {
+    status = emberAfSendCommandUnicast(EMBER_OUTGOING_DIRECT, dest);
+  }
+  return (status == EMBER_SUCCESS);
+}
+
+// The storage holds the one image of the relay cache.
+
+EmberAfOtaStorageStatus emberAfOtaStorageInitCallback(void)
+{
+  return EMBER_AF_OTA_STORAGE_SUCCESS;
+}
+
+void emberAfOtaStorageCloseCallback(void)
+{
+}
+
+uint8_t emberAfOtaStorageGetCountCallback(void)
+{
+  iotx_ota_relay_image_t image;
+
+  return (0 == IOT_OtaRelay_GetImage(&image)) ? 1 : 0;
+}
+
+EmberAfOtaImageId emberAfOtaStorageIteratorFirstCallback(void)
+{
+  iotx_ota_relay_image_t image;
+  EmberAfOtaImageId id = emberAfInvalidImageId;
+
+  if (0 == IOT_OtaRelay_GetImage(&image)) {
+    imageIdFromImage(&id, &image);
+  }
+  return id;
+}
+
+EmberAfOtaImageId emberAfOtaStorageIteratorNextCallback(void)
+{
+  return emberAfInvalidImageId;
+}
+
+EmberAfOtaImageId emberAfOtaStorageSearchCallback(uint16_t manufacturerId,
+                                                  uint16_t imageTypeId,
+                                                  const uint16_t* hardwareVersion)
+{
+  iotx_ota_relay_image_t image;
+  EmberAfOtaImageId id = emberAfInvalidImageId;
+
+  if (0 != IOT_OtaRelay_GetImage(&image)
+      || image.manufacturer_id != manufacturerId
+      || image.image_type != imageTypeId) {
+    return id;
+  }
+  // an image without hardware versions is for any hardware
+  if (hardwareVersion != NULL
+      && (image.field_control & OTA_RELAY_FC_HW_VERSIONS)
+      && (*hardwareVersion < image.min_hw_version
+          || *hardwareVersion > image.max_hw_version)) {
+    return id;
+  }
+  imageIdFromImage(&id, &image);
+  return id;
+}
+
+EmberAfOtaStorageStatus emberAfOtaStorageGetFullHeaderCallback(const EmberAfOtaImageId* id,
+                                                               EmberAfOtaHeader* returnData)
+{
+  iotx_ota_relay_image_t image;
+
+  if (0 != IOT_OtaRelay_GetImage(&image) || !imageIdMatches(id, &image)) {
+    return EMBER_AF_OTA_STORAGE_ERROR;
+  }
+
+  MEMSET(returnData, 0, sizeof(EmberAfOtaHeader));
+  returnData->headerVersion = image.header_version;
+  returnData->headerLength = image.header_length;
+  returnData->fieldControl = image.field_control;
+  returnData->manufacturerId = image.manufacturer_id;
+  returnData->imageTypeId = image.image_type;
+  returnData->firmwareVersion = image.file_version;
+  returnData->zigbeeStackVersion = image.stack_version;
+  MEMCOPY(returnData->headerString, image.header_string, EMBER_AF_OTA_MAX_HEADER_STRING_LENGTH);
+  returnData->imageSize = image.image_size;
+  returnData->securityCredentials = image.security_credential_version;
+  MEMCOPY(returnData->upgradeFileDestination, image.destination, EUI64_SIZE);
+  returnData->minimumHardwareVersion = image.min_hw_version;
+  returnData->maximumHardwareVersion = image.max_hw_version;
+  return EMBER_AF_OTA_STORAGE_SUCCESS;
+}
+
+uint32_t emberAfOtaStorageGetTotalImageSizeCallback(const EmberAfOtaImageId* id)
+{
+  iotx_ota_relay_image_t image;
+
+  if (0 != IOT_OtaRelay_GetImage(&image) || !imageIdMatches(id, &image)) {
+    return 0;
+  }
+  return image.image_size;
+}
+
+EmberAfOtaStorageStatus emberAfOtaStorageReadImageDataCallback(const EmberAfOtaImageId* id,
+                                                               uint32_t offset,
+                                                               uint32_t length,
+                                                               uint8_t* returnData,
+                                                               uint32_t* returnedLength)
+{
+  iotx_ota_relay_image_t image;
+  int res;
+
+  if (0 != IOT_OtaRelay_GetImage(&image) || !imageIdMatches(id, &image)) {
+    return EMBER_AF_OTA_STORAGE_ERROR;
+  }
+  // the generation fails the read if another image replaced this one since
+  res = IOT_OtaRelay_Read(image.generation, offset, returnData, length);
+  if (res < 0) {
+    return EMBER_AF_OTA_STORAGE_ERROR;
+  }
+  *returnedLength = (uint32_t)res;
+  return EMBER_AF_OTA_STORAGE_SUCCESS;
+}
+
+#else /* OTA_RELAY_ENABLED */
+
+// Without the relay there is no image to serve.
+
+uint8_t emberAfOtaServerQueryCallback(const EmberAfOtaImageId* currentImageId,
+                                      uint16_t* hardwareVersion,
+                                      EmberAfOtaImageId* nextUpgradeImageId)
+{
+  return EMBER_ZCL_STATUS_NO_IMAGE_AVAILABLE;
+}
+
+bool emberAfOtaServerSendImageNotifyCallback(EmberNodeId dest,
+                                             uint8_t endpoint,
+                                             uint8_t payloadType,
+                                             uint8_t queryJitter,
+                                             const EmberAfOtaImageId* id)
+{
+  return false;
+}
+
+EmberAfOtaStorageStatus emberAfOtaStorageInitCallback(void)
+{
+  return EMBER_AF_OTA_STORAGE_SUCCESS;
+}
+
+void emberAfOtaStorageCloseCallback(void)
+{
+}
+
+uint8_t emberAfOtaStorageGetCountCallback(void)
+{
+  return 0;
+}
+
+EmberAfOtaImageId emberAfOtaStorageIteratorFirstCallback(void)
+{
+  return emberAfInvalidImageId;
+}
+
+EmberAfOtaImageId emberAfOtaStorageIteratorNextCallback(void)
+{
+  return emberAfInvalidImageId;
+}
+
+EmberAfOtaImageId emberAfOtaStorageSearchCallback(uint16_t manufacturerId,
+                                                  uint16_t imageTypeId,
+                                                  const uint16_t* hardwareVersion)
+{
+  return emberAfInvalidImageId;
+}
+
+EmberAfOtaStorageStatus emberAfOtaStorageGetFullHeaderCallback(const EmberAfOtaImageId* id,
+                                                               EmberAfOtaHeader* returnData)
+{
+  return EMBER_AF_OTA_STORAGE_ERROR;
+}
+
+uint32_t emberAfOtaStorageGetTotalImageSizeCallback(const EmberAfOtaImageId* id)
+{
+  return 0;
+}
+
+EmberAfOtaStorageStatus emberAfOtaStorageReadImageDataCallback(const EmberAfOtaImageId* id,
+                                                               uint32_t offset,
+                                                               uint32_t length,
+                                                               uint8_t* returnData,
+                                                               uint32_t* returnedLength)
+{
+  return EMBER_AF_OTA_STORAGE_ERROR;
+}
+
+#endif /* OTA_RELAY_ENABLED */
@@ -0,0 +1,58 @@
+/*
+ * ota-relay-server.h
+ *
+ * Zigbee OTA server for the sub-device images the gateway relays from the
+ * cloud. The image is downloaded once by the SDK ota_relay module into its
+ * image cache and every node that queries for it is served from there.
+ *
+ * The ota-server plugin is not part of this build, so the OTA cluster
+ * commands are taken in emberAfPreCommandReceivedCallback() and the OTA
+ * server/storage callbacks are implemented here on top of the relay cache.
+ */
+
+#ifndef OTA_RELAY_SERVER_H_
+#define OTA_RELAY_SERVER_H_
+
+// Nodes downloading at the same time. The others are told to wait and
+// query again later.
+#define OTA_RELAY_SERVER_MAX_SESSIONS         4
+// A node that sent no request for this long gives its slot up.
+#define OTA_RELAY_SERVER_SESSION_TIMEOUT_MS   60000
+// Seconds a node turned away is asked to wait before the next request.
+#define OTA_RELAY_SERVER_WAIT_SECONDS         60
+// Shortest gap between two blocks of an image page, and between any two
+// page blocks the server sends, whoever they go to.
+#define OTA_RELAY_SERVER_MIN_SPACING_MS       20
+#define OTA_RELAY_SERVER_TX_GAP_MS            10
+#define OTA_RELAY_SERVER_MAX_BLOCK_SIZE       80
+// Query jitter of the Image Notify broadcast when a new image is ready.
+#define OTA_RELAY_SERVER_NOTIFY_JITTER        50
+
+typedef struct {
+  uint8_t  sessions;
+  uint32_t queries;
+  uint32_t blockRequests;
+  uint32_t pageRequests;
+  uint32_t blocksSent;
+  uint32_t bytesSent;
+  uint32_t waits;           // requests turned away, all sessions busy
+  uint32_t aborts;
+  uint32_t upgradeEnds;
+  uint32_t notifies;
+} OtaRelayServerStats;
+
+extern EmberEventControl otaRelayEventControl;
+
+void otaRelayServerInit(void);
+
+// Handles the OTA cluster commands of a client, returns false for anything
+// else.
+bool otaRelayServerCommandReceived(EmberAfClusterCommand *cmd);
+
+// Sends the page blocks that are due and the Image Notify of a new image,
+// from otaRelayEventHandler().
+void otaRelayServerTick(void);
+
+void otaRelayServerGetStats(OtaRelayServerStats *stats);
+
+#endif /* OTA_RELAY_SERVER_H_ */
@@ -14,8 +14,14 @@ typedef unsigned char  uint8;
 typedef signed char   int8;
 typedef unsigned short uint16;
 typedef signed short   int16;
+#ifdef IOTX_HOST_BUILD
+/* long is 64 bit on LP64 hosts, the packet header and fields are 32 */
+typedef uint32_t       uint32;
+typedef int32_t        int32;
+#else
 typedef unsigned long  uint32;
 typedef signed long    int32;
+#endif
 
 typedef struct bd_addr_t
 {
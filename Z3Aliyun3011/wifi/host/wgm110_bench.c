@@ -0,0 +1,391 @@
+/*
+ * WGM110 driver benchmark for the host build.
+ *
+ * Runs the unmodified wgm110.c against the module simulator on a pty:
+ * the simulator, with a TCP echo and a TCP discard server behind it, is
+ * forked off so the getrusage() figures below belong to the driver side
+ * only (the bench thread calling the wifi_xxx API, plus wifi_task).
+ *
+ * Reported per phase:
+ *   command round trip  wifi_tls_set_auth_mode(), one command and its response
+ *   echo round trip     wifi_tcpip_write() + wifi_tcpip_read() of -s bytes via the echo server
+ *   TLS reconnect       wifi_tls_set_user_cert() + wifi_tcpip_tls_connect_byhostname() + disconnect,
+ *                       the way HAL_SSL_Establish() and HAL_SSL_Destroy() do it
+ *   write throughput    -t bytes through wifi_tcpip_write() to the discard server
+ *   idle                -i ms with the link up and nothing to do
+ * and for each the driver's wakeups (context switches), CPU time and
+ * how many uart_rx() polls found the rx FIFO empty.
+ *
+ * The driver's WiFi_TracePrintln()/WiFi_ErrPrintln() go to the infra_dlog
+ * ring, written out at the end to IOTX_DLOG_FILE for dlog_decode.
+ *
+ * usage: wgm110_bench [-b baud] [-l module latency us] [-n round trips] [-s size] [-t write bytes] [-i idle ms] [-v]
+ */
+#define _GNU_SOURCE     /* posix_openpt() and friends */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "infra_config.h"
+#include "wgm110_port.h"
+#include "wgm110_sim.h"
+#include "wgm110.h"
+#ifdef INFRA_DLOG
+#include "infra_dlog.h"
+#endif
+
+#define BENCH_SIZE_MAX      4096
+
+typedef struct {
+    uint64_t            us;
+    uint64_t            cpu_us;
+    uint64_t            csw;
+    wgm110_port_stats_t port;
+} bench_sample_t;
+
+typedef struct {
+    int                 fd;
+    bool                echo;
+} bench_server_t;
+
+static bench_server_t g_bench_servers[2];
+
+extern void HAL_SleepMs(uint32_t ms);
+
+static uint64_t bench_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int bench_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void bench_sample(bench_sample_t *sample)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    sample->us = bench_now_us();
+    sample->cpu_us = (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000
+                     + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+    sample->csw = ru.ru_nvcsw + ru.ru_nivcsw;
+    wgm110_port_get_stats(&sample->port);
+}
+
+static void bench_report_cpu(const char *phase, const bench_sample_t *start, const bench_sample_t *end)
+{
+    double   secs = (end->us - start->us) / 1e6;
+    uint32_t polls = end->port.rx_polls - start->port.rx_polls;
+    uint32_t empty = end->port.rx_empty - start->port.rx_empty;
+
+    printf("  %-10s %8.0f wakeups/s  cpu %5.1f%%  uart polls %8.0f/s, %3.0f%% empty\n",
+           phase,
+           (end->csw - start->csw) / secs,
+           (end->cpu_us - start->cpu_us) / 1e4 / secs,
+           polls / secs,
+           polls ? 100.0 * empty / polls : 0.0);
+}
+
+static void bench_report_latency(const char *what, uint64_t *samples, uint32_t count)
+{
+    qsort(samples, count, sizeof(uint64_t), bench_cmp);
+    printf("  %-20s us: min %llu p50 %llu p90 %llu p99 %llu max %llu\n",
+           what,
+           (unsigned long long)samples[0],
+           (unsigned long long)samples[count / 2],
+           (unsigned long long)samples[count * 9 / 10],
+           (unsigned long long)samples[count * 99 / 100],
+           (unsigned long long)samples[count - 1]);
+}
+
+static int bench_listen(uint16_t *port)
+{
+    struct sockaddr_in addr;
+    socklen_t          addr_len = sizeof(addr);
+    int                fd;
+
+    fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || 0 != bind(fd, (struct sockaddr *)&addr, sizeof(addr)) || 0 != listen(fd, 4)
+        || 0 != getsockname(fd, (struct sockaddr *)&addr, &addr_len)) {
+        return -1;
+    }
+
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+/* echo or discard server, one connection at a time */
+static void *bench_server_task(void *para)
+{
+    bench_server_t *server = (bench_server_t *)para;
+    uint8_t         buf[BENCH_SIZE_MAX];
+    ssize_t         ret;
+    int             fd;
+
+    while ((fd = accept(server->fd, NULL, NULL)) >= 0) {
+        while ((ret = recv(fd, buf, sizeof(buf), 0)) > 0) {
+            if (server->echo && send(fd, buf, ret, MSG_NOSIGNAL) != ret) {
+                break;
+            }
+        }
+        close(fd);
+    }
+
+    return NULL;
+}
+
+static pid_t bench_start_sim(const wgm110_sim_config_t *config, int echo_fd, int discard_fd, char *tty, size_t tty_len)
+{
+    pthread_t task;
+    pid_t     pid;
+    int       master;
+    int       slave;
+
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || 0 != grantpt(master) || 0 != unlockpt(master) || NULL == ptsname(master)) {
+        return -1;
+    }
+    snprintf(tty, tty_len, "%s", ptsname(master));
+
+    /* held by the simulator so the pty does not hang up before the driver opens it */
+    slave = open(tty, O_RDWR | O_NOCTTY);
+    if (slave < 0) {
+        return -1;
+    }
+
+    pid = fork();
+    if (0 == pid) {
+        g_bench_servers[0].fd = echo_fd;
+        g_bench_servers[0].echo = true;
+        g_bench_servers[1].fd = discard_fd;
+        g_bench_servers[1].echo = false;
+        pthread_create(&task, NULL, bench_server_task, &g_bench_servers[0]);
+        pthread_create(&task, NULL, bench_server_task, &g_bench_servers[1]);
+        exit((0 == wgm110_sim_run(master, config)) ? 0 : 1);
+    }
+
+    close(master);
+    close(slave);
+    close(echo_fd);
+    close(discard_fd);
+    return pid;
+}
+
+int main(int argc, char *argv[])
+{
+    wgm110_sim_config_t config;
+    bench_sample_t      s0;
+    bench_sample_t      s1;
+    char                tty[64];
+    uint16_t            echo_port;
+    uint16_t            discard_port;
+    int                 echo_fd;
+    int                 discard_fd;
+    uint32_t            count = 200;
+    uint32_t            size = 64;
+    uint32_t            total = 16384;
+    uint32_t            idle_ms = 2000;
+    uint32_t            i;
+    uint32_t            done;
+    uint64_t           *latency_us;
+    uint64_t            t0;
+    uint8_t            *buf;
+    uint8_t             endpoint;
+    WiFi_Stats          stats;
+    pid_t               pid;
+    int                 ret = 0;
+    int                 opt;
+
+    memset(&config, 0, sizeof(config));
+    config.baud = 115200;
+    config.latency_us = 500;
+
+    while ((opt = getopt(argc, argv, "b:l:n:s:t:i:v")) != -1) {
+        switch (opt) {
+            case 'b':
+                config.baud = (uint32_t)atoi(optarg);
+                break;
+            case 'l':
+                config.latency_us = (uint32_t)atoi(optarg);
+                break;
+            case 'n':
+                count = (uint32_t)atoi(optarg);
+                break;
+            case 's':
+                size = (uint32_t)atoi(optarg);
+                break;
+            case 't':
+                total = (uint32_t)atoi(optarg);
+                break;
+            case 'i':
+                idle_ms = (uint32_t)atoi(optarg);
+                break;
+            case 'v':
+                config.verbose = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-b baud] [-l latency us] [-n round trips] [-s size] [-t write bytes] [-i idle ms] [-v]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (0 == count || 0 == size || size > BENCH_SIZE_MAX || 0 == total) {
+        fprintf(stderr, "invalid arguments, size 1..%d\n", BENCH_SIZE_MAX);
+        return 1;
+    }
+
+    latency_us = (uint64_t *)calloc(count, sizeof(uint64_t));
+    buf = (uint8_t *)calloc(1, BENCH_SIZE_MAX);
+    echo_fd = bench_listen(&echo_port);
+    discard_fd = bench_listen(&discard_port);
+    if (NULL == latency_us || NULL == buf || echo_fd < 0 || discard_fd < 0) {
+        return 1;
+    }
+
+    pid = bench_start_sim(&config, echo_fd, discard_fd, tty, sizeof(tty));
+    if (pid < 0) {
+        fprintf(stderr, "start simulator failed: %s\n", strerror(errno));
+        return 1;
+    }
+    setenv(WGM110_UART_ENV, tty, 1);
+
+    printf("wgm110_bench: %s, %u baud, %u us module latency\n", tty, config.baud, config.latency_us);
+
+    t0 = bench_now_us();
+    if (0 != wifi_init() || 0 != wifi_connect("bench", "bench", 5000)) {
+        fprintf(stderr, "wifi bring-up failed\n");
+        ret = 1;
+        goto exit;
+    }
+    printf("  bring-up %llu ms (reset, PS load, wifi on, connect)\n", (unsigned long long)(bench_now_us() - t0) / 1000);
+
+    /* command round trip */
+    bench_sample(&s0);
+    for (i = 0; i < count; i++) {
+        t0 = bench_now_us();
+        if (0 != wifi_tls_set_auth_mode(1)) {
+            fprintf(stderr, "command %u failed\n", i);
+            ret = 1;
+            goto exit;
+        }
+        latency_us[i] = bench_now_us() - t0;
+    }
+    bench_sample(&s1);
+    bench_report_latency("command round trip", latency_us, count);
+    bench_report_cpu("command", &s0, &s1);
+
+    /* echo round trip */
+    if (0 != wifi_tcpip_tcp_connect_byhostname("localhost", echo_port, &endpoint)) {
+        fprintf(stderr, "connect echo server failed\n");
+        ret = 1;
+        goto exit;
+    }
+    memset(buf, 'x', size);
+    bench_sample(&s0);
+    for (i = 0; i < count; i++) {
+        t0 = bench_now_us();
+        if (wifi_tcpip_write(endpoint, buf, size, 2000) != (int)size
+            || wifi_tcpip_read(endpoint, buf, size, 2000) != (int)size) {
+            fprintf(stderr, "echo %u failed\n", i);
+            ret = 1;
+            goto exit;
+        }
+        latency_us[i] = bench_now_us() - t0;
+    }
+    bench_sample(&s1);
+    wifi_tcpip_disconnect(endpoint);
+    printf("  echo of %u bytes\n", size);
+    bench_report_latency("echo round trip", latency_us, count);
+    bench_report_cpu("echo", &s0, &s1);
+
+    /* TLS reconnect, the simulator makes a plain TCP connection of it */
+    bench_sample(&s0);
+    for (i = 0; i < count; i++) {
+        t0 = bench_now_us();
+        if (0 != wifi_tls_set_user_cert("-----BEGIN CERTIFICATE-----\nbench\n-----END CERTIFICATE-----\n")
+            || 0 != wifi_tcpip_tls_connect_byhostname("localhost", echo_port, &endpoint)) {
+            fprintf(stderr, "reconnect %u failed\n", i);
+            ret = 1;
+            goto exit;
+        }
+        wifi_tcpip_disconnect(endpoint);
+        latency_us[i] = bench_now_us() - t0;
+    }
+    bench_sample(&s1);
+    if (0 == wifi_get_stats(&stats)) {
+        printf("  dns cache hits %u resolves %u, certificate uploads %u skipped %u\n",
+               stats.dns_hits, stats.dns_resolves, stats.tls_cert_uploads, stats.tls_cert_skips);
+    }
+    bench_report_latency("TLS reconnect", latency_us, count);
+    bench_report_cpu("reconnect", &s0, &s1);
+
+    /* write throughput */
+    if (0 != wifi_tcpip_tcp_connect_byhostname("localhost", discard_port, &endpoint)) {
+        fprintf(stderr, "connect discard server failed\n");
+        ret = 1;
+        goto exit;
+    }
+    bench_sample(&s0);
+    for (done = 0; done < total; done += ret) {
+        ret = wifi_tcpip_write(endpoint, buf, (total - done < BENCH_SIZE_MAX) ? total - done : BENCH_SIZE_MAX, 2000);
+        if (ret <= 0) {
+            fprintf(stderr, "write failed after %u bytes\n", done);
+            ret = 1;
+            goto exit;
+        }
+    }
+    ret = 0;
+    bench_sample(&s1);
+    printf("  write %u bytes in %llu ms: %.1f KB/s",
+           total, (unsigned long long)(s1.us - s0.us) / 1000,
+           total * 1e6 / 1024 / (s1.us - s0.us));
+    if (config.baud) {
+        printf(", UART ceiling %.1f KB/s", config.baud / 10.0 / 1024);
+    }
+    printf("\n");
+    bench_report_cpu("write", &s0, &s1);
+
+    /* idle with an endpoint open */
+    bench_sample(&s0);
+    HAL_SleepMs(idle_ms);
+    bench_sample(&s1);
+    bench_report_cpu("idle", &s0, &s1);
+    wifi_tcpip_disconnect(endpoint);
+
+exit:
+#ifdef INFRA_DLOG
+    /* the driver's traces, for IOTX_DLOG_FILE; no drain task, it would show in the wakeups */
+    iotx_dlog_drain();
+#endif
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    free(latency_us);
+    free(buf);
+
+    return ret;
+}
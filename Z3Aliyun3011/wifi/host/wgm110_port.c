@@ -0,0 +1,208 @@
+/*
+ * wgm110_port.c
+ *
+ * Serial and semaphore stand-ins for building wgm110.c on Linux, see
+ * wgm110_port.h. Reads never block, like the EFR32 driver reading its rx
+ * FIFO, so uart_rx() keeps polling at the same 1 ms period as on target
+ * and the wakeups it costs show up in wgm110_bench.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+
+#include "wgm110_port.h"
+
+static int                  g_uart_fd = -1;
+static wgm110_port_stats_t  g_port_stats;
+
+static speed_t port_baud_to_speed(uint32_t rate)
+{
+    switch (rate) {
+        case 9600:
+            return B9600;
+        case 19200:
+            return B19200;
+        case 38400:
+            return B38400;
+        case 57600:
+            return B57600;
+        case 230400:
+            return B230400;
+        case 460800:
+            return B460800;
+        case 921600:
+            return B921600;
+        default:
+            return B115200;
+    }
+}
+
+EmberStatus emberSerialInit(uint8_t port, uint32_t rate, uint8_t parity, uint8_t stopBits)
+{
+    struct termios  tio;
+    const char     *path = getenv(WGM110_UART_ENV);
+
+    (void)port;
+    (void)parity;
+    (void)stopBits;
+
+    if (NULL == path) {
+        fprintf(stderr, "%s not set\n", WGM110_UART_ENV);
+        return EMBER_ERR_FATAL;
+    }
+
+    g_uart_fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (g_uart_fd < 0) {
+        fprintf(stderr, "open %s: %s\n", path, strerror(errno));
+        return EMBER_ERR_FATAL;
+    }
+
+    /* 8N1 without flow control, the line discipline must not touch the frames */
+    if (0 == tcgetattr(g_uart_fd, &tio)) {
+        cfmakeraw(&tio);
+        cfsetspeed(&tio, port_baud_to_speed(rate));
+        tio.c_cflag |= CLOCAL | CREAD;
+        tio.c_cflag &= ~CRTSCTS;
+        tcsetattr(g_uart_fd, TCSANOW, &tio);
+    }
+
+    return EMBER_SUCCESS;
+}
+
+uint16_t emberSerialReadAvailable(uint8_t port)
+{
+    int avail = 0;
+
+    (void)port;
+
+    g_port_stats.rx_polls++;
+    if (g_uart_fd < 0 || 0 != ioctl(g_uart_fd, FIONREAD, &avail) || avail <= 0) {
+        g_port_stats.rx_empty++;
+        return 0;
+    }
+
+    return (avail > 0xFFFF) ? 0xFFFF : (uint16_t)avail;
+}
+
+EmberStatus emberSerialReadData(uint8_t port, uint8_t *data, uint16_t length, uint16_t *bytesRead)
+{
+    ssize_t ret;
+
+    (void)port;
+
+    ret = read(g_uart_fd, data, length);
+    if (ret <= 0) {
+        if (NULL != bytesRead) {
+            *bytesRead = 0;
+        }
+        return EMBER_SERIAL_RX_EMPTY;
+    }
+
+    g_port_stats.rx_bytes += ret;
+    if (NULL != bytesRead) {
+        *bytesRead = (uint16_t)ret;
+    }
+    return (ret == length) ? EMBER_SUCCESS : EMBER_SERIAL_RX_EMPTY;
+}
+
+EmberStatus emberSerialWriteData(uint8_t port, uint8_t *data, uint16_t length)
+{
+    uint16_t sent = 0;
+    ssize_t  ret;
+
+    (void)port;
+
+    g_port_stats.tx_calls++;
+    while (sent < length) {
+        ret = write(g_uart_fd, data + sent, length - sent);
+        if (ret > 0) {
+            sent += ret;
+            continue;
+        }
+        if (ret < 0 && EAGAIN != errno && EINTR != errno) {
+            return EMBER_ERR_FATAL;
+        }
+        /* tty buffer full, the target driver would also wait for its tx FIFO */
+        usleep(100);
+    }
+
+    g_port_stats.tx_bytes += length;
+    return EMBER_SUCCESS;
+}
+
+void OSSemCreate(OS_SEM *p_sem, CPU_CHAR *p_name, OS_SEM_CTR cnt, RTOS_ERR *p_err)
+{
+    (void)p_name;
+
+    pthread_mutex_init(&p_sem->lock, NULL);
+    pthread_cond_init(&p_sem->cond, NULL);
+    p_sem->ctr = cnt;
+    p_err->Code = RTOS_ERR_NONE;
+}
+
+OS_SEM_CTR OSSemPend(OS_SEM *p_sem, OS_TICK timeout, OS_OPT opt, CPU_TS *p_ts, RTOS_ERR *p_err)
+{
+    struct timespec ts;
+    OS_SEM_CTR      ctr;
+    int             ret = 0;
+
+    (void)opt;
+    (void)p_ts;
+
+    g_port_stats.sem_pends++;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout / OS_CFG_TICK_RATE_HZ;
+    ts.tv_nsec += (long)(timeout % OS_CFG_TICK_RATE_HZ) * (1000000000L / OS_CFG_TICK_RATE_HZ);
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&p_sem->lock);
+    /* a timeout of 0 ticks waits forever, as in Micrium */
+    while (0 == p_sem->ctr && 0 == ret) {
+        ret = (0 == timeout) ? pthread_cond_wait(&p_sem->cond, &p_sem->lock)
+                             : pthread_cond_timedwait(&p_sem->cond, &p_sem->lock, &ts);
+    }
+    if (p_sem->ctr > 0) {
+        p_sem->ctr--;
+        ret = 0;
+    }
+    ctr = p_sem->ctr;
+    pthread_mutex_unlock(&p_sem->lock);
+
+    if (NULL != p_err) {
+        p_err->Code = (0 == ret) ? RTOS_ERR_NONE : RTOS_ERR_TIMEOUT;
+    }
+    return ctr;
+}
+
+OS_SEM_CTR OSSemPost(OS_SEM *p_sem, OS_OPT opt, RTOS_ERR *p_err)
+{
+    OS_SEM_CTR ctr;
+
+    (void)opt;
+
+    pthread_mutex_lock(&p_sem->lock);
+    ctr = ++p_sem->ctr;
+    pthread_cond_signal(&p_sem->cond);
+    pthread_mutex_unlock(&p_sem->lock);
+
+    if (NULL != p_err) {
+        p_err->Code = RTOS_ERR_NONE;
+    }
+    return ctr;
+}
+
+void wgm110_port_get_stats(wgm110_port_stats_t *stats)
+{
+    memcpy(stats, &g_port_stats, sizeof(*stats));
+}
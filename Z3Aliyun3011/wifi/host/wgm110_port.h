@@ -0,0 +1,77 @@
+/*
+ * wgm110_port.h
+ *
+ * Host stand-ins for the EFR32 serial driver and the Micrium semaphore
+ * calls made by wgm110.c, so the driver builds unchanged for Linux
+ * (IOTX_HOST_BUILD) and speaks BGAPI over a tty: the pty of the module
+ * simulator in wgm110_sim.c, or a real WGM110 behind a USB serial adapter.
+ *
+ * The tty path is taken from the WGM110_UART environment variable.
+ */
+
+#ifndef WIFI_HOST_WGM110_PORT_H_
+#define WIFI_HOST_WGM110_PORT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define WGM110_UART_ENV     "WGM110_UART"
+
+/* emberSerialXxx() */
+typedef uint8_t EmberStatus;
+
+#define EMBER_SUCCESS       0x00
+#define EMBER_ERR_FATAL     0x01
+#define EMBER_SERIAL_RX_EMPTY 0x29
+
+#define comPortUsart3       3
+#define PARITY_NONE         0
+
+EmberStatus emberSerialInit(uint8_t port, uint32_t rate, uint8_t parity, uint8_t stopBits);
+uint16_t emberSerialReadAvailable(uint8_t port);
+EmberStatus emberSerialReadData(uint8_t port, uint8_t *data, uint16_t length, uint16_t *bytesRead);
+EmberStatus emberSerialWriteData(uint8_t port, uint8_t *data, uint16_t length);
+
+/* OSSemXxx() */
+typedef char        CPU_CHAR;
+typedef uint32_t    CPU_TS;
+typedef uint32_t    OS_TICK;
+typedef uint16_t    OS_OPT;
+typedef uint32_t    OS_SEM_CTR;
+
+typedef struct {
+    int Code;
+} RTOS_ERR;
+
+#define RTOS_ERR_NONE           0
+#define RTOS_ERR_TIMEOUT        1
+#define RTOS_ERR_CODE_GET(err)  ((err).Code)
+
+#define OS_CFG_TICK_RATE_HZ     1000u
+#define OS_OPT_POST_1           0x0000u
+#define OS_OPT_PEND_BLOCKING    0x0000u
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    OS_SEM_CTR      ctr;
+} OS_SEM;
+
+void OSSemCreate(OS_SEM *p_sem, CPU_CHAR *p_name, OS_SEM_CTR cnt, RTOS_ERR *p_err);
+OS_SEM_CTR OSSemPend(OS_SEM *p_sem, OS_TICK timeout, OS_OPT opt, CPU_TS *p_ts, RTOS_ERR *p_err);
+OS_SEM_CTR OSSemPost(OS_SEM *p_sem, OS_OPT opt, RTOS_ERR *p_err);
+
+/* counters for wgm110_bench */
+typedef struct {
+    uint32_t rx_polls;      /* emberSerialReadAvailable() calls */
+    uint32_t rx_empty;      /* ... of which found nothing to read */
+    uint32_t rx_bytes;
+    uint32_t tx_calls;
+    uint32_t tx_bytes;
+    uint32_t sem_pends;
+} wgm110_port_stats_t;
+
+void wgm110_port_get_stats(wgm110_port_stats_t *stats);
+
+#endif /* WIFI_HOST_WGM110_PORT_H_ */
@@ -0,0 +1,837 @@
+/*
+ * wgm110_sim.c
+ *
+ * Module side of the BGAPI link, see wgm110_sim.h. Covers the commands
+ * wgm110.c uses: system reset/hello, PS load, MAC, SME on/connect/AP,
+ * DNS, TCP/TLS/UDP endpoints, endpoint send/close and transmit size.
+ *
+ * Timing model: a command is acted on once its frame has crossed the
+ * wire (10 bits per byte at the configured baud) plus latency_us of
+ * module processing. Responses and events go through a tx queue drained
+ * by its own thread, in chunks of about 1 ms of wire time, so the
+ * driver's uart_rx() sees partial frames as it would on the EFR32 USART.
+ * TLS endpoints are carried as plain TCP.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <termios.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "api/wifi_bglib.h"
+#include "wgm110_sim.h"
+
+#define SIM_MAX_ENDPOINTS   16
+#define SIM_FIRST_ENDPOINT  2       /* 0 and 1 are the module's UART and USB */
+#define SIM_TCP_DATA_MAX    255     /* evt_endpoint_data carries an uint8array */
+#define SIM_UDP_DATA_MAX    1472
+#define SIM_TXQ_SIZE        16384
+#define SIM_TXQ_HIGH        4096    /* stop reading sockets above this, as the module runs out of buffers */
+
+#define Sim_DbgPrintln(...) if (g_sim.config.verbose) {fprintf(stderr, "[wgm110_sim] ");fprintf(stderr, __VA_ARGS__);fprintf(stderr, "\n");}
+
+typedef struct {
+    uint32_t            type;       /* endpoint_type_xxx, endpoint_type_free when unused */
+    int                 fd;
+    struct sockaddr_in  peer;       /* udp: destination of endpoint_send */
+    uint16_t            tx_size;    /* udp: datagram size from endpoint_set_transmit_size */
+    uint16_t            tx_len;
+    uint8_t             tx_buf[SIM_UDP_DATA_MAX];
+    uint8_t             closing;
+} sim_endpoint;
+
+typedef struct {
+    int                 fd;
+    wgm110_sim_config_t config;
+    sim_endpoint        ep[SIM_MAX_ENDPOINTS];
+    uint8_t             rx_buf[BGLIB_MSG_MAXLEN];
+    uint16_t            rx_len;
+    uint64_t            rx_wire_free_us;
+
+    /* drained by sim_tx_task at the configured baud */
+    pthread_mutex_t     tx_lock;
+    pthread_cond_t      tx_cond;
+    uint8_t             txq[SIM_TXQ_SIZE];
+    uint32_t            txq_head;
+    uint32_t            txq_len;
+    uint8_t             running;
+} sim_state;
+
+static sim_state g_sim;
+
+static uint64_t sim_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void sim_sleep_until(uint64_t deadline_us)
+{
+    uint64_t        now = sim_now_us();
+    struct timespec ts;
+
+    if (deadline_us <= now) {
+        return;
+    }
+
+    ts.tv_sec = (deadline_us - now) / 1000000;
+    ts.tv_nsec = ((deadline_us - now) % 1000000) * 1000;
+    while (0 != nanosleep(&ts, &ts) && EINTR == errno) {
+    }
+}
+
+static uint64_t sim_wire_us(uint32_t bytes)
+{
+    if (0 == g_sim.config.baud) {
+        return 0;
+    }
+
+    return (uint64_t)bytes * 10 * 1000000 / g_sim.config.baud;
+}
+
+static void *sim_tx_task(void *para)
+{
+    uint8_t  chunk[256];
+    uint32_t chunk_max;
+    uint32_t len;
+    uint32_t i;
+    uint64_t wire_free = 0;
+    uint64_t now;
+    ssize_t  ret;
+
+    (void)para;
+
+    /* about 1 ms worth of bytes per write, at least one */
+    chunk_max = (0 == g_sim.config.baud) ? sizeof(chunk) : g_sim.config.baud / 10 / 1000;
+    if (0 == chunk_max) {
+        chunk_max = 1;
+    } else if (chunk_max > sizeof(chunk)) {
+        chunk_max = sizeof(chunk);
+    }
+
+    pthread_mutex_lock(&g_sim.tx_lock);
+    while (g_sim.running) {
+        if (0 == g_sim.txq_len) {
+            pthread_cond_wait(&g_sim.tx_cond, &g_sim.tx_lock);
+            continue;
+        }
+
+        len = (g_sim.txq_len < chunk_max) ? g_sim.txq_len : chunk_max;
+        for (i = 0; i < len; i++) {
+            chunk[i] = g_sim.txq[(g_sim.txq_head + i) % SIM_TXQ_SIZE];
+        }
+        g_sim.txq_head = (g_sim.txq_head + len) % SIM_TXQ_SIZE;
+        g_sim.txq_len -= len;
+        pthread_cond_broadcast(&g_sim.tx_cond);
+        pthread_mutex_unlock(&g_sim.tx_lock);
+
+        /* the bytes leave the module once the previous ones are on the wire */
+        now = sim_now_us();
+        if (wire_free < now) {
+            wire_free = now;
+        }
+        wire_free += sim_wire_us(len);
+        sim_sleep_until(wire_free);
+
+        for (i = 0; i < len; i += ret) {
+            ret = write(g_sim.fd, chunk + i, len - i);
+            if (ret <= 0) {
+                if (ret < 0 && (EAGAIN == errno || EINTR == errno)) {
+                    usleep(100);
+                    ret = 0;
+                    continue;
+                }
+                break;
+            }
+        }
+
+        pthread_mutex_lock(&g_sim.tx_lock);
+    }
+    pthread_mutex_unlock(&g_sim.tx_lock);
+
+    return NULL;
+}
+
+static void sim_txq_put(const uint8_t *data, uint32_t len)
+{
+    uint32_t i;
+
+    for (i = 0; i < len; i++) {
+        while (SIM_TXQ_SIZE == g_sim.txq_len) {
+            pthread_cond_wait(&g_sim.tx_cond, &g_sim.tx_lock);
+        }
+        g_sim.txq[(g_sim.txq_head + g_sim.txq_len) % SIM_TXQ_SIZE] = data[i];
+        g_sim.txq_len++;
+    }
+}
+
+/* queue one response or event: header, fixed fields, then the array payload if any */
+static void sim_output(uint32_t msg_id, const void *fields, uint16_t fields_len, const void *data, uint16_t data_len)
+{
+    uint8_t  hdr[BGLIB_MSG_HEADER_LEN];
+    uint16_t len = fields_len + data_len;
+
+    hdr[0] = (uint8_t)((msg_id & 0xF8) | ((len >> 8) & 0x07));
+    hdr[1] = (uint8_t)(len & 0xFF);
+    hdr[2] = (uint8_t)((msg_id >> 16) & 0xFF);
+    hdr[3] = (uint8_t)((msg_id >> 24) & 0xFF);
+
+    pthread_mutex_lock(&g_sim.tx_lock);
+    sim_txq_put(hdr, sizeof(hdr));
+    if (fields_len > 0) {
+        sim_txq_put((const uint8_t *)fields, fields_len);
+    }
+    if (data_len > 0) {
+        sim_txq_put((const uint8_t *)data, data_len);
+    }
+    pthread_cond_broadcast(&g_sim.tx_cond);
+    pthread_mutex_unlock(&g_sim.tx_lock);
+}
+
+static uint32_t sim_txq_pending(void)
+{
+    uint32_t len;
+
+    pthread_mutex_lock(&g_sim.tx_lock);
+    len = g_sim.txq_len;
+    pthread_mutex_unlock(&g_sim.tx_lock);
+
+    return len;
+}
+
+static int sim_endpoint_alloc(uint32_t type, int fd)
+{
+    int i;
+
+    for (i = SIM_FIRST_ENDPOINT; i < SIM_MAX_ENDPOINTS; i++) {
+        if (endpoint_type_free == g_sim.ep[i].type) {
+            memset(&g_sim.ep[i], 0, sizeof(g_sim.ep[i]));
+            g_sim.ep[i].type = type;
+            g_sim.ep[i].fd = fd;
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static void sim_endpoint_status(uint8_t endpoint, uint8_t active)
+{
+    struct wifi_msg_endpoint_status_evt_t evt;
+
+    memset(&evt, 0, sizeof(evt));
+    evt.endpoint = endpoint;
+    evt.type = g_sim.ep[endpoint].type;
+    evt.streaming = (endpoint_type_udp_server == evt.type) ? 0 : 1;
+    evt.destination = -1;
+    evt.active = active;
+    sim_output(wifi_evt_endpoint_status_id, &evt, sizeof(evt), NULL, 0);
+}
+
+static void sim_endpoint_free(uint8_t endpoint)
+{
+    if (g_sim.ep[endpoint].fd > 0) {
+        close(g_sim.ep[endpoint].fd);
+    }
+    sim_endpoint_status(endpoint, 0);
+    memset(&g_sim.ep[endpoint], 0, sizeof(g_sim.ep[endpoint]));
+    g_sim.ep[endpoint].type = endpoint_type_free;
+}
+
+static void sim_sockaddr(struct sockaddr_in *addr, uint32_t ipaddr, uint16_t port)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = ipaddr;     /* ipv4.u is already in network order */
+    addr->sin_port = htons(port);
+}
+
+static uint16_t sim_errno_to_result(int err)
+{
+    switch (err) {
+        case ECONNREFUSED:
+            return wifi_err_tcpip_reset;
+        case ETIMEDOUT:
+            return wifi_err_tcpip_timeout;
+        case EADDRINUSE:
+            return wifi_err_tcpip_in_use;
+        case ENETUNREACH:
+        case EHOSTUNREACH:
+            return wifi_err_tcpip_routing;
+        default:
+            return wifi_err_tcpip_abort;
+    }
+}
+
+static void sim_cmd_ps_load(uint16_t key)
+{
+    struct wifi_msg_flash_ps_load_rsp_t rsp;
+    const char                         *value = NULL;
+
+    if (FLASH_PS_KEY_CLIENT_SSID == key) {
+        value = g_sim.config.ssid;
+    } else if (FLASH_PS_KEY_CLIENT_PW == key) {
+        value = g_sim.config.passwd;
+    }
+
+    memset(&rsp, 0, sizeof(rsp));
+    if (NULL == value) {
+        rsp.result = wifi_err_hardware_ps_key_not_found;
+        sim_output(wifi_rsp_flash_ps_load_id, &rsp, sizeof(rsp), NULL, 0);
+    } else {
+        rsp.result = wifi_err_success;
+        rsp.value.len = (uint8_t)strlen(value);
+        sim_output(wifi_rsp_flash_ps_load_id, &rsp, sizeof(rsp), value, rsp.value.len);
+    }
+}
+
+static void sim_cmd_connect_ssid(void)
+{
+    struct wifi_msg_sme_connect_ssid_rsp_t      rsp;
+    struct wifi_msg_sme_connected_evt_t         connected;
+    struct wifi_msg_sme_interface_status_evt_t  status;
+    struct wifi_msg_tcpip_configuration_evt_t   config;
+
+    memset(&rsp, 0, sizeof(rsp));
+    sim_output(wifi_rsp_sme_connect_ssid_id, &rsp, sizeof(rsp), NULL, 0);
+
+    memset(&connected, 0, sizeof(connected));
+    sim_output(wifi_evt_sme_connected_id, &connected, sizeof(connected), NULL, 0);
+
+    /* the host's loopback stands in for the DHCP lease */
+    memset(&config, 0, sizeof(config));
+    config.address.u = htonl(INADDR_LOOPBACK);
+    config.netmask.u = htonl(0xFF000000);
+    config.gateway.u = htonl(INADDR_LOOPBACK);
+    config.use_dhcp = 1;
+    sim_output(wifi_evt_tcpip_configuration_id, &config, sizeof(config), NULL, 0);
+
+    memset(&status, 0, sizeof(status));
+    status.status = 1;
+    sim_output(wifi_evt_sme_interface_status_id, &status, sizeof(status), NULL, 0);
+}
+
+static void sim_cmd_dns_gethostbyname(const uint8_t *name, uint8_t name_len)
+{
+    struct wifi_msg_tcpip_dns_gethostbyname_rsp_t        rsp;
+    struct wifi_msg_tcpip_dns_gethostbyname_result_evt_t evt;
+    struct addrinfo                                       hints;
+    struct addrinfo                                      *res = NULL;
+    char                                                  host[256];
+
+    memset(&rsp, 0, sizeof(rsp));
+    sim_output(wifi_rsp_tcpip_dns_gethostbyname_id, &rsp, sizeof(rsp), NULL, 0);
+
+    memcpy(host, name, name_len);
+    host[name_len] = '\0';
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    memset(&evt, 0, sizeof(evt));
+    if (0 == getaddrinfo(host, NULL, &hints, &res) && NULL != res) {
+        evt.result = wifi_err_success;
+        evt.address.u = ((struct sockaddr_in *)res->ai_addr)->sin_addr.s_addr;
+        freeaddrinfo(res);
+    } else {
+        evt.result = wifi_err_tcpip_unknown_host;
+    }
+    evt.name.len = name_len;
+    sim_output(wifi_evt_tcpip_dns_gethostbyname_result_id, &evt, sizeof(evt), name, name_len);
+}
+
+static void sim_cmd_tcp_connect(uint32_t rsp_id, uint32_t type, uint32_t ipaddr, uint16_t port)
+{
+    struct wifi_msg_tcpip_tcp_connect_rsp_t rsp;
+    struct sockaddr_in                      addr;
+    int                                     fd;
+    int                                     opt = 1;
+    int                                     endpoint = -1;
+
+    memset(&rsp, 0, sizeof(rsp));
+    sim_sockaddr(&addr, ipaddr, port);
+
+    fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd < 0 || 0 != connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+        rsp.result = sim_errno_to_result(errno);
+    } else {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+        endpoint = sim_endpoint_alloc(type, fd);
+        if (endpoint < 0) {
+            rsp.result = wifi_err_out_of_memory;
+        }
+    }
+
+    if (endpoint < 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        Sim_DbgPrintln("connect %s:%u failed, result=0x%x", inet_ntoa(addr.sin_addr), port, rsp.result);
+        sim_output(rsp_id, &rsp, sizeof(rsp), NULL, 0);
+        return;
+    }
+
+    rsp.endpoint = endpoint;
+    sim_output(rsp_id, &rsp, sizeof(rsp), NULL, 0);
+    if (endpoint_type_tls == type) {
+        /* no handshake, report the certificate the module would have checked as valid */
+        struct wifi_msg_tcpip_tls_verify_result_evt_t verify_evt;
+
+        memset(&verify_evt, 0, sizeof(verify_evt));
+        sim_output(wifi_evt_tcpip_tls_verify_result_id, &verify_evt, sizeof(verify_evt), NULL, 0);
+    }
+    sim_endpoint_status(endpoint, 1);
+}
+
+static void sim_cmd_udp_server(uint16_t port)
+{
+    struct wifi_msg_tcpip_start_udp_server_rsp_t rsp;
+    struct sockaddr_in                           addr;
+    int                                          fd;
+    int                                          opt = 1;
+    int                                          endpoint = -1;
+
+    memset(&rsp, 0, sizeof(rsp));
+    sim_sockaddr(&addr, htonl(INADDR_ANY), port);
+
+    fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd >= 0) {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    }
+    if (fd < 0 || 0 != bind(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+        rsp.result = sim_errno_to_result(errno);
+    } else {
+        endpoint = sim_endpoint_alloc(endpoint_type_udp_server, fd);
+        if (endpoint < 0) {
+            rsp.result = wifi_err_out_of_memory;
+        }
+    }
+
+    if (endpoint < 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        sim_output(wifi_rsp_tcpip_start_udp_server_id, &rsp, sizeof(rsp), NULL, 0);
+        return;
+    }
+
+    rsp.endpoint = endpoint;
+    sim_output(wifi_rsp_tcpip_start_udp_server_id, &rsp, sizeof(rsp), NULL, 0);
+    sim_endpoint_status(endpoint, 1);
+}
+
+static void sim_cmd_udp_connect(uint32_t ipaddr, uint16_t port)
+{
+    struct wifi_msg_tcpip_udp_connect_rsp_t rsp;
+    int                                     fd;
+    int                                     endpoint = -1;
+
+    memset(&rsp, 0, sizeof(rsp));
+
+    fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (fd < 0) {
+        rsp.result = sim_errno_to_result(errno);
+    } else {
+        endpoint = sim_endpoint_alloc(endpoint_type_udp, fd);
+        if (endpoint < 0) {
+            close(fd);
+            rsp.result = wifi_err_out_of_memory;
+        } else {
+            sim_sockaddr(&g_sim.ep[endpoint].peer, ipaddr, port);
+            rsp.endpoint = endpoint;
+        }
+    }
+
+    sim_output(wifi_rsp_tcpip_udp_connect_id, &rsp, sizeof(rsp), NULL, 0);
+    if (endpoint >= 0) {
+        sim_endpoint_status(endpoint, 1);
+    }
+}
+
+static void sim_cmd_udp_bind(uint8_t endpoint, uint16_t port)
+{
+    struct wifi_msg_tcpip_udp_bind_rsp_t rsp;
+    struct sockaddr_in                   addr;
+    int                                  opt = 1;
+
+    memset(&rsp, 0, sizeof(rsp));
+    if (endpoint >= SIM_MAX_ENDPOINTS || endpoint_type_udp != g_sim.ep[endpoint].type) {
+        rsp.result = wifi_err_invalid_param;
+    } else {
+        /* shares the port with the udp server endpoint, as on the module */
+        sim_sockaddr(&addr, htonl(INADDR_ANY), port);
+        setsockopt(g_sim.ep[endpoint].fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        if (0 != bind(g_sim.ep[endpoint].fd, (struct sockaddr *)&addr, sizeof(addr))) {
+            rsp.result = sim_errno_to_result(errno);
+        }
+    }
+
+    sim_output(wifi_rsp_tcpip_udp_bind_id, &rsp, sizeof(rsp), NULL, 0);
+}
+
+static void sim_cmd_set_transmit_size(uint8_t endpoint, uint16_t size)
+{
+    struct wifi_msg_endpoint_set_transmit_size_rsp_t rsp;
+
+    memset(&rsp, 0, sizeof(rsp));
+    rsp.endpoint = endpoint;
+    if (endpoint >= SIM_MAX_ENDPOINTS || endpoint_type_free == g_sim.ep[endpoint].type
+        || size > SIM_UDP_DATA_MAX) {
+        rsp.result = wifi_err_invalid_param;
+    } else {
+        g_sim.ep[endpoint].tx_size = size;
+        g_sim.ep[endpoint].tx_len = 0;
+    }
+
+    sim_output(wifi_rsp_endpoint_set_transmit_size_id, &rsp, sizeof(rsp), NULL, 0);
+}
+
+static void sim_cmd_endpoint_send(uint8_t endpoint, const uint8_t *data, uint8_t len)
+{
+    struct wifi_msg_endpoint_send_rsp_t  rsp;
+    sim_endpoint                        *ep = &g_sim.ep[endpoint % SIM_MAX_ENDPOINTS];
+    ssize_t                              ret = 0;
+    uint16_t                             copy;
+
+    memset(&rsp, 0, sizeof(rsp));
+    rsp.endpoint = endpoint;
+
+    if (endpoint >= SIM_MAX_ENDPOINTS || endpoint_type_free == ep->type || ep->closing) {
+        rsp.result = wifi_err_tcpip_not_connected;
+    } else if (endpoint_type_udp == ep->type) {
+        /* with a transmit size set, datagrams are gathered up to that size */
+        copy = (ep->tx_len + len > sizeof(ep->tx_buf)) ? sizeof(ep->tx_buf) - ep->tx_len : len;
+        memcpy(&ep->tx_buf[ep->tx_len], data, copy);
+        ep->tx_len += copy;
+        if (0 == ep->tx_size || ep->tx_len >= ep->tx_size) {
+            ret = sendto(ep->fd, ep->tx_buf, ep->tx_len, 0, (struct sockaddr *)&ep->peer, sizeof(ep->peer));
+            ep->tx_len = 0;
+        }
+    } else {
+        ret = send(ep->fd, data, len, MSG_NOSIGNAL);
+    }
+
+    if (ret < 0) {
+        rsp.result = sim_errno_to_result(errno);
+    }
+
+    sim_output(wifi_rsp_endpoint_send_id, &rsp, sizeof(rsp), NULL, 0);
+}
+
+static void sim_cmd_endpoint_close(uint8_t endpoint)
+{
+    struct wifi_msg_endpoint_close_rsp_t rsp;
+
+    memset(&rsp, 0, sizeof(rsp));
+    rsp.endpoint = endpoint;
+    if (endpoint >= SIM_MAX_ENDPOINTS || endpoint_type_free == g_sim.ep[endpoint].type) {
+        rsp.result = wifi_err_invalid_param;
+        sim_output(wifi_rsp_endpoint_close_id, &rsp, sizeof(rsp), NULL, 0);
+        return;
+    }
+
+    sim_output(wifi_rsp_endpoint_close_id, &rsp, sizeof(rsp), NULL, 0);
+    sim_endpoint_free(endpoint);
+}
+
+static void sim_cmd_system_reset(void)
+{
+    struct wifi_msg_system_boot_evt_t evt;
+    int                               i;
+
+    for (i = SIM_FIRST_ENDPOINT; i < SIM_MAX_ENDPOINTS; i++) {
+        if (endpoint_type_free != g_sim.ep[i].type) {
+            close(g_sim.ep[i].fd);
+            memset(&g_sim.ep[i], 0, sizeof(g_sim.ep[i]));
+        }
+    }
+
+    memset(&evt, 0, sizeof(evt));
+    evt.major = 1;
+    evt.minor = 4;
+    sim_output(wifi_evt_system_boot_id, &evt, sizeof(evt), NULL, 0);
+}
+
+/* a result-only response, the layout shared by most sme/tcpip/https commands */
+static void sim_rsp_result(uint32_t rsp_id, uint16_t result)
+{
+    sim_output(rsp_id, &result, sizeof(result), NULL, 0);
+}
+
+static void sim_handle_command(const uint8_t *frame)
+{
+    struct wifi_cmd_packet *pck = BGLIB_MSG(frame);
+    uint8_t                 mac[7] = {0, 0x00, 0x0B, 0x57, 0x5E, 0x11, 0x00};
+    uint8_t                 u8 = 0;
+    uint8_t                 hw_result[3] = {0};
+
+    switch (BGLIB_MSG_ID(frame)) {
+        case wifi_cmd_system_reset_id:
+            sim_cmd_system_reset();
+            break;
+        case wifi_cmd_system_hello_id:
+            sim_output(wifi_rsp_system_hello_id, NULL, 0, NULL, 0);
+            break;
+        case wifi_cmd_system_set_max_power_saving_state_id:
+            sim_rsp_result(wifi_rsp_system_set_max_power_saving_state_id, wifi_err_success);
+            break;
+        case wifi_cmd_flash_ps_load_id:
+            sim_cmd_ps_load(pck->cmd_flash_ps_load.key);
+            break;
+        case wifi_cmd_flash_ps_erase_all_id:
+            sim_rsp_result(wifi_rsp_flash_ps_erase_all_id, wifi_err_success);
+            break;
+        case wifi_cmd_config_get_mac_id:
+            sim_output(wifi_rsp_config_get_mac_id, hw_result, sizeof(hw_result), NULL, 0);
+            sim_output(wifi_evt_config_mac_address_id, mac, sizeof(mac), NULL, 0);
+            break;
+        case wifi_cmd_sme_set_operating_mode_id:
+            sim_rsp_result(wifi_rsp_sme_set_operating_mode_id, wifi_err_success);
+            break;
+        case wifi_cmd_sme_wifi_on_id:
+            sim_rsp_result(wifi_rsp_sme_wifi_on_id, wifi_err_success);
+            sim_rsp_result(wifi_evt_sme_wifi_is_on_id, wifi_err_success);
+            break;
+        case wifi_cmd_sme_set_password_id:
+            sim_output(wifi_rsp_sme_set_password_id, &u8, sizeof(u8), NULL, 0);
+            break;
+        case wifi_cmd_sme_connect_ssid_id:
+            sim_cmd_connect_ssid();
+            break;
+        case wifi_cmd_sme_set_ap_password_id:
+            sim_output(wifi_rsp_sme_set_ap_password_id, &u8, sizeof(u8), NULL, 0);
+            break;
+        case wifi_cmd_sme_set_ap_hidden_id:
+            sim_output(wifi_rsp_sme_set_ap_hidden_id, hw_result, sizeof(hw_result), NULL, 0);
+            break;
+        case wifi_cmd_https_enable_id:
+            sim_rsp_result(wifi_rsp_https_enable_id, wifi_err_success);
+            break;
+        case wifi_cmd_sme_start_ap_mode_id:
+            sim_output(wifi_rsp_sme_start_ap_mode_id, hw_result, sizeof(hw_result), NULL, 0);
+            sim_output(wifi_evt_sme_ap_mode_started_id, &u8, sizeof(u8), NULL, 0);
+            break;
+        case wifi_cmd_sme_stop_ap_mode_id:
+            sim_output(wifi_rsp_sme_stop_ap_mode_id, hw_result, sizeof(hw_result), NULL, 0);
+            sim_output(wifi_evt_sme_ap_mode_stopped_id, &u8, sizeof(u8), NULL, 0);
+            break;
+        case wifi_cmd_tcpip_dns_gethostbyname_id:
+            sim_cmd_dns_gethostbyname(pck->cmd_tcpip_dns_gethostbyname.name.data,
+                                      pck->cmd_tcpip_dns_gethostbyname.name.len);
+            break;
+        case wifi_cmd_tcpip_tcp_connect_id:
+            sim_cmd_tcp_connect(wifi_rsp_tcpip_tcp_connect_id, endpoint_type_tcp,
+                                pck->cmd_tcpip_tcp_connect.address.u, pck->cmd_tcpip_tcp_connect.port);
+            break;
+        case wifi_cmd_tcpip_tls_connect_id:
+            sim_cmd_tcp_connect(wifi_rsp_tcpip_tls_connect_id, endpoint_type_tls,
+                                pck->cmd_tcpip_tls_connect.address.u, pck->cmd_tcpip_tls_connect.port);
+            break;
+        case wifi_cmd_tcpip_tls_set_authmode_id:
+            sim_output(wifi_rsp_tcpip_tls_set_authmode_id, NULL, 0, NULL, 0);
+            break;
+        case wifi_cmd_tcpip_tls_set_user_certificate_id:
+            sim_rsp_result(wifi_rsp_tcpip_tls_set_user_certificate_id, wifi_err_success);
+            break;
+        case wifi_cmd_tcpip_start_udp_server_id:
+            sim_cmd_udp_server(pck->cmd_tcpip_start_udp_server.port);
+            break;
+        case wifi_cmd_tcpip_udp_connect_id:
+            sim_cmd_udp_connect(pck->cmd_tcpip_udp_connect.address.u, pck->cmd_tcpip_udp_connect.port);
+            break;
+        case wifi_cmd_tcpip_udp_bind_id:
+            sim_cmd_udp_bind(pck->cmd_tcpip_udp_bind.endpoint, pck->cmd_tcpip_udp_bind.port);
+            break;
+        case wifi_cmd_tcpip_multicast_join_id:
+            sim_rsp_result(wifi_rsp_tcpip_multicast_join_id, wifi_err_success);
+            break;
+        case wifi_cmd_endpoint_set_transmit_size_id:
+            sim_cmd_set_transmit_size(pck->cmd_endpoint_set_transmit_size.endpoint,
+                                      pck->cmd_endpoint_set_transmit_size.size);
+            break;
+        case wifi_cmd_endpoint_send_id:
+            sim_cmd_endpoint_send(pck->cmd_endpoint_send.endpoint,
+                                  pck->cmd_endpoint_send.data.data,
+                                  pck->cmd_endpoint_send.data.len);
+            break;
+        case wifi_cmd_endpoint_close_id:
+            sim_cmd_endpoint_close(pck->cmd_endpoint_close.endpoint);
+            break;
+        default:
+            /* the driver times out on it, as it would on a firmware without the command */
+            Sim_DbgPrintln("unhandled command class %u id %u", frame[2], frame[3]);
+            break;
+    }
+}
+
+/* consume complete frames from the UART rx buffer */
+static void sim_uart_input(void)
+{
+    uint16_t frame_len;
+    uint64_t now;
+
+    while (g_sim.rx_len >= BGLIB_MSG_HEADER_LEN) {
+        frame_len = BGLIB_MSG_HEADER_LEN + BGLIB_MSG_LEN(g_sim.rx_buf);
+        if (g_sim.rx_len < frame_len) {
+            break;
+        }
+
+        /* the module sees the command once its last byte is in, then works on it */
+        now = sim_now_us();
+        if (g_sim.rx_wire_free_us < now) {
+            g_sim.rx_wire_free_us = now;
+        }
+        g_sim.rx_wire_free_us += sim_wire_us(frame_len);
+        sim_sleep_until(g_sim.rx_wire_free_us + g_sim.config.latency_us);
+
+        sim_handle_command(g_sim.rx_buf);
+
+        g_sim.rx_len -= frame_len;
+        memmove(g_sim.rx_buf, &g_sim.rx_buf[frame_len], g_sim.rx_len);
+    }
+}
+
+static void sim_endpoint_input(uint8_t endpoint)
+{
+    sim_endpoint                       *ep = &g_sim.ep[endpoint];
+    struct wifi_msg_endpoint_data_evt_t data_evt;
+    struct wifi_msg_endpoint_closing_evt_t closing_evt;
+    struct wifi_msg_tcpip_udp_data_evt_t udp_evt;
+    struct sockaddr_in                  addr;
+    socklen_t                           addr_len = sizeof(addr);
+    uint8_t                             buf[SIM_UDP_DATA_MAX];
+    ssize_t                             ret;
+
+    if (endpoint_type_udp_server == ep->type || endpoint_type_udp == ep->type) {
+        ret = recvfrom(ep->fd, buf, sizeof(buf), MSG_DONTWAIT, (struct sockaddr *)&addr, &addr_len);
+        if (ret <= 0) {
+            return;
+        }
+
+        memset(&udp_evt, 0, sizeof(udp_evt));
+        udp_evt.endpoint = endpoint;
+        udp_evt.source_address.u = addr.sin_addr.s_addr;
+        udp_evt.source_port = ntohs(addr.sin_port);
+        udp_evt.data.len = (uint16_t)ret;
+        sim_output(wifi_evt_tcpip_udp_data_id, &udp_evt, sizeof(udp_evt), buf, (uint16_t)ret);
+        return;
+    }
+
+    ret = recv(ep->fd, buf, SIM_TCP_DATA_MAX, MSG_DONTWAIT);
+    if (ret > 0) {
+        memset(&data_evt, 0, sizeof(data_evt));
+        data_evt.endpoint = endpoint;
+        data_evt.data.len = (uint8_t)ret;
+        sim_output(wifi_evt_endpoint_data_id, &data_evt, sizeof(data_evt), buf, (uint16_t)ret);
+    } else if (0 == ret || (EAGAIN != errno && EINTR != errno)) {
+        /* peer closed, the host is expected to close the endpoint */
+        memset(&closing_evt, 0, sizeof(closing_evt));
+        closing_evt.endpoint = endpoint;
+        closing_evt.reason = (0 == ret) ? wifi_err_success : sim_errno_to_result(errno);
+        sim_output(wifi_evt_endpoint_closing_id, &closing_evt, sizeof(closing_evt), NULL, 0);
+        ep->closing = 1;
+    }
+}
+
+int wgm110_sim_run(int fd, const wgm110_sim_config_t *config)
+{
+    struct pollfd   pfd[SIM_MAX_ENDPOINTS + 1];
+    uint8_t         pfd_ep[SIM_MAX_ENDPOINTS + 1];
+    struct termios  tio;
+    pthread_t       tx_task;
+    nfds_t          nfds;
+    int             throttled;
+    ssize_t         ret;
+    int             result = 0;
+    uint8_t         i;
+
+    memset(&g_sim, 0, sizeof(g_sim));
+    g_sim.fd = fd;
+    g_sim.config = *config;
+    g_sim.running = 1;
+    pthread_mutex_init(&g_sim.tx_lock, NULL);
+    pthread_cond_init(&g_sim.tx_cond, NULL);
+
+    /* on a pty master this also puts the driver's side in raw mode */
+    if (0 == tcgetattr(fd, &tio)) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    if (0 != pthread_create(&tx_task, NULL, sim_tx_task, NULL)) {
+        return -1;
+    }
+
+    while (1) {
+        pfd[0].fd = fd;
+        pfd[0].events = POLLIN;
+        pfd[0].revents = 0;
+        nfds = 1;
+
+        /* leave socket data in the kernel while the UART is backed up */
+        throttled = (sim_txq_pending() >= SIM_TXQ_HIGH);
+        if (!throttled) {
+            for (i = SIM_FIRST_ENDPOINT; i < SIM_MAX_ENDPOINTS; i++) {
+                if (endpoint_type_free != g_sim.ep[i].type && !g_sim.ep[i].closing) {
+                    pfd[nfds].fd = g_sim.ep[i].fd;
+                    pfd[nfds].events = POLLIN;
+                    pfd[nfds].revents = 0;
+                    pfd_ep[nfds] = i;
+                    nfds++;
+                }
+            }
+        }
+
+        ret = poll(pfd, nfds, throttled ? 1 : -1);
+        if (ret < 0 && EINTR != errno) {
+            result = -1;
+            break;
+        }
+
+        if (pfd[0].revents & POLLIN) {
+            ret = read(fd, &g_sim.rx_buf[g_sim.rx_len], sizeof(g_sim.rx_buf) - g_sim.rx_len);
+            if (0 == ret || (ret < 0 && EAGAIN != errno && EINTR != errno)) {
+                break;
+            }
+            if (ret > 0) {
+                g_sim.rx_len += ret;
+                sim_uart_input();
+            }
+        } else if (pfd[0].revents & (POLLHUP | POLLERR)) {
+            /* no one has the pty slave open (yet) */
+            usleep(10000);
+        }
+
+        for (i = 1; i < nfds; i++) {
+            if (pfd[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                sim_endpoint_input(pfd_ep[i]);
+            }
+        }
+    }
+
+    pthread_mutex_lock(&g_sim.tx_lock);
+    g_sim.running = 0;
+    pthread_cond_broadcast(&g_sim.tx_cond);
+    pthread_mutex_unlock(&g_sim.tx_lock);
+    pthread_join(tx_task, NULL);
+
+    for (i = SIM_FIRST_ENDPOINT; i < SIM_MAX_ENDPOINTS; i++) {
+        if (endpoint_type_free != g_sim.ep[i].type) {
+            close(g_sim.ep[i].fd);
+        }
+    }
+
+    return result;
+}
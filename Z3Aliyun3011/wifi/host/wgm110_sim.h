@@ -0,0 +1,29 @@
+/*
+ * wgm110_sim.h
+ *
+ * WGM110 module simulator for the host build: answers the BGAPI commands
+ * wgm110.c sends with the responses and events the module would, backed
+ * by host sockets (TCP, UDP, DNS), and paces its UART output at the
+ * configured baud rate so the driver sees frames arrive as on target.
+ */
+
+#ifndef WIFI_HOST_WGM110_SIM_H_
+#define WIFI_HOST_WGM110_SIM_H_
+
+#include <stdint.h>
+
+typedef struct {
+    uint32_t    baud;           /* UART bit rate, 10 bits per byte on the wire, 0 for unpaced */
+    uint32_t    latency_us;     /* module processing time per command */
+    const char *ssid;           /* FLASH_PS_KEY_CLIENT_SSID/PW, NULL for an empty PS store */
+    const char *passwd;
+    int         verbose;
+} wgm110_sim_config_t;
+
+/*
+ * Serve the module side of the UART on fd (a pty master or one end of a
+ * socketpair) until it is closed. Returns 0 on hangup, -1 on error.
+ */
+int wgm110_sim_run(int fd, const wgm110_sim_config_t *config);
+
+#endif /* WIFI_HOST_WGM110_SIM_H_ */
@@ -2,11 +2,20 @@
 #include "stdlib.h"
 #include "string.h"
 
+#ifdef IOTX_HOST_BUILD
+#include "host/wgm110_port.h"
+#else
 #include "app/framework/include/af.h"
 #include <kernel/include/os.h>
 #include <common/include/rtos_prio.h>
+#endif
 
+#include "infra_config.h"
 #include "wrappers_defs.h"
+#ifdef INFRA_DLOG
+#include "infra_log.h"
+#include "infra_dlog.h"
+#endif
 
 #include "api/wifi_bglib.h"
 #include "wgm110.h"
@@ -22,13 +31,20 @@
 #define WiFi_DbgPrintln(...)
 #define WiFi_DbgPrint(...)
 #endif
+#ifdef INFRA_DLOG
+#define WiFi_TracePrintln(...) iotx_dlog(LOG_INFO_LEVEL, __func__, __LINE__, __VA_ARGS__)
+#define WiFi_ErrPrintln(...) iotx_dlog(LOG_ERR_LEVEL, __func__, __LINE__, __VA_ARGS__)
+#else
 #define WiFi_TracePrintln(...) printf("[%s][%d]", __func__, __LINE__);printf(__VA_ARGS__);printf("\r\n");
 #define WiFi_ErrPrintln(...) printf("\033[31m[%s][%d]", __func__, __LINE__);printf(__VA_ARGS__);printf("\r\n");printf("\33[37m");
+#endif
 
 #define DESC(x) #x
 
 #define WIFI_DEFAULT_TIMEOUT 10000
 
+#define WIFI_MS_TO_TICK(ms) (((ms) * OS_CFG_TICK_RATE_HZ + 999) / 1000)
+
 typedef enum
 {
     TLS_AUTH_NONE,
@@ -98,15 +114,41 @@ typedef struct
     uint16_t  error;    
 }wifi_operation;
 
-#define MAX_EP_SIMULTANEOUS_NUM 2
 typedef struct
 {
     uint8_t   used;    
     uint8_t   endpoint;
     uint16_t  rx_len;    
+    uint16_t  rx_high_water;
+    uint32_t  rx_drops;
+    uint32_t  session;       /* changes each time the endpoint comes up */
     uint8_t   rxdata[4096];
 }wifi_ep_state;
 
+/*
+ * Addresses resolved for the connect_byhostname calls, reused on reconnect.
+ * The module reports no TTL: an entry is dropped after WIFI_DNS_CACHE_MS
+ * or when a connect to its address fails.
+ */
+#define WIFI_DNS_CACHE_NUM      4
+#define WIFI_DNS_CACHE_HOST_LEN 64
+#define WIFI_DNS_CACHE_MS       (10 * 60 * 1000)
+typedef struct
+{
+    char      host[WIFI_DNS_CACHE_HOST_LEN];
+    uint32_t  ipaddr;
+    uint32_t  boot;             /* module boot the entry belongs to */
+    uint64_t  time;
+}wifi_dns_entry;
+
+/* TLS certificate the module holds since its last boot */
+typedef struct
+{
+    uint32_t  boot;
+    uint32_t  len;              /* 0 when none is set */
+    uint32_t  hash;
+}wifi_tls_cert;
+
 #define UDP_DATA_UNIT_MAGIC  0xDEFA
 #define MAX_UDP_DATA_BUF_LEN 4096
 typedef struct
@@ -132,9 +174,24 @@ static uint16_t          g_local_udpport = 0;
 static void *            g_wifi_mutex = NULL;
 static void *            g_uart_mutex = NULL;
 static void *            g_recv_mutex = NULL;
+static OS_SEM            g_udp_rx_sem;
+static OS_SEM            g_ep_rx_sem;
+static volatile uint8_t  g_udp_rx_wakeup = false;
+static uint8_t           g_udp_borrowed = false;
 static wifi_operation    wifi_oper_ctrl;
 static wifi_ep_state     g_wifi_ep_state[MAX_EP_SIMULTANEOUS_NUM];
+static uint32_t          g_wifi_ep_sessions = 0;
 static uint8_t           g_udp_data_buf[MAX_UDP_DATA_BUF_LEN] = {0};
+static uint16_t          g_udp_high_water = 0;
+static uint32_t          g_udp_drops = 0;
+static volatile uint32_t g_wifi_boots = 0;
+static wifi_dns_entry    g_dns_cache[WIFI_DNS_CACHE_NUM];
+static uint32_t          g_dns_hits = 0;
+static uint32_t          g_dns_resolves = 0;
+static wifi_tls_cert     g_tls_cert;
+static uint32_t          g_tls_cert_uploads = 0;
+static uint32_t          g_tls_cert_skips = 0;
+static volatile uint8_t  g_tls_peer_seen = false;
 static char              g_wifi_ssid[128] = {0};
 static char              g_wifi_passwd[128] = {0};
 
@@ -238,6 +295,10 @@ static void wifi_endpoint_status_change(uint8_t endpoint, bool up)
                 if (true != g_wifi_ep_state[i].used) {
                     g_wifi_ep_state[i].endpoint = endpoint;
                     g_wifi_ep_state[i].rx_len = 0;
+                    if (0 == ++g_wifi_ep_sessions) {
+                        g_wifi_ep_sessions = 1;
+                    }
+                    g_wifi_ep_state[i].session = g_wifi_ep_sessions;
                     g_wifi_ep_state[i].used = true;
                     break;
                 }
@@ -248,6 +309,7 @@ static void wifi_endpoint_status_change(uint8_t endpoint, bool up)
             if (true == g_wifi_ep_state[i].used && endpoint == g_wifi_ep_state[i].endpoint) {
                 g_wifi_ep_state[i].endpoint = 0xFF;
                 g_wifi_ep_state[i].rx_len = 0;
+                g_wifi_ep_state[i].session = 0;
                 g_wifi_ep_state[i].used = false;
                 break;
             }
@@ -275,6 +337,7 @@ static int wifi_endpoint_data_enqueue(uint8_t endpoint, uint8_t *pdata, int len)
             //WiFi_DbgPrintln("ep(%d) %d bytes", endpoint, g_wifi_ep_state[i].rx_len);
             if (g_wifi_ep_state[i].rx_len >= sizeof(g_wifi_ep_state[i].rxdata)) {
                 WiFi_ErrPrintln("endpoint %d buf full", endpoint);
+                g_wifi_ep_state[i].rx_drops += len;
             } else {
                 copylen = len;
                 if (copylen + g_wifi_ep_state[i].rx_len >= sizeof(g_wifi_ep_state[i].rxdata)) {
@@ -284,6 +347,10 @@ static int wifi_endpoint_data_enqueue(uint8_t endpoint, uint8_t *pdata, int len)
                        pdata,
                        copylen);
                 g_wifi_ep_state[i].rx_len += copylen;
+                g_wifi_ep_state[i].rx_drops += len - copylen;
+                if (g_wifi_ep_state[i].rx_len > g_wifi_ep_state[i].rx_high_water) {
+                    g_wifi_ep_state[i].rx_high_water = g_wifi_ep_state[i].rx_len;
+                }
                 WiFi_DbgPrintln("ep(%d) enqueue %d bytes", endpoint, copylen);
             }
 
@@ -291,6 +358,13 @@ static int wifi_endpoint_data_enqueue(uint8_t endpoint, uint8_t *pdata, int len)
         }
     }
     HAL_MutexUnlock(g_recv_mutex);
+
+    if (copylen > 0) {
+        RTOS_ERR err;
+
+        /*signal the waiter in wifi_endpoint_wait  */
+        OSSemPost(&g_ep_rx_sem, OS_OPT_POST_1, &err);
+    }
     return copylen;
 }
 
@@ -344,6 +418,12 @@ static void wifi_empty_udpdata_buf(uint8_t endpoint)
         tail += sizeof(wifi_udpunit_hdr) + punit->unit_len;
     }
 
+    /*the head unit is lent out by wifi_udpdata_peek, wifi_udpdata_release drops it  */
+    if (true == g_udp_borrowed && tail > 0) {
+        punit = (wifi_udpunit_hdr *)&g_udp_data_buf[0];
+        offset = sizeof(wifi_udpunit_hdr) + punit->unit_len;
+    }
+
     while (offset < tail) {
         punit = (wifi_udpunit_hdr *)&g_udp_data_buf[offset];
         if (punit->magic != UDP_DATA_UNIT_MAGIC) {
@@ -358,6 +438,9 @@ static void wifi_empty_udpdata_buf(uint8_t endpoint)
                 memcpy(&g_udp_data_buf[offset], &g_udp_data_buf[next], tail - next);
                 ((wifi_udpunit_hdr *)&g_udp_data_buf[offset])->magic = bak;
                 tail -= sizeof(wifi_udpunit_hdr) + punit->unit_len;
+            } else {
+                punit->magic = 0;
+                tail = offset;
             }
         } else {
             offset = next;
@@ -403,6 +486,7 @@ static void wifi_udpdata_dumpqueue()
 
 static void wifi_udpdata_enqueue(uint8_t endpoint, uint8_t *pdata, int len, uint32_t ipaddr, uint16_t udpport)
 {
+    RTOS_ERR err;
     uint16_t tail = 0;
     wifi_udpunit_hdr *punit = NULL;
     
@@ -424,6 +508,7 @@ static void wifi_udpdata_enqueue(uint8_t endpoint, uint8_t *pdata, int len, uint
                                                                                  (ipaddr >> 16) & 0xFF, 
                                                                                  (ipaddr >> 24) & 0xFF, 
                                                                                  udpport);
+        g_udp_drops++;
         HAL_MutexUnlock(g_recv_mutex);
         return;
     }
@@ -442,9 +527,16 @@ static void wifi_udpdata_enqueue(uint8_t endpoint, uint8_t *pdata, int len, uint
     if (tail + sizeof(wifi_udpunit_hdr) <= sizeof(g_udp_data_buf)) {
         ((wifi_udpunit_hdr *)&g_udp_data_buf[tail])->magic = 0;
     }
+    if (tail > g_udp_high_water) {
+        g_udp_high_water = tail;
+    }
 
     HAL_MutexUnlock(g_recv_mutex);
 
+    /*signal the reader blocked in wifi_udp_read and the waiter in wifi_endpoint_wait  */
+    OSSemPost(&g_udp_rx_sem, OS_OPT_POST_1, &err);
+    OSSemPost(&g_ep_rx_sem, OS_OPT_POST_1, &err);
+
     WiFi_DbgPrintln("endpoint=%d ip=%d.%d.%d.%d port=%d enqueue %d bytes", endpoint, 
                                                                            ipaddr & 0xFF, 
                                                                            (ipaddr >> 8) & 0xFF, 
@@ -469,6 +561,12 @@ static int wifi_udpdata_dequeue(uint8_t endpoint, uint8_t *pdata, int len, uint3
     wifi_udpdata_dumpqueue();
     
     HAL_MutexLock(g_recv_mutex);
+
+    /*the head unit is lent out by wifi_udpdata_peek  */
+    if (true == g_udp_borrowed) {
+        HAL_MutexUnlock(g_recv_mutex);
+        return 0;
+    }
     
     /*find tail  */
     while (tail + sizeof(wifi_udpunit_hdr) < sizeof(g_udp_data_buf)) {
@@ -515,10 +613,9 @@ static int wifi_udpdata_dequeue(uint8_t endpoint, uint8_t *pdata, int len, uint3
                 ((wifi_udpunit_hdr *)&g_udp_data_buf[offset])->magic = 0;
             }
             
+            /*one datagram per read  */
             readlen += ret;
-            if (readlen >= len) {
-                break;
-            }
+            break;
         } else {
             offset = next;
         }
@@ -530,6 +627,67 @@ static int wifi_udpdata_dequeue(uint8_t endpoint, uint8_t *pdata, int len, uint3
     return ret;    
 }
 
+/*
+ * Point at the head datagram in place, it stays queued (enqueue only appends
+ * behind it) until wifi_udpdata_release() drops it.
+ */
+static int wifi_udpdata_peek(uint8_t **ppdata, uint32_t *pipaddr, uint16_t *pudpport)
+{
+    int      ret = 0;
+    wifi_udpunit_hdr *punit = (wifi_udpunit_hdr *)&g_udp_data_buf[0];
+
+    HAL_MutexLock(g_recv_mutex);
+    if (true != g_udp_borrowed && punit->magic == UDP_DATA_UNIT_MAGIC) {
+        *ppdata = &g_udp_data_buf[sizeof(wifi_udpunit_hdr)];
+        *pipaddr = punit->ipaddr;
+        *pudpport = punit->udpport;
+        g_udp_borrowed = true;
+        ret = punit->unit_len;
+    }
+    HAL_MutexUnlock(g_recv_mutex);
+
+    return ret;
+}
+
+static void wifi_udpdata_release()
+{
+    uint16_t tail = 0;
+    uint16_t next = 0;
+    uint16_t bak = 0;
+    wifi_udpunit_hdr *punit = NULL;
+
+    HAL_MutexLock(g_recv_mutex);
+    if (true != g_udp_borrowed) {
+        HAL_MutexUnlock(g_recv_mutex);
+        return;
+    }
+
+    /*find tail  */
+    while (tail + sizeof(wifi_udpunit_hdr) < sizeof(g_udp_data_buf)) {
+        punit = (wifi_udpunit_hdr *)&g_udp_data_buf[tail];
+        if (punit->magic != UDP_DATA_UNIT_MAGIC) {
+            break;
+        }
+
+        tail += sizeof(wifi_udpunit_hdr) + punit->unit_len;
+    }
+
+    /*move next unit forward  */
+    punit = (wifi_udpunit_hdr *)&g_udp_data_buf[0];
+    next = sizeof(wifi_udpunit_hdr) + punit->unit_len;
+    if (next < tail) {
+        bak = ((wifi_udpunit_hdr *)&g_udp_data_buf[next])->magic;
+        ((wifi_udpunit_hdr *)&g_udp_data_buf[next])->magic = 0;
+        memmove(&g_udp_data_buf[0], &g_udp_data_buf[next], tail - next);
+        ((wifi_udpunit_hdr *)&g_udp_data_buf[0])->magic = bak;
+    } else {
+        punit->magic = 0;
+    }
+    g_udp_borrowed = false;
+
+    HAL_MutexUnlock(g_recv_mutex);
+}
+
 bool wifi_is_running()
 {
     return (WLAN_STATE_INIT <= g_wifi_state) ? true : false;
@@ -545,6 +703,54 @@ bool wifi_is_connected()
     return (WLAN_STATE_CONNECTED <= g_wifi_state) ? true : false;
 }
 
+int wifi_get_stats(WiFi_Stats *pstats)
+{
+    uint8_t  i;
+    uint16_t tail = 0;
+    wifi_udpunit_hdr *punit = NULL;
+
+    if (NULL == pstats) {
+        return WLAN_ERR_PARA;
+    }
+
+    memset(pstats, 0, sizeof(WiFi_Stats));
+    if (NULL == g_recv_mutex) {
+        return WLAN_ERR_OS;
+    }
+
+    HAL_MutexLock(g_recv_mutex);
+    for (i = 0; i < MAX_EP_SIMULTANEOUS_NUM; i++) {
+        pstats->ep[i].used = g_wifi_ep_state[i].used;
+        pstats->ep[i].endpoint = g_wifi_ep_state[i].endpoint;
+        pstats->ep[i].rx_len = g_wifi_ep_state[i].rx_len;
+        pstats->ep[i].rx_size = sizeof(g_wifi_ep_state[i].rxdata);
+        pstats->ep[i].rx_high_water = g_wifi_ep_state[i].rx_high_water;
+        pstats->ep[i].rx_drops = g_wifi_ep_state[i].rx_drops;
+    }
+
+    /*find tail  */
+    while (tail + sizeof(wifi_udpunit_hdr) < sizeof(g_udp_data_buf)) {
+        punit = (wifi_udpunit_hdr *)&g_udp_data_buf[tail];
+        if (punit->magic != UDP_DATA_UNIT_MAGIC) {
+            break;
+        }
+
+        tail += sizeof(wifi_udpunit_hdr) + punit->unit_len;
+    }
+    pstats->udp_used = tail;
+    pstats->udp_size = sizeof(g_udp_data_buf);
+    pstats->udp_high_water = g_udp_high_water;
+    pstats->udp_drops = g_udp_drops;
+    HAL_MutexUnlock(g_recv_mutex);
+
+    pstats->dns_hits = g_dns_hits;
+    pstats->dns_resolves = g_dns_resolves;
+    pstats->tls_cert_uploads = g_tls_cert_uploads;
+    pstats->tls_cert_skips = g_tls_cert_skips;
+
+    return WLAN_ERR_NONE;
+}
+
 void *wifi_task(void *para)
 {
     uint16_t                msg_length;
@@ -569,6 +775,8 @@ void *wifi_task(void *para)
                 WiFi_TracePrintln("WiFi reset");
                 WiFi_DbgPrintln("recv %s", DESC(wifi_evt_system_boot_id));
                 g_wifi_state = WLAN_STATE_IDLE;
+                /* the certificate and the cached addresses belong to the previous boot */
+                g_wifi_boots++;
                 pskey = FLASH_PS_KEY_CLIENT_SSID;
                 wifi_cmd_flash_ps_load(pskey);
                 break;
@@ -930,6 +1138,9 @@ void *wifi_task(void *para)
                 break;
             case wifi_evt_tcpip_tls_verify_result_id:
                 WiFi_DbgPrintln("recv %s flags=%d", DESC(wifi_evt_tcpip_tls_verify_result_id), pck->evt_tcpip_tls_verify_result.flags);
+                if (WLAN_OPER_TLS_CONNECT == wifi_oper_ctrl.type) {
+                    g_tls_peer_seen = true;
+                }
                 break;
             case wifi_evt_flash_ps_key_changed_id:
             case wifi_evt_tcpip_endpoint_status_id:
@@ -946,6 +1157,7 @@ void *wifi_task(void *para)
 int wifi_init()
 {
     int     ret = 0;
+    RTOS_ERR err;
     hal_os_thread_param_t   param;
 
     g_wifi_mutex = HAL_MutexCreate();
@@ -960,6 +1172,22 @@ int wifi_init()
         HAL_MutexDestroy(g_wifi_mutex);
         return WLAN_ERR_OS;
     }
+
+    OSSemCreate(&g_udp_rx_sem, "udp rx", 0, &err);
+    if (RTOS_ERR_CODE_GET(err) != RTOS_ERR_NONE) {
+        WiFi_ErrPrintln("create udp rx semaphore failed");
+        HAL_MutexDestroy(g_recv_mutex);
+        HAL_MutexDestroy(g_wifi_mutex);
+        return WLAN_ERR_OS;
+    }
+
+    OSSemCreate(&g_ep_rx_sem, "ep rx", 0, &err);
+    if (RTOS_ERR_CODE_GET(err) != RTOS_ERR_NONE) {
+        WiFi_ErrPrintln("create ep rx semaphore failed");
+        HAL_MutexDestroy(g_recv_mutex);
+        HAL_MutexDestroy(g_wifi_mutex);
+        return WLAN_ERR_OS;
+    }
     
     ret = wifi_uart_init();
     if (0 != ret) {
@@ -1432,6 +1660,85 @@ int wifi_connect_withsaveddata(int timeout_ms)
     return wifi_connect(g_wifi_ssid, g_wifi_passwd, timeout_ms);
 }
 
+/* called with g_wifi_mutex held */
+static wifi_dns_entry *wifi_dns_cache_find(const char *hostname)
+{
+    uint8_t i;
+
+    for (i = 0; i < WIFI_DNS_CACHE_NUM; i++) {
+        if (g_dns_cache[i].boot == g_wifi_boots && '\0' != g_dns_cache[i].host[0]
+            && 0 == strcmp(g_dns_cache[i].host, hostname)) {
+            return &g_dns_cache[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* called with g_wifi_mutex held */
+static void wifi_dns_cache_put(const char *hostname, uint32_t ipaddr)
+{
+    uint8_t         i;
+    wifi_dns_entry *pentry;
+
+    if (strlen(hostname) >= WIFI_DNS_CACHE_HOST_LEN) {
+        return;
+    }
+
+    /* the entry of the host, else a free one, else the oldest */
+    pentry = wifi_dns_cache_find(hostname);
+    if (NULL == pentry) {
+        pentry = &g_dns_cache[0];
+        for (i = 0; i < WIFI_DNS_CACHE_NUM; i++) {
+            if (g_dns_cache[i].boot != g_wifi_boots || '\0' == g_dns_cache[i].host[0]) {
+                pentry = &g_dns_cache[i];
+                break;
+            }
+            if (g_dns_cache[i].time < pentry->time) {
+                pentry = &g_dns_cache[i];
+            }
+        }
+    }
+
+    strcpy(pentry->host, hostname);
+    pentry->ipaddr = ipaddr;
+    pentry->boot = g_wifi_boots;
+    pentry->time = HAL_UptimeMs();
+}
+
+static bool wifi_dns_cache_get(const char *hostname, uint32_t *p_ipaddr)
+{
+    wifi_dns_entry *pentry;
+    bool            found = false;
+
+    HAL_MutexLock(g_wifi_mutex);
+    pentry = wifi_dns_cache_find(hostname);
+    if (NULL != pentry) {
+        if (HAL_UptimeMs() - pentry->time < WIFI_DNS_CACHE_MS) {
+            *p_ipaddr = pentry->ipaddr;
+            g_dns_hits++;
+            found = true;
+        } else {
+            pentry->host[0] = '\0';
+        }
+    }
+    HAL_MutexUnlock(g_wifi_mutex);
+
+    return found;
+}
+
+static void wifi_dns_cache_drop(const char *hostname)
+{
+    wifi_dns_entry *pentry;
+
+    HAL_MutexLock(g_wifi_mutex);
+    pentry = wifi_dns_cache_find(hostname);
+    if (NULL != pentry) {
+        pentry->host[0] = '\0';
+    }
+    HAL_MutexUnlock(g_wifi_mutex);
+}
+
 int wifi_hostname_resolve(const char *hostname, uint32_t *p_ipaddr)
 {
     int      ret = WLAN_ERR_NONE;
@@ -1459,7 +1766,9 @@ int wifi_hostname_resolve(const char *hostname, uint32_t *p_ipaddr)
                                                             (*p_ipaddr >> 8) & 0xFF, 
                                                             (*p_ipaddr >> 16) & 0xFF, 
                                                             (*p_ipaddr >> 24) & 0xFF);
+        wifi_dns_cache_put(hostname, *p_ipaddr);
     }
+    g_dns_resolves++;
 
     HAL_MutexUnlock(g_wifi_mutex);
     return ret;
@@ -1494,24 +1803,50 @@ int wifi_tcpip_tcp_connect_byip(uint32_t ipaddr, uint16_t port, uint8_t *pendpoi
     return ret;
 }
 
-int wifi_tcpip_tcp_connect_byhostname(const char *phostname, uint16_t port, uint8_t *pendpoint)
+/* module tcpip errors and timeouts, the ones a wrong address gives */
+static bool wifi_connect_error_is_tcpip(int err)
+{
+    return WLAN_ERR_TIMEOUT == err || (err >= wifi_errspc_tcpip && err < wifi_errspc_hardware);
+}
+
+/* a cached address is tried first, a connect to it that fails with a tcpip error resolves the host again */
+static int wifi_tcpip_connect_byhostname(const char *phostname, uint16_t port, uint8_t *pendpoint,
+                                         int (*connect_byip)(uint32_t, uint16_t, uint8_t *))
 {
     int      ret;
     uint32_t ipaddr;
 
+    if (wifi_dns_cache_get(phostname, &ipaddr)) {
+        ret = connect_byip(ipaddr, port, pendpoint);
+        if (0 == ret) {
+            return 0;
+        }
+        WiFi_TracePrintln("connect to cached address of %s failed %d", phostname, ret);
+        if (!wifi_connect_error_is_tcpip(ret)) {
+            return ret;
+        }
+        wifi_dns_cache_drop(phostname);
+    }
+
     ret = wifi_hostname_resolve(phostname, &ipaddr);
     if (0 != ret) {
         return ret;
     }
 
-    ret = wifi_tcpip_tcp_connect_byip(ipaddr, port, pendpoint);
+    ret = connect_byip(ipaddr, port, pendpoint);
     if (0 != ret) {
+        wifi_dns_cache_drop(phostname);
         return ret;
     }
 
     return 0;
 }
 
+int wifi_tcpip_tcp_connect_byhostname(const char *phostname, uint16_t port, uint8_t *pendpoint)
+{
+    return wifi_tcpip_connect_byhostname(phostname, port, pendpoint, wifi_tcpip_tcp_connect_byip);
+}
+
 int wifi_tcpip_disconnect(uint8_t endpoint)
 {
     int      ret = WLAN_ERR_NONE;
@@ -1650,26 +1985,135 @@ int wifi_tcpip_read(uint8_t endpoint, uint8_t *pdata, int len, int timeout_ms)
     return cnt;
 }
 
+/*
+ * must be called with g_recv_mutex held
+ */
+static uint8_t wifi_endpoint_has_data(uint8_t endpoint)
+{
+    uint8_t  i;
+    uint16_t offset = 0;
+    wifi_udpunit_hdr *punit = NULL;
+
+    for (i = 0; i < MAX_EP_SIMULTANEOUS_NUM; i++) {
+        if (true == g_wifi_ep_state[i].used && endpoint == g_wifi_ep_state[i].endpoint) {
+            return g_wifi_ep_state[i].rx_len > 0;
+        }
+    }
+
+    while (offset + sizeof(wifi_udpunit_hdr) < sizeof(g_udp_data_buf)) {
+        punit = (wifi_udpunit_hdr *)&g_udp_data_buf[offset];
+        if (punit->magic != UDP_DATA_UNIT_MAGIC) {
+            break;
+        }
+        if (punit->endpoint == endpoint) {
+            return true;
+        }
+
+        offset += sizeof(wifi_udpunit_hdr) + punit->unit_len;
+    }
+
+    return false;
+}
+
+/*
+ * Wait until one of the endpoints has data queued, TCP/TLS stream or UDP
+ * datagram. Returns a mask of the ready ones, bit i for endpoints[i], 0 on
+ * timeout. Only one task is expected to wait here at a time.
+ */
+int wifi_endpoint_wait(const uint8_t *endpoints, int count, int timeout_ms)
+{
+    int      ready = 0;
+    int      i;
+    uint64_t start;
+    uint64_t elapsed;
+    RTOS_ERR err;
+
+    start = HAL_UptimeMs();
+    while (1) {
+        HAL_MutexLock(g_recv_mutex);
+        for (i = 0; i < count && i < 32; i++) {
+            if (wifi_endpoint_has_data(endpoints[i])) {
+                ready |= 1 << i;
+            }
+        }
+        HAL_MutexUnlock(g_recv_mutex);
+
+        if (0 != ready) {
+            break;
+        }
+
+        elapsed = HAL_UptimeMs() - start;
+        if (elapsed >= timeout_ms) {
+            break;
+        }
+
+        OSSemPend(&g_ep_rx_sem, WIFI_MS_TO_TICK(timeout_ms - elapsed), OS_OPT_PEND_BLOCKING, NULL, &err);
+    }
+
+    return ready;
+}
+
+/*
+ * Session of a connected endpoint, 0 when it is down. The module gives the
+ * number of a closed endpoint to the next connection, the session tells the
+ * two apart.
+ */
+uint32_t wifi_endpoint_session(uint8_t endpoint)
+{
+    uint32_t session = 0;
+    uint8_t  i;
+
+    HAL_MutexLock(g_recv_mutex);
+    for (i = 0; i < MAX_EP_SIMULTANEOUS_NUM; i++) {
+        if (true == g_wifi_ep_state[i].used && endpoint == g_wifi_ep_state[i].endpoint) {
+            session = g_wifi_ep_state[i].session;
+            break;
+        }
+    }
+    HAL_MutexUnlock(g_recv_mutex);
+
+    return session;
+}
+
+/* the module keeps the certificate until it reboots, the same one is not sent again */
 int wifi_tls_set_user_cert(const char *pcert)
 {
     int      ret = WLAN_ERR_NONE;
+    uint32_t len = strlen(pcert);
+    uint32_t hash = 2166136261u;    /* FNV-1a */
+    uint32_t i;
 
     if (!wifi_is_connected()) {
         WiFi_ErrPrintln("Wifi not connected");
         return WLAN_ERR_HW;
     }
+
+    for (i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)pcert[i]) * 16777619u;
+    }
     
     HAL_MutexLock(g_wifi_mutex);
 
+    if (g_tls_cert.boot == g_wifi_boots && g_tls_cert.len == len && g_tls_cert.hash == hash) {
+        g_tls_cert_skips++;
+        HAL_MutexUnlock(g_wifi_mutex);
+        return WLAN_ERR_NONE;
+    }
+
     wifi_oper_ctrl.type = WLAN_OPER_TLS_SET_CERT;
     wifi_oper_ctrl.error = WLAN_ERR_NONE;
     wifi_oper_ctrl.done = false;
-    wifi_cmd_tcpip_tls_set_user_certificate(strlen(pcert), pcert);
+    wifi_cmd_tcpip_tls_set_user_certificate(len, pcert);
 
     ret = wifi_sync_wait_done(WIFI_DEFAULT_TIMEOUT);
     if (WLAN_ERR_TIMEOUT != ret) {
         ret = wifi_oper_ctrl.error;
     }
+
+    g_tls_cert.boot = g_wifi_boots;
+    g_tls_cert.len = (WLAN_ERR_NONE == ret) ? len : 0;
+    g_tls_cert.hash = hash;
+    g_tls_cert_uploads++;
     
     HAL_MutexUnlock(g_wifi_mutex);
     return ret;
@@ -1711,6 +2155,7 @@ int wifi_tcpip_tls_connect_byip(uint32_t ipaddr, uint16_t port, uint8_t *pendpoi
     
     HAL_MutexLock(g_wifi_mutex);
 
+    g_tls_peer_seen = false;
     wifi_oper_ctrl.type = WLAN_OPER_TLS_CONNECT;
     wifi_oper_ctrl.error = WLAN_ERR_NONE;
     wifi_oper_ctrl.done = false;
@@ -1721,6 +2166,12 @@ int wifi_tcpip_tls_connect_byip(uint32_t ipaddr, uint16_t port, uint8_t *pendpoi
         ret = wifi_oper_ctrl.error;
     }
 
+    /* the server certificate came in, so the TCP connect worked and the handshake failed */
+    if (WLAN_ERR_NONE != ret && g_tls_peer_seen) {
+        WiFi_ErrPrintln("tls handshake failed %d", ret);
+        ret = WLAN_ERR_TLS;
+    }
+
     if (WLAN_ERR_NONE == ret) {
         *pendpoint = *(uint8_t *)wifi_oper_ctrl.output;
     }
@@ -1731,20 +2182,7 @@ int wifi_tcpip_tls_connect_byip(uint32_t ipaddr, uint16_t port, uint8_t *pendpoi
 
 int wifi_tcpip_tls_connect_byhostname(const char *phostname, uint16_t port, uint8_t *pendpoint)
 {
-    int      ret;
-    uint32_t ipaddr;
-
-    ret = wifi_hostname_resolve(phostname, &ipaddr);
-    if (0 != ret) {
-        return ret;
-    }
-
-    ret = wifi_tcpip_tls_connect_byip(ipaddr, port, pendpoint);
-    if (0 != ret) {
-        return ret;
-    }
-
-    return 0;
+    return wifi_tcpip_connect_byhostname(phostname, port, pendpoint, wifi_tcpip_tls_connect_byip);
 }
 
 int wifi_udp_listen(uint16_t port, uint8_t *p_endpoint)
@@ -1778,25 +2216,90 @@ int wifi_udp_listen(uint16_t port, uint8_t *p_endpoint)
     return ret;
 }
 
+/*
+ * Read one datagram, blocks on the udp rx semaphore until a datagram is
+ * enqueued, wifi_udp_read_wakeup() is called or timeout_ms elapses.
+ */
 int wifi_udp_read(uint8_t endpoint, uint8_t *pdata, int len, int timeout_ms, UDP_Addr *psrc)
 {
     int      cnt = 0;
     uint64_t start;
+    uint64_t elapsed;
+    RTOS_ERR err;
 
     start = HAL_UptimeMs();
-    while (cnt < len) {
-        cnt += wifi_udpdata_dequeue(endpoint, pdata + cnt, len - cnt, &(psrc->ipaddr), &(psrc->port));
+    while (1) {
+        cnt = wifi_udpdata_dequeue(endpoint, pdata, len, &(psrc->ipaddr), &(psrc->port));
+        if (cnt > 0) {
+            break;
+        }
 
-        if (HAL_UptimeMs() - start > timeout_ms) {
+        if (true == g_udp_rx_wakeup) {
+            g_udp_rx_wakeup = false;
             break;
-        } else {
-            HAL_SleepMs(1);
         }
+
+        elapsed = HAL_UptimeMs() - start;
+        if (elapsed >= timeout_ms) {
+            break;
+        }
+
+        OSSemPend(&g_udp_rx_sem, WIFI_MS_TO_TICK(timeout_ms - elapsed), OS_OPT_PEND_BLOCKING, NULL, &err);
+    }
+
+    return cnt;
+}
+
+/*
+ * Same as wifi_udp_read() but without copying, *ppdata points at the datagram
+ * inside the rx queue and stays valid until wifi_udp_read_release().
+ */
+int wifi_udp_read_borrow(uint8_t endpoint, uint8_t **ppdata, int timeout_ms, UDP_Addr *psrc)
+{
+    int      cnt = 0;
+    uint64_t start;
+    uint64_t elapsed;
+    RTOS_ERR err;
+
+    (void)endpoint;
+
+    start = HAL_UptimeMs();
+    while (1) {
+        cnt = wifi_udpdata_peek(ppdata, &(psrc->ipaddr), &(psrc->port));
+        if (cnt > 0) {
+            break;
+        }
+
+        if (true == g_udp_rx_wakeup) {
+            g_udp_rx_wakeup = false;
+            break;
+        }
+
+        elapsed = HAL_UptimeMs() - start;
+        if (elapsed >= timeout_ms) {
+            break;
+        }
+
+        OSSemPend(&g_udp_rx_sem, WIFI_MS_TO_TICK(timeout_ms - elapsed), OS_OPT_PEND_BLOCKING, NULL, &err);
     }
 
     return cnt;
 }
 
+void wifi_udp_read_release(uint8_t endpoint)
+{
+    (void)endpoint;
+    wifi_udpdata_release();
+}
+
+void wifi_udp_read_wakeup()
+{
+    RTOS_ERR err;
+
+    g_udp_rx_wakeup = true;
+    OSSemPost(&g_udp_rx_sem, OS_OPT_POST_1, &err);
+}
+
 int wifi_udp_connect(uint32_t ipaddr, uint16_t port, uint8_t *p_endpoint, int timeout_ms)
 {
     int      ret = WLAN_ERR_NONE;
@@ -17,6 +17,7 @@ typedef enum
     WLAN_ERR_HW = -4,
     WLAN_ERR_GEN = -5,
     WLAN_ERR_PARA = -6,
+    WLAN_ERR_TLS = -7,
 }WLAN_ERRCODE;
 
 #define MAX_WIFI_SSID_LEN   32
@@ -28,6 +29,31 @@ typedef struct
     uint16_t port;
 }UDP_Addr;
 
+#define MAX_EP_SIMULTANEOUS_NUM 2
+
+typedef struct
+{
+    uint8_t   used;
+    uint8_t   endpoint;
+    uint16_t  rx_len;           /* bytes waiting in the endpoint rx buffer */
+    uint16_t  rx_size;
+    uint16_t  rx_high_water;
+    uint32_t  rx_drops;         /* bytes lost on a full rx buffer */
+}WiFi_EpStats;
+
+typedef struct
+{
+    WiFi_EpStats ep[MAX_EP_SIMULTANEOUS_NUM];
+    uint16_t  udp_used;         /* bytes queued in the UDP buffer, unit headers included */
+    uint16_t  udp_size;
+    uint16_t  udp_high_water;
+    uint32_t  udp_drops;        /* datagrams lost on a full UDP buffer */
+    uint32_t  dns_hits;         /* connects that reused a resolved address */
+    uint32_t  dns_resolves;
+    uint32_t  tls_cert_uploads;
+    uint32_t  tls_cert_skips;   /* the module already held the certificate */
+}WiFi_Stats;
+
 int wifi_init();
 int wifi_connect(const char *pssid, const char *ppasswd, int timeout_ms);
 int wifi_connect_withsaveddata(int timeout_ms);
@@ -35,12 +61,17 @@ int wifi_tcpip_tcp_connect_byhostname(const char *phostname, uint16_t port, uint
 int wifi_tcpip_tls_connect_byhostname(const char *phostname, uint16_t port, uint8_t *pendpoint);
 int wifi_tcpip_write(uint8_t endpoint, uint8_t *pdata, int len, int timeout_ms);
 int wifi_tcpip_read(uint8_t endpoint, uint8_t *pdata, int len, int timeout_ms);
+int wifi_endpoint_wait(const uint8_t *endpoints, int count, int timeout_ms);
+uint32_t wifi_endpoint_session(uint8_t endpoint);
 int wifi_tcpip_disconnect(uint8_t endpoint);
 uint32_t wifi_get_local_ipaddr();
 int wifi_get_local_mac(uint8_t mac[6]);
 int wifi_tcpip_multicast_join(uint32_t ipaddr);
 int wifi_udp_listen(uint16_t port, uint8_t *p_endpoint);
 int wifi_udp_read(uint8_t endpoint, uint8_t *pdata, int len, int timeout_ms, UDP_Addr *psrc);
+int wifi_udp_read_borrow(uint8_t endpoint, uint8_t **ppdata, int timeout_ms, UDP_Addr *psrc);
+void wifi_udp_read_release(uint8_t endpoint);
+void wifi_udp_read_wakeup();
 int wifi_udp_write(uint8_t endpoint, uint8_t *pdata, int len, int timeout_ms, UDP_Addr *premote);
 int wifi_tcpip_udp_close(uint8_t endpoint);
 int wifi_tls_set_user_cert(const char *pcert);
@@ -50,6 +81,7 @@ int wifi_stop_ap();
 bool wifi_is_ssid_valid();
 int wifi_erase_alldata();
 bool wifi_is_connected();
+int wifi_get_stats(WiFi_Stats *pstats);
 
 
 #endif /* WIFI_WGM110_H_ */